@@ -0,0 +1,64 @@
+#ifndef ASLAM_CAMERAS_BEARING_LOOKUP_TABLE_H_
+#define ASLAM_CAMERAS_BEARING_LOOKUP_TABLE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <aslam/common/macros.h>
+
+namespace aslam {
+
+// Forward declarations.
+class Camera;
+
+/// \class BearingLookupTable
+/// \brief Precomputed bearing vectors of a camera on a regular pixel grid.
+///
+/// The grid nodes are placed on every subsampling-th pixel and hold the bearing vector
+/// returned by the exact back-projection of the camera, stored as floats. Queries in between
+/// the nodes are answered by bilinear interpolation. The table does not track changes of the
+/// camera calibration, the camera drops its table when the calibration can change.
+class BearingLookupTable {
+ public:
+  ASLAM_POINTER_TYPEDEFS(BearingLookupTable);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(BearingLookupTable);
+
+  /// \brief Build the table by back-projecting the grid nodes with the camera model.
+  /// @param[in] camera      The camera to tabulate.
+  /// @param[in] subsampling Distance between the grid nodes in pixels. 1 is a dense table.
+  BearingLookupTable(const Camera& camera, int subsampling);
+
+  /// \brief Interpolate the bearing vector of a keypoint.
+  /// @param[in]  keypoint     Keypoint in image coordinates.
+  /// @param[out] out_point_3d Interpolated bearing vector.
+  /// @return False if the keypoint is not covered by the table or if one of the
+  ///         surrounding nodes could not be back-projected.
+  bool lookup(const Eigen::Ref<const Eigen::Vector2d>& keypoint,
+              Eigen::Vector3d* out_point_3d) const;
+
+  /// \brief Distance between the grid nodes in pixels.
+  int getSubsampling() const {
+    return subsampling_;
+  }
+
+  /// \brief Returns the memory used by the table in bytes.
+  size_t getMemoryFootprintBytes() const;
+
+ private:
+  const int subsampling_;
+  const uint32_t image_width_;
+  const uint32_t image_height_;
+
+  int num_cols_;
+  int num_rows_;
+  /// Bearing vectors of the grid nodes (x, y, z), stored row-major.
+  std::vector<float> bearings_;
+  /// Did the back-projection succeed for the grid node?
+  std::vector<unsigned char> is_valid_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_BEARING_LOOKUP_TABLE_H_
@@ -3,6 +3,7 @@
 
 #include <aslam/cameras/camera.h>
 #include <aslam/cameras/distortion.h>
+#include <aslam/cameras/lidar-angle-table.h>
 #include <aslam/common/crtp-clone.h>
 #include <aslam/common/macros.h>
 #include <aslam/common/types.h>
@@ -78,6 +79,46 @@ class Camera3DLidar : public aslam::Cloneable<Camera, Camera3DLidar> {
       const Eigen::Ref<const Eigen::Vector2d>& keypoint,
       Eigen::Vector3d* out_point_3d) const;
 
+  // Get the overloaded vectorized methods from base into scope.
+  using Camera::backProject3Vectorized;
+  using Camera::project3Vectorized;
+
+  /// \brief Compute the unit bearing vectors of a list of keypoints. The sines and cosines
+  ///        of the beam angles are taken from a \ref LidarAngleTable, which is built on first
+  ///        use and rebuilt whenever the intrinsics change.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_points_3d Unit bearing vectors in euclidean coordinates.
+  /// @param[out] out_success   Were the projections successful? Always true.
+  virtual void backProject3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+      Eigen::Matrix3Xd* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+
+  /// \brief Projects a matrix of euclidean points to 2d image measurements. The angles are
+  ///        estimated by a fast approximation and refined exactly around the closest entry
+  ///        of a \ref LidarAngleTable.
+  /// @param[in]  points_3d     The points in euclidean coordinates.
+  /// @param[out] out_keypoints The keypoints in image coordinates.
+  /// @param[out] out_results   Contains information about the success of the
+  ///                           projections. Check \ref ProjectionResult for
+  ///                           more information.
+  virtual void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Creates a dense range image from a sweep of points. Every point is projected
+  ///        and stored in the pixel containing its keypoint. If several points fall into
+  ///        the same pixel, the closest one is kept.
+  /// @param[in]  points_3d         The points of the sweep in euclidean coordinates.
+  /// @param[out] out_range_image   The range of the point in each pixel, imageHeight() x
+  ///                               imageWidth(). Zero for pixels without a point.
+  /// @param[out] out_point_indices Optional, the index of the point in each pixel. -1 for
+  ///                               pixels without a point. nullptr: skipped.
+  void createRangeImage(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::MatrixXf* out_range_image, Eigen::MatrixXi* out_point_indices) const;
+
   /// \brief Checks the success of a projection operation and returns the result
   /// in a
   ///        ProjectionResult object.
@@ -281,6 +322,11 @@ class Camera3DLidar : public aslam::Cloneable<Camera, Camera3DLidar> {
     return LineDelayMode::kColumns;
   }
 
+ protected:
+  /// \brief Bounds the field of view to the band of elevations covered by the image rows.
+  ///        The lidar covers all azimuths, hence there is no horizontal bound.
+  virtual void computeFieldOfViewBound(FieldOfViewBound* bound) const;
+
  private:
   /// \brief Minimal depth for a valid projection.
   static const double kSquaredMinimumDepth;
@@ -288,6 +334,14 @@ class Camera3DLidar : public aslam::Cloneable<Camera, Camera3DLidar> {
   bool isValidImpl() const override;
   void setRandomImpl() override;
   bool isEqualImpl(const Sensor& other, const bool verbose) const override;
+
+  /// \brief Returns the angle table for the current intrinsics, (re)builds it if it is
+  ///        missing or outdated.
+  LidarAngleTable::ConstPtr getAngleTable() const;
+
+  /// \brief Lazily built table of the beam angles. Accessed atomically and shared between
+  ///        clones as the table itself is immutable.
+  mutable LidarAngleTable::ConstPtr angle_table_;
 };
 
 }  // namespace aslam
@@ -0,0 +1,466 @@
+#ifndef ASLAM_CAMERAS_CAMERA_MODEL_INL_H_
+#define ASLAM_CAMERAS_CAMERA_MODEL_INL_H_
+
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace internal {
+// Same as the minimum depth of the pinhole and unified projection cameras.
+constexpr double kCameraModelMinimumDepth = 1e-10;
+
+inline bool isKeypointInImageBox(const Eigen::Vector2d& keypoint, uint32_t image_width,
+                                 uint32_t image_height) {
+  return keypoint[0] >= 0.0 && keypoint[1] >= 0.0 &&
+      keypoint[0] < static_cast<double>(image_width) &&
+      keypoint[1] < static_cast<double>(image_height);
+}
+}  // namespace internal
+
+template <typename DerivedCoefficients>
+inline void DistortionKernel<NullDistortion>::distort(
+    const Eigen::MatrixBase<DerivedCoefficients>& /*coefficients*/,
+    const Eigen::Vector2d& point, Eigen::Vector2d* out_point,
+    Eigen::Matrix2d* out_jacobian_point,
+    Eigen::Matrix<double, 2, kNumOfParams>* /*out_jacobian_coefficients*/) {
+  *out_point = point;
+  if (out_jacobian_point) {
+    out_jacobian_point->setIdentity();
+  }
+}
+
+template <typename DerivedCoefficients>
+inline void DistortionKernel<RadTanDistortion>::distort(
+    const Eigen::MatrixBase<DerivedCoefficients>& coefficients,
+    const Eigen::Vector2d& point, Eigen::Vector2d* out_point,
+    Eigen::Matrix2d* out_jacobian_point,
+    Eigen::Matrix<double, 2, kNumOfParams>* out_jacobian_coefficients) {
+  const double k1 = coefficients[0];
+  const double k2 = coefficients[1];
+  const double p1 = coefficients[2];
+  const double p2 = coefficients[3];
+  const double x = point[0];
+  const double y = point[1];
+
+  const double mx2_u = x * x;
+  const double my2_u = y * y;
+  const double mxy_u = x * y;
+  const double rho2_u = mx2_u + my2_u;
+  const double rad_dist_u = k1 * rho2_u + k2 * rho2_u * rho2_u;
+
+  if (out_jacobian_point) {
+    const double duf_du =   1.0 + rad_dist_u
+                          + 2.0 * k1 * mx2_u
+                          + 4.0 * k2 * rho2_u * mx2_u
+                          + 2.0 * p1 * y
+                          + 6.0 * p2 * x;
+    const double duf_dv =   2.0 * k1 * mxy_u
+                          + 4.0 * k2 * rho2_u * mxy_u
+                          + 2.0 * p1 * x
+                          + 2.0 * p2 * y;
+    const double dvf_dv =   1.0 + rad_dist_u
+                          + 2.0 * k1 * my2_u
+                          + 4.0 * k2 * rho2_u * my2_u
+                          + 2.0 * p2 * x
+                          + 6.0 * p1 * y;
+    (*out_jacobian_point)(0, 0) = duf_du;
+    (*out_jacobian_point)(0, 1) = duf_dv;
+    (*out_jacobian_point)(1, 0) = duf_dv;
+    (*out_jacobian_point)(1, 1) = dvf_dv;
+  }
+
+  if (out_jacobian_coefficients) {
+    const double rho4_u = rho2_u * rho2_u;
+    Eigen::Matrix<double, 2, kNumOfParams>& J = *out_jacobian_coefficients;
+    J(0, 0) = x * rho2_u;
+    J(0, 1) = x * rho4_u;
+    J(0, 2) = 2.0 * mxy_u;
+    J(0, 3) = rho2_u + 2.0 * mx2_u;
+    J(1, 0) = y * rho2_u;
+    J(1, 1) = y * rho4_u;
+    J(1, 2) = rho2_u + 2.0 * my2_u;
+    J(1, 3) = 2.0 * mxy_u;
+  }
+
+  (*out_point)[0] = x + x * rad_dist_u + 2.0 * p1 * mxy_u + p2 * (rho2_u + 2.0 * mx2_u);
+  (*out_point)[1] = y + y * rad_dist_u + 2.0 * p2 * mxy_u + p1 * (rho2_u + 2.0 * my2_u);
+}
+
+template <typename DerivedCoefficients>
+inline void DistortionKernel<EquidistantDistortion>::distort(
+    const Eigen::MatrixBase<DerivedCoefficients>& coefficients,
+    const Eigen::Vector2d& point, Eigen::Vector2d* out_point,
+    Eigen::Matrix2d* out_jacobian_point,
+    Eigen::Matrix<double, 2, kNumOfParams>* out_jacobian_coefficients) {
+  const double k1 = coefficients[0];
+  const double k2 = coefficients[1];
+  const double k3 = coefficients[2];
+  const double k4 = coefficients[3];
+  const Eigen::Vector2d m = point;
+
+  const double r2 = m.squaredNorm();
+  const double r = std::sqrt(r2);
+
+  // Handle special case around image center.
+  if (r < 1e-10) {
+    *out_point = m;
+    if (out_jacobian_point) {
+      out_jacobian_point->setIdentity();
+    }
+    if (out_jacobian_coefficients) {
+      out_jacobian_coefficients->setZero();
+    }
+    return;
+  }
+
+  // The distortion is radial: d(m) = s(r) * m with s(r) = theta_d(theta(r)) / r.
+  const double theta = std::atan(r);
+  const double theta2 = theta * theta;
+  const double theta3 = theta2 * theta;
+  const double theta5 = theta3 * theta2;
+  const double theta7 = theta5 * theta2;
+  const double theta9 = theta7 * theta2;
+  const double thetad = theta + k1 * theta3 + k2 * theta5 + k3 * theta7 + k4 * theta9;
+  const double scaling = thetad / r;
+
+  if (out_jacobian_point) {
+    const double dthetad_dtheta =
+        1.0 + 3.0 * k1 * theta2 + 5.0 * k2 * theta2 * theta2 + 7.0 * k3 * theta3 * theta3 +
+        9.0 * k4 * theta7 * theta;
+    const double dthetad_dr = dthetad_dtheta / (1.0 + r2);
+    *out_jacobian_point = ((dthetad_dr - scaling) / r2) * m * m.transpose();
+    out_jacobian_point->diagonal().array() += scaling;
+  }
+
+  if (out_jacobian_coefficients) {
+    const double inv_r = 1.0 / r;
+    out_jacobian_coefficients->col(0) = (theta3 * inv_r) * m;
+    out_jacobian_coefficients->col(1) = (theta5 * inv_r) * m;
+    out_jacobian_coefficients->col(2) = (theta7 * inv_r) * m;
+    out_jacobian_coefficients->col(3) = (theta9 * inv_r) * m;
+  }
+
+  *out_point = scaling * m;
+}
+
+template <typename DerivedCoefficients>
+inline void DistortionKernel<FisheyeDistortion>::distort(
+    const Eigen::MatrixBase<DerivedCoefficients>& coefficients,
+    const Eigen::Vector2d& point, Eigen::Vector2d* out_point,
+    Eigen::Matrix2d* out_jacobian_point,
+    Eigen::Matrix<double, 2, kNumOfParams>* out_jacobian_coefficients) {
+  const double w = coefficients[0];
+  const Eigen::Vector2d m = point;
+  const double r2 = m.squaredNorm();
+
+  if (w * w < 1e-5) {
+    // Limit w > 0.
+    *out_point = m;
+    if (out_jacobian_point) {
+      out_jacobian_point->setIdentity();
+    }
+    if (out_jacobian_coefficients) {
+      out_jacobian_coefficients->setZero();
+    }
+    return;
+  }
+
+  const double tanwhalf = std::tan(w / 2.0);
+  const double mul2tanwby2 = 2.0 * tanwhalf;
+  double scaling;
+  if (r2 < 1e-5) {
+    // Limit r_u > 0. The coordinates get multiplied by an expression not depending on r_u.
+    scaling = mul2tanwby2 / w;
+    if (out_jacobian_point) {
+      *out_jacobian_point = scaling * Eigen::Matrix2d::Identity();
+    }
+    if (out_jacobian_coefficients) {
+      const double coswhalf = std::cos(w / 2.0);
+      *out_jacobian_coefficients = ((w - std::sin(w)) / (w * w * coswhalf * coswhalf)) * m;
+    }
+  } else {
+    // The distortion is radial: d(m) = s(r, w) * m with s = atan(2 tan(w / 2) r) / (r w).
+    const double r = std::sqrt(r2);
+    const double denominator = 1.0 + mul2tanwby2 * mul2tanwby2 * r2;
+    scaling = std::atan(mul2tanwby2 * r) / (r * w);
+    if (out_jacobian_point) {
+      *out_jacobian_point =
+          ((mul2tanwby2 / (w * denominator) - scaling) / r2) * m * m.transpose();
+      out_jacobian_point->diagonal().array() += scaling;
+    }
+    if (out_jacobian_coefficients) {
+      const double dscaling_dw =
+          (1.0 + tanwhalf * tanwhalf) / (w * denominator) - scaling / w;
+      *out_jacobian_coefficients = dscaling_dw * m;
+    }
+  }
+
+  *out_point = scaling * m;
+}
+
+template <typename DerivedIntrinsics>
+inline bool PinholeProjection::normalize(
+    const Eigen::MatrixBase<DerivedIntrinsics>& /*intrinsics*/, const Eigen::Vector3d& point_3d,
+    Eigen::Vector2d* out_point, Eigen::Matrix<double, 2, 3>* out_jacobian_point,
+    Eigen::Matrix<double, 2, kNumOfProjectionParams>* /*out_jacobian_projection_params*/) {
+  const double x = point_3d[0];
+  const double y = point_3d[1];
+  const double rz = 1.0 / point_3d[2];
+  (*out_point)[0] = x * rz;
+  (*out_point)[1] = y * rz;
+  if (out_jacobian_point) {
+    const double rz2 = rz * rz;
+    Eigen::Matrix<double, 2, 3>& J = *out_jacobian_point;
+    J(0, 0) = rz;
+    J(0, 1) = 0.0;
+    J(0, 2) = -x * rz2;
+    J(1, 0) = 0.0;
+    J(1, 1) = rz;
+    J(1, 2) = -y * rz2;
+  }
+  return true;
+}
+
+inline const ProjectionResult PinholeProjection::evaluateProjectionResult(
+    const Eigen::Vector2d& keypoint, const Eigen::Vector3d& point_3d, uint32_t image_width,
+    uint32_t image_height) {
+  const bool visibility = internal::isKeypointInImageBox(keypoint, image_width, image_height);
+  if (visibility && (point_3d[2] > internal::kCameraModelMinimumDepth))
+    return ProjectionResult(ProjectionResult::Status::KEYPOINT_VISIBLE);
+  else if (!visibility && (point_3d[2] > internal::kCameraModelMinimumDepth))
+    return ProjectionResult(ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX);
+  else if (point_3d[2] < 0.0)
+    return ProjectionResult(ProjectionResult::Status::POINT_BEHIND_CAMERA);
+  else
+    return ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+}
+
+template <typename DerivedIntrinsics>
+inline bool UnifiedProjection::normalize(
+    const Eigen::MatrixBase<DerivedIntrinsics>& intrinsics, const Eigen::Vector3d& point_3d,
+    Eigen::Vector2d* out_point, Eigen::Matrix<double, 2, 3>* out_jacobian_point,
+    Eigen::Matrix<double, 2, kNumOfProjectionParams>* out_jacobian_projection_params) {
+  const double xi = intrinsics[0];
+  const double x = point_3d[0];
+  const double y = point_3d[1];
+  const double z = point_3d[2];
+
+  const double d = point_3d.norm();
+  const double rz = 1.0 / (z + xi * d);
+
+  // Check if point will lead to a valid projection.
+  const double fov_parameter = (xi <= 1.0) ? xi : (1.0 / xi);
+  if (!(z > -(fov_parameter * d))) {
+    return false;
+  }
+
+  (*out_point)[0] = x * rz;
+  (*out_point)[1] = y * rz;
+
+  if (out_jacobian_point) {
+    Eigen::Matrix<double, 2, 3>& J = *out_jacobian_point;
+    double rz2 = rz * rz / d;
+    J(0, 0) = rz2 * (d * z + xi * (y * y + z * z));
+    J(1, 0) = -rz2 * xi * x * y;
+    J(0, 1) = J(1, 0);
+    J(1, 1) = rz2 * (d * z + xi * (x * x + z * z));
+    rz2 = rz2 * (-xi * z - d);
+    J(0, 2) = x * rz2;
+    J(1, 2) = y * rz2;
+  }
+  if (out_jacobian_projection_params) {
+    (*out_jacobian_projection_params)(0, 0) = -x * rz * d * rz;
+    (*out_jacobian_projection_params)(1, 0) = -y * rz * d * rz;
+  }
+  return true;
+}
+
+inline const ProjectionResult UnifiedProjection::evaluateProjectionResult(
+    const Eigen::Vector2d& keypoint, const Eigen::Vector3d& point_3d, uint32_t image_width,
+    uint32_t image_height) {
+  const bool visibility = internal::isKeypointInImageBox(keypoint, image_width, image_height);
+  const double d2 = point_3d.squaredNorm();
+  const double min_depth2 =
+      internal::kCameraModelMinimumDepth * internal::kCameraModelMinimumDepth;
+  if (visibility && (d2 > min_depth2))
+    return ProjectionResult(ProjectionResult::Status::KEYPOINT_VISIBLE);
+  else if (!visibility && (d2 > min_depth2))
+    return ProjectionResult(ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX);
+  return ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+}
+
+template <typename Projection, typename DistortionType>
+CameraModel<Projection, DistortionType>::CameraModel(
+    const IntrinsicsVector& intrinsics, const DistortionVector& distortion_coefficients,
+    uint32_t image_width, uint32_t image_height)
+    : intrinsics_(intrinsics),
+      distortion_coefficients_(distortion_coefficients),
+      image_width_(image_width),
+      image_height_(image_height) {}
+
+template <typename Projection, typename DistortionType>
+CameraModel<Projection, DistortionType>::CameraModel(const Camera& camera)
+    : image_width_(camera.imageWidth()),
+      image_height_(camera.imageHeight()) {
+  CHECK(isCompatible(camera)) << "The camera does not match the model.";
+  const Eigen::VectorXd& intrinsics = camera.getParameters();
+  const Eigen::VectorXd& distortion_coefficients = camera.getDistortion().getParameters();
+  CHECK_EQ(intrinsics.size(), kNumOfIntrinsics) << "intrinsics: invalid size!";
+  CHECK_EQ(distortion_coefficients.size(), kNumOfDistortionParams)
+      << "dist_coeffs: invalid size!";
+  intrinsics_ = intrinsics;
+  distortion_coefficients_ = distortion_coefficients;
+}
+
+template <typename Projection, typename DistortionType>
+bool CameraModel<Projection, DistortionType>::isCompatible(const Camera& camera) {
+  return camera.getType() == Projection::type() &&
+      camera.getDistortion().getType() == DistortionKernel<DistortionType>::type();
+}
+
+template <typename Projection, typename DistortionType>
+inline const ProjectionResult CameraModel<Projection, DistortionType>::project3(
+    const Eigen::Vector3d& point_3d, Eigen::Vector2d* out_keypoint,
+    PointJacobian* out_jacobian_point, IntrinsicsJacobian* out_jacobian_intrinsics,
+    DistortionJacobian* out_jacobian_distortion) const {
+  CHECK_NOTNULL(out_keypoint);
+  if (!project3Functional(intrinsics_, distortion_coefficients_, point_3d, out_keypoint,
+                          out_jacobian_point, out_jacobian_intrinsics,
+                          out_jacobian_distortion)) {
+    return ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+  }
+  return Projection::evaluateProjectionResult(*out_keypoint, point_3d, image_width_,
+                                              image_height_);
+}
+
+template <typename Projection, typename DistortionType>
+template <typename DerivedIntrinsics, typename DerivedDistortion>
+inline bool CameraModel<Projection, DistortionType>::project3Functional(
+    const Eigen::MatrixBase<DerivedIntrinsics>& intrinsics,
+    const Eigen::MatrixBase<DerivedDistortion>& distortion_coefficients,
+    const Eigen::Vector3d& point_3d, Eigen::Vector2d* out_keypoint,
+    PointJacobian* out_jacobian_point, IntrinsicsJacobian* out_jacobian_intrinsics,
+    DistortionJacobian* out_jacobian_distortion) {
+  EIGEN_STATIC_ASSERT_VECTOR_SPECIFIC_SIZE(DerivedIntrinsics, kNumOfIntrinsics);
+  enum { kOffset = Projection::kNumOfProjectionParams };
+  const double fu = intrinsics[kOffset];
+  const double fv = intrinsics[kOffset + 1];
+  const double cu = intrinsics[kOffset + 2];
+  const double cv = intrinsics[kOffset + 3];
+
+  // Project the point onto the normalized image plane.
+  Eigen::Vector2d normalized;
+  Eigen::Matrix<double, 2, 3> J_normalized_point;
+  Eigen::Matrix<double, 2, kOffset> J_normalized_params;
+  const bool need_params_jacobian = out_jacobian_intrinsics != nullptr && kOffset > 0;
+  if (!Projection::normalize(intrinsics, point_3d, &normalized,
+                             out_jacobian_point ? &J_normalized_point : nullptr,
+                             need_params_jacobian ? &J_normalized_params : nullptr)) {
+    out_keypoint->setZero();
+    if (out_jacobian_point) {
+      out_jacobian_point->setZero();
+    }
+    if (out_jacobian_intrinsics) {
+      out_jacobian_intrinsics->setZero();
+    }
+    if (out_jacobian_distortion) {
+      out_jacobian_distortion->setZero();
+    }
+    return false;
+  }
+
+  // Distort the point.
+  Eigen::Vector2d distorted;
+  Eigen::Matrix2d J_distortion;
+  const bool need_distortion_jacobian = out_jacobian_point != nullptr || need_params_jacobian;
+  DistortionKernel<DistortionType>::distort(
+      distortion_coefficients, normalized, &distorted,
+      need_distortion_jacobian ? &J_distortion : nullptr, out_jacobian_distortion);
+  if (out_jacobian_distortion) {
+    out_jacobian_distortion->row(0) *= fu;
+    out_jacobian_distortion->row(1) *= fv;
+  }
+
+  if (need_distortion_jacobian) {
+    J_distortion.row(0) *= fu;
+    J_distortion.row(1) *= fv;
+  }
+  if (out_jacobian_point) {
+    out_jacobian_point->noalias() = J_distortion * J_normalized_point;
+  }
+  if (out_jacobian_intrinsics) {
+    out_jacobian_intrinsics->setZero();
+    if (need_params_jacobian) {
+      out_jacobian_intrinsics->template leftCols<kOffset>().noalias() =
+          J_distortion * J_normalized_params;
+    }
+    (*out_jacobian_intrinsics)(0, kOffset) = distorted[0];
+    (*out_jacobian_intrinsics)(1, kOffset + 1) = distorted[1];
+    (*out_jacobian_intrinsics)(0, kOffset + 2) = 1.0;
+    (*out_jacobian_intrinsics)(1, kOffset + 3) = 1.0;
+  }
+
+  // Normalized image plane to camera plane.
+  (*out_keypoint)[0] = fu * distorted[0] + cu;
+  (*out_keypoint)[1] = fv * distorted[1] + cv;
+  return true;
+}
+
+template <typename Projection, typename DistortionType>
+CameraModelAdapter<Projection, DistortionType>::CameraModelAdapter(const CameraType& camera)
+    : CameraType(camera) {
+  CHECK(Model::isCompatible(camera)) << "The camera does not match the model.";
+}
+
+template <typename Projection, typename DistortionType>
+const ProjectionResult CameraModelAdapter<Projection, DistortionType>::project3Functional(
+    const Eigen::Ref<const Eigen::Vector3d>& point_3d,
+    const Eigen::VectorXd* intrinsics_external,
+    const Eigen::VectorXd* distortion_coefficients_external,
+    Eigen::Vector2d* out_keypoint,
+    Eigen::Matrix<double, 2, 3>* out_jacobian_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian_distortion) const {
+  CHECK_NOTNULL(out_keypoint);
+  const Distortion& distortion = this->getDistortion();
+  // Models with the same number of parameters would otherwise silently run the wrong kernel,
+  // e.g. after the distortion was replaced with setDistortion.
+  CHECK(distortion.getType() == DistortionKernel<DistortionType>::type())
+      << "The distortion of the camera does not match the model.";
+
+  // Use the internal parameters if no external ones are given.
+  const Eigen::VectorXd& intrinsics =
+      intrinsics_external ? *intrinsics_external : this->getParameters();
+  const Eigen::VectorXd& distortion_coefficients =
+      distortion_coefficients_external ? *distortion_coefficients_external
+                                       : distortion.getParameters();
+  CHECK_EQ(intrinsics.size(), Model::kNumOfIntrinsics) << "intrinsics: invalid size!";
+  CHECK_EQ(distortion_coefficients.size(), Model::kNumOfDistortionParams)
+      << "dist_coeffs: invalid size!";
+
+  typedef Eigen::Map<const typename Model::IntrinsicsVector> IntrinsicsMap;
+  typedef Eigen::Map<const typename Model::DistortionVector> DistortionMap;
+  const Eigen::Vector3d point = point_3d;
+  typename Model::IntrinsicsJacobian J_intrinsics;
+  typename Model::DistortionJacobian J_distortion;
+  const bool valid = Model::project3Functional(
+      IntrinsicsMap(intrinsics.data()), DistortionMap(distortion_coefficients.data()), point,
+      out_keypoint, out_jacobian_point, out_jacobian_intrinsics ? &J_intrinsics : nullptr,
+      out_jacobian_distortion ? &J_distortion : nullptr);
+  if (out_jacobian_intrinsics) {
+    *out_jacobian_intrinsics = J_intrinsics;
+  }
+  if (out_jacobian_distortion) {
+    *out_jacobian_distortion = J_distortion;
+  }
+  if (!valid) {
+    return ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+  }
+  return Projection::evaluateProjectionResult(*out_keypoint, point, this->imageWidth(),
+                                              this->imageHeight());
+}
+
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_CAMERA_MODEL_INL_H_
@@ -0,0 +1,270 @@
+#ifndef ASLAM_CAMERAS_CAMERA_MODEL_H_
+#define ASLAM_CAMERAS_CAMERA_MODEL_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <aslam/cameras/camera.h>
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-null.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/macros.h>
+
+namespace aslam {
+
+//////////////////////////////////////////////////////////////
+/// \name Distortion kernels
+/// Statically dispatched distortion functions with fixed-size Jacobians. The math is the
+/// same as in the virtual distortion classes.
+/// @{
+
+/// \brief Distortion kernel of a distortion model. Specialized for all distortion models.
+template <typename DistortionType>
+struct DistortionKernel;
+
+template <>
+struct DistortionKernel<NullDistortion> {
+  enum { kNumOfParams = NullDistortion::kNumOfParams };
+  static Distortion::Type type() { return Distortion::Type::kNoDistortion; }
+
+  template <typename DerivedCoefficients>
+  static void distort(const Eigen::MatrixBase<DerivedCoefficients>& coefficients,
+                      const Eigen::Vector2d& point, Eigen::Vector2d* out_point,
+                      Eigen::Matrix2d* out_jacobian_point,
+                      Eigen::Matrix<double, 2, kNumOfParams>* out_jacobian_coefficients);
+};
+
+template <>
+struct DistortionKernel<RadTanDistortion> {
+  enum { kNumOfParams = RadTanDistortion::kNumOfParams };
+  static Distortion::Type type() { return Distortion::Type::kRadTan; }
+
+  template <typename DerivedCoefficients>
+  static void distort(const Eigen::MatrixBase<DerivedCoefficients>& coefficients,
+                      const Eigen::Vector2d& point, Eigen::Vector2d* out_point,
+                      Eigen::Matrix2d* out_jacobian_point,
+                      Eigen::Matrix<double, 2, kNumOfParams>* out_jacobian_coefficients);
+};
+
+template <>
+struct DistortionKernel<EquidistantDistortion> {
+  enum { kNumOfParams = EquidistantDistortion::kNumOfParams };
+  static Distortion::Type type() { return Distortion::Type::kEquidistant; }
+
+  template <typename DerivedCoefficients>
+  static void distort(const Eigen::MatrixBase<DerivedCoefficients>& coefficients,
+                      const Eigen::Vector2d& point, Eigen::Vector2d* out_point,
+                      Eigen::Matrix2d* out_jacobian_point,
+                      Eigen::Matrix<double, 2, kNumOfParams>* out_jacobian_coefficients);
+};
+
+template <>
+struct DistortionKernel<FisheyeDistortion> {
+  enum { kNumOfParams = FisheyeDistortion::kNumOfParams };
+  static Distortion::Type type() { return Distortion::Type::kFisheye; }
+
+  template <typename DerivedCoefficients>
+  static void distort(const Eigen::MatrixBase<DerivedCoefficients>& coefficients,
+                      const Eigen::Vector2d& point, Eigen::Vector2d* out_point,
+                      Eigen::Matrix2d* out_jacobian_point,
+                      Eigen::Matrix<double, 2, kNumOfParams>* out_jacobian_coefficients);
+};
+/// @}
+
+//////////////////////////////////////////////////////////////
+/// \name Projection kernels
+/// Statically dispatched projections onto the normalized image plane. The intrinsics of all
+/// projections end with fu, fv, cu, cv which are preceded by kNumOfProjectionParams
+/// parameters specific to the projection.
+/// @{
+
+/// \brief Pinhole projection. Intrinsic parameters ordering: fu, fv, cu, cv
+struct PinholeProjection {
+  typedef PinholeCamera CameraType;
+  enum {
+    kNumOfParams = 4,
+    kNumOfProjectionParams = 0
+  };
+  static Camera::Type type() { return Camera::Type::kPinhole; }
+
+  /// \brief Project the point onto the normalized image plane.
+  /// @return False if the point can not be projected.
+  template <typename DerivedIntrinsics>
+  static bool normalize(
+      const Eigen::MatrixBase<DerivedIntrinsics>& intrinsics, const Eigen::Vector3d& point_3d,
+      Eigen::Vector2d* out_point, Eigen::Matrix<double, 2, 3>* out_jacobian_point,
+      Eigen::Matrix<double, 2, kNumOfProjectionParams>* out_jacobian_projection_params);
+
+  /// \brief Same evaluation as PinholeCamera::evaluateProjectionResult.
+  static const ProjectionResult evaluateProjectionResult(
+      const Eigen::Vector2d& keypoint, const Eigen::Vector3d& point_3d, uint32_t image_width,
+      uint32_t image_height);
+};
+
+/// \brief Unified projection. Intrinsic parameters ordering: xi, fu, fv, cu, cv
+struct UnifiedProjection {
+  typedef UnifiedProjectionCamera CameraType;
+  enum {
+    kNumOfParams = 5,
+    kNumOfProjectionParams = 1
+  };
+  static Camera::Type type() { return Camera::Type::kUnifiedProjection; }
+
+  /// \brief Project the point onto the normalized image plane.
+  /// @return False if the point can not be projected.
+  template <typename DerivedIntrinsics>
+  static bool normalize(
+      const Eigen::MatrixBase<DerivedIntrinsics>& intrinsics, const Eigen::Vector3d& point_3d,
+      Eigen::Vector2d* out_point, Eigen::Matrix<double, 2, 3>* out_jacobian_point,
+      Eigen::Matrix<double, 2, kNumOfProjectionParams>* out_jacobian_projection_params);
+
+  /// \brief Same evaluation as UnifiedProjectionCamera::evaluateProjectionResult.
+  static const ProjectionResult evaluateProjectionResult(
+      const Eigen::Vector2d& keypoint, const Eigen::Vector3d& point_3d, uint32_t image_width,
+      uint32_t image_height);
+};
+/// @}
+
+/// \class CameraModel
+/// \brief Camera model with the projection and the distortion model fixed at compile time.
+///
+/// All parameter blocks and Jacobians have fixed sizes and no function is virtual, such that
+/// the compiler can inline the full projection including the distortion and all Jacobians.
+/// This is meant for hot loops (e.g. the residuals of a bundle adjustment) that project
+/// millions of points with the same camera type. Masks are not supported.
+///
+/// Example:
+/// @code
+///   CameraModel<PinholeProjection, RadTanDistortion> model(*camera);
+///   model.project3(point_3d, &keypoint, &J_point, &J_intrinsics, &J_distortion);
+/// @endcode
+template <typename Projection, typename DistortionType>
+class CameraModel {
+ public:
+  ASLAM_POINTER_TYPEDEFS(CameraModel);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  enum {
+    kNumOfIntrinsics = Projection::kNumOfParams,
+    kNumOfDistortionParams = DistortionKernel<DistortionType>::kNumOfParams
+  };
+  typedef Eigen::Matrix<double, kNumOfIntrinsics, 1> IntrinsicsVector;
+  typedef Eigen::Matrix<double, kNumOfDistortionParams, 1> DistortionVector;
+  typedef Eigen::Matrix<double, 2, 3> PointJacobian;
+  typedef Eigen::Matrix<double, 2, kNumOfIntrinsics> IntrinsicsJacobian;
+  typedef Eigen::Matrix<double, 2, kNumOfDistortionParams> DistortionJacobian;
+
+  /// \brief Construct the model from its parameters.
+  CameraModel(const IntrinsicsVector& intrinsics, const DistortionVector& distortion_coefficients,
+              uint32_t image_width, uint32_t image_height);
+
+  /// \brief Copy the calibration of a camera. The camera has to be compatible.
+  explicit CameraModel(const Camera& camera);
+
+  /// \brief Returns whether the camera and distortion type of the camera match the model.
+  static bool isCompatible(const Camera& camera);
+
+  /// \brief Project a point and optionally compute the Jacobians using the parameters of the
+  ///        model. See Camera::project3Functional for the definition of the outputs.
+  const ProjectionResult project3(const Eigen::Vector3d& point_3d, Eigen::Vector2d* out_keypoint,
+                                  PointJacobian* out_jacobian_point = nullptr,
+                                  IntrinsicsJacobian* out_jacobian_intrinsics = nullptr,
+                                  DistortionJacobian* out_jacobian_distortion = nullptr) const;
+
+  /// \brief Project a point using external parameters. The keypoint and all requested
+  ///        Jacobians are zero if the projection is invalid.
+  /// @param[in]  intrinsics              Intrinsic parameters (kNumOfIntrinsics).
+  /// @param[in]  distortion_coefficients Distortion coefficients (kNumOfDistortionParams).
+  /// @param[in]  point_3d                The point in camera coordinates.
+  /// @param[out] out_keypoint            The keypoint in image coordinates.
+  /// @param[out] out_jacobian_point      The Jacobian wrt. to the 3d point (optional).
+  /// @param[out] out_jacobian_intrinsics The Jacobian wrt. the intrinsics (optional).
+  /// @param[out] out_jacobian_distortion The Jacobian wrt. the distortion (optional).
+  /// @return False if the point can not be projected.
+  template <typename DerivedIntrinsics, typename DerivedDistortion>
+  static bool project3Functional(
+      const Eigen::MatrixBase<DerivedIntrinsics>& intrinsics,
+      const Eigen::MatrixBase<DerivedDistortion>& distortion_coefficients,
+      const Eigen::Vector3d& point_3d, Eigen::Vector2d* out_keypoint,
+      PointJacobian* out_jacobian_point, IntrinsicsJacobian* out_jacobian_intrinsics,
+      DistortionJacobian* out_jacobian_distortion);
+
+  const IntrinsicsVector& getIntrinsics() const { return intrinsics_; }
+  const DistortionVector& getDistortionCoefficients() const { return distortion_coefficients_; }
+  uint32_t imageWidth() const { return image_width_; }
+  uint32_t imageHeight() const { return image_height_; }
+
+ private:
+  IntrinsicsVector intrinsics_;
+  DistortionVector distortion_coefficients_;
+  uint32_t image_width_;
+  uint32_t image_height_;
+};
+
+/// \class CameraModelAdapter
+/// \brief Type-erased adapter which exposes the CameraModel fast path through the
+///        aslam::Camera interface.
+///
+/// The adapter is a copy of the wrapped camera whose project3Functional is replaced by the
+/// statically dispatched CameraModel kernel. All other functions behave as in the wrapped
+/// camera type. The distortion type must not be changed after construction.
+template <typename Projection, typename DistortionType>
+class CameraModelAdapter : public Projection::CameraType {
+ public:
+  ASLAM_POINTER_TYPEDEFS(CameraModelAdapter);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef typename Projection::CameraType CameraType;
+  typedef CameraModel<Projection, DistortionType> Model;
+
+  /// \brief Copy the camera. Its distortion type has to match DistortionType.
+  explicit CameraModelAdapter(const CameraType& camera);
+  CameraModelAdapter(const CameraModelAdapter& other) = default;
+  void operator=(const CameraModelAdapter&) = delete;
+  virtual ~CameraModelAdapter() {}
+
+  virtual Camera* clone() const override {
+    return new CameraModelAdapter(*this);
+  }
+
+  // Get the overloaded non-virtual project3Functional(..) from base into scope.
+  using CameraType::project3Functional;
+
+  /// \brief Same as Camera::project3Functional, but evaluated by the CameraModel kernel.
+  virtual const ProjectionResult project3Functional(
+      const Eigen::Ref<const Eigen::Vector3d>& point_3d,
+      const Eigen::VectorXd* intrinsics_external,
+      const Eigen::VectorXd* distortion_coefficients_external,
+      Eigen::Vector2d* out_keypoint,
+      Eigen::Matrix<double, 2, 3>* out_jacobian_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian_distortion) const override;
+};
+
+/// \brief Wrap a camera into the CameraModelAdapter matching its camera and distortion type.
+/// @return nullptr if no specialized model exists for the camera.
+Camera::Ptr createCameraModelAdapter(const Camera& camera);
+
+/// \brief Camera::project3FunctionalBatch evaluated by the CameraModel kernel matching the
+///        camera. All Jacobians are computed in fixed-size blocks, hence nothing is allocated
+///        if the outputs already have the required size.
+/// @return False if no specialized model exists for the camera.
+bool project3FunctionalBatchWithCameraModel(
+    const Camera& camera, const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    const Eigen::VectorXd* intrinsics_external,
+    const Eigen::VectorXd* distortion_coefficients_external, Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results);
+
+}  // namespace aslam
+
+#include "camera-model-inl.h"
+
+#endif  // ASLAM_CAMERAS_CAMERA_MODEL_H_
@@ -3,6 +3,7 @@
 
 #include <aslam/cameras/camera.h>
 #include <aslam/cameras/distortion.h>
+#include <aslam/cameras/inverse-distortion-grid.h>
 #include <aslam/common/crtp-clone.h>
 #include <aslam/common/macros.h>
 #include <aslam/common/types.h>
@@ -116,6 +117,50 @@ class PinholeCamera : public aslam::Cloneable<Camera, PinholeCamera> {
   virtual bool backProject3(const Eigen::Ref<const Eigen::Vector2d>& keypoint,
                             Eigen::Vector3d* out_point_3d) const;
 
+  /// \brief Compute the 3d bearing vectors in euclidean coordinates given a list of
+  ///        keypoints in image coordinates. Uses the projection (& distortion) models.
+  ///
+  /// All keypoints are undistorted at once. Distortion models without a closed-form inverse
+  /// use an \ref InverseDistortionGrid which is built on first use and rebuilt whenever the
+  /// intrinsics or the distortion change. If enabled, the bearing lookup table is used instead.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_point_3ds Bearing vectors in euclidean coordinates (with
+  ///                           z=1 -> non-normalized).
+  /// @param[out] out_success   Were the projections successful?
+  virtual void backProject3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+      Eigen::Matrix3Xd* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+
+  /// \brief Single-precision version of backProject3Vectorized. Models without a closed-form
+  ///        inverse are refined in double precision. If enabled, the bearing lookup table
+  ///        is queried in double precision.
+  virtual void backProject3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+      Eigen::Matrix3Xf* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+
+  /// \brief Projects a matrix of euclidean points to 2d image measurements. Applies the
+  ///        projection (& distortion) models to the points.
+  ///
+  /// The whole block is processed at once: the points are normalized into separate coordinate
+  /// arrays (structure-of-arrays) which are distorted in a single call to the distortion model.
+  /// @param[in]  points_3d     The points in euclidean coordinates.
+  /// @param[out] out_keypoints The keypoints in image coordinates.
+  /// @param[out] out_results   Contains information about the success of the
+  ///                           projections. Check \ref ProjectionResult for
+  ///                           more information.
+  virtual void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      Eigen::Matrix2Xd* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Single-precision version of project3Vectorized.
+  virtual void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+      Eigen::Matrix2Xf* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
   /// \brief Checks the success of a projection operation and returns the result in a
   ///        ProjectionResult object.
   /// @param[in] keypoint Keypoint in image coordinates.
@@ -171,6 +216,19 @@ class PinholeCamera : public aslam::Cloneable<Camera, PinholeCamera> {
       Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian_intrinsics,
       Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian_distortion) const;
 
+  /// \brief Batched version of project3Functional. Evaluated by the statically dispatched
+  ///        CameraModel kernel which doesn't allocate any memory per point. See
+  ///        Camera::project3FunctionalBatch for the layout of the outputs.
+  virtual void project3FunctionalBatch(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      const Eigen::VectorXd* intrinsics_external,
+      const Eigen::VectorXd* distortion_coefficients_external,
+      Eigen::Matrix2Xd* out_keypoints,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+      std::vector<ProjectionResult>* out_results) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -258,6 +316,11 @@ class PinholeCamera : public aslam::Cloneable<Camera, PinholeCamera> {
   /// \brief Create a test camera object for unit testing. (without distortion)
   static PinholeCamera::Ptr createTestCamera();
 
+ protected:
+  /// \brief Bounds the field of view by the four planes through the camera center that
+  ///        enclose the undistorted image border.
+  virtual void computeFieldOfViewBound(FieldOfViewBound* bound) const;
+
  private:
   /// \brief Minimal depth for a valid projection.
   static const double kMinimumDepth;
@@ -265,6 +328,28 @@ class PinholeCamera : public aslam::Cloneable<Camera, PinholeCamera> {
   bool isValidImpl() const override;
   void setRandomImpl() override;
   bool isEqualImpl(const Sensor& other, const bool verbose) const override;
+
+  /// \brief Returns the inverse distortion grid covering the image, (re)builds it if it is
+  ///        missing or outdated.
+  InverseDistortionGrid::ConstPtr getInverseDistortionGrid() const;
+
+  /// \brief Implementation of project3Vectorized for single and double precision.
+  template <typename ScalarType>
+  void project3VectorizedImpl(
+      const Eigen::Ref<const Eigen::Matrix<ScalarType, 3, Eigen::Dynamic>>& points_3d,
+      Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
+  /// \brief Implementation of backProject3Vectorized for single and double precision.
+  template <typename ScalarType>
+  void backProject3VectorizedImpl(
+      const Eigen::Ref<const Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>>& keypoints,
+      Eigen::Matrix<ScalarType, 3, Eigen::Dynamic>* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+
+  /// \brief Lazily built grid for batched undistortion. Accessed atomically and shared
+  ///        between clones as the grid itself is immutable.
+  mutable InverseDistortionGrid::ConstPtr inverse_distortion_grid_;
 };
 
 }  // namespace aslam
@@ -176,6 +176,19 @@ class UnifiedProjectionCamera
       Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian_intrinsics,
       Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian_distortion) const;
 
+  /// \brief Batched version of project3Functional. Evaluated by the statically dispatched
+  ///        CameraModel kernel which doesn't allocate any memory per point. See
+  ///        Camera::project3FunctionalBatch for the layout of the outputs.
+  virtual void project3FunctionalBatch(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      const Eigen::VectorXd* intrinsics_external,
+      const Eigen::VectorXd* distortion_coefficients_external,
+      Eigen::Matrix2Xd* out_keypoints,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+      std::vector<ProjectionResult>* out_results) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -263,6 +276,11 @@ class UnifiedProjectionCamera
   /// \brief Create a test camera object for unit testing. (without distortion)
   static UnifiedProjectionCamera::Ptr createTestCamera();
 
+ protected:
+  /// \brief Bounds the field of view by the cone of valid projections given by xi and by
+  ///        the cone enclosing the back-projected image border.
+  virtual void computeFieldOfViewBound(FieldOfViewBound* bound) const;
+
  private:
   /// \brief Minimal depth for a valid projection.
   static constexpr double kMinimumDepth = 1e-10;
@@ -1,6 +1,7 @@
 #ifndef ASLAM_CAMERAS_CAMERA_H_
 #define ASLAM_CAMERAS_CAMERA_H_
 
+#include <atomic>
 #include <cstdint>
 #include <iostream>
 #include <memory>
@@ -10,8 +11,10 @@
 #include <Eigen/Dense>
 #include <glog/logging.h>
 
+#include <aslam/cameras/bearing-lookup-table.h>
 #include <aslam/cameras/distortion-null.h>
 #include <aslam/cameras/distortion.h>
+#include <aslam/cameras/field-of-view-bound.h>
 #include <aslam/common/macros.h>
 #include <aslam/common/sensor.h>
 #include <aslam/common/types.h>
@@ -194,7 +197,12 @@ class Camera : public Sensor {
         is_compressed_(other.is_compressed_),
         intrinsics_(other.intrinsics_),
         camera_type_(other.camera_type_),
-        distortion_(nullptr) {
+        distortion_(nullptr),
+        bearing_lookup_table_subsampling_(
+            other.bearing_lookup_table_subsampling_.load()),
+        bearing_lookup_table_(std::atomic_load(&other.bearing_lookup_table_)),
+        is_building_bearing_lookup_table_(false),
+        field_of_view_bound_(std::atomic_load(&other.field_of_view_bound_)) {
     CHECK(other.distortion_);
     distortion_.reset(other.distortion_->clone());
   };
@@ -223,11 +231,13 @@ class Camera : public Sensor {
   /// \brief Set the width of the image in pixels.
   void setImageWidth(uint32_t image_width) {
     image_width_ = image_width;
+    invalidateCalibrationCaches();
   }
 
   /// \brief Set the height of the image in pixels.
   void setImageHeight(uint32_t image_height) {
     image_height_ = image_height;
+    invalidateCalibrationCaches();
   }
 
   /// \brief Print the internal parameters of the camera in a human-readable
@@ -291,6 +301,22 @@ class Camera : public Sensor {
       Eigen::Matrix2Xd* out_keypoints,
       std::vector<ProjectionResult>* out_results) const;
 
+  /// \brief Single-precision version of project3Vectorized. Meant for visibility checks and
+  ///        keypoint prediction where float accuracy is sufficient.
+  ///
+  /// This vanilla version converts the points to double and calls
+  /// project3Vectorized. Camera implementers are encouraged to override for
+  /// efficiency.
+  /// @param[in]  point_3d      The point in euclidean coordinates.
+  /// @param[out] out_keypoints The keypoint in image coordinates.
+  /// @param[out] out_results   Contains information about the success of the
+  ///                           projections. Check \ref ProjectionResult for
+  ///                           more information.
+  virtual void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+      Eigen::Matrix2Xf* out_keypoints,
+      std::vector<ProjectionResult>* out_results) const;
+
   /// \brief Compute the 3d bearing vector in euclidean coordinates given a
   /// keypoint in
   ///        image coordinates. Uses the projection (& distortion) models.
@@ -319,6 +345,20 @@ class Camera : public Sensor {
       const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
       Eigen::Matrix3Xd* out_points_3d,
       std::vector<unsigned char>* out_success) const;
+
+  /// \brief Single-precision version of backProject3Vectorized.
+  ///
+  /// This vanilla version converts the keypoints to double and calls
+  /// backProject3Vectorized. Camera implementers are encouraged to override for
+  /// efficiency.
+  /// @param[in]  keypoints     Keypoints in image coordinates.
+  /// @param[out] out_point_3ds Bearing vectors in euclidean coordinates (with
+  /// z=1 -> non-normalized).
+  /// @param[out] out_success   Were the projections successful?
+  virtual void backProject3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+      Eigen::Matrix3Xf* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -426,6 +466,44 @@ class Camera : public Sensor {
       Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian_distortion)
       const = 0;
 
+  /// \brief Projects a batch of points and computes the Jacobians of all projections. This is
+  ///        the batched version of project3Functional for optimizer back-ends.
+  ///
+  /// The Jacobians of all points are written to contiguous column-major buffers where the
+  /// Jacobian of point i is the i-th 2xK block, e.g. the intrinsics Jacobian of point i is
+  /// out_jacobians_intrinsics->middleCols(i * getParameterSize(), getParameterSize()).
+  /// The outputs are only resized if they do not have the required size. Callers that reuse
+  /// the buffers between calls thus don't allocate any memory.
+  ///
+  /// This vanilla version repeatedly calls project3Functional and copies the Jacobians into
+  /// the buffers. Camera implementers are encouraged to override for efficiency.
+  /// @param[in]  points_3d                The points in euclidean coordinates.
+  /// @param[in]  intrinsics_external      External intrinsic parameter vector.
+  ///                                      NOTE: If nullptr, use internal intrinsic parameters.
+  /// @param[in]  distortion_coefficients_external External distortion parameter vector.
+  ///                                      NOTE: If nullptr, use internal distortion
+  ///                                      parameters.
+  /// @param[out] out_keypoints            The keypoints in image coordinates.
+  /// @param[out] out_jacobians_point      2 x (3 * N) Jacobians wrt. to the points.
+  ///                                        nullptr: calculation is skipped.
+  /// @param[out] out_jacobians_intrinsics 2 x (getParameterSize() * N) Jacobians wrt. to
+  ///                                      the intrinsics. nullptr: calculation is skipped.
+  /// @param[out] out_jacobians_distortion 2 x (getDistortion().getParameterSize() * N)
+  ///                                      Jacobians wrt. to the distortion parameters.
+  ///                                        nullptr: calculation is skipped.
+  /// @param[out] out_results              Contains information about the success of the
+  ///                                      projections. Check \ref ProjectionResult for more
+  ///                                      information.
+  virtual void project3FunctionalBatch(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+      const Eigen::VectorXd* intrinsics_external,
+      const Eigen::VectorXd* distortion_coefficients_external,
+      Eigen::Matrix2Xd* out_keypoints,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+      Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+      std::vector<ProjectionResult>* out_results) const;
+
   /// @}
 
  public:
@@ -549,8 +627,12 @@ class Camera : public Sensor {
   /// \name Methods to interface the underlying distortion model.
   /// @{
 
-  /// Returns a pointer to the underlying distortion object.
+  /// Returns a pointer to the underlying distortion object. Drops the bearing
+  /// lookup table and the field of view bound, which are rebuilt on their next
+  /// use. They are not checked against the distortion on every use, so do not
+  /// keep the pointer to modify the distortion later.
   aslam::Distortion* getDistortionMutable() {
+    invalidateCalibrationCaches();
     return CHECK_NOTNULL(distortion_.get());
   };
 
@@ -562,6 +644,7 @@ class Camera : public Sensor {
   /// Set the distortion model.
   void setDistortion(aslam::Distortion::UniquePtr& distortion) {
     distortion_ = std::move(distortion);
+    invalidateCalibrationCaches();
   };
 
   /// Is a distortion model set for this camera.
@@ -573,6 +656,7 @@ class Camera : public Sensor {
   /// Remove the distortion model from this camera.
   void removeDistortion() {
     distortion_.reset(new NullDistortion);
+    invalidateCalibrationCaches();
   };
   /// @}
 
@@ -585,8 +669,12 @@ class Camera : public Sensor {
     return intrinsics_;
   };
 
-  /// Get the intrinsic parameters.
+  /// Get the intrinsic parameters. Drops the bearing lookup table and the field
+  /// of view bound, which are rebuilt on their next use. They are not checked
+  /// against the parameters on every use, so do not keep the pointer to modify
+  /// the parameters later.
   inline double* getParametersMutable() {
+    invalidateCalibrationCaches();
     return &intrinsics_.coeffRef(0, 0);
   };
 
@@ -595,6 +683,7 @@ class Camera : public Sensor {
   void setParameters(const Eigen::VectorXd& params) {
     CHECK_EQ(getParameterSize(), params.size());
     intrinsics_ = params;
+    invalidateCalibrationCaches();
   }
 
   /// Function to check whether the given intrinsic parameters are valid for
@@ -603,6 +692,54 @@ class Camera : public Sensor {
 
   /// @}
 
+  //////////////////////////////////////////////////////////////
+  /// \name Methods to control the bearing lookup table.
+  /// @{
+
+  /// Enable the bearing lookup table. The table holds the bearing vectors of
+  /// every subsampling-th pixel and is built on the first back-projection.
+  /// Afterwards, back-projections inside the image are answered by bilinear
+  /// interpolation in the table. The table is dropped by the methods that set
+  /// or hand out the intrinsics or the distortion for modification, and
+  /// rebuilt on the next back-projection. Only used by camera models that support it
+  /// (pinhole and unified projection).
+  /// @param[in] subsampling Distance between the table nodes in pixels.
+  void enableBearingLookupTable(int subsampling = 1);
+
+  /// Disable the bearing lookup table and free its memory.
+  void disableBearingLookupTable();
+
+  /// Is the bearing lookup table enabled?
+  bool isBearingLookupTableEnabled() const {
+    return bearing_lookup_table_subsampling_ > 0;
+  }
+
+  /// Memory used by the bearing lookup table in bytes. Zero if it has not
+  /// been built (yet).
+  size_t getBearingLookupTableMemoryBytes() const;
+
+  /// @}
+
+  //////////////////////////////////////////////////////////////
+  /// \name Methods to cull points outside of the field of view.
+  /// @{
+
+  /// \brief Get the indices of all points that may be visible in the camera. The points are
+  ///        tested against a conservative bound of the field of view without evaluating the
+  ///        projection. All points that project into the image box are returned, plus some
+  ///        points close to the field of view.
+  /// @param[in]  points_3d             The points in euclidean coordinates.
+  /// @param[out] out_candidate_indices The indices of the points that may be visible, sorted
+  ///                                   in ascending order.
+  void getFieldOfViewCandidates(const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+                                std::vector<int>* out_candidate_indices) const;
+
+  /// \brief Returns the conservative bound of the field of view. The bound is built on the
+  ///        first use and dropped whenever the calibration is changed through the camera.
+  FieldOfViewBound::ConstPtr getFieldOfViewBound() const;
+
+  /// @}
+
   //////////////////////////////////////////////////////////////
   /// \name Methods to access the mask.
   /// @{
@@ -653,7 +790,50 @@ class Camera : public Sensor {
 
   /// @}
 
+ protected:
+  /// Back-project a keypoint using the bearing lookup table.
+  /// @return False if the table is disabled, being built or does not cover the
+  ///         keypoint. The caller has to use the exact model in that case.
+  bool backProject3FromLookupTable(
+      const Eigen::Ref<const Eigen::Vector2d>& keypoint,
+      Eigen::Vector3d* out_point_3d) const;
+
+  /// Back-project a list of keypoints using the bearing lookup table.
+  /// Keypoints which are not covered by the table are back-projected with
+  /// backProject3.
+  /// @return False if the table is disabled or being built. Nothing is
+  ///         computed in that case.
+  bool backProject3VectorizedFromLookupTable(
+      const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+      Eigen::Matrix3Xd* out_points_3d,
+      std::vector<unsigned char>* out_success) const;
+
+  /// Drop the bearing lookup table, it is rebuilt on the next use.
+  void invalidateBearingLookupTable();
+
+  /// Drop the bearing lookup table and the field of view bound, they are
+  /// rebuilt on their next use. Call this whenever the image size, the
+  /// intrinsics or the distortion change.
+  void invalidateCalibrationCaches();
+
+  /// \brief Restrict the bound to the field of view of the camera. The bound must contain
+  ///        all points that project into the image box.
+  ///
+  /// This vanilla version bounds the back-projected image border by a cone around the
+  /// bearing of the image center. This is valid for lenses whose field angle grows towards
+  /// the image border. The bound stays unbounded if the border can not be back-projected.
+  /// Camera implementers are encouraged to override with a tighter bound.
+  virtual void computeFieldOfViewBound(FieldOfViewBound* bound) const;
+
+  /// \brief Keypoints sampled along the border of the image box in order, starting at the
+  ///        top left corner. Neighboring samples are at most spacing pixels apart.
+  Eigen::Matrix2Xd getImageBorderKeypoints(double spacing) const;
+
  private:
+  /// Returns the bearing lookup table, (re)builds it if it is missing or was
+  /// built with another subsampling. Returns nullptr if the table is disabled or being built.
+  BearingLookupTable::ConstPtr getBearingLookupTable() const;
+
   bool isValidImpl() const = 0;
   void setRandomImpl() = 0;
   bool isEqualImpl(const Sensor& other, const bool verbose) const = 0;
@@ -681,6 +861,16 @@ class Camera : public Sensor {
 
   /// \brief The distortion for this camera.
   aslam::Distortion::UniquePtr distortion_;
+
+ private:
+  /// Node distance of the bearing lookup table, zero if disabled.
+  std::atomic<int> bearing_lookup_table_subsampling_;
+  /// Lazily built bearing lookup table. Accessed atomically.
+  mutable BearingLookupTable::ConstPtr bearing_lookup_table_;
+  /// Set while a thread builds the bearing lookup table.
+  mutable std::atomic<bool> is_building_bearing_lookup_table_;
+  /// Lazily built bound of the field of view. Accessed atomically.
+  mutable FieldOfViewBound::ConstPtr field_of_view_bound_;
 };
 }  // namespace aslam
 #include "camera-inl.h"
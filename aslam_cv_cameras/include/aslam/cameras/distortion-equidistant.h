@@ -1,11 +1,15 @@
 #ifndef ASLAM_EQUIDISTANT_DISTORTION_H_
 #define ASLAM_EQUIDISTANT_DISTORTION_H_
 
+#include <atomic>
+#include <memory>
+
 #include <Eigen/Core>
 #include <glog/logging.h>
 
 #include <aslam/common/crtp-clone.h>
 #include <aslam/cameras/distortion.h>
+#include <aslam/cameras/equidistant-inverse-fit.h>
 #include <aslam/common/macros.h>
 
 namespace aslam {
@@ -16,7 +20,8 @@ namespace aslam {
 ///        Fish-Eye Lenses" by Juho Kannala and Sami S. Brandt for further information.
 ///        The ordering of the parameter vector is: k1 k2 k3 k4
 ///        NOTE: The inverse transformation (undistort) in this case is not available in
-///        closed form and so it is computed iteratively!
+///        closed form and so it is computed iteratively by default! See \ref InverseMode for
+///        a faster alternative.
 class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDistortion> {
  public:
   /** \brief Number of parameters used for this distortion model. */
@@ -25,6 +30,16 @@ class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDis
   enum { CLASS_SERIALIZATION_VERSION = 1 };
   ASLAM_POINTER_TYPEDEFS(EquidistantDistortion);
 
+  /// \brief Methods to invert the distortion.
+  enum class InverseMode {
+    /// Iterative Gauss-Newton solver on the 2d point.
+    kIterative,
+    /// Per-camera Chebyshev fit of the inverse theta polynomial followed by Newton steps,
+    /// see \ref EquidistantInverseFit. Points outside of the fitted range use the iterative
+    /// solver. Only used with the internal distortion parameters.
+    kPolynomialFit
+  };
+
   //////////////////////////////////////////////////////////////
   /// \name Constructors/destructors and operators
   /// @{
@@ -38,7 +53,10 @@ class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDis
 
  public:
   /// Copy constructor for clone operation.
-  EquidistantDistortion(const EquidistantDistortion&) = default;
+  EquidistantDistortion(const EquidistantDistortion& other)
+      : Base(other),
+        inverse_mode_(other.inverse_mode_),
+        inverse_fit_(std::atomic_load(&other.inverse_fit_)) {}
   void operator=(const EquidistantDistortion&) = delete;
 
   /// @}
@@ -83,6 +101,13 @@ class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDis
                                         const Eigen::Vector2d& point,
                                         Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian) const;
 
+  /// \brief Apply distortion to a batch of points in the normalized image plane using the
+  ///        internal distortion parameters (structure-of-arrays).
+  /// @param[in,out] x The x-coordinates of the points. After the function, these are distorted.
+  /// @param[in,out] y The y-coordinates of the points. After the function, these are distorted.
+  virtual void distortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const;
+  virtual void distortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -98,6 +123,23 @@ class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDis
   virtual void undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                   Eigen::Vector2d* point) const;
 
+  // Get the single-precision overload from base into scope.
+  using Distortion::undistortVectorized;
+
+  /// \brief Apply undistortion to a batch of points using the internal distortion parameters
+  ///        (structure-of-arrays). Uses the polynomial fit if selected by the inverse mode.
+  /// @param[in,out] x The x-coordinates of the distorted points. After the function, these are
+  ///                  in the normalized image plane.
+  /// @param[in,out] y The y-coordinates of the distorted points. After the function, these are
+  ///                  in the normalized image plane.
+  virtual void undistortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const;
+
+  /// \brief Select the method used to invert the distortion.
+  void setInverseMode(InverseMode inverse_mode) { inverse_mode_ = inverse_mode; }
+
+  /// \brief Returns the method used to invert the distortion.
+  InverseMode getInverseMode() const { return inverse_mode_; }
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -149,6 +191,23 @@ class EquidistantDistortion : public aslam::Cloneable<Distortion, EquidistantDis
 
   /// @}
 
+ private:
+  /// \brief Implementation of distortVectorized for single and double precision.
+  template <typename ScalarType>
+  void distortVectorizedImpl(Eigen::Array<ScalarType, Eigen::Dynamic, 1>* x,
+                             Eigen::Array<ScalarType, Eigen::Dynamic, 1>* y) const;
+
+  /// \brief Undistort a point with the iterative Gauss-Newton solver.
+  void undistortIteratively(const Eigen::VectorXd& dist_coeffs, Eigen::Vector2d* point) const;
+
+  /// \brief Returns the inverse fit for the internal parameters, (re)builds it if it is missing
+  ///        or outdated.
+  EquidistantInverseFit::ConstPtr getInverseFit() const;
+
+  /// Method used to invert the distortion.
+  InverseMode inverse_mode_ = InverseMode::kIterative;
+  /// Lazily built fit of the inverse. Accessed atomically.
+  mutable EquidistantInverseFit::ConstPtr inverse_fit_;
 };
 
 } // namespace aslam
@@ -77,6 +77,13 @@ class FisheyeDistortion : public aslam::Cloneable<Distortion, FisheyeDistortion>
                                         const Eigen::Vector2d& point,
                                         Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian) const;
 
+  /// \brief Apply distortion to a batch of points in the normalized image plane using the
+  ///        internal distortion parameters (structure-of-arrays).
+  /// @param[in,out] x The x-coordinates of the points. After the function, these are distorted.
+  /// @param[in,out] y The y-coordinates of the points. After the function, these are distorted.
+  virtual void distortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const;
+  virtual void distortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -92,6 +99,15 @@ class FisheyeDistortion : public aslam::Cloneable<Distortion, FisheyeDistortion>
   virtual void undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                   Eigen::Vector2d* point) const;
 
+  /// \brief Apply undistortion to a batch of points using the internal distortion parameters
+  ///        (structure-of-arrays). Uses the closed-form inverse.
+  /// @param[in,out] x The x-coordinates of the distorted points. After the function, these are
+  ///                  in the normalized image plane.
+  /// @param[in,out] y The y-coordinates of the distorted points. After the function, these are
+  ///                  in the normalized image plane.
+  virtual void undistortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const;
+  virtual void undistortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -151,6 +167,16 @@ class FisheyeDistortion : public aslam::Cloneable<Distortion, FisheyeDistortion>
   static constexpr double kMaxValidW = 1.5;
 
   /// @}
+
+  /// \brief Implementation of distortVectorized for single and double precision.
+  template <typename ScalarType>
+  void distortVectorizedImpl(Eigen::Array<ScalarType, Eigen::Dynamic, 1>* x,
+                             Eigen::Array<ScalarType, Eigen::Dynamic, 1>* y) const;
+
+  /// \brief Implementation of undistortVectorized for single and double precision.
+  template <typename ScalarType>
+  void undistortVectorizedImpl(Eigen::Array<ScalarType, Eigen::Dynamic, 1>* x,
+                               Eigen::Array<ScalarType, Eigen::Dynamic, 1>* y) const;
 };
 
 } // namespace aslam
@@ -100,6 +100,13 @@ class NullDistortion : public aslam::Cloneable<Distortion, NullDistortion> {
     }
   }
 
+  /// \brief Apply distortion to a batch of points (structure-of-arrays). This
+  /// is a no-op for the null distortion.
+  virtual void distortVectorized(
+      Eigen::ArrayXd* /* x */, Eigen::ArrayXd* /* y */) const {}
+  virtual void distortVectorized(
+      Eigen::ArrayXf* /* x */, Eigen::ArrayXf* /* y */) const {}
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -121,6 +128,13 @@ class NullDistortion : public aslam::Cloneable<Distortion, NullDistortion> {
       const Eigen::VectorXd& /*dist_coeffs*/,
       Eigen::Vector2d* /*point*/) const {}
 
+  /// \brief Apply undistortion to a batch of points (structure-of-arrays). This
+  /// is a no-op for the null distortion.
+  virtual void undistortVectorized(
+      Eigen::ArrayXd* /* x */, Eigen::ArrayXd* /* y */) const {}
+  virtual void undistortVectorized(
+      Eigen::ArrayXf* /* x */, Eigen::ArrayXf* /* y */) const {}
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -71,6 +71,13 @@ class RadTanDistortion : public aslam::Cloneable<Distortion, RadTanDistortion> {
                                         const Eigen::Vector2d& point,
                                         Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian) const;
 
+  /// \brief Apply distortion to a batch of points in the normalized image plane using the
+  ///        internal distortion parameters (structure-of-arrays).
+  /// @param[in,out] x The x-coordinates of the points. After the function, these are distorted.
+  /// @param[in,out] y The y-coordinates of the points. After the function, these are distorted.
+  virtual void distortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const;
+  virtual void distortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -137,6 +144,11 @@ class RadTanDistortion : public aslam::Cloneable<Distortion, RadTanDistortion> {
 
   /// @}
 
+ private:
+  /// \brief Implementation of distortVectorized for single and double precision.
+  template <typename ScalarType>
+  void distortVectorizedImpl(Eigen::Array<ScalarType, Eigen::Dynamic, 1>* x,
+                             Eigen::Array<ScalarType, Eigen::Dynamic, 1>* y) const;
 };
 } // namespace aslam
 
@@ -109,6 +109,25 @@ class Distortion {
                                  const Eigen::Vector2d& point,
                                  Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobian) const = 0;
 
+  /// \brief Apply distortion to a batch of points in the normalized image plane using the
+  ///        internal distortion parameters. The points are passed as separate coordinate
+  ///        arrays (structure-of-arrays) such that the models can process them in SIMD lanes.
+  ///
+  /// This vanilla version just repeatedly calls distort. Distortion implementers are
+  /// encouraged to override for efficiency.
+  /// @param[in,out] x The x-coordinates of the points. After the function, these are distorted.
+  /// @param[in,out] y The y-coordinates of the points. After the function, these are distorted.
+  virtual void distortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const;
+
+  /// \brief Single-precision version of distortVectorized. Trades accuracy for twice the
+  ///        number of SIMD lanes, e.g. for visibility checks or keypoint prediction.
+  ///
+  /// This vanilla version converts the points to double and calls distortVectorized.
+  /// Distortion implementers are encouraged to override for efficiency.
+  /// @param[in,out] x The x-coordinates of the points. After the function, these are distorted.
+  /// @param[in,out] y The y-coordinates of the points. After the function, these are distorted.
+  virtual void distortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -135,6 +154,28 @@ class Distortion {
   virtual void undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                   Eigen::Vector2d* point) const = 0;
 
+  /// \brief Apply undistortion to a batch of points using the internal distortion parameters.
+  ///        The points are passed as separate coordinate arrays (structure-of-arrays).
+  ///
+  /// This vanilla version just repeatedly calls undistort. Distortion implementers are
+  /// encouraged to override for efficiency. See \ref InverseDistortionGrid for models without
+  /// a closed-form inverse.
+  /// @param[in,out] x The x-coordinates of the distorted points. After the function, these are
+  ///                  in the normalized image plane.
+  /// @param[in,out] y The y-coordinates of the distorted points. After the function, these are
+  ///                  in the normalized image plane.
+  virtual void undistortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const;
+
+  /// \brief Single-precision version of undistortVectorized.
+  ///
+  /// This vanilla version converts the points to double and calls undistortVectorized.
+  /// Distortion implementers are encouraged to override for efficiency.
+  /// @param[in,out] x The x-coordinates of the distorted points. After the function, these are
+  ///                  in the normalized image plane.
+  /// @param[in,out] y The y-coordinates of the distorted points. After the function, these are
+  ///                  in the normalized image plane.
+  virtual void undistortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const;
+
   /// @}
 
   //////////////////////////////////////////////////////////////
@@ -0,0 +1,75 @@
+#ifndef ASLAM_CAMERAS_EQUIDISTANT_INVERSE_FIT_H_
+#define ASLAM_CAMERAS_EQUIDISTANT_INVERSE_FIT_H_
+
+#include <Eigen/Dense>
+
+#include <aslam/common/macros.h>
+
+namespace aslam {
+
+/// \class EquidistantInverseFit
+/// \brief Precomputed inverse of the theta polynomial of the equidistant distortion model.
+///
+/// The equidistant model maps the angle theta of a ray to the distorted radius
+/// r_d = theta * (1 + k1 * theta^2 + k2 * theta^4 + k3 * theta^6 + k4 * theta^8). Its inverse
+/// theta(r_d) is approximated once by a Chebyshev polynomial on the range where the model is
+/// monotonic. Undistortion evaluates the polynomial, refines theta with a fixed number of
+/// Newton steps and sets the undistorted radius to tan(theta). This replaces the iterative 2d
+/// Gauss-Newton solver by a handful of multiply-adds per point.
+class EquidistantInverseFit {
+ public:
+  ASLAM_POINTER_TYPEDEFS(EquidistantInverseFit);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(EquidistantInverseFit);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  enum {
+    kDefaultDegree = 24,
+    kNumNewtonSteps = 2
+  };
+
+  /// \brief Fit the inverse of the theta polynomial.
+  /// @param[in] dist_coeffs The coefficients of the equidistant model (k1, k2, k3, k4).
+  /// @param[in] degree      Degree of the Chebyshev polynomial.
+  explicit EquidistantInverseFit(const Eigen::VectorXd& dist_coeffs,
+                                 int degree = kDefaultDegree);
+
+  /// \brief Undistort a point in the normalized image plane.
+  /// @param[in,out] point The distorted point. After the function, this point is in the
+  ///                      normalized image plane if the undistortion was successful.
+  /// @return False if the point is outside of the fitted range or the refinement did not
+  ///         converge. The point is left unchanged in this case.
+  bool undistort(Eigen::Vector2d* point) const;
+
+  /// \brief Undistort a batch of points in the normalized image plane (structure-of-arrays).
+  /// @param[in,out] x           The x-coordinates of the distorted points. After the function,
+  ///                            these are undistorted where successful.
+  /// @param[in,out] y           The y-coordinates of the distorted points. After the function,
+  ///                            these are undistorted where successful.
+  /// @param[out]    out_success Was the undistortion of the points successful? Unsuccessful
+  ///                            points are left unchanged.
+  void undistort(Eigen::ArrayXd* x, Eigen::ArrayXd* y,
+                 Eigen::Array<bool, Eigen::Dynamic, 1>* out_success) const;
+
+  /// \brief Returns whether the fit was computed for the given coefficients.
+  bool isValidFor(const Eigen::VectorXd& dist_coeffs) const;
+
+  /// \brief The largest distorted radius covered by the fit.
+  double getMaxDistortedRadius() const { return max_distorted_radius_; }
+
+ private:
+  /// \brief Theta of the given distorted radii, Chebyshev fit followed by Newton steps.
+  /// @return The absolute residual of the distortion polynomial at the returned theta.
+  Eigen::ArrayXd solveTheta(const Eigen::ArrayXd& radius_distorted,
+                            Eigen::ArrayXd* theta) const;
+
+  const Eigen::VectorXd dist_coeffs_;
+  double max_theta_;
+  double max_distorted_radius_;
+
+  /// Chebyshev coefficients of theta(r_d) on [0, max_distorted_radius_].
+  Eigen::ArrayXd chebyshev_coefficients_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_EQUIDISTANT_INVERSE_FIT_H_
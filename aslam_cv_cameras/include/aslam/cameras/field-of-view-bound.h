@@ -0,0 +1,62 @@
+#ifndef ASLAM_CAMERAS_FIELD_OF_VIEW_BOUND_H_
+#define ASLAM_CAMERAS_FIELD_OF_VIEW_BOUND_H_
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <aslam/common/macros.h>
+
+namespace aslam {
+
+/// \class FieldOfViewBound
+/// \brief Conservative bound of the field of view of a camera.
+///
+/// The bound is the intersection of half-spaces through the camera center and of cones
+/// around axes through the camera center. Every point that projects into the image box of
+/// the camera lies inside the bound, the converse does not hold. This allows to reject most
+/// points outside the field of view without evaluating the projection and the distortion.
+/// The bound does not keep the calibration it was built from, the camera drops its bound
+/// whenever the calibration changes.
+class FieldOfViewBound {
+ public:
+  ASLAM_POINTER_TYPEDEFS(FieldOfViewBound);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(FieldOfViewBound);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /// \brief Create an unbounded field of view.
+  FieldOfViewBound();
+
+  /// \brief Restrict the bound to the points p with normal.dot(p) >= 0.
+  void addHalfSpace(const Eigen::Vector3d& normal);
+
+  /// \brief Restrict the bound to the points whose angle to the axis is at most half_angle.
+  ///        Cones with a half angle of pi or more don't restrict the bound.
+  void addCone(const Eigen::Vector3d& axis, double half_angle);
+
+  /// \brief Returns true if the bound doesn't reject any point.
+  bool isUnbounded() const {
+    return half_space_normals_.cols() == 0 && cone_axes_.cols() == 0;
+  }
+
+  /// \brief Returns false if the point is certainly not visible in the camera.
+  bool isCandidate(const Eigen::Ref<const Eigen::Vector3d>& point_3d) const;
+
+  /// \brief Get the indices of all points that may be visible in the camera.
+  /// @param[in]  points_3d             The points in the camera frame.
+  /// @param[out] out_candidate_indices The indices of all points inside the bound, sorted in
+  ///                                   ascending order.
+  void getCandidates(const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+                     std::vector<int>* out_candidate_indices) const;
+
+ private:
+  /// Normals of the half-spaces.
+  Eigen::Matrix3Xd half_space_normals_;
+  /// Unit axes of the cones and the cosines of their half angles.
+  Eigen::Matrix3Xd cone_axes_;
+  Eigen::RowVectorXd cone_cos_half_angles_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_FIELD_OF_VIEW_BOUND_H_
@@ -0,0 +1,79 @@
+#ifndef ASLAM_CAMERAS_INVERSE_DISTORTION_GRID_H_
+#define ASLAM_CAMERAS_INVERSE_DISTORTION_GRID_H_
+
+#include <aslam/cameras/distortion.h>
+#include <aslam/common/macros.h>
+#include <Eigen/Dense>
+
+namespace aslam {
+
+/// \class InverseDistortionGrid
+/// \brief Batched undistortion engine for distortion models without a closed-form inverse.
+///
+/// The inverse distortion is precomputed once on a regular grid spanning a rectangle of
+/// distorted points in the normalized image plane. Batches of points are then seeded by
+/// bilinear interpolation on this grid and refined with a fixed number of Newton steps which
+/// operate on all points at once (structure-of-arrays). Points that are not converged after
+/// the last step fall back to the iterative solver of the distortion model.
+class InverseDistortionGrid {
+ public:
+  ASLAM_POINTER_TYPEDEFS(InverseDistortionGrid);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(InverseDistortionGrid);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  enum {
+    kDefaultNumCellsPerAxis = 32,
+    kDefaultNumNewtonSteps = 2
+  };
+
+  /// \brief Precompute the inverse distortion grid.
+  /// @param[in] distortion          The distortion model to invert. A copy is stored.
+  /// @param[in] min_distorted       Lower corner of the grid (distorted, normalized plane).
+  /// @param[in] max_distorted       Upper corner of the grid (distorted, normalized plane).
+  /// @param[in] num_cells_per_axis  Number of grid cells along each axis.
+  /// @param[in] num_newton_steps    Number of vectorized Newton steps after the seeding.
+  InverseDistortionGrid(const Distortion& distortion,
+                        const Eigen::Vector2d& min_distorted,
+                        const Eigen::Vector2d& max_distorted,
+                        int num_cells_per_axis = kDefaultNumCellsPerAxis,
+                        int num_newton_steps = kDefaultNumNewtonSteps);
+
+  /// \brief Undistort a batch of points in the normalized image plane.
+  /// @param[in,out] x The x-coordinates of the distorted points. After the function, these
+  ///                  are undistorted.
+  /// @param[in,out] y The y-coordinates of the distorted points. After the function, these
+  ///                  are undistorted.
+  void undistort(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const;
+
+  /// \brief Single-precision version of undistort. The points are refined in double
+  ///        precision.
+  void undistort(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const;
+
+  /// \brief Returns whether this grid was built for the given distortion model (type and
+  ///        parameters) and the given rectangle.
+  bool isValidFor(const Distortion& distortion, const Eigen::Vector2d& min_distorted,
+                  const Eigen::Vector2d& max_distorted) const;
+
+ private:
+  /// \brief Bilinear interpolation of the grid to get an initial guess of the undistorted points.
+  void interpolateSeed(const Eigen::ArrayXd& x, const Eigen::ArrayXd& y,
+                       Eigen::ArrayXd* x_undistorted, Eigen::ArrayXd* y_undistorted) const;
+
+  /// \brief Seeds and refines one block of points.
+  void undistortBlock(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const;
+
+  const Distortion::UniquePtr distortion_;
+  const Eigen::Vector2d min_distorted_;
+  const Eigen::Vector2d max_distorted_;
+  const int num_cells_per_axis_;
+  const int num_newton_steps_;
+  Eigen::Vector2d cell_size_;
+
+  /// Undistorted coordinates of the grid nodes, stored row-major.
+  Eigen::ArrayXd x_undistorted_;
+  Eigen::ArrayXd y_undistorted_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_INVERSE_DISTORTION_GRID_H_
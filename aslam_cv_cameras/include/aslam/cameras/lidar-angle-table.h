@@ -0,0 +1,65 @@
+#ifndef ASLAM_CAMERAS_LIDAR_ANGLE_TABLE_H_
+#define ASLAM_CAMERAS_LIDAR_ANGLE_TABLE_H_
+
+#include <cstdint>
+
+#include <Eigen/Dense>
+
+#include <aslam/common/macros.h>
+
+namespace aslam {
+
+/// \class LidarAngleTable
+/// \brief Precomputed sines and cosines of the beam angles of a 3d lidar.
+///
+/// The table holds the azimuth of every image column and the elevation of every image row.
+/// Back-projection composes the table entry of the closest column (row) with the remaining
+/// fraction of a column (row) through the angle addition theorems. Projection estimates the
+/// angles with a fast polynomial approximation, which selects the closest column (row). The
+/// angle relative to the table entry is small and is recovered exactly by a short series.
+/// Points are processed in fixed-size blocks (structure-of-arrays) without branches such that
+/// the compiler can vectorize. Angles too far from any table entry, e.g. for coarse
+/// resolutions, are computed with the standard library functions.
+class LidarAngleTable {
+ public:
+  ASLAM_POINTER_TYPEDEFS(LidarAngleTable);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(LidarAngleTable);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /// \brief Precompute the tables.
+  /// @param[in] intrinsics   The intrinsics of the lidar, see Camera3DLidar::Parameters.
+  /// @param[in] image_width  The number of image columns.
+  /// @param[in] image_height The number of image rows.
+  LidarAngleTable(const Eigen::VectorXd& intrinsics, uint32_t image_width,
+                  uint32_t image_height);
+
+  /// \brief Project points to keypoints. Equivalent to the projection of Camera3DLidar,
+  ///        the keypoint of points close to the origin is set to zero.
+  void project(const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+               Eigen::Matrix2Xd* out_keypoints) const;
+
+  /// \brief Back-project keypoints to unit bearing vectors. Equivalent to the
+  ///        back-projection of Camera3DLidar.
+  void backProject(const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+                   Eigen::Matrix3Xd* out_bearings) const;
+
+  /// \brief Returns whether the table was built for the given intrinsics and image size.
+  bool isValidFor(const Eigen::VectorXd& intrinsics, uint32_t image_width,
+                  uint32_t image_height) const;
+
+ private:
+  const Eigen::VectorXd intrinsics_;
+  const uint32_t image_width_;
+  const uint32_t image_height_;
+
+  /// Azimuth of the columns, the angle of (z, x) relative to the z-axis.
+  Eigen::ArrayXd column_sines_;
+  Eigen::ArrayXd column_cosines_;
+  /// Elevation of the rows, the angle of the bearing relative to the x-z plane.
+  Eigen::ArrayXd row_sines_;
+  Eigen::ArrayXd row_cosines_;
+};
+
+}  // namespace aslam
+
+#endif  // ASLAM_CAMERAS_LIDAR_ANGLE_TABLE_H_
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include <Eigen/Core>
 #include <aslam/common/macros.h>
 #include <aslam/common/pose-types.h>
 #include <aslam/common/sensor.h>
@@ -17,6 +18,7 @@ class PropertyTree;
 }
 namespace aslam {
 class Camera;
+class ThreadPool;
 }
 
 namespace aslam {
@@ -171,6 +173,28 @@ class NCamera : public Sensor {
   /// NCamera and all contained cameras.
   aslam::NCamera::Ptr cloneRigWithoutDistortion() const;
 
+  /// \brief Project points given in the body frame into all cameras of the rig.
+  ///
+  /// The points are transformed and projected in chunks of points. The chunks of all cameras
+  /// are processed in parallel on the thread pool. The call waits for the chunks, so it must
+  /// not be made from a task running on the same thread pool, which could deadlock.
+  /// @param[in]  points_B        The points in the body frame.
+  /// @param[in]  thread_pool     The thread pool used to process the chunks. If nullptr, all
+  ///                             chunks are processed on the calling thread.
+  /// @param[out] out_keypoints   For every camera i, the keypoints of all points in camera i.
+  /// @param[out] out_is_visible  For every camera i, a mask which is true for all points that
+  ///                             project into the image box of camera i.
+  void project3Vectorized(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_B, ThreadPool* thread_pool,
+      std::vector<Eigen::Matrix2Xd>* out_keypoints,
+      std::vector<std::vector<unsigned char>>* out_is_visible) const;
+
+  /// \brief Same as above, but creates a thread pool with num_threads threads for the call.
+  void project3VectorizedWithNumThreads(
+      const Eigen::Ref<const Eigen::Matrix3Xd>& points_B, size_t num_threads,
+      std::vector<Eigen::Matrix2Xd>* out_keypoints,
+      std::vector<std::vector<unsigned char>>* out_is_visible) const;
+
  private:
   bool isValidImpl() const override;
 
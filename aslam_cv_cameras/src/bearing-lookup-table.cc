@@ -0,0 +1,90 @@
+#include "aslam/cameras/bearing-lookup-table.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include <aslam/cameras/camera.h>
+
+namespace aslam {
+
+BearingLookupTable::BearingLookupTable(const Camera& camera, int subsampling)
+    : subsampling_(subsampling),
+      image_width_(camera.imageWidth()),
+      image_height_(camera.imageHeight()) {
+  CHECK_GT(subsampling_, 0);
+  CHECK_GT(image_width_, 0u);
+  CHECK_GT(image_height_, 0u);
+
+  // Enough nodes to cover the last pixel row and column.
+  num_cols_ = (image_width_ - 1 + subsampling_ - 1) / subsampling_ + 1;
+  num_rows_ = (image_height_ - 1 + subsampling_ - 1) / subsampling_ + 1;
+  if (num_cols_ < 2) {
+    num_cols_ = 2;
+  }
+  if (num_rows_ < 2) {
+    num_rows_ = 2;
+  }
+
+  const size_t num_nodes = static_cast<size_t>(num_cols_) * num_rows_;
+  bearings_.resize(3u * num_nodes);
+  is_valid_.resize(num_nodes);
+  Eigen::Matrix2Xd keypoints(2, num_nodes);
+  for (int row = 0; row < num_rows_; ++row) {
+    for (int col = 0; col < num_cols_; ++col) {
+      keypoints.col(row * num_cols_ + col) << col * subsampling_, row * subsampling_;
+    }
+  }
+  Eigen::Matrix3Xd points_3d;
+  std::vector<unsigned char> success;
+  camera.backProject3Vectorized(keypoints, &points_3d, &success);
+  CHECK_EQ(static_cast<size_t>(points_3d.cols()), num_nodes);
+  for (size_t i = 0u; i < num_nodes; ++i) {
+    bearings_[3u * i] = static_cast<float>(points_3d(0, i));
+    bearings_[3u * i + 1u] = static_cast<float>(points_3d(1, i));
+    bearings_[3u * i + 2u] = static_cast<float>(points_3d(2, i));
+    is_valid_[i] = success[i];
+  }
+}
+
+bool BearingLookupTable::lookup(
+    const Eigen::Ref<const Eigen::Vector2d>& keypoint,
+    Eigen::Vector3d* out_point_3d) const {
+  CHECK_NOTNULL(out_point_3d);
+  const double grid_x = keypoint[0] / subsampling_;
+  const double grid_y = keypoint[1] / subsampling_;
+  if (!(grid_x >= 0.0 && grid_y >= 0.0 && grid_x <= num_cols_ - 1 &&
+        grid_y <= num_rows_ - 1)) {
+    return false;
+  }
+  const int col = std::min(static_cast<int>(grid_x), num_cols_ - 2);
+  const int row = std::min(static_cast<int>(grid_y), num_rows_ - 2);
+  const size_t idx = static_cast<size_t>(row) * num_cols_ + col;
+  const size_t idx_below = idx + num_cols_;
+  if (!is_valid_[idx] || !is_valid_[idx + 1u] || !is_valid_[idx_below] ||
+      !is_valid_[idx_below + 1u]) {
+    return false;
+  }
+
+  const float wx = static_cast<float>(grid_x - col);
+  const float wy = static_cast<float>(grid_y - row);
+  const float w00 = (1.0f - wx) * (1.0f - wy);
+  const float w01 = wx * (1.0f - wy);
+  const float w10 = (1.0f - wx) * wy;
+  const float w11 = wx * wy;
+  const float* b00 = &bearings_[3u * idx];
+  const float* b01 = b00 + 3;
+  const float* b10 = &bearings_[3u * idx_below];
+  const float* b11 = b10 + 3;
+  for (int i = 0; i < 3; ++i) {
+    (*out_point_3d)[i] = w00 * b00[i] + w01 * b01[i] + w10 * b10[i] + w11 * b11[i];
+  }
+  return true;
+}
+
+size_t BearingLookupTable::getMemoryFootprintBytes() const {
+  return sizeof(*this) + bearings_.capacity() * sizeof(float) +
+      is_valid_.capacity() * sizeof(unsigned char);
+}
+
+}  // namespace aslam
@@ -0,0 +1,87 @@
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+
+// Compares the batched PinholeCamera::backProject3Vectorized (grid-seeded Newton steps or
+// closed-form inverse) to the per-point iterative undistortion in terms of accuracy and
+// throughput.
+
+constexpr int kNumKeypoints = 50000;
+constexpr int kNumRepetitions = 20;
+
+template <typename DistortionType>
+class BackProject3VectorizedBenchmark : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    camera_ = aslam::PinholeCamera::createTestCamera<DistortionType>();
+    keypoints_.resize(2, kNumKeypoints);
+    for (int i = 0; i < kNumKeypoints; ++i) {
+      keypoints_.col(i) = camera_->createRandomKeypoint();
+    }
+  }
+
+  aslam::PinholeCamera::Ptr camera_;
+  Eigen::Matrix2Xd keypoints_;
+};
+
+using testing::Types;
+typedef Types<aslam::RadTanDistortion, aslam::EquidistantDistortion,
+              aslam::FisheyeDistortion> Implementations;
+TYPED_TEST_CASE(BackProject3VectorizedBenchmark, Implementations);
+
+TYPED_TEST(BackProject3VectorizedBenchmark, CompareToIterativeSolver) {
+  const std::string name =
+      ::testing::UnitTest::GetInstance()->current_test_info()->type_param();
+  Eigen::Matrix3Xd points_iterative, points_batched;
+  std::vector<unsigned char> success_iterative, success_batched;
+
+  // Build the inverse distortion grid outside of the timed section.
+  this->camera_->backProject3Vectorized(
+      this->keypoints_.leftCols(1), &points_batched, &success_batched);
+
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer_iterative("iterative: " + name);
+    this->camera_->aslam::Camera::backProject3Vectorized(
+        this->keypoints_, &points_iterative, &success_iterative);
+    timer_iterative.Stop();
+
+    timing::TimerImpl timer_batched("batched: " + name);
+    this->camera_->backProject3Vectorized(
+        this->keypoints_, &points_batched, &success_batched);
+    timer_batched.Stop();
+  }
+
+  // Accuracy: deviation from the iterative solver and reprojection error in pixels.
+  const double max_deviation = (points_iterative - points_batched).cwiseAbs().maxCoeff();
+  Eigen::Matrix2Xd reprojections_iterative, reprojections_batched;
+  std::vector<aslam::ProjectionResult> results;
+  this->camera_->project3Vectorized(points_iterative, &reprojections_iterative, &results);
+  this->camera_->project3Vectorized(points_batched, &reprojections_batched, &results);
+  const double max_error_iterative =
+      (reprojections_iterative - this->keypoints_).colwise().norm().maxCoeff();
+  const double max_error_batched =
+      (reprojections_batched - this->keypoints_).colwise().norm().maxCoeff();
+  EXPECT_LT(max_deviation, 1e-6);
+  EXPECT_LE(max_error_batched, std::max(max_error_iterative, 1e-6));
+
+  const double mean_iterative = timing::Timing::GetMeanSeconds("iterative: " + name);
+  const double mean_batched = timing::Timing::GetMeanSeconds("batched: " + name);
+  LOG(INFO) << name << ": " << kNumKeypoints << " keypoints, iterative "
+            << mean_iterative * 1e3 << " ms (max reprojection error "
+            << max_error_iterative << " px), batched " << mean_batched * 1e3
+            << " ms (max reprojection error " << max_error_batched
+            << " px), max deviation " << max_deviation << ", speedup "
+            << mean_iterative / mean_batched << "x";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,117 @@
+#include <string>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera-model.h>
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-null.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+
+// Compares the projection with all Jacobians (as used in bundle-adjustment residuals) through
+// the virtual camera interface to the statically dispatched CameraModel and to the
+// CameraModelAdapter.
+
+constexpr int kNumPoints = 50000;
+constexpr int kNumRepetitions = 50;
+
+template<typename Projection, typename Distortion>
+struct ProjectionDistortion {
+  typedef Projection ProjectionType;
+  typedef Distortion DistortionType;
+};
+
+template <typename ProjectionDistortion>
+class CameraModelBenchmark : public testing::Test {
+ public:
+  typedef typename ProjectionDistortion::ProjectionType ProjectionType;
+  typedef typename ProjectionDistortion::DistortionType DistortionType;
+  typedef typename ProjectionType::CameraType CameraType;
+  typedef aslam::CameraModel<ProjectionType, DistortionType> ModelType;
+
+ protected:
+  virtual void SetUp() {
+    camera_ = CameraType::template createTestCamera<DistortionType>();
+    points_.resize(3, kNumPoints);
+    for (int i = 0; i < kNumPoints; ++i) {
+      points_.col(i) = camera_->createRandomVisiblePoint(10.0);
+    }
+  }
+
+  typename CameraType::Ptr camera_;
+  Eigen::Matrix3Xd points_;
+};
+
+using testing::Types;
+typedef Types<ProjectionDistortion<aslam::PinholeProjection, aslam::NullDistortion>,
+    ProjectionDistortion<aslam::PinholeProjection, aslam::RadTanDistortion>,
+    ProjectionDistortion<aslam::PinholeProjection, aslam::EquidistantDistortion>,
+    ProjectionDistortion<aslam::PinholeProjection, aslam::FisheyeDistortion>,
+    ProjectionDistortion<aslam::UnifiedProjection, aslam::RadTanDistortion>,
+    ProjectionDistortion<aslam::UnifiedProjection, aslam::FisheyeDistortion>>
+    Implementations;
+TYPED_TEST_CASE(CameraModelBenchmark, Implementations);
+
+TYPED_TEST(CameraModelBenchmark, ProjectWithJacobians) {
+  typedef typename TestFixture::ModelType ModelType;
+  const std::string name =
+      ::testing::UnitTest::GetInstance()->current_test_info()->type_param();
+  const ModelType model(*this->camera_);
+  const aslam::Camera::Ptr adapter = aslam::createCameraModelAdapter(*this->camera_);
+  ASSERT_TRUE(adapter);
+
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix<double, 2, 3> J_point;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_intrinsics;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_distortion;
+  typename ModelType::IntrinsicsJacobian J_intrinsics_model;
+  typename ModelType::DistortionJacobian J_distortion_model;
+
+  // Accumulate the results such that the compiler can not drop the projections.
+  double sum_virtual = 0.0;
+  double sum_adapter = 0.0;
+  double sum_model = 0.0;
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer_virtual("virtual: " + name);
+    for (int i = 0; i < kNumPoints; ++i) {
+      this->camera_->project3Functional(this->points_.col(i), nullptr, nullptr, &keypoint,
+                                        &J_point, &J_intrinsics, &J_distortion);
+      sum_virtual += keypoint.sum() + J_point.sum() + J_intrinsics.sum();
+    }
+    timer_virtual.Stop();
+
+    timing::TimerImpl timer_adapter("adapter: " + name);
+    for (int i = 0; i < kNumPoints; ++i) {
+      adapter->project3Functional(this->points_.col(i), nullptr, nullptr, &keypoint, &J_point,
+                                  &J_intrinsics, &J_distortion);
+      sum_adapter += keypoint.sum() + J_point.sum() + J_intrinsics.sum();
+    }
+    timer_adapter.Stop();
+
+    timing::TimerImpl timer_model("model: " + name);
+    for (int i = 0; i < kNumPoints; ++i) {
+      model.project3(this->points_.col(i), &keypoint, &J_point, &J_intrinsics_model,
+                     &J_distortion_model);
+      sum_model += keypoint.sum() + J_point.sum() + J_intrinsics_model.sum();
+    }
+    timer_model.Stop();
+  }
+  EXPECT_NEAR(sum_virtual, sum_model, 1e-6 * std::abs(sum_virtual));
+  EXPECT_NEAR(sum_virtual, sum_adapter, 1e-6 * std::abs(sum_virtual));
+
+  const double mean_virtual = timing::Timing::GetMeanSeconds("virtual: " + name);
+  const double mean_adapter = timing::Timing::GetMeanSeconds("adapter: " + name);
+  const double mean_model = timing::Timing::GetMeanSeconds("model: " + name);
+  LOG(INFO) << name << ": " << kNumPoints << " points, virtual " << mean_virtual * 1e3
+            << " ms, adapter " << mean_adapter * 1e3 << " ms (speedup "
+            << mean_virtual / mean_adapter << "x), model " << mean_model * 1e3
+            << " ms (speedup " << mean_virtual / mean_model << "x)";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
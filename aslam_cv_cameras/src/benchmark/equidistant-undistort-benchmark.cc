@@ -0,0 +1,74 @@
+#include <algorithm>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+
+// Compares the inverse modes of EquidistantDistortion: the iterative solver and the
+// polynomial fit, per point and batched.
+
+constexpr int kNumKeypoints = 50000;
+constexpr int kNumRepetitions = 20;
+
+TEST(EquidistantUndistortBenchmark, CompareInverseModes) {
+  aslam::EquidistantDistortion::UniquePtr distortion =
+      aslam::EquidistantDistortion::createTestDistortion();
+  const Eigen::Matrix2Xd keypoints = Eigen::Matrix2Xd::Random(2, kNumKeypoints);
+  Eigen::Matrix2Xd keypoints_iterative(2, kNumKeypoints);
+  Eigen::Matrix2Xd keypoints_fit(2, kNumKeypoints);
+  Eigen::Vector2d keypoint;
+  Eigen::ArrayXd x, y;
+
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    distortion->setInverseMode(aslam::EquidistantDistortion::InverseMode::kIterative);
+    timing::TimerImpl timer_iterative("iterative");
+    for (int i = 0; i < kNumKeypoints; ++i) {
+      distortion->undistort(keypoints.col(i), &keypoint);
+      keypoints_iterative.col(i) = keypoint;
+    }
+    timer_iterative.Stop();
+
+    distortion->setInverseMode(aslam::EquidistantDistortion::InverseMode::kPolynomialFit);
+    timing::TimerImpl timer_fit("polynomial fit");
+    for (int i = 0; i < kNumKeypoints; ++i) {
+      distortion->undistort(keypoints.col(i), &keypoint);
+      keypoints_fit.col(i) = keypoint;
+    }
+    timer_fit.Stop();
+
+    x = keypoints.row(0).transpose().array();
+    y = keypoints.row(1).transpose().array();
+    timing::TimerImpl timer_fit_vectorized("polynomial fit vectorized");
+    distortion->undistortVectorized(&x, &y);
+    timer_fit_vectorized.Stop();
+  }
+
+  // Accuracy: deviation from the iterative solver and residual of the distortion.
+  const double max_deviation = (keypoints_iterative - keypoints_fit).cwiseAbs().maxCoeff();
+  double max_residual_iterative = 0.0;
+  double max_residual_fit = 0.0;
+  for (int i = 0; i < kNumKeypoints; ++i) {
+    distortion->distort(keypoints_iterative.col(i), &keypoint);
+    max_residual_iterative =
+        std::max(max_residual_iterative, (keypoint - keypoints.col(i)).norm());
+    distortion->distort(keypoints_fit.col(i), &keypoint);
+    max_residual_fit = std::max(max_residual_fit, (keypoint - keypoints.col(i)).norm());
+  }
+  EXPECT_LT(max_deviation, 1e-6);
+  EXPECT_LT(max_residual_fit, 1e-11);
+
+  const double mean_iterative = timing::Timing::GetMeanSeconds("iterative");
+  const double mean_fit = timing::Timing::GetMeanSeconds("polynomial fit");
+  const double mean_fit_vectorized = timing::Timing::GetMeanSeconds("polynomial fit vectorized");
+  LOG(INFO) << kNumKeypoints << " keypoints, iterative " << mean_iterative * 1e3
+            << " ms (max residual " << max_residual_iterative << "), polynomial fit "
+            << mean_fit * 1e3 << " ms, vectorized " << mean_fit_vectorized * 1e3
+            << " ms (max residual " << max_residual_fit << "), max deviation "
+            << max_deviation << ", speedup " << mean_iterative / mean_fit_vectorized << "x";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,97 @@
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+
+// Projects a map of points surrounding the camera, of which only a small fraction is in the
+// field of view. Compares projecting all points to projecting only the candidates returned by
+// the field of view pre-culling.
+
+constexpr int kNumPoints = 200000;
+constexpr int kNumRepetitions = 20;
+
+template<typename Camera, typename Distortion>
+struct CameraDistortion {
+  typedef Camera CameraType;
+  typedef Distortion DistortionType;
+};
+
+template <typename CameraDistortion>
+class FieldOfViewCullBenchmark : public testing::Test {
+ public:
+  typedef typename CameraDistortion::CameraType CameraType;
+  typedef typename CameraDistortion::DistortionType DistortionType;
+
+ protected:
+  virtual void SetUp() {
+    camera_ = CameraType::template createTestCamera<DistortionType>();
+    points_ = 20.0 * Eigen::Matrix3Xd::Random(3, kNumPoints);
+  }
+
+  typename CameraType::Ptr camera_;
+  Eigen::Matrix3Xd points_;
+};
+
+using testing::Types;
+typedef Types<CameraDistortion<aslam::PinholeCamera, aslam::RadTanDistortion>,
+    CameraDistortion<aslam::PinholeCamera, aslam::EquidistantDistortion>,
+    CameraDistortion<aslam::UnifiedProjectionCamera, aslam::FisheyeDistortion>>
+    Implementations;
+TYPED_TEST_CASE(FieldOfViewCullBenchmark, Implementations);
+
+TYPED_TEST(FieldOfViewCullBenchmark, CompareToProjectingAllPoints) {
+  const std::string name =
+      ::testing::UnitTest::GetInstance()->current_test_info()->type_param();
+  Eigen::Matrix2Xd keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  size_t num_visible_all = 0u;
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer("all: " + name);
+    this->camera_->project3Vectorized(this->points_, &keypoints, &results);
+    num_visible_all = 0u;
+    for (const aslam::ProjectionResult& result : results) {
+      num_visible_all += result.isKeypointVisible() ? 1u : 0u;
+    }
+    timer.Stop();
+  }
+
+  // Build the bound outside of the timed loop, it is cached by the camera.
+  this->camera_->getFieldOfViewBound();
+  std::vector<int> candidates;
+  Eigen::Matrix3Xd candidate_points;
+  size_t num_visible_culled = 0u;
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer("culled: " + name);
+    this->camera_->getFieldOfViewCandidates(this->points_, &candidates);
+    candidate_points.resize(Eigen::NoChange, candidates.size());
+    for (size_t i = 0u; i < candidates.size(); ++i) {
+      candidate_points.col(i) = this->points_.col(candidates[i]);
+    }
+    this->camera_->project3Vectorized(candidate_points, &keypoints, &results);
+    num_visible_culled = 0u;
+    for (const aslam::ProjectionResult& result : results) {
+      num_visible_culled += result.isKeypointVisible() ? 1u : 0u;
+    }
+    timer.Stop();
+  }
+  EXPECT_EQ(num_visible_all, num_visible_culled);
+
+  const double mean_all = timing::Timing::GetMeanSeconds("all: " + name);
+  const double mean_culled = timing::Timing::GetMeanSeconds("culled: " + name);
+  LOG(INFO) << name << ": " << kNumPoints << " points, " << candidates.size()
+            << " candidates, " << num_visible_all << " visible, project all "
+            << mean_all * 1e3 << " ms, cull and project " << mean_culled * 1e3
+            << " ms, speedup " << mean_all / mean_culled << "x";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,107 @@
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera-3d-lidar.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/memory.h>
+#include <aslam/common/timer.h>
+
+// Projects and back-projects full sweeps of a 128-beam lidar. Compares the per-point calls
+// of the trigonometric functions to the vectorized versions using the angle tables, and
+// reports the time to build a dense range image from a sweep.
+
+constexpr int kNumRepetitions = 20;
+
+class LidarProjectionBenchmark : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    Eigen::VectorXd intrinsics(4);
+    intrinsics[aslam::Camera3DLidar::Parameters::kHorizontalResolutionRad] =
+        2.0 * M_PI / 2048.0;
+    intrinsics[aslam::Camera3DLidar::Parameters::kVerticalResolutionRad] = 0.0061;
+    intrinsics[aslam::Camera3DLidar::Parameters::kVerticalCenterRad] = 0.39;
+    intrinsics[aslam::Camera3DLidar::Parameters::kHorizontalCenterRad] = 0.0;
+    camera_ = aligned_unique<aslam::Camera3DLidar>(intrinsics, 2048u, 128u);
+
+    // One return per pixel with a random range.
+    const int num_points = camera_->imageWidth() * camera_->imageHeight();
+    pixels_.resize(2, num_points);
+    for (uint32_t row = 0u; row < camera_->imageHeight(); ++row) {
+      for (uint32_t col = 0u; col < camera_->imageWidth(); ++col) {
+        pixels_.col(row * camera_->imageWidth() + col) << col + 0.5, row + 0.5;
+      }
+    }
+    Eigen::Vector3d bearing;
+    sweep_.resize(3, num_points);
+    const Eigen::ArrayXd ranges = 50.0 * (Eigen::ArrayXd::Random(num_points) + 1.1);
+    for (int i = 0; i < num_points; ++i) {
+      camera_->backProject3(pixels_.col(i), &bearing);
+      sweep_.col(i) = bearing * ranges[i];
+    }
+  }
+
+  aslam::Camera3DLidar::UniquePtr camera_;
+  Eigen::Matrix2Xd pixels_;
+  Eigen::Matrix3Xd sweep_;
+};
+
+TEST_F(LidarProjectionBenchmark, Sweep) {
+  const int num_points = sweep_.cols();
+  Eigen::Matrix2Xd keypoints_scalar(2, num_points);
+  Eigen::Matrix2Xd keypoints;
+  Eigen::Vector2d keypoint;
+  std::vector<aslam::ProjectionResult> results;
+  Eigen::Matrix3Xd bearings_scalar(3, num_points);
+  Eigen::Matrix3Xd bearings;
+  Eigen::Vector3d bearing;
+  std::vector<unsigned char> success;
+  Eigen::MatrixXf range_image;
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer_project_scalar("project scalar");
+    for (int i = 0; i < num_points; ++i) {
+      camera_->project3(sweep_.col(i), &keypoint);
+      keypoints_scalar.col(i) = keypoint;
+    }
+    timer_project_scalar.Stop();
+
+    timing::TimerImpl timer_project("project vectorized");
+    camera_->project3Vectorized(sweep_, &keypoints, &results);
+    timer_project.Stop();
+
+    timing::TimerImpl timer_back_project_scalar("back-project scalar");
+    for (int i = 0; i < num_points; ++i) {
+      camera_->backProject3(pixels_.col(i), &bearing);
+      bearings_scalar.col(i) = bearing;
+    }
+    timer_back_project_scalar.Stop();
+
+    timing::TimerImpl timer_back_project("back-project vectorized");
+    camera_->backProject3Vectorized(pixels_, &bearings, &success);
+    timer_back_project.Stop();
+
+    timing::TimerImpl timer_range_image("range image");
+    camera_->createRangeImage(sweep_, &range_image, nullptr);
+    timer_range_image.Stop();
+  }
+  EXPECT_LT((keypoints - keypoints_scalar).cwiseAbs().maxCoeff(), 1e-9);
+  EXPECT_LT((bearings - bearings_scalar).cwiseAbs().maxCoeff(), 1e-12);
+  EXPECT_EQ(num_points, (range_image.array() > 0.0f).count());
+
+  const double project_scalar = timing::Timing::GetMeanSeconds("project scalar");
+  const double project = timing::Timing::GetMeanSeconds("project vectorized");
+  const double back_project_scalar = timing::Timing::GetMeanSeconds("back-project scalar");
+  const double back_project = timing::Timing::GetMeanSeconds("back-project vectorized");
+  LOG(INFO) << num_points << " points, project: scalar " << project_scalar * 1e3
+            << " ms, vectorized " << project * 1e3 << " ms, speedup "
+            << project_scalar / project << "x";
+  LOG(INFO) << num_points << " points, back-project: scalar " << back_project_scalar * 1e3
+            << " ms, vectorized " << back_project * 1e3 << " ms, speedup "
+            << back_project_scalar / back_project << "x";
+  LOG(INFO) << "range image: " << timing::Timing::GetMeanSeconds("range image") * 1e3
+            << " ms";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,77 @@
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera.h>
+#include <aslam/cameras/ncamera.h>
+#include <aslam/cameras/random-camera-generator.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/pose-types.h>
+#include <aslam/common/thread-pool.h>
+#include <aslam/common/timer.h>
+
+// Projects a local map into all cameras of a surround-view rig. Compares the hand-written
+// single-threaded rig loop to NCamera::project3Vectorized with an increasing number of threads.
+
+constexpr int kNumPoints = 200000;
+constexpr int kNumRepetitions = 20;
+
+class NCameraProjectionBenchmark : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    ncamera_ = aslam::createSurroundViewTestNCamera();
+    points_B_ = 20.0 * Eigen::Matrix3Xd::Random(3, kNumPoints);
+  }
+
+  aslam::NCamera::Ptr ncamera_;
+  Eigen::Matrix3Xd points_B_;
+};
+
+TEST_F(NCameraProjectionBenchmark, ThreadScaling) {
+  const size_t num_cameras = ncamera_->getNumCameras();
+  std::vector<Eigen::Matrix2Xd> keypoints_loop(num_cameras);
+  std::vector<std::vector<unsigned char>> is_visible_loop(num_cameras);
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer_loop("rig loop");
+    for (size_t cam_idx = 0u; cam_idx < num_cameras; ++cam_idx) {
+      const aslam::Camera& camera = ncamera_->getCamera(cam_idx);
+      const aslam::Transformation& T_C_B = ncamera_->get_T_C_B(cam_idx);
+      keypoints_loop[cam_idx].resize(Eigen::NoChange, kNumPoints);
+      is_visible_loop[cam_idx].resize(kNumPoints);
+      Eigen::Vector2d keypoint;
+      for (int i = 0; i < kNumPoints; ++i) {
+        const Eigen::Vector3d point_B = points_B_.col(i);
+        is_visible_loop[cam_idx][i] =
+            camera.project3(T_C_B * point_B, &keypoint).isKeypointVisible();
+        keypoints_loop[cam_idx].col(i) = keypoint;
+      }
+    }
+    timer_loop.Stop();
+  }
+  const double mean_loop = timing::Timing::GetMeanSeconds("rig loop");
+  LOG(INFO) << num_cameras << " cameras, " << kNumPoints << " points, rig loop: "
+            << mean_loop * 1e3 << " ms";
+
+  for (const size_t num_threads : {1u, 2u, 4u, 8u}) {
+    const std::string tag = "threads: " + std::to_string(num_threads);
+    aslam::ThreadPool thread_pool(num_threads);
+    std::vector<Eigen::Matrix2Xd> keypoints;
+    std::vector<std::vector<unsigned char>> is_visible;
+    for (int rep = 0; rep < kNumRepetitions; ++rep) {
+      timing::TimerImpl timer(tag);
+      ncamera_->project3Vectorized(points_B_, num_threads > 1u ? &thread_pool : nullptr,
+                                   &keypoints, &is_visible);
+      timer.Stop();
+    }
+    EXPECT_EQ(is_visible_loop, is_visible);
+
+    const double mean = timing::Timing::GetMeanSeconds(tag);
+    LOG(INFO) << num_threads << " threads: " << mean * 1e3 << " ms, speedup "
+              << mean_loop / mean << "x";
+  }
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,130 @@
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-null.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+
+// Compares the projection with all Jacobians through per-point calls of project3Functional
+// to project3FunctionalBatch writing into reused buffers. Besides the timings, the number of
+// heap allocations of both variants is reported.
+
+namespace {
+std::atomic<size_t> num_allocations(0u);
+}  // namespace
+
+// Count all heap allocations. Eigen allocates through malloc directly, hence malloc is
+// interposed instead of operator new (glibc only).
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* malloc(size_t size) {
+  ++num_allocations;
+  return __libc_malloc(size);
+}
+
+constexpr int kNumPoints = 50000;
+constexpr int kNumRepetitions = 50;
+
+template<typename Camera, typename Distortion>
+struct CameraDistortion {
+  typedef Camera CameraType;
+  typedef Distortion DistortionType;
+};
+
+template <typename CameraDistortion>
+class Project3BatchBenchmark : public testing::Test {
+ public:
+  typedef typename CameraDistortion::CameraType CameraType;
+  typedef typename CameraDistortion::DistortionType DistortionType;
+
+ protected:
+  virtual void SetUp() {
+    camera_ = CameraType::template createTestCamera<DistortionType>();
+    points_.resize(3, kNumPoints);
+    for (int i = 0; i < kNumPoints; ++i) {
+      points_.col(i) = camera_->createRandomVisiblePoint(10.0);
+    }
+  }
+
+  typename CameraType::Ptr camera_;
+  Eigen::Matrix3Xd points_;
+};
+
+using testing::Types;
+typedef Types<CameraDistortion<aslam::PinholeCamera, aslam::NullDistortion>,
+    CameraDistortion<aslam::PinholeCamera, aslam::RadTanDistortion>,
+    CameraDistortion<aslam::PinholeCamera, aslam::EquidistantDistortion>,
+    CameraDistortion<aslam::PinholeCamera, aslam::FisheyeDistortion>,
+    CameraDistortion<aslam::UnifiedProjectionCamera, aslam::RadTanDistortion>,
+    CameraDistortion<aslam::UnifiedProjectionCamera, aslam::FisheyeDistortion>>
+    Implementations;
+TYPED_TEST_CASE(Project3BatchBenchmark, Implementations);
+
+TYPED_TEST(Project3BatchBenchmark, CompareToPerPointProjection) {
+  const std::string name =
+      ::testing::UnitTest::GetInstance()->current_test_info()->type_param();
+  const int num_intrinsics = this->camera_->getParameterSize();
+  const int num_distortion_params = this->camera_->getDistortion().getParameterSize();
+
+  // Preallocated outputs as they would be owned by the optimizer.
+  Eigen::Matrix2Xd keypoints(2, kNumPoints);
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_point(2, 3 * kNumPoints);
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_intrinsics(2, num_intrinsics * kNumPoints);
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_distortion(2, num_distortion_params * kNumPoints);
+  std::vector<aslam::ProjectionResult> results(kNumPoints);
+
+  size_t allocations_per_point = 0u;
+  size_t allocations_batch = 0u;
+  double sum_per_point = 0.0;
+  double sum_batch = 0.0;
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer_per_point("per-point: " + name);
+    size_t allocations_before = num_allocations;
+    for (int i = 0; i < kNumPoints; ++i) {
+      Eigen::Vector2d keypoint;
+      Eigen::Matrix<double, 2, 3> J_point_single;
+      Eigen::Matrix<double, 2, Eigen::Dynamic> J_intrinsics_single;
+      Eigen::Matrix<double, 2, Eigen::Dynamic> J_distortion_single;
+      results[i] = this->camera_->project3Functional(
+          this->points_.col(i), nullptr, nullptr, &keypoint, &J_point_single,
+          &J_intrinsics_single, &J_distortion_single);
+      keypoints.col(i) = keypoint;
+      J_point.middleCols<3>(3 * i) = J_point_single;
+      J_intrinsics.middleCols(num_intrinsics * i, num_intrinsics) = J_intrinsics_single;
+      J_distortion.middleCols(num_distortion_params * i, num_distortion_params) =
+          J_distortion_single;
+    }
+    allocations_per_point += num_allocations - allocations_before;
+    timer_per_point.Stop();
+    sum_per_point += keypoints.sum() + J_point.sum() + J_intrinsics.sum();
+
+    timing::TimerImpl timer_batch("batch: " + name);
+    allocations_before = num_allocations;
+    this->camera_->project3FunctionalBatch(this->points_, nullptr, nullptr, &keypoints,
+                                           &J_point, &J_intrinsics, &J_distortion, &results);
+    allocations_batch += num_allocations - allocations_before;
+    timer_batch.Stop();
+    sum_batch += keypoints.sum() + J_point.sum() + J_intrinsics.sum();
+  }
+  EXPECT_NEAR(sum_per_point, sum_batch, 1e-6 * std::abs(sum_per_point));
+  EXPECT_EQ(0u, allocations_batch);
+
+  const double mean_per_point = timing::Timing::GetMeanSeconds("per-point: " + name);
+  const double mean_batch = timing::Timing::GetMeanSeconds("batch: " + name);
+  LOG(INFO) << name << ": " << kNumPoints << " points, per-point " << mean_per_point * 1e3
+            << " ms (" << allocations_per_point / kNumRepetitions << " allocations), batch "
+            << mean_batch * 1e3 << " ms (" << allocations_batch / kNumRepetitions
+            << " allocations), speedup " << mean_per_point / mean_batch << "x";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,80 @@
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-null.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+
+// Compares the block-wise PinholeCamera::project3Vectorized to the per-point
+// projection loop of the base class.
+
+constexpr int kNumPoints = 50000;
+constexpr int kNumRepetitions = 50;
+
+template <typename DistortionType>
+class Project3VectorizedBenchmark : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    camera_ = aslam::PinholeCamera::createTestCamera<DistortionType>();
+    points_.resize(3, kNumPoints);
+    for (int i = 0; i < kNumPoints; ++i) {
+      points_.col(i) = camera_->createRandomVisiblePoint(10.0);
+    }
+  }
+
+  aslam::PinholeCamera::Ptr camera_;
+  Eigen::Matrix3Xd points_;
+};
+
+using testing::Types;
+typedef Types<aslam::NullDistortion, aslam::RadTanDistortion,
+              aslam::EquidistantDistortion, aslam::FisheyeDistortion>
+    Implementations;
+TYPED_TEST_CASE(Project3VectorizedBenchmark, Implementations);
+
+TYPED_TEST(Project3VectorizedBenchmark, CompareToPerPointProjection) {
+  const std::string name =
+      ::testing::UnitTest::GetInstance()->current_test_info()->type_param();
+  Eigen::Matrix2Xd keypoints_loop(2, kNumPoints);
+  Eigen::Matrix2Xd keypoints_vectorized;
+  std::vector<aslam::ProjectionResult> results_loop(kNumPoints);
+  std::vector<aslam::ProjectionResult> results_vectorized;
+
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer_loop("per-point: " + name);
+    Eigen::Vector2d keypoint;
+    for (int i = 0; i < kNumPoints; ++i) {
+      results_loop[i] = this->camera_->project3(this->points_.col(i), &keypoint);
+      keypoints_loop.col(i) = keypoint;
+    }
+    timer_loop.Stop();
+
+    timing::TimerImpl timer_vectorized("vectorized: " + name);
+    this->camera_->project3Vectorized(
+        this->points_, &keypoints_vectorized, &results_vectorized);
+    timer_vectorized.Stop();
+  }
+
+  ASSERT_EQ(results_loop.size(), results_vectorized.size());
+  for (int i = 0; i < kNumPoints; ++i) {
+    EXPECT_EQ(results_loop[i], results_vectorized[i]);
+  }
+  EXPECT_LT((keypoints_loop - keypoints_vectorized).cwiseAbs().maxCoeff(), 1e-9);
+
+  const double mean_loop = timing::Timing::GetMeanSeconds("per-point: " + name);
+  const double mean_vectorized =
+      timing::Timing::GetMeanSeconds("vectorized: " + name);
+  LOG(INFO) << name << ": " << kNumPoints << " points, per-point "
+            << mean_loop * 1e3 << " ms, vectorized " << mean_vectorized * 1e3
+            << " ms, speedup " << mean_loop / mean_vectorized << "x";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
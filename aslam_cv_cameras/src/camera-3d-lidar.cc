@@ -1,5 +1,7 @@
 #include "aslam/cameras/camera-3d-lidar.h"
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <utility>
 
@@ -39,6 +41,73 @@ bool Camera3DLidar::backProject3(
   return true;
 }
 
+void Camera3DLidar::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+    Eigen::Matrix3Xd* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+  getAngleTable()->backProject(keypoints, out_points_3d);
+  out_success->assign(keypoints.cols(), true);
+}
+
+void Camera3DLidar::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  getAngleTable()->project(points_3d, out_keypoints);
+  const int num_points = points_3d.cols();
+  out_results->resize(num_points);
+  for (int i = 0; i < num_points; ++i) {
+    if (points_3d.col(i).norm() < 1e-6) {
+      (*out_results)[i] = ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+    } else {
+      (*out_results)[i] = evaluateProjectionResult(out_keypoints->col(i), points_3d.col(i));
+    }
+  }
+}
+
+void Camera3DLidar::createRangeImage(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::MatrixXf* out_range_image, Eigen::MatrixXi* out_point_indices) const {
+  CHECK_NOTNULL(out_range_image);
+  Eigen::Matrix2Xd keypoints;
+  getAngleTable()->project(points_3d, &keypoints);
+
+  out_range_image->setZero(imageHeight(), imageWidth());
+  if (out_point_indices != nullptr) {
+    out_point_indices->setConstant(imageHeight(), imageWidth(), -1);
+  }
+  const int num_points = points_3d.cols();
+  for (int i = 0; i < num_points; ++i) {
+    const double squared_range = points_3d.col(i).squaredNorm();
+    if (squared_range <= kSquaredMinimumDepth || !isKeypointVisible(keypoints.col(i))) {
+      continue;
+    }
+    const int row = static_cast<int>(keypoints(1, i));
+    const int col = static_cast<int>(keypoints(0, i));
+    const float range = static_cast<float>(std::sqrt(squared_range));
+    float& pixel = (*out_range_image)(row, col);
+    if (pixel == 0.0f || range < pixel) {
+      pixel = range;
+      if (out_point_indices != nullptr) {
+        (*out_point_indices)(row, col) = i;
+      }
+    }
+  }
+}
+
+LidarAngleTable::ConstPtr Camera3DLidar::getAngleTable() const {
+  LidarAngleTable::ConstPtr table = std::atomic_load(&angle_table_);
+  if (!table || !table->isValidFor(intrinsics_, imageWidth(), imageHeight())) {
+    table = aligned_shared<const LidarAngleTable>(intrinsics_, imageWidth(), imageHeight());
+    std::atomic_store(&angle_table_, table);
+  }
+  return table;
+}
+
 const ProjectionResult Camera3DLidar::project3Functional(
     const Eigen::Ref<const Eigen::Vector3d>& point_3d,
     const Eigen::VectorXd* intrinsics_external,
@@ -157,6 +226,7 @@ void Camera3DLidar::setRandomImpl() {
   if (test_camera->distortion_) {
     distortion_ = std::move(test_camera->distortion_);
   }
+  invalidateCalibrationCaches();
 }
 
 bool Camera3DLidar::isEqualImpl(const Sensor& other, const bool verbose) const {
@@ -182,4 +252,16 @@ bool Camera3DLidar::isEqualImpl(const Sensor& other, const bool verbose) const {
   return true;
 }
 
+void Camera3DLidar::computeFieldOfViewBound(FieldOfViewBound* bound) const {
+  CHECK_NOTNULL(bound);
+  // The image rows cover the elevations [-verticalCenter, height * resolution - verticalCenter].
+  constexpr double kMarginRad = 1e-6;
+  const double min_elevation = std::max(-verticalCenter(), -M_PI_2) - kMarginRad;
+  const double max_elevation =
+      std::min(imageHeight() * verticalResolution() - verticalCenter(), M_PI_2) + kMarginRad;
+  // The elevation asin(y / |p|) is pi/2 minus the angle between the point and the y-axis.
+  bound->addCone(Eigen::Vector3d::UnitY(), M_PI_2 - min_elevation);
+  bound->addCone(-Eigen::Vector3d::UnitY(), M_PI_2 + max_elevation);
+}
+
 }  // namespace aslam
@@ -0,0 +1,181 @@
+#include "aslam/cameras/camera-model.h"
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace {
+template <typename Projection>
+Camera::Ptr createAdapterForDistortion(const Camera& camera) {
+  typedef typename Projection::CameraType CameraType;
+  const CameraType& typed_camera = static_cast<const CameraType&>(camera);
+  switch (camera.getDistortion().getType()) {
+    case Distortion::Type::kNoDistortion:
+      return aligned_shared<CameraModelAdapter<Projection, NullDistortion>>(typed_camera);
+    case Distortion::Type::kRadTan:
+      return aligned_shared<CameraModelAdapter<Projection, RadTanDistortion>>(typed_camera);
+    case Distortion::Type::kEquidistant:
+      return aligned_shared<CameraModelAdapter<Projection, EquidistantDistortion>>(
+          typed_camera);
+    case Distortion::Type::kFisheye:
+      return aligned_shared<CameraModelAdapter<Projection, FisheyeDistortion>>(typed_camera);
+    default:
+      LOG(FATAL) << "Unknown distortion model: "
+                 << static_cast<int>(camera.getDistortion().getType());
+  }
+  return Camera::Ptr();
+}
+
+template <typename Projection, typename DistortionType>
+void project3FunctionalBatchImpl(
+    const Camera& camera, const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    const Eigen::VectorXd* intrinsics_external,
+    const Eigen::VectorXd* distortion_coefficients_external, Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results) {
+  typedef CameraModel<Projection, DistortionType> Model;
+  enum {
+    kNumOfIntrinsics = Model::kNumOfIntrinsics,
+    kNumOfDistortionParams = Model::kNumOfDistortionParams
+  };
+
+  // Use the internal parameters if no external ones are given.
+  const Eigen::VectorXd& intrinsics =
+      intrinsics_external ? *intrinsics_external : camera.getParameters();
+  const Eigen::VectorXd& distortion_coefficients =
+      distortion_coefficients_external ? *distortion_coefficients_external
+                                       : camera.getDistortion().getParameters();
+  CHECK_EQ(intrinsics.size(), kNumOfIntrinsics) << "intrinsics: invalid size!";
+  CHECK_EQ(distortion_coefficients.size(), kNumOfDistortionParams)
+      << "dist_coeffs: invalid size!";
+  const Eigen::Map<const typename Model::IntrinsicsVector> intrinsics_map(intrinsics.data());
+  const Eigen::Map<const typename Model::DistortionVector> distortion_map(
+      distortion_coefficients.data());
+
+  const int num_points = points_3d.cols();
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+  if (out_jacobians_point) {
+    out_jacobians_point->resize(Eigen::NoChange, 3 * num_points);
+  }
+  if (out_jacobians_intrinsics) {
+    out_jacobians_intrinsics->resize(Eigen::NoChange, kNumOfIntrinsics * num_points);
+  }
+  if (out_jacobians_distortion) {
+    out_jacobians_distortion->resize(Eigen::NoChange, kNumOfDistortionParams * num_points);
+  }
+
+  Eigen::Vector3d point;
+  Eigen::Vector2d keypoint;
+  typename Model::PointJacobian J_point;
+  typename Model::IntrinsicsJacobian J_intrinsics;
+  typename Model::DistortionJacobian J_distortion;
+  for (int i = 0; i < num_points; ++i) {
+    point = points_3d.col(i);
+    const bool valid = Model::project3Functional(
+        intrinsics_map, distortion_map, point, &keypoint,
+        out_jacobians_point ? &J_point : nullptr,
+        out_jacobians_intrinsics ? &J_intrinsics : nullptr,
+        out_jacobians_distortion ? &J_distortion : nullptr);
+    out_keypoints->col(i) = keypoint;
+    (*out_results)[i] = valid ? Projection::evaluateProjectionResult(
+        keypoint, point, camera.imageWidth(), camera.imageHeight()) :
+        ProjectionResult(ProjectionResult::Status::PROJECTION_INVALID);
+    if (out_jacobians_point) {
+      out_jacobians_point->template middleCols<3>(3 * i) = J_point;
+    }
+    if (out_jacobians_intrinsics) {
+      out_jacobians_intrinsics->template middleCols<kNumOfIntrinsics>(kNumOfIntrinsics * i) =
+          J_intrinsics;
+    }
+    if (out_jacobians_distortion) {
+      out_jacobians_distortion->template middleCols<kNumOfDistortionParams>(
+          kNumOfDistortionParams * i) = J_distortion;
+    }
+  }
+}
+
+template <typename Projection>
+void project3FunctionalBatchForDistortion(
+    const Camera& camera, const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    const Eigen::VectorXd* intrinsics_external,
+    const Eigen::VectorXd* distortion_coefficients_external, Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results) {
+  switch (camera.getDistortion().getType()) {
+    case Distortion::Type::kNoDistortion:
+      project3FunctionalBatchImpl<Projection, NullDistortion>(
+          camera, points_3d, intrinsics_external, distortion_coefficients_external,
+          out_keypoints, out_jacobians_point, out_jacobians_intrinsics,
+          out_jacobians_distortion, out_results);
+      break;
+    case Distortion::Type::kRadTan:
+      project3FunctionalBatchImpl<Projection, RadTanDistortion>(
+          camera, points_3d, intrinsics_external, distortion_coefficients_external,
+          out_keypoints, out_jacobians_point, out_jacobians_intrinsics,
+          out_jacobians_distortion, out_results);
+      break;
+    case Distortion::Type::kEquidistant:
+      project3FunctionalBatchImpl<Projection, EquidistantDistortion>(
+          camera, points_3d, intrinsics_external, distortion_coefficients_external,
+          out_keypoints, out_jacobians_point, out_jacobians_intrinsics,
+          out_jacobians_distortion, out_results);
+      break;
+    case Distortion::Type::kFisheye:
+      project3FunctionalBatchImpl<Projection, FisheyeDistortion>(
+          camera, points_3d, intrinsics_external, distortion_coefficients_external,
+          out_keypoints, out_jacobians_point, out_jacobians_intrinsics,
+          out_jacobians_distortion, out_results);
+      break;
+    default:
+      LOG(FATAL) << "Unknown distortion model: "
+                 << static_cast<int>(camera.getDistortion().getType());
+  }
+}
+}  // namespace
+
+Camera::Ptr createCameraModelAdapter(const Camera& camera) {
+  switch (camera.getType()) {
+    case Camera::Type::kPinhole:
+      return createAdapterForDistortion<PinholeProjection>(camera);
+    case Camera::Type::kUnifiedProjection:
+      return createAdapterForDistortion<UnifiedProjection>(camera);
+    default:
+      // No specialized model for this camera.
+      return Camera::Ptr();
+  }
+}
+
+bool project3FunctionalBatchWithCameraModel(
+    const Camera& camera, const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    const Eigen::VectorXd* intrinsics_external,
+    const Eigen::VectorXd* distortion_coefficients_external, Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results) {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  switch (camera.getType()) {
+    case Camera::Type::kPinhole:
+      project3FunctionalBatchForDistortion<PinholeProjection>(
+          camera, points_3d, intrinsics_external, distortion_coefficients_external,
+          out_keypoints, out_jacobians_point, out_jacobians_intrinsics,
+          out_jacobians_distortion, out_results);
+      return true;
+    case Camera::Type::kUnifiedProjection:
+      project3FunctionalBatchForDistortion<UnifiedProjection>(
+          camera, points_3d, intrinsics_external, distortion_coefficients_external,
+          out_keypoints, out_jacobians_point, out_jacobians_intrinsics,
+          out_jacobians_distortion, out_results);
+      return true;
+    default:
+      // No specialized model for this camera.
+      return false;
+  }
+}
+
+}  // namespace aslam
@@ -1,9 +1,12 @@
+#include <algorithm>
 #include <memory>
 #include <utility>
 
 #include <aslam/cameras/camera-pinhole.h>
 
 #include <aslam/cameras/camera-factory.h>
+#include <aslam/cameras/camera-model.h>
+#include <aslam/cameras/distortion-equidistant.h>
 #include <aslam/common/types.h>
 
 #include "aslam/cameras/random-camera-generator.h"
@@ -48,6 +51,10 @@ bool PinholeCamera::backProject3(const Eigen::Ref<const Eigen::Vector2d>& keypoi
                                  Eigen::Vector3d* out_point_3d) const {
   CHECK_NOTNULL(out_point_3d);
 
+  if (backProject3FromLookupTable(keypoint, out_point_3d)) {
+    return true;
+  }
+
   Eigen::Vector2d kp = keypoint;
   kp[0] = (kp[0] - cu()) / fu();
   kp[1] = (kp[1] - cv()) / fv();
@@ -62,6 +69,142 @@ bool PinholeCamera::backProject3(const Eigen::Ref<const Eigen::Vector2d>& keypoi
   return true;
 }
 
+void PinholeCamera::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+    Eigen::Matrix3Xd* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+  if (backProject3VectorizedFromLookupTable(keypoints, out_points_3d, out_success)) {
+    return;
+  }
+  backProject3VectorizedImpl<double>(keypoints, out_points_3d, out_success);
+}
+
+void PinholeCamera::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+    Eigen::Matrix3Xf* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+  if (isBearingLookupTableEnabled()) {
+    // The table is queried in double precision.
+    Camera::backProject3Vectorized(keypoints, out_points_3d, out_success);
+    return;
+  }
+  backProject3VectorizedImpl<float>(keypoints, out_points_3d, out_success);
+}
+
+template <typename ScalarType>
+void PinholeCamera::backProject3VectorizedImpl(
+    const Eigen::Ref<const Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>>& keypoints,
+    Eigen::Matrix<ScalarType, 3, Eigen::Dynamic>* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  typedef Eigen::Array<ScalarType, Eigen::Dynamic, 1> ArrayType;
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+  const int num_points = keypoints.cols();
+  out_points_3d->resize(Eigen::NoChange, num_points);
+  // Always valid for the pinhole model.
+  out_success->assign(num_points, true);
+  if (num_points == 0) {
+    return;
+  }
+
+  ArrayType x = (keypoints.row(0).transpose().array() - static_cast<ScalarType>(cu())) /
+      static_cast<ScalarType>(fu());
+  ArrayType y = (keypoints.row(1).transpose().array() - static_cast<ScalarType>(cv())) /
+      static_cast<ScalarType>(fv());
+
+  switch (distortion_->getType()) {
+    case Distortion::Type::kEquidistant:
+      if (static_cast<const EquidistantDistortion&>(*distortion_).getInverseMode() ==
+          EquidistantDistortion::InverseMode::kPolynomialFit) {
+        distortion_->undistortVectorized(&x, &y);
+      } else {
+        getInverseDistortionGrid()->undistort(&x, &y);
+      }
+      break;
+    case Distortion::Type::kRadTan:
+      // No closed-form inverse.
+      getInverseDistortionGrid()->undistort(&x, &y);
+      break;
+    default:
+      distortion_->undistortVectorized(&x, &y);
+      break;
+  }
+
+  out_points_3d->row(0) = x.matrix().transpose();
+  out_points_3d->row(1) = y.matrix().transpose();
+  out_points_3d->row(2).setOnes();
+}
+
+InverseDistortionGrid::ConstPtr PinholeCamera::getInverseDistortionGrid() const {
+  // Span the grid over the image area in the (distorted) normalized image plane.
+  const Eigen::Vector2d min_distorted(-cu() / fu(), -cv() / fv());
+  const Eigen::Vector2d max_distorted(
+      (imageWidth() - cu()) / fu(), (imageHeight() - cv()) / fv());
+
+  InverseDistortionGrid::ConstPtr grid = std::atomic_load(&inverse_distortion_grid_);
+  if (!grid || !grid->isValidFor(*distortion_, min_distorted, max_distorted)) {
+    grid = aligned_shared<const InverseDistortionGrid>(
+        *distortion_, min_distorted, max_distorted);
+    std::atomic_store(&inverse_distortion_grid_, grid);
+  }
+  return grid;
+}
+
+void PinholeCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    Eigen::Matrix2Xd* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3VectorizedImpl<double>(points_3d, out_keypoints, out_results);
+}
+
+void PinholeCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  project3VectorizedImpl<float>(points_3d, out_keypoints, out_results);
+}
+
+template <typename ScalarType>
+void PinholeCamera::project3VectorizedImpl(
+    const Eigen::Ref<const Eigen::Matrix<ScalarType, 3, Eigen::Dynamic>>& points_3d,
+    Eigen::Matrix<ScalarType, 2, Eigen::Dynamic>* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  typedef Eigen::Array<ScalarType, Eigen::Dynamic, 1> ArrayType;
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  const int num_points = points_3d.cols();
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+  if (num_points == 0) {
+    return;
+  }
+
+  // Project onto the normalized image plane.
+  const ArrayType rz = points_3d.row(2).transpose().array().inverse();
+  ArrayType x = points_3d.row(0).transpose().array() * rz;
+  ArrayType y = points_3d.row(1).transpose().array() * rz;
+
+  // Distort all points in one go.
+  distortion_->distortVectorized(&x, &y);
+
+  // Normalized image plane to camera plane.
+  const ScalarType fu_s = static_cast<ScalarType>(fu());
+  const ScalarType fv_s = static_cast<ScalarType>(fv());
+  const ScalarType cu_s = static_cast<ScalarType>(cu());
+  const ScalarType cv_s = static_cast<ScalarType>(cv());
+  out_keypoints->row(0) = (fu_s * x + cu_s).matrix().transpose();
+  out_keypoints->row(1) = (fv_s * y + cv_s).matrix().transpose();
+
+  for (int i = 0; i < num_points; ++i) {
+    (*out_results)[i] =
+        evaluateProjectionResult(out_keypoints->col(i), points_3d.col(i));
+  }
+}
+
 const ProjectionResult PinholeCamera::project3Functional(
     const Eigen::Ref<const Eigen::Vector3d>& point_3d,
     const Eigen::VectorXd* intrinsics_external,
@@ -163,6 +306,21 @@ const ProjectionResult PinholeCamera::project3Functional(
   return evaluateProjectionResult(*out_keypoint, point_3d);
 }
 
+void PinholeCamera::project3FunctionalBatch(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    const Eigen::VectorXd* intrinsics_external,
+    const Eigen::VectorXd* distortion_coefficients_external,
+    Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results) const {
+  const bool has_model = project3FunctionalBatchWithCameraModel(
+      *this, points_3d, intrinsics_external, distortion_coefficients_external, out_keypoints,
+      out_jacobians_point, out_jacobians_intrinsics, out_jacobians_distortion, out_results);
+  CHECK(has_model);
+}
+
 Eigen::Vector2d PinholeCamera::createRandomKeypoint() const {
   Eigen::Vector2d out;
   out.setRandom();
@@ -249,6 +407,7 @@ void PinholeCamera::setRandomImpl() {
   if (test_camera->distortion_) {
     distortion_ = std::move(test_camera->distortion_);
   }
+  invalidateCalibrationCaches();
 }
 
 bool PinholeCamera::isEqualImpl(const Sensor& other, const bool verbose) const {
@@ -279,4 +438,34 @@ PinholeCamera::Ptr PinholeCamera::createTestCamera() {
   return camera;
 }
 
+void PinholeCamera::computeFieldOfViewBound(FieldOfViewBound* bound) const {
+  CHECK_NOTNULL(bound);
+  constexpr double kBorderSampleSpacingPx = 4.0;
+  const Eigen::Matrix2Xd border_keypoints = getImageBorderKeypoints(kBorderSampleSpacingPx);
+  Eigen::Matrix3Xd border_bearings;
+  std::vector<unsigned char> success;
+  backProject3Vectorized(border_keypoints, &border_bearings, &success);
+  if (std::find(success.begin(), success.end(), false) != success.end() ||
+      (border_bearings.row(2).array() <= 0.0).any()) {
+    Camera::computeFieldOfViewBound(bound);
+    return;
+  }
+  const Eigen::Matrix2Xd border_normalized =
+      border_bearings.topRows<2>().array().rowwise() / border_bearings.row(2).array();
+
+  // The distance between neighboring samples is added as margin for the border in between.
+  double margin = 0.0;
+  const int num_samples = border_normalized.cols();
+  for (int i = 0; i < num_samples; ++i) {
+    margin = std::max(margin, (border_normalized.col((i + 1) % num_samples) -
+                               border_normalized.col(i)).norm());
+  }
+  const Eigen::Vector2d min_normalized = border_normalized.rowwise().minCoeff().array() - margin;
+  const Eigen::Vector2d max_normalized = border_normalized.rowwise().maxCoeff().array() + margin;
+  bound->addHalfSpace(Eigen::Vector3d(1.0, 0.0, -min_normalized.x()));
+  bound->addHalfSpace(Eigen::Vector3d(-1.0, 0.0, max_normalized.x()));
+  bound->addHalfSpace(Eigen::Vector3d(0.0, 1.0, -min_normalized.y()));
+  bound->addHalfSpace(Eigen::Vector3d(0.0, -1.0, max_normalized.y()));
+}
+
 }  // namespace aslam
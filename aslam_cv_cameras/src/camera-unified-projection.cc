@@ -1,8 +1,10 @@
+#include <cmath>
 #include <memory>
 
 #include <aslam/cameras/camera-unified-projection.h>
 
 #include <aslam/cameras/camera-factory.h>
+#include <aslam/cameras/camera-model.h>
 #include <aslam/cameras/camera-pinhole.h>
 #include <aslam/common/types.h>
 
@@ -55,6 +57,10 @@ bool UnifiedProjectionCamera::backProject3(const Eigen::Ref<const Eigen::Vector2
                                            Eigen::Vector3d* out_point_3d) const {
   CHECK_NOTNULL(out_point_3d);
 
+  if (backProject3FromLookupTable(keypoint, out_point_3d)) {
+    return true;
+  }
+
   Eigen::Vector2d kp = keypoint;
   kp[0] = (kp[0] - cu()) / fu();
   kp[1] = (kp[1] - cv()) / fv();
@@ -233,6 +239,21 @@ bool UnifiedProjectionCamera::isLiftable(const Eigen::Ref<const Eigen::Vector2d>
   return isUndistortedKeypointValid(rho2_d, xi());
 }
 
+void UnifiedProjectionCamera::project3FunctionalBatch(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    const Eigen::VectorXd* intrinsics_external,
+    const Eigen::VectorXd* distortion_coefficients_external,
+    Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results) const {
+  const bool has_model = project3FunctionalBatchWithCameraModel(
+      *this, points_3d, intrinsics_external, distortion_coefficients_external, out_keypoints,
+      out_jacobians_point, out_jacobians_intrinsics, out_jacobians_distortion, out_results);
+  CHECK(has_model);
+}
+
 Eigen::Vector2d UnifiedProjectionCamera::createRandomKeypoint() const {
   // This is tricky...The camera model defines a circle on the normalized image
   // plane and the projection equations don't work outside of it.
@@ -335,6 +356,7 @@ void UnifiedProjectionCamera::setRandomImpl() {
   if (test_camera->distortion_) {
     distortion_ = std::move(test_camera->distortion_);
   }
+  invalidateCalibrationCaches();
 }
 
 bool UnifiedProjectionCamera::isEqualImpl(const Sensor& other, const bool verbose) const {
@@ -365,4 +387,12 @@ UnifiedProjectionCamera::Ptr UnifiedProjectionCamera::createTestCamera() {
   camera->setId(id);
   return camera;
 }
+
+void UnifiedProjectionCamera::computeFieldOfViewBound(FieldOfViewBound* bound) const {
+  CHECK_NOTNULL(bound);
+  // Points with z <= -fov_parameter(xi) * |p| don't have a valid projection.
+  bound->addCone(Eigen::Vector3d::UnitZ(), std::acos(-fov_parameter(xi())));
+  Camera::computeFieldOfViewBound(bound);
+}
+
 }  // namespace aslam
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <memory>
 
 #include <glog/logging.h>
@@ -48,7 +50,9 @@ Camera::Camera(
       is_compressed_(false),
       intrinsics_(intrinsics),
       camera_type_(camera_type),
-      distortion_(std::move(distortion)) {
+      distortion_(std::move(distortion)),
+      bearing_lookup_table_subsampling_(0),
+      is_building_bearing_lookup_table_(false) {
   CHECK_NOTNULL(distortion_.get());
 }
 
@@ -62,7 +66,9 @@ Camera::Camera(
       is_compressed_(false),
       intrinsics_(intrinsics),
       camera_type_(camera_type),
-      distortion_(new NullDistortion()) {}
+      distortion_(new NullDistortion()),
+      bearing_lookup_table_subsampling_(0),
+      is_building_bearing_lookup_table_(false) {}
 
 void Camera::printParameters(std::ostream& out, const std::string& text) const {
   if (text.size() > 0) {
@@ -108,6 +114,7 @@ bool Camera::loadFromYamlNodeImpl(const YAML::Node& yaml_node) {
     LOG(ERROR) << "Unable to parse the camera because the node is not a map.";
     return false;
   }
+  invalidateCalibrationCaches();
 
   // Determine the distortion type. Start with no distortion.
   const YAML::Node& distortion_config = yaml_node["distortion"];
@@ -426,6 +433,233 @@ void Camera::backProject3Vectorized(
   }
 }
 
+void Camera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xf>& points_3d,
+    Eigen::Matrix2Xf* out_keypoints,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  Eigen::Matrix2Xd keypoints;
+  project3Vectorized(points_3d.cast<double>(), &keypoints, out_results);
+  *out_keypoints = keypoints.cast<float>();
+}
+
+void Camera::backProject3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix2Xf>& keypoints,
+    Eigen::Matrix3Xf* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+  Eigen::Matrix3Xd points_3d;
+  backProject3Vectorized(keypoints.cast<double>(), &points_3d, out_success);
+  *out_points_3d = points_3d.cast<float>();
+}
+
+void Camera::project3FunctionalBatch(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    const Eigen::VectorXd* intrinsics_external,
+    const Eigen::VectorXd* distortion_coefficients_external,
+    Eigen::Matrix2Xd* out_keypoints,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_point,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_intrinsics,
+    Eigen::Matrix<double, 2, Eigen::Dynamic>* out_jacobians_distortion,
+    std::vector<ProjectionResult>* out_results) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_results);
+  const int num_points = points_3d.cols();
+  const int num_intrinsics = getParameterSize();
+  const int num_distortion_params = getDistortion().getParameterSize();
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  out_results->resize(num_points, ProjectionResult::Status::UNINITIALIZED);
+  if (out_jacobians_point) {
+    out_jacobians_point->resize(Eigen::NoChange, 3 * num_points);
+  }
+  if (out_jacobians_intrinsics) {
+    out_jacobians_intrinsics->resize(Eigen::NoChange, num_intrinsics * num_points);
+  }
+  if (out_jacobians_distortion) {
+    out_jacobians_distortion->resize(Eigen::NoChange, num_distortion_params * num_points);
+  }
+
+  // The temporaries are shared by all points such that they are allocated at most once.
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix<double, 2, 3> J_point;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_intrinsics(2, num_intrinsics);
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_distortion(2, num_distortion_params);
+  for (int i = 0; i < num_points; ++i) {
+    (*out_results)[i] = project3Functional(
+        points_3d.col(i), intrinsics_external, distortion_coefficients_external, &keypoint,
+        out_jacobians_point ? &J_point : nullptr,
+        out_jacobians_intrinsics ? &J_intrinsics : nullptr,
+        out_jacobians_distortion ? &J_distortion : nullptr);
+    out_keypoints->col(i) = keypoint;
+    if (out_jacobians_point) {
+      out_jacobians_point->middleCols<3>(3 * i) = J_point;
+    }
+    if (out_jacobians_intrinsics) {
+      out_jacobians_intrinsics->middleCols(num_intrinsics * i, num_intrinsics) = J_intrinsics;
+    }
+    if (out_jacobians_distortion) {
+      out_jacobians_distortion->middleCols(num_distortion_params * i, num_distortion_params) =
+          J_distortion;
+    }
+  }
+}
+
+void Camera::enableBearingLookupTable(int subsampling) {
+  CHECK_GT(subsampling, 0);
+  bearing_lookup_table_subsampling_ = subsampling;
+}
+
+void Camera::disableBearingLookupTable() {
+  bearing_lookup_table_subsampling_ = 0;
+  invalidateBearingLookupTable();
+}
+
+size_t Camera::getBearingLookupTableMemoryBytes() const {
+  BearingLookupTable::ConstPtr table = std::atomic_load(&bearing_lookup_table_);
+  return table ? table->getMemoryFootprintBytes() : 0u;
+}
+
+void Camera::invalidateBearingLookupTable() {
+  std::atomic_store(&bearing_lookup_table_, BearingLookupTable::ConstPtr());
+}
+
+void Camera::invalidateCalibrationCaches() {
+  invalidateBearingLookupTable();
+  std::atomic_store(&field_of_view_bound_, FieldOfViewBound::ConstPtr());
+}
+
+void Camera::getFieldOfViewCandidates(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+    std::vector<int>* out_candidate_indices) const {
+  CHECK_NOTNULL(out_candidate_indices);
+  getFieldOfViewBound()->getCandidates(points_3d, out_candidate_indices);
+}
+
+FieldOfViewBound::ConstPtr Camera::getFieldOfViewBound() const {
+  // The calibration is not compared here, the bound is dropped whenever it can change.
+  FieldOfViewBound::ConstPtr bound = std::atomic_load(&field_of_view_bound_);
+  if (!bound) {
+    FieldOfViewBound::Ptr new_bound = aligned_shared<FieldOfViewBound>();
+    computeFieldOfViewBound(new_bound.get());
+    bound = new_bound;
+    std::atomic_store(&field_of_view_bound_, bound);
+  }
+  return bound;
+}
+
+void Camera::computeFieldOfViewBound(FieldOfViewBound* bound) const {
+  CHECK_NOTNULL(bound);
+  constexpr double kBorderSampleSpacingPx = 4.0;
+  const Eigen::Matrix2Xd border_keypoints = getImageBorderKeypoints(kBorderSampleSpacingPx);
+  Eigen::Matrix3Xd border_bearings;
+  std::vector<unsigned char> success;
+  backProject3Vectorized(border_keypoints, &border_bearings, &success);
+  Eigen::Vector3d axis;
+  if (!backProject3(Eigen::Vector2d(0.5 * imageWidth(), 0.5 * imageHeight()), &axis) ||
+      std::find(success.begin(), success.end(), false) != success.end()) {
+    return;
+  }
+  axis.normalize();
+  border_bearings.colwise().normalize();
+
+  // The angle between neighboring samples is added as margin for the border in between.
+  double max_cos_sample_spacing = 1.0;
+  const int num_samples = border_bearings.cols();
+  for (int i = 0; i < num_samples; ++i) {
+    max_cos_sample_spacing = std::min(
+        max_cos_sample_spacing,
+        border_bearings.col(i).dot(border_bearings.col((i + 1) % num_samples)));
+  }
+  const double min_cos_border = (axis.transpose() * border_bearings).minCoeff();
+  const double half_angle = std::acos(std::max(-1.0, std::min(1.0, min_cos_border))) +
+      std::acos(std::max(-1.0, std::min(1.0, max_cos_sample_spacing)));
+  bound->addCone(axis, half_angle);
+}
+
+Eigen::Matrix2Xd Camera::getImageBorderKeypoints(double spacing) const {
+  CHECK_GT(spacing, 0.0);
+  const double width = imageWidth();
+  const double height = imageHeight();
+  Eigen::Matrix<double, 2, 5> corners;
+  corners << 0.0, width, width, 0.0, 0.0,
+             0.0, 0.0, height, height, 0.0;
+
+  std::vector<int> num_samples_per_side(4);
+  int num_samples = 0;
+  for (int side = 0; side < 4; ++side) {
+    const double length = (corners.col(side + 1) - corners.col(side)).norm();
+    num_samples_per_side[side] = std::max(1, static_cast<int>(std::ceil(length / spacing)));
+    num_samples += num_samples_per_side[side];
+  }
+  Eigen::Matrix2Xd keypoints(2, num_samples);
+  int sample_idx = 0;
+  for (int side = 0; side < 4; ++side) {
+    const Eigen::Vector2d step =
+        (corners.col(side + 1) - corners.col(side)) / num_samples_per_side[side];
+    for (int i = 0; i < num_samples_per_side[side]; ++i) {
+      keypoints.col(sample_idx++) = corners.col(side) + i * step;
+    }
+  }
+  return keypoints;
+}
+
+BearingLookupTable::ConstPtr Camera::getBearingLookupTable() const {
+  const int subsampling = bearing_lookup_table_subsampling_.load();
+  if (subsampling <= 0) {
+    return nullptr;
+  }
+  // The calibration is not compared here, the table is dropped whenever it can change.
+  BearingLookupTable::ConstPtr table = std::atomic_load(&bearing_lookup_table_);
+  if (table && table->getSubsampling() == subsampling) {
+    return table;
+  }
+
+  // Only one thread builds the table. The others and the back-projections
+  // issued while building the table use the exact model in the meantime.
+  bool expected = false;
+  if (!is_building_bearing_lookup_table_.compare_exchange_strong(expected, true)) {
+    return nullptr;
+  }
+  table = aligned_shared<const BearingLookupTable>(*this, subsampling);
+  std::atomic_store(&bearing_lookup_table_, table);
+  is_building_bearing_lookup_table_ = false;
+  return table;
+}
+
+bool Camera::backProject3FromLookupTable(
+    const Eigen::Ref<const Eigen::Vector2d>& keypoint,
+    Eigen::Vector3d* out_point_3d) const {
+  CHECK_NOTNULL(out_point_3d);
+  BearingLookupTable::ConstPtr table = getBearingLookupTable();
+  return table && table->lookup(keypoint, out_point_3d);
+}
+
+bool Camera::backProject3VectorizedFromLookupTable(
+    const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+    Eigen::Matrix3Xd* out_points_3d,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(out_points_3d);
+  CHECK_NOTNULL(out_success);
+  BearingLookupTable::ConstPtr table = getBearingLookupTable();
+  if (!table) {
+    return false;
+  }
+  out_points_3d->resize(Eigen::NoChange, keypoints.cols());
+  out_success->resize(keypoints.cols(), false);
+  Eigen::Vector3d bearing;
+  for (int i = 0; i < keypoints.cols(); ++i) {
+    if (table->lookup(keypoints.col(i), &bearing)) {
+      (*out_success)[i] = true;
+    } else {
+      (*out_success)[i] = backProject3(keypoints.col(i), &bearing);
+    }
+    out_points_3d->col(i) = bearing;
+  }
+  return true;
+}
+
 void Camera::setMask(const cv::Mat& mask) {
   CHECK_EQ(image_height_, static_cast<size_t>(mask.rows));
   CHECK_EQ(image_width_, static_cast<size_t>(mask.cols));
@@ -1,5 +1,7 @@
 #include <aslam/cameras/distortion-equidistant.h>
 
+#include <aslam/common/memory.h>
+
 namespace aslam {
 std::ostream& operator<<(std::ostream& out, const EquidistantDistortion& distortion) {
   distortion.printParameters(out, std::string(""));
@@ -141,11 +143,91 @@ void EquidistantDistortion::distortParameterJacobian(
                    dvf_dk1, dvf_dk2, dvf_dk3, dvf_dk4;
 }
 
+void EquidistantDistortion::distortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const {
+  distortVectorizedImpl(x, y);
+}
+
+void EquidistantDistortion::distortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const {
+  distortVectorizedImpl(x, y);
+}
+
+template <typename ScalarType>
+void EquidistantDistortion::distortVectorizedImpl(
+    Eigen::Array<ScalarType, Eigen::Dynamic, 1>* x,
+    Eigen::Array<ScalarType, Eigen::Dynamic, 1>* y) const {
+  typedef Eigen::Array<ScalarType, Eigen::Dynamic, 1> ArrayType;
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  CHECK_EQ(x->size(), y->size());
+  CHECK_EQ(distortion_coefficients_.size(), kNumOfParams) << "dist_coeffs: invalid size!";
+
+  const ScalarType k1 = static_cast<ScalarType>(distortion_coefficients_(0));
+  const ScalarType k2 = static_cast<ScalarType>(distortion_coefficients_(1));
+  const ScalarType k3 = static_cast<ScalarType>(distortion_coefficients_(2));
+  const ScalarType k4 = static_cast<ScalarType>(distortion_coefficients_(3));
+  const ScalarType one = static_cast<ScalarType>(1.0);
+
+  const ArrayType r = (x->square() + y->square()).sqrt();
+  const ArrayType theta = r.atan();
+  const ArrayType theta2 = theta.square();
+  // Horner scheme of 1 + k1 * theta^2 + k2 * theta^4 + k3 * theta^6 + k4 * theta^8.
+  const ArrayType thetad =
+      theta * (one + theta2 * (k1 + theta2 * (k2 + theta2 * (k3 + theta2 * k4))));
+
+  // Points around the image center remain unchanged.
+  const ArrayType scaling = (r > static_cast<ScalarType>(1e-8)).select(thetad / r, one);
+  *x *= scaling;
+  *y *= scaling;
+}
+
 void EquidistantDistortion::undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                                Eigen::Vector2d* point) const {
   CHECK_EQ(dist_coeffs.size(), kNumOfParams) << "dist_coeffs: invalid size!";
   CHECK_NOTNULL(point);
 
+  // The fit is only available for the internal parameters.
+  if (inverse_mode_ == InverseMode::kPolynomialFit && dist_coeffs == distortion_coefficients_ &&
+      getInverseFit()->undistort(point)) {
+    return;
+  }
+  undistortIteratively(dist_coeffs, point);
+}
+
+void EquidistantDistortion::undistortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  CHECK_EQ(x->size(), y->size());
+  if (inverse_mode_ != InverseMode::kPolynomialFit) {
+    Distortion::undistortVectorized(x, y);
+    return;
+  }
+
+  Eigen::Array<bool, Eigen::Dynamic, 1> success;
+  getInverseFit()->undistort(x, y, &success);
+  Eigen::Vector2d point;
+  for (int i = 0; i < x->size(); ++i) {
+    if (!success[i]) {
+      point << (*x)[i], (*y)[i];
+      undistortIteratively(distortion_coefficients_, &point);
+      (*x)[i] = point[0];
+      (*y)[i] = point[1];
+    }
+  }
+}
+
+EquidistantInverseFit::ConstPtr EquidistantDistortion::getInverseFit() const {
+  EquidistantInverseFit::ConstPtr fit = std::atomic_load(&inverse_fit_);
+  if (!fit || !fit->isValidFor(distortion_coefficients_)) {
+    fit = aligned_shared<const EquidistantInverseFit>(distortion_coefficients_);
+    std::atomic_store(&inverse_fit_, fit);
+  }
+  return fit;
+}
+
+void EquidistantDistortion::undistortIteratively(const Eigen::VectorXd& dist_coeffs,
+                                                 Eigen::Vector2d* point) const {
+  CHECK_NOTNULL(point);
+
   const int n = 30;  // Max. number of iterations
 
   Eigen::Vector2d& y = *point;
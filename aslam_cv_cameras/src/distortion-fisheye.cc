@@ -100,8 +100,8 @@ void FisheyeDistortion::distortParameterJacobian(const Eigen::VectorXd* dist_coe
     out_jacobian->setZero();
   }
   else if (r_u * r_u < 1e-5) {
-    out_jacobian->setOnes();
-    *out_jacobian *= (w - sin(w)) / (w * w * cos(w / 2) * cos(w / 2));
+    // The coordinates get multiplied by an expression only depending on w.
+    *out_jacobian = point * ((w - sin(w)) / (w * w * cos(w / 2) * cos(w / 2)));
   }
   else {
     const double dxd_d_w = (2 * u * (tanwhalfsq / 2 + 0.5))
@@ -116,6 +116,41 @@ void FisheyeDistortion::distortParameterJacobian(const Eigen::VectorXd* dist_coe
   }
 }
 
+void FisheyeDistortion::distortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const {
+  distortVectorizedImpl(x, y);
+}
+
+void FisheyeDistortion::distortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const {
+  distortVectorizedImpl(x, y);
+}
+
+template <typename ScalarType>
+void FisheyeDistortion::distortVectorizedImpl(
+    Eigen::Array<ScalarType, Eigen::Dynamic, 1>* x,
+    Eigen::Array<ScalarType, Eigen::Dynamic, 1>* y) const {
+  typedef Eigen::Array<ScalarType, Eigen::Dynamic, 1> ArrayType;
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  CHECK_EQ(x->size(), y->size());
+  CHECK_EQ(distortion_coefficients_.size(), kNumOfParams) << "dist_coeffs: invalid size!";
+
+  const double w_double = distortion_coefficients_(0);
+  if (w_double * w_double < 1e-5) {
+    // Limit w > 0.
+    return;
+  }
+  const ScalarType w = static_cast<ScalarType>(w_double);
+  const ScalarType mul2tanwby2 = static_cast<ScalarType>(2. * tan(w_double / 2.));
+
+  const ArrayType r_u2 = x->square() + y->square();
+  const ArrayType r_u = r_u2.sqrt();
+  // Limit r_u > 0.
+  const ArrayType r_rd = (r_u2 < static_cast<ScalarType>(1e-5)).select(
+      mul2tanwby2 / w, (r_u * mul2tanwby2).atan() / (r_u * w));
+  *x *= r_rd;
+  *y *= r_rd;
+}
+
 void FisheyeDistortion::undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                            Eigen::Vector2d* point) const {
   CHECK_NOTNULL(point);
@@ -142,6 +177,44 @@ void FisheyeDistortion::undistortUsingExternalCoefficients(const Eigen::VectorXd
   (*point) *= r_u;
 }
 
+void FisheyeDistortion::undistortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const {
+  undistortVectorizedImpl(x, y);
+}
+
+void FisheyeDistortion::undistortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const {
+  undistortVectorizedImpl(x, y);
+}
+
+template <typename ScalarType>
+void FisheyeDistortion::undistortVectorizedImpl(
+    Eigen::Array<ScalarType, Eigen::Dynamic, 1>* x,
+    Eigen::Array<ScalarType, Eigen::Dynamic, 1>* y) const {
+  typedef Eigen::Array<ScalarType, Eigen::Dynamic, 1> ArrayType;
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  CHECK_EQ(x->size(), y->size());
+  CHECK_EQ(distortion_coefficients_.size(), kNumOfParams) << "dist_coeffs: invalid size!";
+
+  const double w_double = distortion_coefficients_(0);
+  const double mul2tanwby2_double = tan(w_double / 2.0) * 2.0;
+  if (mul2tanwby2_double == 0) {
+    return;
+  }
+  const ScalarType w = static_cast<ScalarType>(w_double);
+  const ScalarType mul2tanwby2 = static_cast<ScalarType>(mul2tanwby2_double);
+  const ScalarType zero = static_cast<ScalarType>(0.0);
+  const ScalarType one = static_cast<ScalarType>(1.0);
+
+  // Points at the center or beyond the valid angle remain unchanged.
+  const ScalarType max_valid_angle = static_cast<ScalarType>(kMaxValidAngle);
+  const ArrayType r_d = (x->square() + y->square()).sqrt();
+  const ArrayType r_u =
+      (r_d == zero || (r_d * w).abs() > max_valid_angle).select(
+          one, (r_d * w).tan() / (r_d * mul2tanwby2));
+  *x *= r_u;
+  *y *= r_u;
+}
+
 bool FisheyeDistortion::areParametersValid(const Eigen::VectorXd& parameters) {
   // Check the vector size.
   if (parameters.size() != kNumOfParams)
@@ -90,6 +90,43 @@ void RadTanDistortion::distortParameterJacobian(
                      dvf_dk1, dvf_dk2, dvf_dp1, dvf_dp2;
 }
 
+void RadTanDistortion::distortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const {
+  distortVectorizedImpl(x, y);
+}
+
+void RadTanDistortion::distortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const {
+  distortVectorizedImpl(x, y);
+}
+
+template <typename ScalarType>
+void RadTanDistortion::distortVectorizedImpl(
+    Eigen::Array<ScalarType, Eigen::Dynamic, 1>* x,
+    Eigen::Array<ScalarType, Eigen::Dynamic, 1>* y) const {
+  typedef Eigen::Array<ScalarType, Eigen::Dynamic, 1> ArrayType;
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  CHECK_EQ(x->size(), y->size());
+  CHECK_EQ(distortion_coefficients_.size(), kNumOfParams) << "dist_coeffs: invalid size!";
+
+  const ScalarType k1 = static_cast<ScalarType>(distortion_coefficients_(0));
+  const ScalarType k2 = static_cast<ScalarType>(distortion_coefficients_(1));
+  const ScalarType p1 = static_cast<ScalarType>(distortion_coefficients_(2));
+  const ScalarType p2 = static_cast<ScalarType>(distortion_coefficients_(3));
+  const ScalarType one = static_cast<ScalarType>(1.0);
+  const ScalarType two = static_cast<ScalarType>(2.0);
+
+  const ArrayType mx2_u = x->square();
+  const ArrayType my2_u = y->square();
+  const ArrayType mxy_u = (*x) * (*y);
+  const ArrayType rho2_u = mx2_u + my2_u;
+  const ArrayType rad_dist_u = rho2_u * (k1 + k2 * rho2_u);
+
+  const ArrayType x_distorted =
+      (*x) * (one + rad_dist_u) + two * p1 * mxy_u + p2 * (rho2_u + two * mx2_u);
+  *y = (*y) * (one + rad_dist_u) + two * p2 * mxy_u + p1 * (rho2_u + two * my2_u);
+  *x = x_distorted;
+}
+
 void RadTanDistortion::undistortUsingExternalCoefficients(const Eigen::VectorXd& dist_coeffs,
                                                           Eigen::Vector2d* point) const {
   CHECK_EQ(dist_coeffs.size(), kNumOfParams) << "dist_coeffs: invalid size!";
@@ -50,6 +50,29 @@ void Distortion::distort(
   distortUsingExternalCoefficients(nullptr, point, out_jacobian);
 }
 
+void Distortion::distortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  CHECK_EQ(x->size(), y->size());
+  Eigen::Vector2d point;
+  for (int i = 0; i < x->size(); ++i) {
+    point << (*x)[i], (*y)[i];
+    distortUsingExternalCoefficients(nullptr, &point, nullptr);
+    (*x)[i] = point[0];
+    (*y)[i] = point[1];
+  }
+}
+
+void Distortion::distortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  Eigen::ArrayXd x_double = x->cast<double>();
+  Eigen::ArrayXd y_double = y->cast<double>();
+  distortVectorized(&x_double, &y_double);
+  *x = x_double.cast<float>();
+  *y = y_double.cast<float>();
+}
+
 void Distortion::undistort(Eigen::Vector2d* point) const {
   CHECK_NOTNULL(point);
   undistortUsingExternalCoefficients(distortion_coefficients_, point);
@@ -62,6 +85,29 @@ void Distortion::undistort(const Eigen::Vector2d& point,
   undistortUsingExternalCoefficients(distortion_coefficients_, out_point);
 }
 
+void Distortion::undistortVectorized(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  CHECK_EQ(x->size(), y->size());
+  Eigen::Vector2d point;
+  for (int i = 0; i < x->size(); ++i) {
+    point << (*x)[i], (*y)[i];
+    undistortUsingExternalCoefficients(distortion_coefficients_, &point);
+    (*x)[i] = point[0];
+    (*y)[i] = point[1];
+  }
+}
+
+void Distortion::undistortVectorized(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  Eigen::ArrayXd x_double = x->cast<double>();
+  Eigen::ArrayXd y_double = y->cast<double>();
+  undistortVectorized(&x_double, &y_double);
+  *x = x_double.cast<float>();
+  *y = y_double.cast<float>();
+}
+
 void Distortion::setParameters(const Eigen::VectorXd& dist_coeffs) {
   CHECK(distortionParametersValid(dist_coeffs)) << "Distortion parameters invalid!";
   distortion_coefficients_ = dist_coeffs;
@@ -0,0 +1,143 @@
+#include "aslam/cameras/equidistant-inverse-fit.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace {
+// Largest angle of a ray to the optical axis covered by the fit.
+constexpr double kMaxFitTheta = 89.0 * M_PI / 180.0;
+// Number of samples to find the range where the distortion polynomial is monotonic.
+constexpr int kNumMonotonicitySamples = 1000;
+// Points with a larger residual of the distortion polynomial after the last Newton step are
+// reported as unsuccessful.
+constexpr double kMaxResidual = 1e-12;
+// Points closer to the center remain unchanged, as in the iterative solver.
+constexpr double kMinSquaredRadius = 1e-6;
+
+// Horner scheme of theta * (1 + k1 * theta^2 + k2 * theta^4 + k3 * theta^6 + k4 * theta^8)
+// and of its derivative.
+template <typename Type>
+inline Type distortTheta(const Type& theta, const Eigen::VectorXd& k) {
+  const Type theta2 = theta * theta;
+  return theta * (1.0 + theta2 * (k[0] + theta2 * (k[1] + theta2 * (k[2] + theta2 * k[3]))));
+}
+
+template <typename Type>
+inline Type distortThetaDerivative(const Type& theta, const Eigen::VectorXd& k) {
+  const Type theta2 = theta * theta;
+  return 1.0 + theta2 * (3.0 * k[0] + theta2 * (5.0 * k[1] + theta2 *
+      (7.0 * k[2] + theta2 * (9.0 * k[3]))));
+}
+}  // namespace
+
+EquidistantInverseFit::EquidistantInverseFit(const Eigen::VectorXd& dist_coeffs, int degree)
+    : dist_coeffs_(dist_coeffs) {
+  CHECK_EQ(dist_coeffs_.size(), 4);
+  CHECK_GT(degree, 0);
+
+  // The fit covers [0, max_theta_] where the distortion polynomial is strictly increasing.
+  max_theta_ = 0.0;
+  for (int i = 1; i <= kNumMonotonicitySamples; ++i) {
+    const double theta = kMaxFitTheta * i / kNumMonotonicitySamples;
+    if (distortThetaDerivative(theta, dist_coeffs_) <= 0.0) {
+      break;
+    }
+    max_theta_ = theta;
+  }
+  max_distorted_radius_ = distortTheta(max_theta_, dist_coeffs_);
+  LOG_IF(WARNING, max_theta_ <= 0.0)
+      << "The equidistant distortion " << dist_coeffs_.transpose()
+      << " is not invertible, the fit is empty.";
+
+  // Chebyshev interpolation, theta at the nodes is found by bisection.
+  const int num_nodes = degree + 1;
+  Eigen::ArrayXd node_thetas(num_nodes);
+  for (int k = 0; k < num_nodes; ++k) {
+    const double radius_distorted =
+        0.5 * max_distorted_radius_ * (1.0 + std::cos(M_PI * (k + 0.5) / num_nodes));
+    double lower = 0.0;
+    double upper = max_theta_;
+    for (int i = 0; i < 100 && upper - lower > 1e-15; ++i) {
+      const double middle = 0.5 * (lower + upper);
+      if (distortTheta(middle, dist_coeffs_) < radius_distorted) {
+        lower = middle;
+      } else {
+        upper = middle;
+      }
+    }
+    node_thetas[k] = 0.5 * (lower + upper);
+  }
+  chebyshev_coefficients_.resize(num_nodes);
+  for (int j = 0; j < num_nodes; ++j) {
+    double sum = 0.0;
+    for (int k = 0; k < num_nodes; ++k) {
+      sum += node_thetas[k] * std::cos(M_PI * j * (k + 0.5) / num_nodes);
+    }
+    chebyshev_coefficients_[j] = 2.0 * sum / num_nodes;
+  }
+  chebyshev_coefficients_[0] *= 0.5;
+}
+
+bool EquidistantInverseFit::isValidFor(const Eigen::VectorXd& dist_coeffs) const {
+  return dist_coeffs_.size() == dist_coeffs.size() && dist_coeffs_ == dist_coeffs;
+}
+
+Eigen::ArrayXd EquidistantInverseFit::solveTheta(const Eigen::ArrayXd& radius_distorted,
+                                                 Eigen::ArrayXd* theta) const {
+  CHECK_NOTNULL(theta);
+  // Clenshaw recurrence on the radius mapped to [-1, 1].
+  const Eigen::ArrayXd t = (2.0 / std::max(max_distorted_radius_, 1e-12)) *
+      radius_distorted.min(max_distorted_radius_) - 1.0;
+  Eigen::ArrayXd b1 = Eigen::ArrayXd::Zero(t.size());
+  Eigen::ArrayXd b2 = Eigen::ArrayXd::Zero(t.size());
+  for (int j = chebyshev_coefficients_.size() - 1; j >= 1; --j) {
+    const Eigen::ArrayXd b0 = 2.0 * t * b1 - b2 + chebyshev_coefficients_[j];
+    b2 = b1;
+    b1 = b0;
+  }
+  *theta = t * b1 - b2 + chebyshev_coefficients_[0];
+
+  for (int i = 0; i < kNumNewtonSteps; ++i) {
+    *theta -= (distortTheta(*theta, dist_coeffs_) - radius_distorted) /
+        distortThetaDerivative(*theta, dist_coeffs_);
+  }
+  return (distortTheta(*theta, dist_coeffs_) - radius_distorted).abs();
+}
+
+bool EquidistantInverseFit::undistort(Eigen::Vector2d* point) const {
+  CHECK_NOTNULL(point);
+  Eigen::ArrayXd x(1), y(1);
+  x << (*point)[0];
+  y << (*point)[1];
+  Eigen::Array<bool, Eigen::Dynamic, 1> success;
+  undistort(&x, &y, &success);
+  (*point) << x[0], y[0];
+  return success[0];
+}
+
+void EquidistantInverseFit::undistort(
+    Eigen::ArrayXd* x, Eigen::ArrayXd* y,
+    Eigen::Array<bool, Eigen::Dynamic, 1>* out_success) const {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  CHECK_NOTNULL(out_success);
+  CHECK_EQ(x->size(), y->size());
+
+  const Eigen::ArrayXd squared_radius = x->square() + y->square();
+  const Eigen::ArrayXd radius_distorted = squared_radius.sqrt();
+  Eigen::ArrayXd theta;
+  const Eigen::ArrayXd residual = solveTheta(radius_distorted, &theta);
+
+  const Eigen::Array<bool, Eigen::Dynamic, 1> is_center = squared_radius < kMinSquaredRadius;
+  *out_success = is_center || ((radius_distorted <= max_distorted_radius_) &&
+      (residual <= kMaxResidual * radius_distorted.max(1.0)));
+  const Eigen::ArrayXd scaling =
+      (is_center || !(*out_success)).select(1.0, theta.tan() / radius_distorted);
+  *x *= scaling;
+  *y *= scaling;
+}
+
+}  // namespace aslam
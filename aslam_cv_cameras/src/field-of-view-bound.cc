@@ -0,0 +1,94 @@
+#include "aslam/cameras/field-of-view-bound.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace aslam {
+
+FieldOfViewBound::FieldOfViewBound()
+    : half_space_normals_(3, 0),
+      cone_axes_(3, 0),
+      cone_cos_half_angles_(0) {}
+
+void FieldOfViewBound::addHalfSpace(const Eigen::Vector3d& normal) {
+  CHECK_GT(normal.squaredNorm(), 0.0);
+  half_space_normals_.conservativeResize(Eigen::NoChange, half_space_normals_.cols() + 1);
+  half_space_normals_.rightCols<1>() = normal;
+}
+
+void FieldOfViewBound::addCone(const Eigen::Vector3d& axis, double half_angle) {
+  CHECK_GT(axis.squaredNorm(), 0.0);
+  CHECK_GE(half_angle, 0.0);
+  if (half_angle >= M_PI) {
+    return;
+  }
+  const int num_cones = cone_axes_.cols() + 1;
+  cone_axes_.conservativeResize(Eigen::NoChange, num_cones);
+  cone_axes_.rightCols<1>() = axis.normalized();
+  cone_cos_half_angles_.conservativeResize(num_cones);
+  cone_cos_half_angles_[num_cones - 1] = std::cos(half_angle);
+}
+
+bool FieldOfViewBound::isCandidate(const Eigen::Ref<const Eigen::Vector3d>& point_3d) const {
+  for (int i = 0; i < half_space_normals_.cols(); ++i) {
+    if (half_space_normals_.col(i).dot(point_3d) < 0.0) {
+      return false;
+    }
+  }
+  if (cone_axes_.cols() > 0) {
+    const double norm = point_3d.norm();
+    for (int i = 0; i < cone_axes_.cols(); ++i) {
+      if (cone_axes_.col(i).dot(point_3d) < cone_cos_half_angles_[i] * norm) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void FieldOfViewBound::getCandidates(const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+                                     std::vector<int>* out_candidate_indices) const {
+  CHECK_NOTNULL(out_candidate_indices)->clear();
+  const int num_points = points_3d.cols();
+  if (isUnbounded()) {
+    out_candidate_indices->resize(num_points);
+    for (int i = 0; i < num_points; ++i) {
+      (*out_candidate_indices)[i] = i;
+    }
+    return;
+  }
+
+  // Process the points in blocks such that the temporaries stay in the cache.
+  constexpr int kBlockSize = 1024;
+  typedef Eigen::Array<bool, 1, Eigen::Dynamic> MaskType;
+  Eigen::RowVectorXd dot_products(kBlockSize);
+  Eigen::RowVectorXd norms(kBlockSize);
+  MaskType is_candidate(kBlockSize);
+  for (int start = 0; start < num_points; start += kBlockSize) {
+    const int block_size = std::min(kBlockSize, num_points - start);
+    const auto block = points_3d.middleCols(start, block_size);
+    is_candidate.setConstant(block_size, true);
+    for (int i = 0; i < half_space_normals_.cols(); ++i) {
+      dot_products.head(block_size).noalias() =
+          half_space_normals_.col(i).transpose() * block;
+      is_candidate = is_candidate && (dot_products.head(block_size).array() >= 0.0);
+    }
+    if (cone_axes_.cols() > 0) {
+      norms.head(block_size) = block.colwise().norm();
+      for (int i = 0; i < cone_axes_.cols(); ++i) {
+        dot_products.head(block_size).noalias() = cone_axes_.col(i).transpose() * block;
+        is_candidate = is_candidate && (dot_products.head(block_size).array() >=
+            cone_cos_half_angles_[i] * norms.head(block_size).array());
+      }
+    }
+    for (int i = 0; i < block_size; ++i) {
+      if (is_candidate[i]) {
+        out_candidate_indices->push_back(start + i);
+      }
+    }
+  }
+}
+
+}  // namespace aslam
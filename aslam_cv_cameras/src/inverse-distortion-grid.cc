@@ -0,0 +1,164 @@
+#include "aslam/cameras/inverse-distortion-grid.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace {
+// Step size for the finite-difference Jacobian of the distortion.
+constexpr double kJacobianStep = 1e-7;
+// Points with a larger squared reprojection residual after the last Newton step are handed
+// to the iterative solver of the distortion model.
+constexpr double kMaxSquaredResidual = 1e-20;
+// Number of points processed together.
+constexpr int kBlockSize = 256;
+}  // namespace
+
+InverseDistortionGrid::InverseDistortionGrid(
+    const Distortion& distortion, const Eigen::Vector2d& min_distorted,
+    const Eigen::Vector2d& max_distorted, int num_cells_per_axis, int num_newton_steps)
+    : distortion_(distortion.clone()),
+      min_distorted_(min_distorted),
+      max_distorted_(max_distorted),
+      num_cells_per_axis_(num_cells_per_axis),
+      num_newton_steps_(num_newton_steps) {
+  CHECK_GT(num_cells_per_axis_, 0);
+  CHECK_GE(num_newton_steps_, 0);
+  CHECK((max_distorted_.array() > min_distorted_.array()).all());
+  cell_size_ = (max_distorted_ - min_distorted_) / num_cells_per_axis_;
+
+  const int num_nodes_per_axis = num_cells_per_axis_ + 1;
+  x_undistorted_.resize(num_nodes_per_axis * num_nodes_per_axis);
+  y_undistorted_.resize(num_nodes_per_axis * num_nodes_per_axis);
+  Eigen::Vector2d point;
+  for (int row = 0; row < num_nodes_per_axis; ++row) {
+    for (int col = 0; col < num_nodes_per_axis; ++col) {
+      point << min_distorted_[0] + col * cell_size_[0],
+               min_distorted_[1] + row * cell_size_[1];
+      distortion_->undistort(&point);
+      x_undistorted_[row * num_nodes_per_axis + col] = point[0];
+      y_undistorted_[row * num_nodes_per_axis + col] = point[1];
+    }
+  }
+}
+
+bool InverseDistortionGrid::isValidFor(
+    const Distortion& distortion, const Eigen::Vector2d& min_distorted,
+    const Eigen::Vector2d& max_distorted) const {
+  return *distortion_ == distortion && min_distorted_ == min_distorted &&
+      max_distorted_ == max_distorted;
+}
+
+void InverseDistortionGrid::interpolateSeed(
+    const Eigen::ArrayXd& x, const Eigen::ArrayXd& y,
+    Eigen::ArrayXd* x_undistorted, Eigen::ArrayXd* y_undistorted) const {
+  CHECK_NOTNULL(x_undistorted);
+  CHECK_NOTNULL(y_undistorted);
+  const int num_nodes_per_axis = num_cells_per_axis_ + 1;
+  x_undistorted->resize(x.size());
+  y_undistorted->resize(y.size());
+  for (int i = 0; i < x.size(); ++i) {
+    // Points outside of the grid are clamped to the border cells.
+    const double grid_x = std::min(std::max((x[i] - min_distorted_[0]) / cell_size_[0], 0.0),
+                                   static_cast<double>(num_cells_per_axis_));
+    const double grid_y = std::min(std::max((y[i] - min_distorted_[1]) / cell_size_[1], 0.0),
+                                   static_cast<double>(num_cells_per_axis_));
+    const int col = std::min(static_cast<int>(grid_x), num_cells_per_axis_ - 1);
+    const int row = std::min(static_cast<int>(grid_y), num_cells_per_axis_ - 1);
+    const double wx = grid_x - col;
+    const double wy = grid_y - row;
+    const int idx = row * num_nodes_per_axis + col;
+    const int idx_below = idx + num_nodes_per_axis;
+    (*x_undistorted)[i] =
+        (1.0 - wy) * ((1.0 - wx) * x_undistorted_[idx] + wx * x_undistorted_[idx + 1]) +
+        wy * ((1.0 - wx) * x_undistorted_[idx_below] + wx * x_undistorted_[idx_below + 1]);
+    (*y_undistorted)[i] =
+        (1.0 - wy) * ((1.0 - wx) * y_undistorted_[idx] + wx * y_undistorted_[idx + 1]) +
+        wy * ((1.0 - wx) * y_undistorted_[idx_below] + wx * y_undistorted_[idx_below + 1]);
+  }
+}
+
+void InverseDistortionGrid::undistort(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  CHECK_EQ(x->size(), y->size());
+  const int num_points = x->size();
+
+  // Work on cache-sized blocks to keep the temporaries of the Newton steps in cache.
+  Eigen::ArrayXd x_block, y_block;
+  for (int start = 0; start < num_points; start += kBlockSize) {
+    const int block_size = std::min<int>(kBlockSize, num_points - start);
+    x_block = x->segment(start, block_size);
+    y_block = y->segment(start, block_size);
+    undistortBlock(&x_block, &y_block);
+    x->segment(start, block_size) = x_block;
+    y->segment(start, block_size) = y_block;
+  }
+}
+
+void InverseDistortionGrid::undistort(Eigen::ArrayXf* x, Eigen::ArrayXf* y) const {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+  Eigen::ArrayXd x_double = x->cast<double>();
+  Eigen::ArrayXd y_double = y->cast<double>();
+  undistort(&x_double, &y_double);
+  *x = x_double.cast<float>();
+  *y = y_double.cast<float>();
+}
+
+void InverseDistortionGrid::undistortBlock(Eigen::ArrayXd* x, Eigen::ArrayXd* y) const {
+  CHECK_NOTNULL(x);
+  CHECK_NOTNULL(y);
+
+  Eigen::ArrayXd x_u, y_u;
+  interpolateSeed(*x, *y, &x_u, &y_u);
+
+  // Newton steps on distort(u) = d, for all points at once. The last pass only evaluates the
+  // residual of the final estimate.
+  Eigen::ArrayXd x_d, y_d, x_d_du, y_d_du, x_d_dv, y_d_dv, error_x, error_y;
+  for (int step = 0; step <= num_newton_steps_; ++step) {
+    x_d = x_u;
+    y_d = y_u;
+    distortion_->distortVectorized(&x_d, &y_d);
+    error_x = *x - x_d;
+    error_y = *y - y_d;
+    if (step == num_newton_steps_) {
+      break;
+    }
+
+    // Forward-difference Jacobian of the distortion.
+    x_d_du = x_u + kJacobianStep;
+    y_d_du = y_u;
+    distortion_->distortVectorized(&x_d_du, &y_d_du);
+    x_d_dv = x_u;
+    y_d_dv = y_u + kJacobianStep;
+    distortion_->distortVectorized(&x_d_dv, &y_d_dv);
+    const Eigen::ArrayXd j00 = (x_d_du - x_d) / kJacobianStep;
+    const Eigen::ArrayXd j10 = (y_d_du - y_d) / kJacobianStep;
+    const Eigen::ArrayXd j01 = (x_d_dv - x_d) / kJacobianStep;
+    const Eigen::ArrayXd j11 = (y_d_dv - y_d) / kJacobianStep;
+
+    // Closed-form solution of the 2x2 systems.
+    const Eigen::ArrayXd inv_det = (j00 * j11 - j01 * j10).inverse();
+    x_u += (j11 * error_x - j01 * error_y) * inv_det;
+    y_u += (j00 * error_y - j10 * error_x) * inv_det;
+  }
+
+  // Fall back to the iterative solver for points that did not converge (this also catches
+  // NaNs from singular Jacobians).
+  const Eigen::ArrayXd squared_residual = error_x.square() + error_y.square();
+  Eigen::Vector2d point;
+  for (int i = 0; i < x->size(); ++i) {
+    if (!(squared_residual[i] <= kMaxSquaredResidual)) {
+      point << (*x)[i], (*y)[i];
+      distortion_->undistort(&point);
+      x_u[i] = point[0];
+      y_u[i] = point[1];
+    }
+  }
+  *x = x_u;
+  *y = y_u;
+}
+
+}  // namespace aslam
@@ -0,0 +1,230 @@
+#include "aslam/cameras/lidar-angle-table.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+#include <aslam/cameras/camera-3d-lidar.h>
+
+namespace aslam {
+namespace {
+// Number of points processed together. The block arrays live on the stack.
+constexpr int kBlockSize = 128;
+typedef Eigen::Array<double, kBlockSize, 1> BlockArray;
+typedef Eigen::Array<int, kBlockSize, 1> BlockIndexArray;
+
+// Angles relative to the closest table entry up to this magnitude are evaluated with the
+// truncated series below, which are accurate to double precision in this range.
+constexpr double kMaxSeriesAngle = 0.05;
+// Points closer to the origin than this have no valid projection, as in Camera3DLidar.
+constexpr double kMinimumNorm = 1e-6;
+
+// The angles of the entries of one table: angle_offset + index * angle_resolution.
+struct TableAxis {
+  double angle_offset;
+  double angle_resolution;
+  const Eigen::ArrayXd& sines;
+  const Eigen::ArrayXd& cosines;
+};
+
+// Polynomial approximation of atan2 with a maximum error of about 1e-5 rad.
+inline BlockArray fastAtan2(const BlockArray& y, const BlockArray& x) {
+  const BlockArray abs_x = x.abs();
+  const BlockArray abs_y = y.abs();
+  const BlockArray a =
+      abs_x.min(abs_y) / abs_x.max(abs_y).max(std::numeric_limits<double>::min());
+  const BlockArray s = a * a;
+  BlockArray angle = ((-0.0464964749 * s + 0.15931422) * s - 0.327622764) * s * a + a;
+  angle = (abs_y > abs_x).select(M_PI_2 - angle, angle);
+  angle = (x < 0.0).select(M_PI - angle, angle);
+  return (y < 0.0).select(-angle, angle);
+}
+
+// Index of the closest table entry, the index is clamped to the table.
+inline BlockIndexArray closestTableIndex(const BlockArray& index, int num_entries) {
+  return (index.max(0.0).min(num_entries - 1.0) + 0.5).cast<int>();
+}
+
+// Angle of the vectors (x, y) relative to the x-axis in (-pi, pi].
+void refinedAtan2(const BlockArray& y, const BlockArray& x, const TableAxis& axis,
+                  BlockArray* angle) {
+  CHECK_NOTNULL(angle);
+  const int num_entries = axis.sines.size();
+  const double entries_per_turn = 2.0 * M_PI / axis.angle_resolution;
+  BlockArray index = (fastAtan2(y, x) - axis.angle_offset) / axis.angle_resolution;
+  index = (index < -0.5).select(index + entries_per_turn,
+                                (index > num_entries - 0.5).select(index - entries_per_turn,
+                                                                   index));
+  const BlockIndexArray closest = closestTableIndex(index, num_entries);
+  BlockArray table_sines, table_cosines;
+  for (int i = 0; i < kBlockSize; ++i) {
+    table_sines[i] = axis.sines[closest[i]];
+    table_cosines[i] = axis.cosines[closest[i]];
+  }
+
+  // Rotate (x, y) by minus the angle of the table entry, the remaining angle is small.
+  const BlockArray x_rotated = x * table_cosines + y * table_sines;
+  const BlockArray y_rotated = y * table_cosines - x * table_sines;
+  const BlockArray t = y_rotated / x_rotated;
+  const BlockArray t2 = t * t;
+  *angle = axis.angle_offset + closest.cast<double>() * axis.angle_resolution +
+      t * (1.0 + t2 * (-1.0 / 3.0 + t2 * (1.0 / 5.0 + t2 * (-1.0 / 7.0 + t2 * (1.0 / 9.0)))));
+  *angle = (*angle > M_PI).select(*angle - 2.0 * M_PI,
+                                  (*angle <= -M_PI).select(*angle + 2.0 * M_PI, *angle));
+
+  const auto is_in_series_range = (x_rotated > 0.0) &&
+      (y_rotated.abs() <= kMaxSeriesAngle * x_rotated);
+  if (!is_in_series_range.all()) {
+    for (int i = 0; i < kBlockSize; ++i) {
+      if (!is_in_series_range[i]) {
+        (*angle)[i] = std::atan2(y[i], x[i]);
+      }
+    }
+  }
+}
+
+// Sine and cosine of angle_offset + index * angle_resolution.
+void sinCos(const BlockArray& index, const TableAxis& axis, BlockArray* sine,
+            BlockArray* cosine) {
+  CHECK_NOTNULL(sine);
+  CHECK_NOTNULL(cosine);
+  const BlockIndexArray closest = closestTableIndex(index, axis.sines.size());
+  BlockArray table_sines, table_cosines;
+  for (int i = 0; i < kBlockSize; ++i) {
+    table_sines[i] = axis.sines[closest[i]];
+    table_cosines[i] = axis.cosines[closest[i]];
+  }
+
+  // Angle addition with the remaining small angle.
+  const BlockArray delta = (index - closest.cast<double>()) * axis.angle_resolution;
+  const BlockArray delta2 = delta * delta;
+  const BlockArray sine_delta = delta * (1.0 + delta2 * (-1.0 / 6.0 + delta2 *
+      (1.0 / 120.0 + delta2 * (-1.0 / 5040.0))));
+  const BlockArray cosine_delta = 1.0 + delta2 * (-1.0 / 2.0 + delta2 * (1.0 / 24.0 +
+      delta2 * (-1.0 / 720.0 + delta2 * (1.0 / 40320.0))));
+  *sine = table_sines * cosine_delta + table_cosines * sine_delta;
+  *cosine = table_cosines * cosine_delta - table_sines * sine_delta;
+
+  const auto is_in_series_range = delta.abs() <= kMaxSeriesAngle;
+  if (!is_in_series_range.all()) {
+    for (int i = 0; i < kBlockSize; ++i) {
+      if (!is_in_series_range[i]) {
+        const double angle = axis.angle_offset + index[i] * axis.angle_resolution;
+        (*sine)[i] = std::sin(angle);
+        (*cosine)[i] = std::cos(angle);
+      }
+    }
+  }
+}
+}  // namespace
+
+LidarAngleTable::LidarAngleTable(const Eigen::VectorXd& intrinsics, uint32_t image_width,
+                                 uint32_t image_height)
+    : intrinsics_(intrinsics),
+      image_width_(image_width),
+      image_height_(image_height) {
+  CHECK(Camera3DLidar::areParametersValid(intrinsics_));
+  CHECK_GT(image_width_, 0u);
+  CHECK_GT(image_height_, 0u);
+  const Eigen::ArrayXd column_angles =
+      Eigen::ArrayXd::LinSpaced(image_width_, 0.0, image_width_ - 1.0) *
+      intrinsics_[Camera3DLidar::Parameters::kHorizontalResolutionRad] -
+      intrinsics_[Camera3DLidar::Parameters::kHorizontalCenterRad];
+  column_sines_ = column_angles.sin();
+  column_cosines_ = column_angles.cos();
+  const Eigen::ArrayXd row_angles =
+      Eigen::ArrayXd::LinSpaced(image_height_, 0.0, image_height_ - 1.0) *
+      intrinsics_[Camera3DLidar::Parameters::kVerticalResolutionRad] -
+      intrinsics_[Camera3DLidar::Parameters::kVerticalCenterRad];
+  row_sines_ = row_angles.sin();
+  row_cosines_ = row_angles.cos();
+}
+
+void LidarAngleTable::project(const Eigen::Ref<const Eigen::Matrix3Xd>& points_3d,
+                              Eigen::Matrix2Xd* out_keypoints) const {
+  CHECK_NOTNULL(out_keypoints);
+  const double horizontal_resolution =
+      intrinsics_[Camera3DLidar::Parameters::kHorizontalResolutionRad];
+  const double horizontal_center = intrinsics_[Camera3DLidar::Parameters::kHorizontalCenterRad];
+  const double vertical_resolution =
+      intrinsics_[Camera3DLidar::Parameters::kVerticalResolutionRad];
+  const double vertical_center = intrinsics_[Camera3DLidar::Parameters::kVerticalCenterRad];
+  const TableAxis azimuth_axis{
+      -horizontal_center, horizontal_resolution, column_sines_, column_cosines_};
+  const TableAxis elevation_axis{
+      -vertical_center, vertical_resolution, row_sines_, row_cosines_};
+
+  const int num_points = points_3d.cols();
+  out_keypoints->resize(Eigen::NoChange, num_points);
+  BlockArray x, y, z, azimuth, elevation;
+  for (int start = 0; start < num_points; start += kBlockSize) {
+    const int block_size = std::min(kBlockSize, num_points - start);
+    if (block_size < kBlockSize) {
+      // Pad the last block with valid points.
+      x.setZero();
+      y.setZero();
+      z.setOnes();
+    }
+    x.head(block_size) = points_3d.row(0).segment(start, block_size).transpose();
+    y.head(block_size) = points_3d.row(1).segment(start, block_size).transpose();
+    z.head(block_size) = points_3d.row(2).segment(start, block_size).transpose();
+
+    const BlockArray squared_norm_xz = x * x + z * z;
+    refinedAtan2(x, z, azimuth_axis, &azimuth);
+    refinedAtan2(y, squared_norm_xz.sqrt(), elevation_axis, &elevation);
+    BlockArray u = (azimuth + horizontal_center) / horizontal_resolution;
+    u = (u < 0.0).select(u + image_width_, u);
+    BlockArray v = (elevation + vertical_center) / vertical_resolution;
+
+    const auto is_too_close = squared_norm_xz + y * y < kMinimumNorm * kMinimumNorm;
+    u = is_too_close.select(0.0, u);
+    v = is_too_close.select(0.0, v);
+    out_keypoints->row(0).segment(start, block_size) = u.head(block_size).transpose();
+    out_keypoints->row(1).segment(start, block_size) = v.head(block_size).transpose();
+  }
+}
+
+void LidarAngleTable::backProject(const Eigen::Ref<const Eigen::Matrix2Xd>& keypoints,
+                                  Eigen::Matrix3Xd* out_bearings) const {
+  CHECK_NOTNULL(out_bearings);
+  const TableAxis azimuth_axis{
+      -intrinsics_[Camera3DLidar::Parameters::kHorizontalCenterRad],
+      intrinsics_[Camera3DLidar::Parameters::kHorizontalResolutionRad], column_sines_,
+      column_cosines_};
+  const TableAxis elevation_axis{
+      -intrinsics_[Camera3DLidar::Parameters::kVerticalCenterRad],
+      intrinsics_[Camera3DLidar::Parameters::kVerticalResolutionRad], row_sines_,
+      row_cosines_};
+
+  const int num_points = keypoints.cols();
+  out_bearings->resize(Eigen::NoChange, num_points);
+  BlockArray u, v, sin_azimuth, cos_azimuth, sin_elevation, cos_elevation;
+  for (int start = 0; start < num_points; start += kBlockSize) {
+    const int block_size = std::min(kBlockSize, num_points - start);
+    if (block_size < kBlockSize) {
+      u.setZero();
+      v.setZero();
+    }
+    u.head(block_size) = keypoints.row(0).segment(start, block_size).transpose();
+    v.head(block_size) = keypoints.row(1).segment(start, block_size).transpose();
+
+    sinCos(u, azimuth_axis, &sin_azimuth, &cos_azimuth);
+    sinCos(v, elevation_axis, &sin_elevation, &cos_elevation);
+    out_bearings->row(0).segment(start, block_size) =
+        (sin_azimuth * cos_elevation).head(block_size).transpose();
+    out_bearings->row(1).segment(start, block_size) =
+        sin_elevation.head(block_size).transpose();
+    out_bearings->row(2).segment(start, block_size) =
+        (cos_azimuth * cos_elevation).head(block_size).transpose();
+  }
+}
+
+bool LidarAngleTable::isValidFor(const Eigen::VectorXd& intrinsics, uint32_t image_width,
+                                 uint32_t image_height) const {
+  return image_width_ == image_width && image_height_ == image_height &&
+      intrinsics_.size() == intrinsics.size() && intrinsics_ == intrinsics;
+}
+
+}  // namespace aslam
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <future>
 #include <string>
 #include <utility>
 
@@ -12,6 +14,7 @@
 #include <aslam/cameras/random-camera-generator.h>
 #include <aslam/common/pose-types.h>
 #include <aslam/common/predicates.h>
+#include <aslam/common/thread-pool.h>
 #include <aslam/common/unique-id.h>
 #include <aslam/common/yaml-serialization.h>
 
@@ -345,6 +348,77 @@ aslam::NCamera::Ptr NCamera::cloneRigWithoutDistortion() const {
   return rig_without_distortion;
 }
 
+void NCamera::project3Vectorized(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_B, ThreadPool* thread_pool,
+    std::vector<Eigen::Matrix2Xd>* out_keypoints,
+    std::vector<std::vector<unsigned char>>* out_is_visible) const {
+  CHECK_NOTNULL(out_keypoints);
+  CHECK_NOTNULL(out_is_visible);
+  // Large enough to amortize the task overhead, small enough to balance the load.
+  constexpr int kNumPointsPerChunk = 4096;
+
+  const size_t num_cameras = numCameras();
+  const int num_points = points_B.cols();
+  out_keypoints->resize(num_cameras);
+  out_is_visible->resize(num_cameras);
+  for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    (*out_keypoints)[camera_idx].resize(Eigen::NoChange, num_points);
+    (*out_is_visible)[camera_idx].resize(num_points);
+  }
+
+  // Every chunk writes to a disjoint range of the outputs.
+  auto project_chunk = [&](size_t camera_idx, int start, int num_points_chunk) {
+    const Camera& camera = getCamera(camera_idx);
+    const Transformation& T_C_B = get_T_C_B(camera_idx);
+    const Eigen::Matrix3d R_C_B = T_C_B.getRotationMatrix();
+    const Eigen::Vector3d p_C_B = T_C_B.getPosition();
+
+    Eigen::Matrix3Xd points_C = R_C_B * points_B.middleCols(start, num_points_chunk);
+    points_C.colwise() += p_C_B;
+    Eigen::Matrix2Xd keypoints;
+    std::vector<ProjectionResult> results;
+    camera.project3Vectorized(points_C, &keypoints, &results);
+
+    (*out_keypoints)[camera_idx].middleCols(start, num_points_chunk) = keypoints;
+    std::vector<unsigned char>& is_visible = (*out_is_visible)[camera_idx];
+    for (int i = 0; i < num_points_chunk; ++i) {
+      is_visible[start + i] = results[i].isKeypointVisible();
+    }
+  };
+
+  CHECK(thread_pool == nullptr || !thread_pool->isWorkerThread())
+      << "Waiting for the chunks on a worker thread of the same pool can deadlock.";
+  std::vector<std::future<void>> chunk_futures;
+  for (size_t camera_idx = 0u; camera_idx < num_cameras; ++camera_idx) {
+    for (int start = 0; start < num_points; start += kNumPointsPerChunk) {
+      const int num_points_chunk = std::min(kNumPointsPerChunk, num_points - start);
+      if (thread_pool == nullptr) {
+        project_chunk(camera_idx, start, num_points_chunk);
+      } else {
+        chunk_futures.emplace_back(
+            thread_pool->enqueue(project_chunk, camera_idx, start, num_points_chunk));
+        CHECK(chunk_futures.back().valid()) << "The thread pool has been stopped.";
+      }
+    }
+  }
+  for (std::future<void>& chunk_future : chunk_futures) {
+    chunk_future.get();
+  }
+}
+
+void NCamera::project3VectorizedWithNumThreads(
+    const Eigen::Ref<const Eigen::Matrix3Xd>& points_B, size_t num_threads,
+    std::vector<Eigen::Matrix2Xd>* out_keypoints,
+    std::vector<std::vector<unsigned char>>* out_is_visible) const {
+  CHECK_GT(num_threads, 0u);
+  if (num_threads == 1u) {
+    project3Vectorized(points_B, nullptr, out_keypoints, out_is_visible);
+    return;
+  }
+  ThreadPool thread_pool(num_threads);
+  project3Vectorized(points_B, &thread_pool, out_keypoints, out_is_visible);
+}
+
 bool NCamera::isValidImpl() const {
   for (const aslam::Camera::Ptr& camera : cameras_) {
     CHECK(camera);
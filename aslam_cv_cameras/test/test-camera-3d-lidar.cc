@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <Eigen/Core>
 #include <eigen-checks/gtest.h>
 #include <glog/logging.h>
@@ -179,6 +181,128 @@ TYPED_TEST(TestCameras, CameraTest_isInvertible) {
   EXPECT_TRUE(EIGEN_MATRIX_NEAR(points1, points3, 1e-6));
 }
 
+TYPED_TEST(TestCameras, VectorizedMatchesScalarProjection) {
+  const int N = 5000;
+  Eigen::Matrix3Xd points_3d = 20.0 * Eigen::Matrix3Xd::Random(3, N);
+  // Points on the axes and close to the origin.
+  points_3d.leftCols<6>() << 1.0, -1.0, 0.0, 0.0, 0.0, 1e-8,
+                             0.0, 0.0, 2.0, -2.0, 0.0, 0.0,
+                             0.0, 0.0, 0.0, 0.0, -3.0, 0.0;
+
+  Eigen::Matrix2Xd keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  this->camera_->project3Vectorized(points_3d, &keypoints, &results);
+  ASSERT_EQ(static_cast<size_t>(N), results.size());
+  Eigen::Vector2d keypoint;
+  for (int n = 0; n < N; ++n) {
+    const aslam::ProjectionResult result = this->camera_->project3(points_3d.col(n), &keypoint);
+    EXPECT_EQ(result.getDetailedStatus(), results[n].getDetailedStatus()) << "Point " << n;
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoints.col(n), 1e-9)) << "Point " << n;
+  }
+
+  // Integer and fractional keypoints, including ones outside of the image.
+  Eigen::Matrix2Xd keypoints_2d(2, N);
+  for (int n = 0; n < N; ++n) {
+    keypoints_2d.col(n) = this->camera_->createRandomKeypoint();
+    if (n % 2 == 0) {
+      keypoints_2d.col(n) = keypoints_2d.col(n).array().round();
+    }
+  }
+  keypoints_2d.col(0) << -3.5, -2.25;
+  keypoints_2d.col(1) << this->camera_->imageWidth() + 1.5, this->camera_->imageHeight() + 7.0;
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> success;
+  this->camera_->backProject3Vectorized(keypoints_2d, &bearings, &success);
+  Eigen::Vector3d bearing;
+  for (int n = 0; n < N; ++n) {
+    ASSERT_TRUE(this->camera_->backProject3(keypoints_2d.col(n), &bearing));
+    EXPECT_TRUE(success[n]);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(bearing, bearings.col(n), 1e-12)) << "Keypoint " << n;
+  }
+
+  // The angle table is rebuilt for new intrinsics.
+  Eigen::VectorXd intrinsics = this->camera_->getParameters();
+  intrinsics *= 1.1;
+  this->camera_->setParameters(intrinsics);
+  this->camera_->backProject3Vectorized(keypoints_2d.rightCols<10>(), &bearings, &success);
+  for (int n = 0; n < 10; ++n) {
+    ASSERT_TRUE(this->camera_->backProject3(keypoints_2d.col(N - 10 + n), &bearing));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(bearing, bearings.col(n), 1e-12)) << "Keypoint " << n;
+  }
+}
+
+TYPED_TEST(TestCameras, CreateRangeImage) {
+  const int width = this->camera_->imageWidth();
+  const int height = this->camera_->imageHeight();
+  // One point per pixel center, plus a second, farther point for every other pixel.
+  Eigen::Matrix2Xd pixel_centers(2, width * height);
+  for (int row = 0; row < height; ++row) {
+    for (int col = 0; col < width; ++col) {
+      pixel_centers.col(row * width + col) << col + 0.5, row + 0.5;
+    }
+  }
+  Eigen::Matrix3Xd bearings;
+  std::vector<unsigned char> success;
+  this->camera_->backProject3Vectorized(pixel_centers, &bearings, &success);
+  const Eigen::RowVectorXd ranges =
+      Eigen::RowVectorXd::LinSpaced(width * height, 1.0, 50.0);
+  Eigen::Matrix3Xd points_3d(3, 2 * width * height);
+  points_3d.leftCols(width * height) = bearings.array().rowwise() * ranges.array();
+  points_3d.rightCols(width * height) = 2.0 * points_3d.leftCols(width * height);
+  // The farther points come first and are replaced.
+  points_3d.leftCols(width * height).swap(points_3d.rightCols(width * height));
+
+  Eigen::MatrixXf range_image;
+  Eigen::MatrixXi point_indices;
+  this->camera_->createRangeImage(points_3d, &range_image, &point_indices);
+  ASSERT_EQ(height, range_image.rows());
+  ASSERT_EQ(width, range_image.cols());
+  for (int row = 0; row < height; ++row) {
+    for (int col = 0; col < width; ++col) {
+      const int index = row * width + col;
+      EXPECT_NEAR(ranges[index], range_image(row, col), 1e-5 * ranges[index]);
+      EXPECT_EQ(width * height + index, point_indices(row, col));
+    }
+  }
+
+  // Pixels without a point are zero.
+  this->camera_->createRangeImage(points_3d.leftCols<1>(), &range_image, nullptr);
+  EXPECT_EQ(1, (range_image.array() > 0.0f).count());
+}
+
+TYPED_TEST(TestCameras, FieldOfViewBoundIsTheElevationRange) {
+  // The generic properties of the bound are tested for all cameras in test-cameras.cc. The
+  // lidar sees all around, so only the elevation bounds its field of view.
+  const double min_elevation = -this->camera_->verticalCenter();
+  const double max_elevation =
+      this->camera_->imageHeight() * this->camera_->verticalResolution() +
+      min_elevation;
+  constexpr double kToleranceRad = 1e-4;
+
+  const int N = 20000;
+  const Eigen::Matrix3Xd points_3d = 20.0 * Eigen::Matrix3Xd::Random(3, N);
+  aslam::FieldOfViewBound::ConstPtr bound = this->camera_->getFieldOfViewBound();
+  Eigen::Vector2d keypoint;
+  int num_candidates_behind = 0;
+  for (int n = 0; n < N; ++n) {
+    const Eigen::Vector3d& point = points_3d.col(n);
+    const double elevation = std::asin(point.y() / point.norm());
+    if (elevation > min_elevation + kToleranceRad &&
+        elevation < max_elevation - kToleranceRad) {
+      EXPECT_TRUE(bound->isCandidate(point)) << "Point " << n;
+      num_candidates_behind += point.z() < 0.0 ? 1 : 0;
+    } else if (elevation < min_elevation - kToleranceRad ||
+               elevation > max_elevation + kToleranceRad) {
+      EXPECT_FALSE(bound->isCandidate(point)) << "Point " << n;
+      EXPECT_FALSE(
+          this->camera_->project3(point, &keypoint).isKeypointVisible())
+          << "Point " << n;
+    }
+  }
+  // The azimuth isn't bounded, the points behind the sensor are candidates as well.
+  EXPECT_GT(num_candidates_behind, 0);
+}
+
 TYPED_TEST(TestCameras, TestClone) {
   aslam::Camera::Ptr cam1(this->camera_->clone());
 
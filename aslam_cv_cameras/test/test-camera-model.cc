@@ -0,0 +1,177 @@
+#include <Eigen/Core>
+#include <eigen-checks/gtest.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/camera.h>
+#include <aslam/cameras/camera-model.h>
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/camera-unified-projection.h>
+#include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/distortion-fisheye.h>
+#include <aslam/cameras/distortion-null.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/memory.h>
+
+///////////////////////////////////////////////
+// Types to test
+///////////////////////////////////////////////
+template<typename Projection, typename Distortion>
+struct ProjectionDistortion {
+  typedef Projection ProjectionType;
+  typedef Distortion DistortionType;
+};
+
+using testing::Types;
+typedef Types<ProjectionDistortion<aslam::PinholeProjection, aslam::FisheyeDistortion>,
+    ProjectionDistortion<aslam::UnifiedProjection, aslam::FisheyeDistortion>,
+    ProjectionDistortion<aslam::PinholeProjection, aslam::EquidistantDistortion>,
+    ProjectionDistortion<aslam::UnifiedProjection, aslam::EquidistantDistortion>,
+    ProjectionDistortion<aslam::PinholeProjection, aslam::RadTanDistortion>,
+    ProjectionDistortion<aslam::UnifiedProjection, aslam::RadTanDistortion>,
+    ProjectionDistortion<aslam::PinholeProjection, aslam::NullDistortion>,
+    ProjectionDistortion<aslam::UnifiedProjection, aslam::NullDistortion>>
+    Implementations;
+
+///////////////////////////////////////////////
+// Test fixture
+///////////////////////////////////////////////
+template <class ProjectionDistortion>
+class TestCameraModel : public testing::Test {
+ public:
+  typedef typename ProjectionDistortion::ProjectionType ProjectionType;
+  typedef typename ProjectionDistortion::DistortionType DistortionType;
+  typedef typename ProjectionType::CameraType CameraType;
+  typedef aslam::CameraModel<ProjectionType, DistortionType> ModelType;
+ protected:
+  TestCameraModel()
+      : camera_(CameraType::template createTestCamera<DistortionType>()),
+        adapter_(aslam::createCameraModelAdapter(*camera_)) {};
+  virtual ~TestCameraModel() {};
+
+  /// Random visible points with a few invalid points in front.
+  Eigen::Matrix3Xd createTestPoints(int num_points) const {
+    Eigen::Matrix3Xd points(3, num_points);
+    for (int n = 0; n < num_points; ++n) {
+      points.col(n) = camera_->createRandomVisiblePoint(10.0);
+    }
+    points.col(0) << 5000, -5, 1;
+    points.col(1) << -10, -10, -10;
+    points.col(2) << 0, 0, -1;
+    return points;
+  }
+
+  typename CameraType::Ptr camera_;
+  aslam::Camera::Ptr adapter_;
+};
+
+TYPED_TEST_CASE(TestCameraModel, Implementations);
+
+TYPED_TEST(TestCameraModel, AdapterMatchesCamera) {
+  ASSERT_TRUE(this->adapter_);
+  EXPECT_EQ(this->camera_->getType(), this->adapter_->getType());
+  EXPECT_EQ(this->camera_->getDistortion().getType(),
+            this->adapter_->getDistortion().getType());
+
+  const Eigen::Matrix3Xd points = this->createTestPoints(200);
+  Eigen::Vector2d keypoint, keypoint_adapter;
+  Eigen::Matrix<double, 2, 3> J_point, J_point_adapter;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_intrinsics, J_intrinsics_adapter;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_distortion, J_distortion_adapter;
+  for (int n = 0; n < points.cols(); ++n) {
+    const aslam::ProjectionResult result = this->camera_->project3Functional(
+        points.col(n), nullptr, nullptr, &keypoint, &J_point, &J_intrinsics, &J_distortion);
+    const aslam::ProjectionResult result_adapter = this->adapter_->project3Functional(
+        points.col(n), nullptr, nullptr, &keypoint_adapter, &J_point_adapter,
+        &J_intrinsics_adapter, &J_distortion_adapter);
+    EXPECT_EQ(result.getDetailedStatus(), result_adapter.getDetailedStatus()) << "Point " << n;
+    if (result.getDetailedStatus() != aslam::ProjectionResult::Status::KEYPOINT_VISIBLE) {
+      continue;
+    }
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoint_adapter, 1e-9));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(J_point, J_point_adapter, 1e-6));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(J_intrinsics, J_intrinsics_adapter, 1e-6));
+    ASSERT_EQ(J_distortion.cols(), J_distortion_adapter.cols());
+    if (J_distortion.cols() > 0) {
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(J_distortion, J_distortion_adapter, 1e-6));
+    }
+
+    // The adapter also serves the non-virtual overloads of the camera interface.
+    this->adapter_->project3(points.col(n), &keypoint_adapter);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoint_adapter, 1e-9));
+  }
+}
+
+TYPED_TEST(TestCameraModel, AdapterUsesExternalParameters) {
+  ASSERT_TRUE(this->adapter_);
+  Eigen::VectorXd intrinsics = this->camera_->getParameters();
+  intrinsics *= 1.01;
+  const Eigen::VectorXd distortion = this->camera_->getDistortion().getParameters() * 0.9;
+
+  const Eigen::Matrix3Xd points = this->createTestPoints(50);
+  Eigen::Vector2d keypoint, keypoint_adapter;
+  for (int n = 0; n < points.cols(); ++n) {
+    const aslam::ProjectionResult result = this->camera_->project3Functional(
+        points.col(n), &intrinsics, &distortion, &keypoint);
+    const aslam::ProjectionResult result_adapter = this->adapter_->project3Functional(
+        points.col(n), &intrinsics, &distortion, &keypoint_adapter);
+    EXPECT_EQ(result.getDetailedStatus(), result_adapter.getDetailedStatus()) << "Point " << n;
+    if (result.getDetailedStatus() == aslam::ProjectionResult::Status::KEYPOINT_VISIBLE) {
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoint_adapter, 1e-9));
+    }
+  }
+}
+
+TYPED_TEST(TestCameraModel, ModelMatchesCamera) {
+  typedef typename TestFixture::ModelType ModelType;
+  ASSERT_TRUE(ModelType::isCompatible(*this->camera_));
+  const ModelType model(*this->camera_);
+  EXPECT_EQ(this->camera_->imageWidth(), model.imageWidth());
+  EXPECT_EQ(this->camera_->imageHeight(), model.imageHeight());
+
+  const Eigen::Matrix3Xd points = this->createTestPoints(200);
+  Eigen::Vector2d keypoint, keypoint_model;
+  Eigen::Matrix<double, 2, 3> J_point;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_intrinsics, J_distortion;
+  typename ModelType::PointJacobian J_point_model;
+  typename ModelType::IntrinsicsJacobian J_intrinsics_model;
+  typename ModelType::DistortionJacobian J_distortion_model;
+  for (int n = 0; n < points.cols(); ++n) {
+    const aslam::ProjectionResult result = this->camera_->project3Functional(
+        points.col(n), nullptr, nullptr, &keypoint, &J_point, &J_intrinsics, &J_distortion);
+    const aslam::ProjectionResult result_model = model.project3(
+        points.col(n), &keypoint_model, &J_point_model, &J_intrinsics_model,
+        &J_distortion_model);
+    EXPECT_EQ(result.getDetailedStatus(), result_model.getDetailedStatus()) << "Point " << n;
+    if (result.getDetailedStatus() != aslam::ProjectionResult::Status::KEYPOINT_VISIBLE) {
+      continue;
+    }
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoint_model, 1e-9));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(J_point, J_point_model, 1e-6));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(J_intrinsics, J_intrinsics_model, 1e-6));
+    if (ModelType::kNumOfDistortionParams > 0) {
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(J_distortion, J_distortion_model, 1e-6));
+    }
+  }
+}
+
+TYPED_TEST(TestCameraModel, TestClone) {
+  ASSERT_TRUE(this->adapter_);
+  aslam::Camera::Ptr clone(this->adapter_->clone());
+  EXPECT_TRUE(dynamic_cast<typename TestFixture::CameraType*>(clone.get()) != nullptr);
+  EXPECT_TRUE(*clone == *this->camera_);
+}
+
+TEST(TestCameraModel, IncompatibleCamera) {
+  aslam::PinholeCamera::Ptr camera =
+      aslam::PinholeCamera::createTestCamera<aslam::RadTanDistortion>();
+  EXPECT_TRUE((aslam::CameraModel<aslam::PinholeProjection, aslam::RadTanDistortion>::
+      isCompatible(*camera)));
+  EXPECT_FALSE((aslam::CameraModel<aslam::PinholeProjection, aslam::FisheyeDistortion>::
+      isCompatible(*camera)));
+  EXPECT_FALSE((aslam::CameraModel<aslam::UnifiedProjection, aslam::RadTanDistortion>::
+      isCompatible(*camera)));
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <Eigen/Core>
 #include <eigen-checks/gtest.h>
 #include <glog/logging.h>
@@ -310,6 +311,290 @@ TYPED_TEST(TestCameras, CameraTest_isInvertible) {
   EXPECT_TRUE(EIGEN_MATRIX_NEAR(points1, points3, 1e-2));
 }
 
+TYPED_TEST(TestCameras, project3VectorizedMatchesProject3) {
+  const int N = 500;
+  Eigen::Matrix3Xd points(3, N);
+  for (int n = 0; n < N; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(10.0);
+  }
+  // Add points that are outside of the image box or behind the camera.
+  points.col(0) << 5000, -5, 1;
+  points.col(1) << -10, -10, -10;
+  points.col(2) << 0, 0, -1;
+
+  Eigen::Matrix2Xd keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  this->camera_->project3Vectorized(points, &keypoints, &results);
+  ASSERT_EQ(N, keypoints.cols());
+  ASSERT_EQ(static_cast<size_t>(N), results.size());
+
+  Eigen::Vector2d keypoint;
+  for (int n = 0; n < N; ++n) {
+    aslam::ProjectionResult result = this->camera_->project3(points.col(n), &keypoint);
+    EXPECT_EQ(result.getDetailedStatus(), results[n].getDetailedStatus()) << "Point " << n;
+    if (result.getDetailedStatus() == aslam::ProjectionResult::Status::KEYPOINT_VISIBLE) {
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoints.col(n), 1e-9));
+    }
+  }
+}
+
+TYPED_TEST(TestCameras, project3FunctionalBatchMatchesProject3Functional) {
+  const int N = 200;
+  Eigen::Matrix3Xd points(3, N);
+  for (int n = 0; n < N; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(10.0);
+  }
+  points.col(0) << 5000, -5, 1;
+  points.col(1) << -10, -10, -10;
+  const Eigen::VectorXd intrinsics = this->camera_->getParameters() * 1.01;
+  const Eigen::VectorXd distortion = this->camera_->getDistortion().getParameters() * 0.9;
+  const int num_intrinsics = this->camera_->getParameterSize();
+  const int num_distortion_params = this->camera_->getDistortion().getParameterSize();
+
+  // Compare the specialized and the vanilla implementation to the single point version.
+  Eigen::Matrix2Xd keypoints, keypoints_vanilla;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_point, J_point_vanilla;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_intrinsics, J_intrinsics_vanilla;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_distortion, J_distortion_vanilla;
+  std::vector<aslam::ProjectionResult> results, results_vanilla;
+  this->camera_->project3FunctionalBatch(points, &intrinsics, &distortion, &keypoints,
+                                         &J_point, &J_intrinsics, &J_distortion, &results);
+  this->camera_->aslam::Camera::project3FunctionalBatch(
+      points, &intrinsics, &distortion, &keypoints_vanilla, &J_point_vanilla,
+      &J_intrinsics_vanilla, &J_distortion_vanilla, &results_vanilla);
+  ASSERT_EQ(N, keypoints.cols());
+  ASSERT_EQ(3 * N, J_point.cols());
+  ASSERT_EQ(num_intrinsics * N, J_intrinsics.cols());
+  ASSERT_EQ(num_distortion_params * N, J_distortion.cols());
+  ASSERT_EQ(static_cast<size_t>(N), results.size());
+  ASSERT_EQ(J_distortion.cols(), J_distortion_vanilla.cols());
+
+  Eigen::Vector2d keypoint;
+  Eigen::Matrix<double, 2, 3> J_point_single;
+  Eigen::Matrix<double, 2, Eigen::Dynamic> J_intrinsics_single, J_distortion_single;
+  for (int n = 0; n < N; ++n) {
+    const aslam::ProjectionResult result = this->camera_->project3Functional(
+        points.col(n), &intrinsics, &distortion, &keypoint, &J_point_single,
+        &J_intrinsics_single, &J_distortion_single);
+    EXPECT_EQ(result.getDetailedStatus(), results[n].getDetailedStatus()) << "Point " << n;
+    EXPECT_EQ(result.getDetailedStatus(), results_vanilla[n].getDetailedStatus())
+        << "Point " << n;
+    if (result.getDetailedStatus() != aslam::ProjectionResult::Status::KEYPOINT_VISIBLE) {
+      continue;
+    }
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoints.col(n), 1e-9));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(J_point_single, J_point.middleCols<3>(3 * n), 1e-6));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+        J_intrinsics_single, J_intrinsics.middleCols(num_intrinsics * n, num_intrinsics),
+        1e-6));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoints_vanilla.col(n), 1e-9));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(J_point_single, J_point_vanilla.middleCols<3>(3 * n), 1e-9));
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+        J_intrinsics_single,
+        J_intrinsics_vanilla.middleCols(num_intrinsics * n, num_intrinsics), 1e-9));
+    if (num_distortion_params > 0) {
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+          J_distortion_single,
+          J_distortion.middleCols(num_distortion_params * n, num_distortion_params), 1e-6));
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(
+          J_distortion_single,
+          J_distortion_vanilla.middleCols(num_distortion_params * n, num_distortion_params),
+          1e-9));
+    }
+  }
+}
+
+TYPED_TEST(TestCameras, backProject3VectorizedMatchesBackProject3) {
+  const int N = 500;
+  Eigen::Matrix2Xd keypoints(2, N);
+  for (int n = 0; n < N; ++n) {
+    keypoints.col(n) = this->camera_->createRandomKeypoint();
+  }
+
+  Eigen::Matrix3Xd points_3d;
+  std::vector<unsigned char> success;
+  this->camera_->backProject3Vectorized(keypoints, &points_3d, &success);
+  ASSERT_EQ(N, points_3d.cols());
+  ASSERT_EQ(static_cast<size_t>(N), success.size());
+
+  Eigen::Vector3d point_3d;
+  for (int n = 0; n < N; ++n) {
+    bool result = this->camera_->backProject3(keypoints.col(n), &point_3d);
+    EXPECT_EQ(result, static_cast<bool>(success[n])) << "Keypoint " << n;
+    if (result) {
+      EXPECT_TRUE(EIGEN_MATRIX_NEAR(point_3d, points_3d.col(n), 1e-6));
+    }
+  }
+}
+
+TYPED_TEST(TestCameras, project3VectorizedFloatAccuracy) {
+  // Maximal pixel error of the single-precision projection.
+  constexpr double kMaxPixelError = 1e-3;
+  const int N = 1000;
+  Eigen::Matrix3Xd points(3, N);
+  for (int n = 0; n < N; ++n) {
+    points.col(n) = this->camera_->createRandomVisiblePoint(10.0);
+  }
+  points.col(0) << 5000, -5, 1;
+  points.col(1) << -10, -10, -10;
+
+  Eigen::Matrix2Xd keypoints;
+  std::vector<aslam::ProjectionResult> results;
+  this->camera_->project3Vectorized(points, &keypoints, &results);
+  Eigen::Matrix2Xf keypoints_float;
+  std::vector<aslam::ProjectionResult> results_float;
+  this->camera_->project3Vectorized(points.cast<float>(), &keypoints_float, &results_float);
+  ASSERT_EQ(N, keypoints_float.cols());
+  ASSERT_EQ(static_cast<size_t>(N), results_float.size());
+
+  for (int n = 0; n < N; ++n) {
+    EXPECT_EQ(results[n].getDetailedStatus(), results_float[n].getDetailedStatus())
+        << "Point " << n;
+    if (results[n].getDetailedStatus() == aslam::ProjectionResult::Status::KEYPOINT_VISIBLE) {
+      EXPECT_LT((keypoints.col(n) - keypoints_float.col(n).cast<double>()).norm(),
+                kMaxPixelError) << "Point " << n;
+    }
+  }
+}
+
+TYPED_TEST(TestCameras, backProject3VectorizedFloatAccuracy) {
+  // Maximal reprojection error of the single-precision bearings in pixels.
+  constexpr double kMaxPixelError = 1e-3;
+  const int N = 1000;
+  Eigen::Matrix2Xd keypoints(2, N);
+  for (int n = 0; n < N; ++n) {
+    keypoints.col(n) = this->camera_->createRandomKeypoint();
+  }
+
+  Eigen::Matrix3Xd points;
+  std::vector<unsigned char> success;
+  this->camera_->backProject3Vectorized(keypoints, &points, &success);
+  Eigen::Matrix3Xf points_float;
+  std::vector<unsigned char> success_float;
+  this->camera_->backProject3Vectorized(keypoints.cast<float>(), &points_float, &success_float);
+  ASSERT_EQ(N, points_float.cols());
+  ASSERT_EQ(static_cast<size_t>(N), success_float.size());
+
+  Eigen::Vector2d reprojection;
+  for (int n = 0; n < N; ++n) {
+    EXPECT_EQ(success[n], success_float[n]) << "Keypoint " << n;
+    if (!success[n]) {
+      continue;
+    }
+    this->camera_->project3(points_float.col(n).cast<double>(), &reprojection);
+    EXPECT_LT((keypoints.col(n) - reprojection).norm(), kMaxPixelError) << "Keypoint " << n;
+  }
+}
+
+TYPED_TEST(TestCameras, BearingLookupTable) {
+  const int N = 500;
+  Eigen::Matrix2Xd keypoints(2, N);
+  Eigen::Matrix3Xd points_exact(3, N);
+  std::vector<bool> success_exact(N);
+  Eigen::Vector3d point_3d;
+  for (int n = 0; n < N; ++n) {
+    keypoints.col(n) = this->camera_->createRandomKeypoint();
+    success_exact[n] = this->camera_->backProject3(keypoints.col(n), &point_3d);
+    points_exact.col(n) = point_3d;
+  }
+  EXPECT_EQ(0u, this->camera_->getBearingLookupTableMemoryBytes());
+
+  for (int subsampling : {1, 4}) {
+    // Interpolation error grows with the node distance.
+    const double tolerance = subsampling == 1 ? 1e-4 : 1e-3;
+    this->camera_->enableBearingLookupTable(subsampling);
+    EXPECT_TRUE(this->camera_->isBearingLookupTableEnabled());
+
+    Eigen::Matrix3Xd points_3d;
+    std::vector<unsigned char> success;
+    this->camera_->backProject3Vectorized(keypoints, &points_3d, &success);
+    ASSERT_EQ(static_cast<size_t>(N), success.size());
+    const size_t num_nodes = (this->camera_->imageWidth() - 1 + subsampling - 1) /
+        subsampling + 1u;
+    EXPECT_GT(this->camera_->getBearingLookupTableMemoryBytes(), 3u * sizeof(float) * num_nodes);
+
+    for (int n = 0; n < N; ++n) {
+      EXPECT_EQ(success_exact[n], static_cast<bool>(success[n]));
+      EXPECT_EQ(success_exact[n], this->camera_->backProject3(keypoints.col(n), &point_3d));
+      if (success_exact[n]) {
+        // Compare the directions as the bearings grow large for wide-angle models.
+        const Eigen::Vector3d direction_exact = points_exact.col(n).normalized();
+        EXPECT_TRUE(
+            EIGEN_MATRIX_NEAR(direction_exact, points_3d.col(n).normalized(), tolerance));
+        EXPECT_TRUE(EIGEN_MATRIX_NEAR(direction_exact, point_3d.normalized(), tolerance));
+      }
+    }
+  }
+
+  // Changing the intrinsics invalidates the table.
+  Eigen::VectorXd intrinsics = this->camera_->getParameters();
+  intrinsics *= 1.1;
+  this->camera_->setParameters(intrinsics);
+  EXPECT_EQ(0u, this->camera_->getBearingLookupTableMemoryBytes());
+  Eigen::Vector3d point_from_table;
+  this->camera_->backProject3(keypoints.col(0), &point_from_table);
+  EXPECT_GT(this->camera_->getBearingLookupTableMemoryBytes(), 0u);
+  this->camera_->disableBearingLookupTable();
+  EXPECT_EQ(0u, this->camera_->getBearingLookupTableMemoryBytes());
+  this->camera_->backProject3(keypoints.col(0), &point_3d);
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(point_3d.normalized(), point_from_table.normalized(), 1e-4));
+
+  // So does handing out the intrinsics for modification.
+  this->camera_->enableBearingLookupTable(1);
+  this->camera_->backProject3(keypoints.col(0), &point_from_table);
+  EXPECT_GT(this->camera_->getBearingLookupTableMemoryBytes(), 0u);
+  this->camera_->getParametersMutable()[0] *= 1.1;
+  EXPECT_EQ(0u, this->camera_->getBearingLookupTableMemoryBytes());
+  this->camera_->backProject3(keypoints.col(0), &point_from_table);
+  this->camera_->disableBearingLookupTable();
+  this->camera_->backProject3(keypoints.col(0), &point_3d);
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(point_3d.normalized(), point_from_table.normalized(), 1e-4));
+}
+
+TYPED_TEST(TestCameras, FieldOfViewCandidatesAreConservative) {
+  const int N = 20000;
+  Eigen::Matrix3Xd points_3d = 20.0 * Eigen::Matrix3Xd::Random(3, N);
+  // Make sure that a good share of the points is visible.
+  for (int n = 0; n < N; n += 4) {
+    points_3d.col(n) = this->camera_->createRandomVisiblePoint(10.0 * (n % 3 + 1));
+  }
+
+  std::vector<int> candidates;
+  this->camera_->getFieldOfViewCandidates(points_3d, &candidates);
+  EXPECT_TRUE(std::is_sorted(candidates.begin(), candidates.end()));
+  EXPECT_LT(candidates.size(), static_cast<size_t>(N));
+
+  std::vector<bool> is_candidate(N, false);
+  for (const int index : candidates) {
+    is_candidate[index] = true;
+  }
+  aslam::FieldOfViewBound::ConstPtr bound = this->camera_->getFieldOfViewBound();
+  Eigen::Vector2d keypoint;
+  for (int n = 0; n < N; ++n) {
+    EXPECT_EQ(is_candidate[n], bound->isCandidate(points_3d.col(n))) << "Point " << n;
+    if (this->camera_->project3(points_3d.col(n), &keypoint).isKeypointVisible()) {
+      EXPECT_TRUE(is_candidate[n]) << "Visible point " << n << " was culled.";
+    }
+  }
+
+  // Changing the calibration through the camera drops the bound, which is rebuilt once.
+  EXPECT_EQ(bound, this->camera_->getFieldOfViewBound());
+  Eigen::VectorXd intrinsics = this->camera_->getParameters();
+  intrinsics *= 1.1;
+  this->camera_->setParameters(intrinsics);
+  aslam::FieldOfViewBound::ConstPtr rebuilt_bound = this->camera_->getFieldOfViewBound();
+  EXPECT_NE(bound, rebuilt_bound);
+  EXPECT_EQ(rebuilt_bound, this->camera_->getFieldOfViewBound());
+  this->camera_->getParametersMutable();
+  EXPECT_NE(rebuilt_bound, this->camera_->getFieldOfViewBound());
+  rebuilt_bound = this->camera_->getFieldOfViewBound();
+  this->camera_->getDistortionMutable();
+  EXPECT_NE(rebuilt_bound, this->camera_->getFieldOfViewBound());
+  rebuilt_bound = this->camera_->getFieldOfViewBound();
+  this->camera_->setImageWidth(this->camera_->imageWidth() + 10u);
+  EXPECT_NE(rebuilt_bound, this->camera_->getFieldOfViewBound());
+}
+
 TYPED_TEST(TestCameras, TestClone) {
   aslam::Camera::Ptr cam1(this->camera_->clone());
 
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <Eigen/Core>
 #include <eigen-checks/gtest.h>
 #include <glog/logging.h>
@@ -10,6 +12,7 @@
 #include <aslam/cameras/distortion-null.h>
 #include <aslam/cameras/distortion-radtan.h>
 #include <aslam/cameras/distortion-equidistant.h>
+#include <aslam/cameras/inverse-distortion-grid.h>
 #include <aslam/common/numdiff-jacobian-tester.h>
 
 ///////////////////////////////////////////////
@@ -142,6 +145,140 @@ struct Point3dJacobianFunctor : public aslam::common::NumDiffFunctor<2, 2> {
   const Eigen::VectorXd dist_coeffs_;
 };
 
+TYPED_TEST(TestDistortions, DistortVectorizedMatchesDistort) {
+  const int kNumSamples = 1000;
+  Eigen::Matrix2Xd keypoints = 2.0 * Eigen::Matrix2Xd::Random(2, kNumSamples);
+  // Include the image center which is handled separately by some models.
+  keypoints.col(0).setZero();
+
+  Eigen::ArrayXd x = keypoints.row(0).transpose().array();
+  Eigen::ArrayXd y = keypoints.row(1).transpose().array();
+  this->distortion_->distortVectorized(&x, &y);
+
+  for (int i = 0; i < kNumSamples; ++i) {
+    Eigen::Vector2d keypoint = keypoints.col(i);
+    this->distortion_->distort(&keypoint);
+    EXPECT_NEAR(keypoint[0], x[i], 1e-12);
+    EXPECT_NEAR(keypoint[1], y[i], 1e-12);
+  }
+}
+
+TYPED_TEST(TestDistortions, UndistortVectorizedMatchesUndistort) {
+  const int kNumSamples = 1000;
+  Eigen::Matrix2Xd keypoints = 0.8 * Eigen::Matrix2Xd::Random(2, kNumSamples);
+  keypoints.col(0).setZero();
+
+  Eigen::ArrayXd x = keypoints.row(0).transpose().array();
+  Eigen::ArrayXd y = keypoints.row(1).transpose().array();
+  this->distortion_->undistortVectorized(&x, &y);
+
+  for (int i = 0; i < kNumSamples; ++i) {
+    Eigen::Vector2d keypoint = keypoints.col(i);
+    this->distortion_->undistort(&keypoint);
+    EXPECT_NEAR(keypoint[0], x[i], 1e-12);
+    EXPECT_NEAR(keypoint[1], y[i], 1e-12);
+  }
+}
+
+TYPED_TEST(TestDistortions, VectorizedFloatMatchesDouble) {
+  const int kNumSamples = 1000;
+  Eigen::Matrix2Xd keypoints = 0.8 * Eigen::Matrix2Xd::Random(2, kNumSamples);
+  keypoints.col(0).setZero();
+
+  Eigen::ArrayXd x = keypoints.row(0).transpose().array();
+  Eigen::ArrayXd y = keypoints.row(1).transpose().array();
+  Eigen::ArrayXf x_float = x.cast<float>();
+  Eigen::ArrayXf y_float = y.cast<float>();
+  this->distortion_->distortVectorized(&x, &y);
+  this->distortion_->distortVectorized(&x_float, &y_float);
+  EXPECT_LT((x - x_float.cast<double>()).abs().maxCoeff(), 1e-5);
+  EXPECT_LT((y - y_float.cast<double>()).abs().maxCoeff(), 1e-5);
+
+  this->distortion_->undistortVectorized(&x, &y);
+  this->distortion_->undistortVectorized(&x_float, &y_float);
+  EXPECT_LT((x - x_float.cast<double>()).abs().maxCoeff(), 1e-5);
+  EXPECT_LT((y - y_float.cast<double>()).abs().maxCoeff(), 1e-5);
+}
+
+TYPED_TEST(TestDistortions, InverseDistortionGridUndistort) {
+  const int kNumSamples = 1000;
+  const Eigen::Vector2d min_distorted(-0.8, -0.6);
+  const Eigen::Vector2d max_distorted(0.8, 0.6);
+  aslam::InverseDistortionGrid grid(*this->distortion_, min_distorted, max_distorted);
+  EXPECT_TRUE(grid.isValidFor(*this->distortion_, min_distorted, max_distorted));
+
+  // Also sample outside of the grid which is seeded from the border cells.
+  Eigen::Matrix2Xd keypoints = Eigen::Matrix2Xd::Random(2, kNumSamples);
+  keypoints.col(0).setZero();
+
+  Eigen::ArrayXd x = keypoints.row(0).transpose().array();
+  Eigen::ArrayXd y = keypoints.row(1).transpose().array();
+  grid.undistort(&x, &y);
+
+  for (int i = 0; i < kNumSamples; ++i) {
+    Eigen::Vector2d keypoint = keypoints.col(i);
+    this->distortion_->undistort(&keypoint);
+    EXPECT_NEAR(keypoint[0], x[i], 1e-6);
+    EXPECT_NEAR(keypoint[1], y[i], 1e-6);
+  }
+}
+
+TEST(TestEquidistantDistortion, PolynomialFitInverse) {
+  aslam::EquidistantDistortion::UniquePtr distortion =
+      aslam::EquidistantDistortion::createTestDistortion();
+  aslam::EquidistantDistortion::UniquePtr iterative_distortion =
+      aslam::EquidistantDistortion::createTestDistortion();
+  distortion->setInverseMode(aslam::EquidistantDistortion::InverseMode::kPolynomialFit);
+
+  const int kNumSamples = 5000;
+  Eigen::Matrix2Xd keypoints = 1.5 * Eigen::Matrix2Xd::Random(2, kNumSamples);
+  keypoints.col(0).setZero();
+  Eigen::ArrayXd x = keypoints.row(0).transpose().array();
+  Eigen::ArrayXd y = keypoints.row(1).transpose().array();
+  distortion->undistortVectorized(&x, &y);
+
+  Eigen::Vector2d keypoint, keypoint_iterative, keypoint_distorted;
+  for (int i = 0; i < kNumSamples; ++i) {
+    keypoint = keypoints.col(i);
+    distortion->undistort(&keypoint);
+    EXPECT_NEAR(keypoint[0], x[i], 1e-12);
+    EXPECT_NEAR(keypoint[1], y[i], 1e-12);
+
+    // The iterative solver stops at a looser tolerance, the round trip bounds the error.
+    keypoint_iterative = keypoints.col(i);
+    iterative_distortion->undistort(&keypoint_iterative);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint_iterative, keypoint,
+                                  1e-6 * std::max(1.0, keypoint_iterative.norm())));
+    distortion->distort(keypoint, &keypoint_distorted);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoints.col(i), keypoint_distorted, 1e-11));
+  }
+
+  // The fit is rebuilt for new parameters. The fit is more accurate than the iterative solver
+  // close to the end of the monotonic range of this model.
+  Eigen::VectorXd parameters(4);
+  parameters << -0.3, 0.05, 0.0, 0.0;
+  distortion->setParameters(parameters);
+  for (int i = 0; i < kNumSamples; ++i) {
+    distortion->undistort(0.4 * keypoints.col(i), &keypoint);
+    distortion->distort(keypoint, &keypoint_distorted);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(0.4 * keypoints.col(i), keypoint_distorted, 1e-12));
+  }
+}
+
+TEST(TestFisheyeDistortion, ClosedFormInverse) {
+  aslam::FisheyeDistortion::UniquePtr distortion =
+      aslam::FisheyeDistortion::createTestDistortion();
+  // Distorted radii up to the maximum valid angle of the model.
+  const int kNumSamples = 5000;
+  const Eigen::Matrix2Xd keypoints = 0.9 * Eigen::Matrix2Xd::Random(2, kNumSamples);
+  Eigen::Vector2d keypoint;
+  for (int i = 0; i < kNumSamples; ++i) {
+    distortion->undistort(keypoints.col(i), &keypoint);
+    distortion->distort(&keypoint);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoints.col(i), keypoint, 1e-12));
+  }
+}
+
 TYPED_TEST(TestDistortions, JacobianWrtKeypoint) {
   Eigen::Vector2d keypoint(0.3, -0.2);
   Eigen::VectorXd dist_coeffs = this->distortion_->getParameters();
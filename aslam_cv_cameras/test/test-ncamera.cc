@@ -7,6 +7,7 @@
 #include <aslam/cameras/ncamera.h>
 #include <aslam/cameras/random-camera-generator.h>
 #include <aslam/common/entrypoint.h>
+#include <aslam/common/thread-pool.h>
 #include <aslam/common/yaml-serialization.h>
 
 TEST(TestNCameraYamlSerialization, testEmptyYaml) {
@@ -99,4 +100,45 @@ TEST(TestNCamera, testCloneRigWithoutDistortion) {
   }
 }
 
+TEST(TestNCamera, project3VectorizedMatchesPerCameraProjection) {
+  aslam::NCamera::Ptr ncamera = aslam::createSurroundViewTestNCamera();
+  ASSERT_TRUE(ncamera.get() != nullptr);
+
+  // Use a number of points that is not a multiple of the chunk size.
+  const int kNumPoints = 10007;
+  const Eigen::Matrix3Xd points_B = 10.0 * Eigen::Matrix3Xd::Random(3, kNumPoints);
+
+  std::vector<Eigen::Matrix2Xd> keypoints_serial, keypoints_parallel;
+  std::vector<std::vector<unsigned char>> is_visible_serial, is_visible_parallel;
+  ncamera->project3VectorizedWithNumThreads(
+      points_B, 1u, &keypoints_serial, &is_visible_serial);
+  aslam::ThreadPool thread_pool(4u);
+  ncamera->project3Vectorized(points_B, &thread_pool, &keypoints_parallel, &is_visible_parallel);
+  ASSERT_EQ(ncamera->getNumCameras(), keypoints_serial.size());
+  ASSERT_EQ(ncamera->getNumCameras(), keypoints_parallel.size());
+  ASSERT_EQ(ncamera->getNumCameras(), is_visible_serial.size());
+  ASSERT_EQ(ncamera->getNumCameras(), is_visible_parallel.size());
+
+  size_t num_visible = 0u;
+  Eigen::Vector2d keypoint;
+  for (size_t cam_idx = 0u; cam_idx < ncamera->getNumCameras(); ++cam_idx) {
+    const aslam::Camera& camera = ncamera->getCamera(cam_idx);
+    const aslam::Transformation& T_C_B = ncamera->get_T_C_B(cam_idx);
+    ASSERT_EQ(kNumPoints, keypoints_parallel[cam_idx].cols());
+    ASSERT_EQ(static_cast<size_t>(kNumPoints), is_visible_parallel[cam_idx].size());
+    for (int i = 0; i < kNumPoints; ++i) {
+      const Eigen::Vector3d point_B = points_B.col(i);
+      const aslam::ProjectionResult result = camera.project3(T_C_B * point_B, &keypoint);
+      EXPECT_EQ(result.isKeypointVisible(), is_visible_serial[cam_idx][i] != 0u);
+      EXPECT_EQ(result.isKeypointVisible(), is_visible_parallel[cam_idx][i] != 0u);
+      if (result.isKeypointVisible()) {
+        ++num_visible;
+        EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoints_serial[cam_idx].col(i), 1e-8));
+        EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoint, keypoints_parallel[cam_idx].col(i), 1e-8));
+      }
+    }
+  }
+  EXPECT_GT(num_visible, 0u);
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
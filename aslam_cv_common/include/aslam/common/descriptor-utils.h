@@ -44,21 +44,29 @@ inline void descriptorMeanRoundedToBinaryValue(
   CHECK_NOTNULL(median)->resize(descriptors.rows(), Eigen::NoChange);
   median->setZero();
 
+  // Counted byte by byte without bounds checks, as this runs over all descriptors of a cluster
+  // in every iteration of the vocabulary training.
+  const int num_bytes = descriptors.rows();
   std::vector<int> sums;
-  sums.resize(descriptors.rows() * kBitsPerByte, 0);
-  const size_t num_descriptor_bits = descriptors.rows() * kBitsPerByte;
+  sums.resize(num_bytes * kBitsPerByte, 0);
   for (int i = 0; i < descriptors.cols(); ++i) {
-    for (size_t bit = 0u; bit < num_descriptor_bits; ++bit) {
-      if (getBit(bit, descriptors.col(i))) {
-        ++sums[bit];
+    const unsigned char* descriptor = &descriptors.coeffRef(0, i);
+    for (int byte = 0; byte < num_bytes; ++byte) {
+      int* byte_sums = &sums[byte * kBitsPerByte];
+      for (size_t bit_in_byte = 0u; bit_in_byte < kBitsPerByte; ++bit_in_byte) {
+        byte_sums[bit_in_byte] += (descriptor[byte] >> bit_in_byte) & 1;
       }
     }
   }
   const int half = descriptors.cols() / 2;
-  for (size_t bit = 0u; bit < sums.size(); ++bit) {
-    if (sums[bit] > half) {
-      setBit(bit, median);
+  for (int byte = 0; byte < num_bytes; ++byte) {
+    unsigned char value = 0u;
+    for (size_t bit_in_byte = 0u; bit_in_byte < kBitsPerByte; ++bit_in_byte) {
+      if (sums[byte * kBitsPerByte + bit_in_byte] > half) {
+        value |= static_cast<unsigned char>(1u << bit_in_byte);
+      }
     }
+    (*median)(byte) = value;
   }
 }
 
@@ -0,0 +1,174 @@
+#ifndef ASLAM_COMMON_HAMMING_MATRIX_H_
+#define ASLAM_COMMON_HAMMING_MATRIX_H_
+
+#include <limits>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace aslam {
+namespace common {
+
+/// The kernels computing the Hamming distances of a tile of descriptor pairs.
+enum class HammingKernel {
+  /// 64 bit popcount, available everywhere.
+  kScalar,
+  /// 64 bit popcount with the popcnt instruction.
+  kPopcnt,
+  /// Nibble lookup with pshufb on 128 bit registers, as in Hamming::SSSE3PopcntofXORed.
+  kSsse3,
+  /// Nibble lookup with vpshufb on 256 bit registers.
+  kAvx2,
+  /// vpopcntq on 512 bit registers.
+  kAvx512Vpopcntdq
+};
+
+/// \brief The fastest kernel supported by the CPU, detected at runtime.
+HammingKernel getBestHammingKernel();
+
+/// \brief Is the kernel supported by the CPU and the compiler?
+bool isHammingKernelSupported(HammingKernel kernel);
+
+/// \brief Name of the kernel for logging.
+const char* getHammingKernelName(HammingKernel kernel);
+
+/// \brief Compute the Hamming distances between all pairs of two sets of binary descriptors.
+///
+/// Both operands are tiled such that a tile of each fits into the L1 cache, and the distances
+/// of a tile are computed by the fastest kernel of the CPU.
+///
+/// \param[in]  descriptors_a One descriptor per column, as in VisualFrame::DescriptorsT.
+/// \param[in]  descriptors_b One descriptor per column, of the same size as descriptors_a.
+/// \param[out] distances     The distance of column i of descriptors_a to column j of
+///                           descriptors_b at (i, j).
+void computeHammingDistanceMatrix(
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_a,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_b,
+    Eigen::MatrixXi* distances);
+
+/// \brief Same as above with a given kernel, which must be supported.
+void computeHammingDistanceMatrix(
+    HammingKernel kernel,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_a,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_b,
+    Eigen::MatrixXi* distances);
+
+/// \brief Compute the distances of a query to some of a set of descriptors.
+///
+/// The candidates are processed in blocks by the fastest kernel of the CPU, and no memory is
+/// allocated, such that this can be called for every keypoint with the descriptors in its
+/// search window.
+///
+/// \param[in]  query             The query descriptor of descriptors.rows() bytes.
+/// \param[in]  descriptors       One descriptor per column, as in VisualFrame::DescriptorsT.
+/// \param[in]  candidate_indices The columns of descriptors to compute the distances to, or
+///                               nullptr for the first num_candidates columns.
+/// \param[in]  num_candidates    The number of candidates.
+/// \param[out] distances         The distance to candidate i at distances[i], for
+///                               num_candidates candidates.
+void computeHammingDistancesToQuery(
+    const unsigned char* query,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors,
+    const int* candidate_indices, int num_candidates, int* distances);
+
+/// \brief Same as above with a given kernel, which must be supported.
+void computeHammingDistancesToQuery(
+    HammingKernel kernel, const unsigned char* query,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors,
+    const int* candidate_indices, int num_candidates, int* distances);
+
+/// The index of a missing neighbor, if there were fewer candidates than neighbors.
+constexpr int kNoHammingNeighbor = -1;
+
+/// \brief Set k neighbors to missing, at a distance larger than that of any descriptors.
+inline void resetHammingNeighbors(int k, int* neighbor_indices, int* neighbor_distances) {
+  for (int neighbor = 0; neighbor < k; ++neighbor) {
+    neighbor_indices[neighbor] = kNoHammingNeighbor;
+    neighbor_distances[neighbor] = std::numeric_limits<int>::max();
+  }
+}
+
+/// \brief Insert a candidate into k neighbors sorted by increasing distance, if it is nearer
+///        than the last one. A candidate is inserted after neighbors at the same distance, so
+///        the first of equally near candidates comes first.
+inline void insertHammingNeighbor(int index, int distance, int k, int* neighbor_indices,
+                                  int* neighbor_distances) {
+  if (distance >= neighbor_distances[k - 1]) {
+    return;
+  }
+  int neighbor = k - 1;
+  for (; neighbor > 0 && neighbor_distances[neighbor - 1] > distance; --neighbor) {
+    neighbor_indices[neighbor] = neighbor_indices[neighbor - 1];
+    neighbor_distances[neighbor] = neighbor_distances[neighbor - 1];
+  }
+  neighbor_indices[neighbor] = index;
+  neighbor_distances[neighbor] = distance;
+}
+
+/// \brief Insert the candidates nearer than the k given neighbors of a query.
+///
+/// The neighbors are initialized with resetHammingNeighbors and can be updated with the
+/// candidates of several search windows one after another. With k = 2, the neighbors are the
+/// best and second best distances of Lowe's ratio test. No memory is allocated.
+///
+/// \param[in]     query              The query descriptor of descriptors.rows() bytes.
+/// \param[in]     descriptors        One descriptor per column.
+/// \param[in]     candidate_indices  The columns of descriptors to search, or nullptr for the
+///                                   first num_candidates columns.
+/// \param[in]     num_candidates     The number of candidates.
+/// \param[in]     k                  The number of neighbors.
+/// \param[in,out] neighbor_indices   The columns of the k nearest descriptors.
+/// \param[in,out] neighbor_distances Their distances to the query in increasing order.
+void updateNearestHammingNeighbors(
+    const unsigned char* query,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors,
+    const int* candidate_indices, int num_candidates, int k, int* neighbor_indices,
+    int* neighbor_distances);
+
+/// The candidates of several queries in one array, e.g. the descriptors in the search windows
+/// of the keypoints. The candidates of query q are indices[offsets[q]] to
+/// indices[offsets[q + 1] - 1]. Clearing the lists keeps the memory for the next frame.
+struct HammingCandidateLists {
+  std::vector<int> offsets;
+  std::vector<int> indices;
+  HammingCandidateLists() : offsets(1, 0) {};
+
+  /// \brief End the list of the next query after its candidates were added to indices.
+  void finishQuery() {
+    offsets.push_back(static_cast<int>(indices.size()));
+  }
+
+  int getNumQueries() const {
+    return static_cast<int>(offsets.size()) - 1;
+  }
+
+  void clear() {
+    offsets.resize(1);
+    indices.clear();
+  }
+};
+
+/// \brief Find the k nearest descriptors of each query among all descriptors.
+///
+/// \param[in]  queries            One query descriptor per column.
+/// \param[in]  descriptors        One descriptor per column, of the same size as the queries.
+/// \param[in]  k                  The number of neighbors per query.
+/// \param[out] neighbor_indices   The columns of the k nearest descriptors of query q in column
+///                                q, kNoHammingNeighbor if there are fewer descriptors.
+/// \param[out] neighbor_distances Their distances to query q in increasing order.
+void findNearestHammingNeighbors(
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& queries,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors, int k,
+    Eigen::MatrixXi* neighbor_indices, Eigen::MatrixXi* neighbor_distances);
+
+/// \brief Same as above, searching only the candidates of each query.
+void findNearestHammingNeighbors(
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& queries,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors,
+    const HammingCandidateLists& candidates, int k, Eigen::MatrixXi* neighbor_indices,
+    Eigen::MatrixXi* neighbor_distances);
+
+}  // namespace common
+}  // namespace aslam
+
+#endif  // ASLAM_COMMON_HAMMING_MATRIX_H_
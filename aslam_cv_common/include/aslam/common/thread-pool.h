@@ -82,6 +82,17 @@ class ThreadPool {
       std::numeric_limits<size_t>::max();
 
   size_t numActiveThreads() const;
+
+  /// Number of worker threads in the pool.
+  size_t numThreads() const { return workers_.size(); }
+
+  /// Is the calling thread one of the worker threads of the pool? A task that waits for other
+  /// tasks of its own pool can deadlock once all workers wait.
+  bool isWorkerThread() const;
+
+  /// \brief Restrict the worker threads to the given CPU cores. Only supported on Linux.
+  /// \returns False if the affinity could not be set.
+  bool setCpuAffinity(const std::vector<int>& cpu_cores);
  private:
   // This version is not threadsafe.
   size_t numQueuedTasksImpl() const;
@@ -217,6 +217,46 @@ void buildUndistortMap(const InputDerivedCameraType& input_camera,
   }
 }
 
+/// \brief Calculates subsampled undistortion maps for the given camera geometries. The maps hold
+///        the distorted coordinates of every subsampling-th output pixel in each direction, i.e.
+///        node (r, c) corresponds to the output pixel (c * subsampling, r * subsampling). One
+///        extra row and column of nodes beyond the image border is added such that every output
+///        pixel can be interpolated bilinearly from the four surrounding nodes.
+/// @param[in] input_camera Input camera geometry
+/// @param[in] output_camera Output camera geometry
+/// @param[in] subsampling Distance between the nodes in output pixels.
+/// @param[out] map_u Map of the u-coordinates (CV_32FC1) of size
+///                   ((height - 1) / subsampling + 2) x ((width - 1) / subsampling + 2).
+/// @param[out] map_v Map of the v-coordinates (CV_32FC1) of the same size.
+template<typename InputDerivedCameraType, typename OutputDerivedCameraType>
+void buildSubsampledUndistortMap(const InputDerivedCameraType& input_camera,
+                                 const OutputDerivedCameraType& output_camera, int subsampling,
+                                 cv::Mat* map_u, cv::Mat* map_v) {
+  CHECK_GT(subsampling, 0);
+  CHECK_NOTNULL(map_u);
+  CHECK_NOTNULL(map_v);
+  const int num_rows = (static_cast<int>(output_camera.imageHeight()) - 1) / subsampling + 2;
+  const int num_cols = (static_cast<int>(output_camera.imageWidth()) - 1) / subsampling + 2;
+  map_u->create(num_rows, num_cols, CV_32FC1);
+  map_v->create(num_rows, num_cols, CV_32FC1);
+
+  for (int row = 0; row < num_rows; ++row) {
+    float* map_u_row = map_u->ptr<float>(row);
+    float* map_v_row = map_v->ptr<float>(row);
+    for (int col = 0; col < num_cols; ++col) {
+      // Convert point on normalized image plane to keypoints. (projection and distortion)
+      const Eigen::Vector2d keypoint(col * subsampling, row * subsampling);
+      Eigen::Vector2d keypoint_dist;
+      Eigen::Vector3d point_3d;
+      output_camera.backProject3(keypoint, &point_3d);
+      point_3d /= point_3d[2];
+      input_camera.project3(point_3d, &keypoint_dist);
+      map_u_row[col] = static_cast<float>(keypoint_dist[0]);
+      map_v_row[col] = static_cast<float>(keypoint_dist[1]);
+    }
+  }
+}
+
 } //namespace common
 } //namespace aslam
 
@@ -0,0 +1,131 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/feature-descriptor-ref.h>
+#include <aslam/common/hamming-matrix.h>
+#include <aslam/common/timer.h>
+
+// Compares the distance matrix of two frames of BRISK sized descriptors computed pair by pair
+// through FeatureDescriptorConstRef, as in the frame to frame matcher, to the blocked kernels,
+// and the same for the best and second best candidates in the search windows of keypoints.
+
+constexpr int kDescriptorSizeBytes = 48;
+constexpr int kNumDescriptors = 2000;
+constexpr int kNumRepetitions = 10;
+constexpr int kNumCandidatesPerWindow = 40;
+
+TEST(HammingMatrixBenchmark, CompareToPerPairDistances) {
+  typedef Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> DescriptorsType;
+  DescriptorsType descriptors_a(kDescriptorSizeBytes, kNumDescriptors);
+  DescriptorsType descriptors_b(kDescriptorSizeBytes, kNumDescriptors);
+  descriptors_a.setRandom();
+  descriptors_b.setRandom();
+  const double num_pairs = static_cast<double>(kNumDescriptors) * kNumDescriptors;
+
+  Eigen::MatrixXi per_pair_distances(kNumDescriptors, kNumDescriptors);
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer("per pair");
+    for (int j = 0; j < kNumDescriptors; ++j) {
+      const aslam::common::FeatureDescriptorConstRef descriptor_b(
+          &descriptors_b.coeffRef(0, j), kDescriptorSizeBytes);
+      for (int i = 0; i < kNumDescriptors; ++i) {
+        const aslam::common::FeatureDescriptorConstRef descriptor_a(
+            &descriptors_a.coeffRef(0, i), kDescriptorSizeBytes);
+        per_pair_distances(i, j) = aslam::common::GetNumBitsDifferent(descriptor_a, descriptor_b);
+      }
+    }
+    timer.Stop();
+  }
+  LOG(INFO) << "per pair: " << num_pairs / timing::Timing::GetMeanSeconds("per pair") / 1e6
+            << " M pairs/s";
+
+  const std::vector<aslam::common::HammingKernel> kernels = {
+      aslam::common::HammingKernel::kScalar, aslam::common::HammingKernel::kPopcnt,
+      aslam::common::HammingKernel::kSsse3, aslam::common::HammingKernel::kAvx2,
+      aslam::common::HammingKernel::kAvx512Vpopcntdq};
+  for (const aslam::common::HammingKernel kernel : kernels) {
+    if (!aslam::common::isHammingKernelSupported(kernel)) {
+      continue;
+    }
+    const std::string timer_name = aslam::common::getHammingKernelName(kernel);
+    Eigen::MatrixXi distances;
+    for (int rep = 0; rep < kNumRepetitions; ++rep) {
+      timing::TimerImpl timer(timer_name);
+      aslam::common::computeHammingDistanceMatrix(kernel, descriptors_a, descriptors_b,
+                                                  &distances);
+      timer.Stop();
+    }
+    EXPECT_EQ(per_pair_distances, distances);
+    LOG(INFO) << timer_name << ": "
+              << num_pairs / timing::Timing::GetMeanSeconds(timer_name) / 1e6 << " M pairs/s";
+  }
+}
+
+TEST(HammingMatrixBenchmark, CompareTopTwoToPerPairSearch) {
+  typedef Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> DescriptorsType;
+  DescriptorsType queries(kDescriptorSizeBytes, kNumDescriptors);
+  DescriptorsType descriptors(kDescriptorSizeBytes, kNumDescriptors);
+  queries.setRandom();
+  descriptors.setRandom();
+  // Random search windows, as collected around the predicted keypoint positions.
+  aslam::common::HammingCandidateLists candidates;
+  std::srand(42);
+  for (int query = 0; query < kNumDescriptors; ++query) {
+    for (int candidate = 0; candidate < kNumCandidatesPerWindow; ++candidate) {
+      candidates.indices.push_back(std::rand() % kNumDescriptors);
+    }
+    candidates.finishQuery();
+  }
+  const double num_pairs = static_cast<double>(kNumDescriptors) * kNumCandidatesPerWindow;
+
+  Eigen::MatrixXi per_pair_distances(2, kNumDescriptors);
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer("top two per pair");
+    for (int query = 0; query < kNumDescriptors; ++query) {
+      const aslam::common::FeatureDescriptorConstRef descriptor_query(
+          &queries.coeffRef(0, query), kDescriptorSizeBytes);
+      unsigned int distance_best = kDescriptorSizeBytes * 8 + 1;
+      unsigned int distance_second_best = kDescriptorSizeBytes * 8 + 1;
+      for (int candidate = candidates.offsets[query]; candidate < candidates.offsets[query + 1];
+           ++candidate) {
+        const aslam::common::FeatureDescriptorConstRef descriptor(
+            &descriptors.coeffRef(0, candidates.indices[candidate]), kDescriptorSizeBytes);
+        const unsigned int distance =
+            aslam::common::GetNumBitsDifferent(descriptor_query, descriptor);
+        if (distance < distance_best) {
+          distance_second_best = distance_best;
+          distance_best = distance;
+        } else if (distance < distance_second_best) {
+          distance_second_best = distance;
+        }
+      }
+      per_pair_distances(0, query) = distance_best;
+      per_pair_distances(1, query) = distance_second_best;
+    }
+    timer.Stop();
+  }
+  LOG(INFO) << "top two per pair: "
+            << num_pairs / timing::Timing::GetMeanSeconds("top two per pair") / 1e6
+            << " M pairs/s";
+
+  Eigen::MatrixXi neighbor_indices;
+  Eigen::MatrixXi neighbor_distances;
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer("top two");
+    aslam::common::findNearestHammingNeighbors(queries, descriptors, candidates, 2,
+                                               &neighbor_indices, &neighbor_distances);
+    timer.Stop();
+  }
+  EXPECT_EQ(per_pair_distances, neighbor_distances);
+  LOG(INFO) << "top two, " << aslam::common::getHammingKernelName(
+                   aslam::common::getBestHammingKernel()) << ": "
+            << num_pairs / timing::Timing::GetMeanSeconds("top two") / 1e6 << " M pairs/s";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,805 @@
+#include "aslam/common/hamming-matrix.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include <glog/logging.h>
+
+// The SIMD kernels are compiled with function target attributes and selected at runtime, such
+// that the library does not require the instruction sets of the build machine.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ASLAM_HAMMING_MATRIX_SSSE3
+#define ASLAM_HAMMING_MATRIX_AVX2
+#if (defined(__clang__) && __clang_major__ >= 6) || (!defined(__clang__) && __GNUC__ >= 8)
+#define ASLAM_HAMMING_MATRIX_AVX512
+#endif
+#include <immintrin.h>
+#endif
+
+namespace aslam {
+namespace common {
+namespace {
+// A tile of each operand takes at most half of a 32 KiB L1 data cache.
+constexpr int kMaxTileSizeBytes = 8 * 1024;
+// The nearest neighbor searches compute the distances to this many descriptors at once into a
+// buffer on the stack.
+constexpr int kMaxCandidatesPerPass = 256;
+// The exhaustive nearest neighbor search computes the distances of this many queries at once.
+constexpr int kMaxQueriesPerPass = 16;
+// The kernels compute the distances of this many descriptors of a to one descriptor of b at
+// once, such that every load of b is used for several distances.
+constexpr int kBlockSize = 4;
+
+// Computes the distances of num_a descriptors of a to num_b descriptors of b. The distance of
+// descriptor i of a to descriptor j of b is written to distances[i + j * distances_stride].
+typedef void (*TileKernel)(const unsigned char* descriptors_a, int num_a,
+                           const unsigned char* descriptors_b, int num_b,
+                           int descriptor_size_bytes, int* distances, int distances_stride);
+
+// Computes the distances of a query to num_candidates descriptors, the columns
+// candidate_indices of descriptors or the first num_candidates columns without candidate indices.
+// The distance to candidate i is written to distances[i].
+typedef void (*QueryKernel)(const unsigned char* query, const unsigned char* descriptors,
+                            const int* candidate_indices, int num_candidates,
+                            int descriptor_size_bytes, int* distances);
+
+inline int popcount64(uint64_t value) {
+#ifdef __GNUC__
+  return __builtin_popcountll(value);
+#else
+  value = value - ((value >> 1) & 0x5555555555555555ull);
+  value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+  value = (value + (value >> 4)) & 0x0f0f0f0f0f0f0f0full;
+  return static_cast<int>((value * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// The split of a descriptor into chunks of full SIMD registers, followed by 8 byte words that
+// are loaded with a mask and by the remaining bytes, which are added one by one.
+struct DescriptorLayout {
+  DescriptorLayout(int descriptor_size_bytes, int register_size_bytes)
+    : tail_begin(descriptor_size_bytes / register_size_bytes * register_size_bytes),
+      num_tail_words((descriptor_size_bytes - tail_begin) / 8),
+      scalar_begin(tail_begin + num_tail_words * 8) {}
+  int tail_begin;
+  int num_tail_words;
+  int scalar_begin;
+};
+
+// The number of different bits of the bytes [begin, end) of two descriptors.
+inline int scalarPopcountOfXored(const unsigned char* a, const unsigned char* b, int begin,
+                                 int end) {
+  int distance = 0;
+  int byte = begin;
+  for (; byte + 8 <= end; byte += 8) {
+    uint64_t word_a;
+    uint64_t word_b;
+    std::memcpy(&word_a, a + byte, sizeof(word_a));
+    std::memcpy(&word_b, b + byte, sizeof(word_b));
+    distance += popcount64(word_a ^ word_b);
+  }
+  for (; byte < end; ++byte) {
+    distance += popcount64(static_cast<uint64_t>(a[byte] ^ b[byte]));
+  }
+  return distance;
+}
+
+void computeTileScalar(const unsigned char* descriptors_a, int num_a,
+                       const unsigned char* descriptors_b, int num_b,
+                       int descriptor_size_bytes, int* distances, int distances_stride) {
+  for (int j = 0; j < num_b; ++j) {
+    const unsigned char* descriptor_b = descriptors_b + j * descriptor_size_bytes;
+    for (int i = 0; i < num_a; ++i) {
+      distances[i + j * distances_stride] = scalarPopcountOfXored(
+          descriptors_a + i * descriptor_size_bytes, descriptor_b, 0, descriptor_size_bytes);
+    }
+  }
+}
+
+void computeQueryScalar(const unsigned char* query, const unsigned char* descriptors,
+                        const int* candidate_indices, int num_candidates,
+                        int descriptor_size_bytes, int* distances) {
+  for (int i = 0; i < num_candidates; ++i) {
+    const int index = candidate_indices == nullptr ? i : candidate_indices[i];
+    distances[i] = scalarPopcountOfXored(descriptors + index * descriptor_size_bytes, query, 0,
+                                         descriptor_size_bytes);
+  }
+}
+
+// Get the descriptors of a of the block starting at i, where descriptor i of a is the column
+// candidate_indices[i] of descriptors_a, or column i without candidate indices. A partial block
+// at the end repeats the last descriptor, whose distances are not stored.
+inline void getBlock(const unsigned char* descriptors_a, const int* candidate_indices, int num_a,
+                     int i, int descriptor_size_bytes, const unsigned char** block) {
+  for (int k = 0; k < kBlockSize; ++k) {
+    const int index = std::min(i + k, num_a - 1);
+    block[k] = descriptors_a + (candidate_indices == nullptr ? index : candidate_indices[index]) *
+        descriptor_size_bytes;
+  }
+}
+
+// Add the bytes after scalar_begin that the SIMD registers did not cover to the distances of
+// a partial block of a to a descriptor of b.
+inline void finishPartialBlock(const unsigned char* const* block,
+                               const unsigned char* descriptor_b, int num_valid,
+                               int scalar_begin, int descriptor_size_bytes,
+                               const int* block_distances, int* distances) {
+  for (int k = 0; k < num_valid; ++k) {
+    distances[k] = block_distances[k] + scalarPopcountOfXored(
+        block[k], descriptor_b, scalar_begin, descriptor_size_bytes);
+  }
+}
+
+#ifdef ASLAM_HAMMING_MATRIX_SSSE3
+// Same as scalarPopcountOfXored with the popcnt instruction, which the builtin only uses if the
+// whole library is compiled for it.
+__attribute__((target("popcnt"))) inline int scalarPopcountOfXoredPopcnt(
+    const unsigned char* a, const unsigned char* b, int begin, int end) {
+  long long distance = 0;
+  int byte = begin;
+  for (; byte + 8 <= end; byte += 8) {
+    uint64_t word_a;
+    uint64_t word_b;
+    std::memcpy(&word_a, a + byte, sizeof(word_a));
+    std::memcpy(&word_b, b + byte, sizeof(word_b));
+    distance += _mm_popcnt_u64(word_a ^ word_b);
+  }
+  for (; byte < end; ++byte) {
+    distance += _mm_popcnt_u32(a[byte] ^ b[byte]);
+  }
+  return static_cast<int>(distance);
+}
+
+__attribute__((target("popcnt"))) void computeTilePopcnt(
+    const unsigned char* descriptors_a, int num_a, const unsigned char* descriptors_b,
+    int num_b, int descriptor_size_bytes, int* distances, int distances_stride) {
+  for (int j = 0; j < num_b; ++j) {
+    const unsigned char* descriptor_b = descriptors_b + j * descriptor_size_bytes;
+    for (int i = 0; i < num_a; ++i) {
+      distances[i + j * distances_stride] = scalarPopcountOfXoredPopcnt(
+          descriptors_a + i * descriptor_size_bytes, descriptor_b, 0, descriptor_size_bytes);
+    }
+  }
+}
+
+__attribute__((target("popcnt"))) void computeQueryPopcnt(
+    const unsigned char* query, const unsigned char* descriptors, const int* candidate_indices,
+    int num_candidates, int descriptor_size_bytes, int* distances) {
+  for (int i = 0; i < num_candidates; ++i) {
+    const int index = candidate_indices == nullptr ? i : candidate_indices[i];
+    distances[i] = scalarPopcountOfXoredPopcnt(descriptors + index * descriptor_size_bytes,
+                                               query, 0, descriptor_size_bytes);
+  }
+}
+
+// Store the distances of a block of a to a descriptor of b. The distances of a partial block
+// or of descriptors with bytes after scalar_begin are finished one by one. This only needs
+// SSE2, so it is inlined into all SIMD kernels.
+inline void storeBlock(__m128i block_distances, const unsigned char* const* block,
+                       const unsigned char* descriptor_b, int num_valid, int scalar_begin,
+                       int descriptor_size_bytes, int* distances) {
+  if (num_valid == kBlockSize && scalar_begin == descriptor_size_bytes) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(distances), block_distances);
+    return;
+  }
+  int partial_block_distances[kBlockSize];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(partial_block_distances), block_distances);
+  finishPartialBlock(block, descriptor_b, num_valid, scalar_begin, descriptor_size_bytes,
+                     partial_block_distances, distances);
+}
+
+// Popcount of every byte with a lookup of the nibbles, adapted from
+// http://wm.ite.pl/articles/sse-popcount.html as in Hamming::SSSE3PopcntofXORed.
+__attribute__((target("ssse3"))) inline __m128i popcountBytesSsse3(
+    __m128i value, __m128i lookup, __m128i low_mask) {
+  const __m128i low_nibbles = _mm_and_si128(value, low_mask);
+  const __m128i high_nibbles = _mm_and_si128(_mm_srli_epi16(value, 4), low_mask);
+  return _mm_add_epi8(_mm_shuffle_epi8(lookup, low_nibbles),
+                      _mm_shuffle_epi8(lookup, high_nibbles));
+}
+
+// Add the popcount of a ^ b to the two 64 bit counters of the accumulator.
+__attribute__((target("ssse3"))) inline __m128i accumulatePopcountOfXoredSsse3(
+    __m128i a, __m128i b, __m128i lookup, __m128i low_mask, __m128i accumulator) {
+  return _mm_add_epi64(accumulator, _mm_sad_epu8(
+      popcountBytesSsse3(_mm_xor_si128(a, b), lookup, low_mask), _mm_setzero_si128()));
+}
+
+// Sum the two 64 bit counters of each accumulator into four ints.
+__attribute__((target("ssse3"))) inline __m128i horizontalSum4Ssse3(
+    __m128i accumulator0, __m128i accumulator1, __m128i accumulator2, __m128i accumulator3) {
+  const __m128i sum01 = _mm_add_epi64(_mm_unpacklo_epi64(accumulator0, accumulator1),
+                                      _mm_unpackhi_epi64(accumulator0, accumulator1));
+  const __m128i sum23 = _mm_add_epi64(_mm_unpacklo_epi64(accumulator2, accumulator3),
+                                      _mm_unpackhi_epi64(accumulator2, accumulator3));
+  // The sums fit into the lower 32 bits of the counters.
+  return _mm_unpacklo_epi64(_mm_shuffle_epi32(sum01, _MM_SHUFFLE(3, 1, 2, 0)),
+                            _mm_shuffle_epi32(sum23, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+// The distances of a block of a to a descriptor of b, without the bytes after scalar_begin.
+// With 16 byte registers, the tail is at most one 8 byte word, which is loaded without a mask.
+__attribute__((target("ssse3"))) inline __m128i computeBlockSsse3(
+    const unsigned char* const* block, const unsigned char* descriptor_b,
+    const DescriptorLayout& layout, __m128i lookup, __m128i low_mask) {
+  static_assert(kBlockSize == 4, "The kernel has four accumulators.");
+  const int tail_begin = layout.tail_begin;
+  __m128i accumulator0 = _mm_setzero_si128();
+  __m128i accumulator1 = _mm_setzero_si128();
+  __m128i accumulator2 = _mm_setzero_si128();
+  __m128i accumulator3 = _mm_setzero_si128();
+  for (int offset = 0; offset < tail_begin; offset += 16) {
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(descriptor_b + offset));
+    accumulator0 = accumulatePopcountOfXoredSsse3(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(block[0] + offset)), b, lookup,
+        low_mask, accumulator0);
+    accumulator1 = accumulatePopcountOfXoredSsse3(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(block[1] + offset)), b, lookup,
+        low_mask, accumulator1);
+    accumulator2 = accumulatePopcountOfXoredSsse3(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(block[2] + offset)), b, lookup,
+        low_mask, accumulator2);
+    accumulator3 = accumulatePopcountOfXoredSsse3(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(block[3] + offset)), b, lookup,
+        low_mask, accumulator3);
+  }
+  if (layout.num_tail_words > 0) {
+    const __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(descriptor_b + tail_begin));
+    accumulator0 = accumulatePopcountOfXoredSsse3(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block[0] + tail_begin)), b, lookup,
+        low_mask, accumulator0);
+    accumulator1 = accumulatePopcountOfXoredSsse3(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block[1] + tail_begin)), b, lookup,
+        low_mask, accumulator1);
+    accumulator2 = accumulatePopcountOfXoredSsse3(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block[2] + tail_begin)), b, lookup,
+        low_mask, accumulator2);
+    accumulator3 = accumulatePopcountOfXoredSsse3(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block[3] + tail_begin)), b, lookup,
+        low_mask, accumulator3);
+  }
+  return horizontalSum4Ssse3(accumulator0, accumulator1, accumulator2, accumulator3);
+}
+
+// The nibble popcounts of popcountBytesSsse3.
+__attribute__((target("ssse3"))) inline __m128i getPopcountLookupSsse3() {
+  return _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+}
+
+__attribute__((target("ssse3"))) void computeTileSsse3(
+    const unsigned char* descriptors_a, int num_a, const unsigned char* descriptors_b,
+    int num_b, int descriptor_size_bytes, int* distances, int distances_stride) {
+  const DescriptorLayout layout(descriptor_size_bytes, 16);
+  const __m128i lookup = getPopcountLookupSsse3();
+  const __m128i low_mask = _mm_set1_epi8(0x0f);
+
+  const unsigned char* block[kBlockSize];
+  for (int i = 0; i < num_a; i += kBlockSize) {
+    getBlock(descriptors_a, nullptr, num_a, i, descriptor_size_bytes, block);
+    const int num_valid = std::min(kBlockSize, num_a - i);
+    for (int j = 0; j < num_b; ++j) {
+      const unsigned char* descriptor_b = descriptors_b + j * descriptor_size_bytes;
+      storeBlock(computeBlockSsse3(block, descriptor_b, layout, lookup, low_mask), block,
+                 descriptor_b, num_valid, layout.scalar_begin, descriptor_size_bytes,
+                 distances + i + j * distances_stride);
+    }
+  }
+}
+
+__attribute__((target("ssse3"))) void computeQuerySsse3(
+    const unsigned char* query, const unsigned char* descriptors, const int* candidate_indices,
+    int num_candidates, int descriptor_size_bytes, int* distances) {
+  const DescriptorLayout layout(descriptor_size_bytes, 16);
+  const __m128i lookup = getPopcountLookupSsse3();
+  const __m128i low_mask = _mm_set1_epi8(0x0f);
+
+  const unsigned char* block[kBlockSize];
+  for (int i = 0; i < num_candidates; i += kBlockSize) {
+    getBlock(descriptors, candidate_indices, num_candidates, i, descriptor_size_bytes, block);
+    storeBlock(computeBlockSsse3(block, query, layout, lookup, low_mask), block, query,
+               std::min(kBlockSize, num_candidates - i), layout.scalar_begin,
+               descriptor_size_bytes, distances + i);
+  }
+}
+#endif  // ASLAM_HAMMING_MATRIX_SSSE3
+
+#ifdef ASLAM_HAMMING_MATRIX_AVX2
+// Popcount of every byte with a lookup of the nibbles, as in popcountBytesSsse3.
+__attribute__((target("avx2"))) inline __m256i popcountBytesAvx2(
+    __m256i value, __m256i lookup, __m256i low_mask) {
+  const __m256i low_nibbles = _mm256_and_si256(value, low_mask);
+  const __m256i high_nibbles = _mm256_and_si256(_mm256_srli_epi16(value, 4), low_mask);
+  return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low_nibbles),
+                         _mm256_shuffle_epi8(lookup, high_nibbles));
+}
+
+// Add the popcount of a ^ b to the four 64 bit counters of the accumulator.
+__attribute__((target("avx2"))) inline __m256i accumulatePopcountOfXoredAvx2(
+    __m256i a, __m256i b, __m256i lookup, __m256i low_mask, __m256i accumulator) {
+  return _mm256_add_epi64(accumulator, _mm256_sad_epu8(
+      popcountBytesAvx2(_mm256_xor_si256(a, b), lookup, low_mask), _mm256_setzero_si256()));
+}
+
+// Sum the four 64 bit counters of each accumulator into four ints.
+__attribute__((target("avx2"))) inline __m128i horizontalSum4Avx2(
+    __m256i accumulator0, __m256i accumulator1, __m256i accumulator2, __m256i accumulator3) {
+  const __m256i sum01 = _mm256_add_epi64(_mm256_unpacklo_epi64(accumulator0, accumulator1),
+                                         _mm256_unpackhi_epi64(accumulator0, accumulator1));
+  const __m256i sum23 = _mm256_add_epi64(_mm256_unpacklo_epi64(accumulator2, accumulator3),
+                                         _mm256_unpackhi_epi64(accumulator2, accumulator3));
+  const __m256i sum0123 = _mm256_add_epi64(_mm256_permute2x128_si256(sum01, sum23, 0x20),
+                                           _mm256_permute2x128_si256(sum01, sum23, 0x31));
+  // The sums fit into the lower 32 bits of the counters.
+  const __m256i packed = _mm256_permutevar8x32_epi32(
+      sum0123, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+  return _mm256_castsi256_si128(packed);
+}
+
+// The nibble popcounts of popcountBytesAvx2.
+__attribute__((target("avx2"))) inline __m256i getPopcountLookupAvx2() {
+  return _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                          0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+}
+
+// The distances of a block of a to a descriptor of b, without the bytes after scalar_begin.
+__attribute__((target("avx2"))) inline __m128i computeBlockAvx2(
+    const unsigned char* const* block, const unsigned char* descriptor_b,
+    const DescriptorLayout& layout, __m256i tail_mask, __m256i lookup, __m256i low_mask) {
+  static_assert(kBlockSize == 4, "The kernel has four accumulators.");
+  const int tail_begin = layout.tail_begin;
+  __m256i accumulator0 = _mm256_setzero_si256();
+  __m256i accumulator1 = _mm256_setzero_si256();
+  __m256i accumulator2 = _mm256_setzero_si256();
+  __m256i accumulator3 = _mm256_setzero_si256();
+  for (int offset = 0; offset < tail_begin; offset += 32) {
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(descriptor_b + offset));
+    accumulator0 = accumulatePopcountOfXoredAvx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block[0] + offset)), b, lookup,
+        low_mask, accumulator0);
+    accumulator1 = accumulatePopcountOfXoredAvx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block[1] + offset)), b, lookup,
+        low_mask, accumulator1);
+    accumulator2 = accumulatePopcountOfXoredAvx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block[2] + offset)), b, lookup,
+        low_mask, accumulator2);
+    accumulator3 = accumulatePopcountOfXoredAvx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block[3] + offset)), b, lookup,
+        low_mask, accumulator3);
+  }
+  if (layout.num_tail_words > 0) {
+    const __m256i b = _mm256_maskload_epi64(
+        reinterpret_cast<const long long*>(descriptor_b + tail_begin), tail_mask);
+    accumulator0 = accumulatePopcountOfXoredAvx2(
+        _mm256_maskload_epi64(reinterpret_cast<const long long*>(block[0] + tail_begin),
+                              tail_mask), b, lookup, low_mask, accumulator0);
+    accumulator1 = accumulatePopcountOfXoredAvx2(
+        _mm256_maskload_epi64(reinterpret_cast<const long long*>(block[1] + tail_begin),
+                              tail_mask), b, lookup, low_mask, accumulator1);
+    accumulator2 = accumulatePopcountOfXoredAvx2(
+        _mm256_maskload_epi64(reinterpret_cast<const long long*>(block[2] + tail_begin),
+                              tail_mask), b, lookup, low_mask, accumulator2);
+    accumulator3 = accumulatePopcountOfXoredAvx2(
+        _mm256_maskload_epi64(reinterpret_cast<const long long*>(block[3] + tail_begin),
+                              tail_mask), b, lookup, low_mask, accumulator3);
+  }
+  return horizontalSum4Avx2(accumulator0, accumulator1, accumulator2, accumulator3);
+}
+
+__attribute__((target("avx2"))) void computeTileAvx2(
+    const unsigned char* descriptors_a, int num_a, const unsigned char* descriptors_b,
+    int num_b, int descriptor_size_bytes, int* distances, int distances_stride) {
+  const DescriptorLayout layout(descriptor_size_bytes, 32);
+  const __m256i tail_mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(layout.num_tail_words),
+                                               _mm256_setr_epi64x(0, 1, 2, 3));
+  const __m256i lookup = getPopcountLookupAvx2();
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+
+  const unsigned char* block[kBlockSize];
+  for (int i = 0; i < num_a; i += kBlockSize) {
+    getBlock(descriptors_a, nullptr, num_a, i, descriptor_size_bytes, block);
+    const int num_valid = std::min(kBlockSize, num_a - i);
+    for (int j = 0; j < num_b; ++j) {
+      const unsigned char* descriptor_b = descriptors_b + j * descriptor_size_bytes;
+      storeBlock(computeBlockAvx2(block, descriptor_b, layout, tail_mask, lookup, low_mask),
+                 block, descriptor_b, num_valid, layout.scalar_begin, descriptor_size_bytes,
+                 distances + i + j * distances_stride);
+    }
+  }
+}
+
+__attribute__((target("avx2"))) void computeQueryAvx2(
+    const unsigned char* query, const unsigned char* descriptors, const int* candidate_indices,
+    int num_candidates, int descriptor_size_bytes, int* distances) {
+  const DescriptorLayout layout(descriptor_size_bytes, 32);
+  const __m256i tail_mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(layout.num_tail_words),
+                                               _mm256_setr_epi64x(0, 1, 2, 3));
+  const __m256i lookup = getPopcountLookupAvx2();
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+
+  const unsigned char* block[kBlockSize];
+  for (int i = 0; i < num_candidates; i += kBlockSize) {
+    getBlock(descriptors, candidate_indices, num_candidates, i, descriptor_size_bytes, block);
+    storeBlock(computeBlockAvx2(block, query, layout, tail_mask, lookup, low_mask), block, query,
+               std::min(kBlockSize, num_candidates - i), layout.scalar_begin,
+               descriptor_size_bytes, distances + i);
+  }
+}
+#endif  // ASLAM_HAMMING_MATRIX_AVX2
+
+#ifdef ASLAM_HAMMING_MATRIX_AVX512
+__attribute__((target("avx2,avx512f,avx512vpopcntdq"))) inline __m512i
+accumulatePopcountOfXoredAvx512(__m512i a, __m512i b, __m512i accumulator) {
+  return _mm512_add_epi64(accumulator, _mm512_popcnt_epi64(_mm512_xor_si512(a, b)));
+}
+
+// Add the upper to the lower four 64 bit counters. The zero-masked extracts do not trip the
+// uninitialized warnings of the unmasked ones in GCC.
+__attribute__((target("avx2,avx512f"))) inline __m256i foldAvx512(__m512i accumulator) {
+  return _mm256_add_epi64(_mm512_maskz_extracti64x4_epi64(0xf, accumulator, 0),
+                          _mm512_maskz_extracti64x4_epi64(0xf, accumulator, 1));
+}
+
+// The distances of a block of a to a descriptor of b, without the bytes after scalar_begin.
+__attribute__((target("avx2,avx512f,avx512vpopcntdq"))) inline __m128i computeBlockAvx512(
+    const unsigned char* const* block, const unsigned char* descriptor_b,
+    const DescriptorLayout& layout, __mmask8 tail_mask) {
+  static_assert(kBlockSize == 4, "The kernel has four accumulators.");
+  const int tail_begin = layout.tail_begin;
+  __m512i accumulator0 = _mm512_setzero_si512();
+  __m512i accumulator1 = _mm512_setzero_si512();
+  __m512i accumulator2 = _mm512_setzero_si512();
+  __m512i accumulator3 = _mm512_setzero_si512();
+  for (int offset = 0; offset < tail_begin; offset += 64) {
+    const __m512i b = _mm512_loadu_si512(descriptor_b + offset);
+    accumulator0 = accumulatePopcountOfXoredAvx512(
+        _mm512_loadu_si512(block[0] + offset), b, accumulator0);
+    accumulator1 = accumulatePopcountOfXoredAvx512(
+        _mm512_loadu_si512(block[1] + offset), b, accumulator1);
+    accumulator2 = accumulatePopcountOfXoredAvx512(
+        _mm512_loadu_si512(block[2] + offset), b, accumulator2);
+    accumulator3 = accumulatePopcountOfXoredAvx512(
+        _mm512_loadu_si512(block[3] + offset), b, accumulator3);
+  }
+  if (layout.num_tail_words > 0) {
+    const __m512i b = _mm512_maskz_loadu_epi64(tail_mask, descriptor_b + tail_begin);
+    accumulator0 = accumulatePopcountOfXoredAvx512(
+        _mm512_maskz_loadu_epi64(tail_mask, block[0] + tail_begin), b, accumulator0);
+    accumulator1 = accumulatePopcountOfXoredAvx512(
+        _mm512_maskz_loadu_epi64(tail_mask, block[1] + tail_begin), b, accumulator1);
+    accumulator2 = accumulatePopcountOfXoredAvx512(
+        _mm512_maskz_loadu_epi64(tail_mask, block[2] + tail_begin), b, accumulator2);
+    accumulator3 = accumulatePopcountOfXoredAvx512(
+        _mm512_maskz_loadu_epi64(tail_mask, block[3] + tail_begin), b, accumulator3);
+  }
+  return horizontalSum4Avx2(foldAvx512(accumulator0), foldAvx512(accumulator1),
+                            foldAvx512(accumulator2), foldAvx512(accumulator3));
+}
+
+__attribute__((target("avx2,avx512f,avx512vpopcntdq"))) void computeTileAvx512Vpopcntdq(
+    const unsigned char* descriptors_a, int num_a, const unsigned char* descriptors_b,
+    int num_b, int descriptor_size_bytes, int* distances, int distances_stride) {
+  const DescriptorLayout layout(descriptor_size_bytes, 64);
+  const __mmask8 tail_mask = static_cast<__mmask8>((1u << layout.num_tail_words) - 1u);
+
+  const unsigned char* block[kBlockSize];
+  for (int i = 0; i < num_a; i += kBlockSize) {
+    getBlock(descriptors_a, nullptr, num_a, i, descriptor_size_bytes, block);
+    const int num_valid = std::min(kBlockSize, num_a - i);
+    for (int j = 0; j < num_b; ++j) {
+      const unsigned char* descriptor_b = descriptors_b + j * descriptor_size_bytes;
+      storeBlock(computeBlockAvx512(block, descriptor_b, layout, tail_mask), block,
+                 descriptor_b, num_valid, layout.scalar_begin, descriptor_size_bytes,
+                 distances + i + j * distances_stride);
+    }
+  }
+}
+
+__attribute__((target("avx2,avx512f,avx512vpopcntdq"))) void computeQueryAvx512Vpopcntdq(
+    const unsigned char* query, const unsigned char* descriptors, const int* candidate_indices,
+    int num_candidates, int descriptor_size_bytes, int* distances) {
+  const DescriptorLayout layout(descriptor_size_bytes, 64);
+  const __mmask8 tail_mask = static_cast<__mmask8>((1u << layout.num_tail_words) - 1u);
+
+  const unsigned char* block[kBlockSize];
+  for (int i = 0; i < num_candidates; i += kBlockSize) {
+    getBlock(descriptors, candidate_indices, num_candidates, i, descriptor_size_bytes, block);
+    storeBlock(computeBlockAvx512(block, query, layout, tail_mask), block, query,
+               std::min(kBlockSize, num_candidates - i), layout.scalar_begin,
+               descriptor_size_bytes, distances + i);
+  }
+}
+#endif  // ASLAM_HAMMING_MATRIX_AVX512
+
+TileKernel getTileKernel(HammingKernel kernel) {
+  CHECK(isHammingKernelSupported(kernel))
+      << "The Hamming kernel " << getHammingKernelName(kernel) << " is not supported.";
+  switch (kernel) {
+#ifdef ASLAM_HAMMING_MATRIX_SSSE3
+    case HammingKernel::kPopcnt:
+      return &computeTilePopcnt;
+    case HammingKernel::kSsse3:
+      return &computeTileSsse3;
+#endif
+#ifdef ASLAM_HAMMING_MATRIX_AVX2
+    case HammingKernel::kAvx2:
+      return &computeTileAvx2;
+#endif
+#ifdef ASLAM_HAMMING_MATRIX_AVX512
+    case HammingKernel::kAvx512Vpopcntdq:
+      return &computeTileAvx512Vpopcntdq;
+#endif
+    default:
+      return &computeTileScalar;
+  }
+}
+
+QueryKernel getQueryKernel(HammingKernel kernel) {
+  CHECK(isHammingKernelSupported(kernel))
+      << "The Hamming kernel " << getHammingKernelName(kernel) << " is not supported.";
+  switch (kernel) {
+#ifdef ASLAM_HAMMING_MATRIX_SSSE3
+    case HammingKernel::kPopcnt:
+      return &computeQueryPopcnt;
+    case HammingKernel::kSsse3:
+      return &computeQuerySsse3;
+#endif
+#ifdef ASLAM_HAMMING_MATRIX_AVX2
+    case HammingKernel::kAvx2:
+      return &computeQueryAvx2;
+#endif
+#ifdef ASLAM_HAMMING_MATRIX_AVX512
+    case HammingKernel::kAvx512Vpopcntdq:
+      return &computeQueryAvx512Vpopcntdq;
+#endif
+    default:
+      return &computeQueryScalar;
+  }
+}
+
+void updateNearestNeighbors(QueryKernel query_kernel, const unsigned char* query,
+                            const unsigned char* descriptors, int descriptor_size_bytes,
+                            const int* candidate_indices, int num_candidates, int k,
+                            int* neighbor_indices, int* neighbor_distances) {
+  int distances[kMaxCandidatesPerPass];
+  for (int begin = 0; begin < num_candidates; begin += kMaxCandidatesPerPass) {
+    const int num_pass_candidates = std::min(kMaxCandidatesPerPass, num_candidates - begin);
+    const int* pass_candidate_indices =
+        candidate_indices == nullptr ? nullptr : candidate_indices + begin;
+    const unsigned char* pass_descriptors = candidate_indices == nullptr ?
+        descriptors + begin * descriptor_size_bytes : descriptors;
+    query_kernel(query, pass_descriptors, pass_candidate_indices, num_pass_candidates,
+                 descriptor_size_bytes, distances);
+    for (int i = 0; i < num_pass_candidates; ++i) {
+      insertHammingNeighbor(
+          pass_candidate_indices == nullptr ? begin + i : pass_candidate_indices[i],
+          distances[i], k, neighbor_indices, neighbor_distances);
+    }
+  }
+}
+}  // namespace
+
+bool isHammingKernelSupported(HammingKernel kernel) {
+  switch (kernel) {
+    case HammingKernel::kScalar:
+      return true;
+    case HammingKernel::kPopcnt:
+#ifdef ASLAM_HAMMING_MATRIX_SSSE3
+      return __builtin_cpu_supports("popcnt");
+#else
+      return false;
+#endif
+    case HammingKernel::kSsse3:
+#ifdef ASLAM_HAMMING_MATRIX_SSSE3
+      return __builtin_cpu_supports("ssse3");
+#else
+      return false;
+#endif
+    case HammingKernel::kAvx2:
+#ifdef ASLAM_HAMMING_MATRIX_AVX2
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+    case HammingKernel::kAvx512Vpopcntdq:
+#ifdef ASLAM_HAMMING_MATRIX_AVX512
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+#else
+      return false;
+#endif
+    default:
+      LOG(FATAL) << "Unknown Hamming kernel " << static_cast<int>(kernel) << ".";
+      return false;
+  }
+}
+
+HammingKernel getBestHammingKernel() {
+  static const HammingKernel kBestKernel = []() {
+    if (isHammingKernelSupported(HammingKernel::kAvx512Vpopcntdq)) {
+      return HammingKernel::kAvx512Vpopcntdq;
+    }
+    if (isHammingKernelSupported(HammingKernel::kAvx2)) {
+      return HammingKernel::kAvx2;
+    }
+    if (isHammingKernelSupported(HammingKernel::kPopcnt)) {
+      return HammingKernel::kPopcnt;
+    }
+    if (isHammingKernelSupported(HammingKernel::kSsse3)) {
+      return HammingKernel::kSsse3;
+    }
+    return HammingKernel::kScalar;
+  }();
+  return kBestKernel;
+}
+
+const char* getHammingKernelName(HammingKernel kernel) {
+  switch (kernel) {
+    case HammingKernel::kScalar:
+      return "scalar";
+    case HammingKernel::kPopcnt:
+      return "popcnt";
+    case HammingKernel::kSsse3:
+      return "SSSE3";
+    case HammingKernel::kAvx2:
+      return "AVX2";
+    case HammingKernel::kAvx512Vpopcntdq:
+      return "AVX-512 VPOPCNTDQ";
+    default:
+      return "unknown";
+  }
+}
+
+void computeHammingDistanceMatrix(
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_a,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_b,
+    Eigen::MatrixXi* distances) {
+  computeHammingDistanceMatrix(getBestHammingKernel(), descriptors_a, descriptors_b, distances);
+}
+
+void computeHammingDistanceMatrix(
+    HammingKernel kernel,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_a,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_b,
+    Eigen::MatrixXi* distances) {
+  CHECK_NOTNULL(distances);
+  CHECK_EQ(descriptors_a.rows(), descriptors_b.rows())
+      << "The descriptors need to be of the same size.";
+  const TileKernel tile_kernel = getTileKernel(kernel);
+  const int num_a = static_cast<int>(descriptors_a.cols());
+  const int num_b = static_cast<int>(descriptors_b.cols());
+  const int descriptor_size_bytes = static_cast<int>(descriptors_a.rows());
+  distances->resize(num_a, num_b);
+  if (num_a == 0 || num_b == 0) {
+    return;
+  }
+
+  // The descriptors are the columns of the column-major matrices, so a tile is contiguous.
+  const int tile_size = std::max(
+      kBlockSize, kMaxTileSizeBytes / std::max(descriptor_size_bytes, 1) / kBlockSize *
+          kBlockSize);
+  for (int tile_b = 0; tile_b < num_b; tile_b += tile_size) {
+    for (int tile_a = 0; tile_a < num_a; tile_a += tile_size) {
+      tile_kernel(descriptors_a.data() + tile_a * descriptor_size_bytes,
+                  std::min(tile_size, num_a - tile_a),
+                  descriptors_b.data() + tile_b * descriptor_size_bytes,
+                  std::min(tile_size, num_b - tile_b), descriptor_size_bytes,
+                  distances->data() + tile_a + tile_b * num_a, num_a);
+    }
+  }
+}
+
+void computeHammingDistancesToQuery(
+    const unsigned char* query,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors,
+    const int* candidate_indices, int num_candidates, int* distances) {
+  computeHammingDistancesToQuery(getBestHammingKernel(), query, descriptors, candidate_indices,
+                                 num_candidates, distances);
+}
+
+void computeHammingDistancesToQuery(
+    HammingKernel kernel, const unsigned char* query,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors,
+    const int* candidate_indices, int num_candidates, int* distances) {
+  CHECK_NOTNULL(query);
+  CHECK_GE(num_candidates, 0);
+  if (num_candidates == 0) {
+    return;
+  }
+  CHECK_NOTNULL(distances);
+  if (candidate_indices == nullptr) {
+    CHECK_LE(num_candidates, descriptors.cols());
+  }
+  getQueryKernel(kernel)(query, descriptors.data(), candidate_indices, num_candidates,
+                         static_cast<int>(descriptors.rows()), distances);
+}
+
+void updateNearestHammingNeighbors(
+    const unsigned char* query,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors,
+    const int* candidate_indices, int num_candidates, int k, int* neighbor_indices,
+    int* neighbor_distances) {
+  CHECK_NOTNULL(query);
+  CHECK_GT(k, 0);
+  CHECK_NOTNULL(neighbor_indices);
+  CHECK_NOTNULL(neighbor_distances);
+  updateNearestNeighbors(getQueryKernel(getBestHammingKernel()), query, descriptors.data(),
+                         static_cast<int>(descriptors.rows()), candidate_indices,
+                         num_candidates, k, neighbor_indices, neighbor_distances);
+}
+
+void findNearestHammingNeighbors(
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& queries,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors, int k,
+    Eigen::MatrixXi* neighbor_indices, Eigen::MatrixXi* neighbor_distances) {
+  CHECK_GT(k, 0);
+  CHECK_NOTNULL(neighbor_indices);
+  CHECK_NOTNULL(neighbor_distances);
+  CHECK_EQ(queries.rows(), descriptors.rows())
+      << "The descriptors need to be of the same size.";
+  const int num_queries = static_cast<int>(queries.cols());
+  const int num_descriptors = static_cast<int>(descriptors.cols());
+  const int descriptor_size_bytes = static_cast<int>(descriptors.rows());
+  neighbor_indices->resize(k, num_queries);
+  neighbor_distances->resize(k, num_queries);
+  for (int query = 0; query < num_queries; ++query) {
+    resetHammingNeighbors(k, neighbor_indices->col(query).data(),
+                          neighbor_distances->col(query).data());
+  }
+
+  // The descriptors of a pass are compared to the queries of a pass as one tile, then the
+  // distances are inserted into the neighbors of each query in the order of the descriptors.
+  const TileKernel tile_kernel = getTileKernel(getBestHammingKernel());
+  int distances[kMaxCandidatesPerPass * kMaxQueriesPerPass];
+  for (int query_begin = 0; query_begin < num_queries; query_begin += kMaxQueriesPerPass) {
+    const int num_pass_queries = std::min(kMaxQueriesPerPass, num_queries - query_begin);
+    for (int begin = 0; begin < num_descriptors; begin += kMaxCandidatesPerPass) {
+      const int num_pass_descriptors = std::min(kMaxCandidatesPerPass, num_descriptors - begin);
+      tile_kernel(descriptors.data() + begin * descriptor_size_bytes, num_pass_descriptors,
+                  queries.data() + query_begin * descriptor_size_bytes, num_pass_queries,
+                  descriptor_size_bytes, distances, kMaxCandidatesPerPass);
+      for (int j = 0; j < num_pass_queries; ++j) {
+        int* indices = neighbor_indices->col(query_begin + j).data();
+        int* query_distances = neighbor_distances->col(query_begin + j).data();
+        for (int i = 0; i < num_pass_descriptors; ++i) {
+          insertHammingNeighbor(begin + i, distances[i + j * kMaxCandidatesPerPass], k, indices,
+                                query_distances);
+        }
+      }
+    }
+  }
+}
+
+void findNearestHammingNeighbors(
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& queries,
+    const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors,
+    const HammingCandidateLists& candidates, int k, Eigen::MatrixXi* neighbor_indices,
+    Eigen::MatrixXi* neighbor_distances) {
+  CHECK_GT(k, 0);
+  CHECK_NOTNULL(neighbor_indices);
+  CHECK_NOTNULL(neighbor_distances);
+  CHECK_EQ(queries.rows(), descriptors.rows())
+      << "The descriptors need to be of the same size.";
+  const int num_queries = static_cast<int>(queries.cols());
+  CHECK_EQ(num_queries, candidates.getNumQueries())
+      << "There needs to be one candidate list per query.";
+  CHECK_EQ(static_cast<size_t>(candidates.offsets.back()), candidates.indices.size());
+  neighbor_indices->resize(k, num_queries);
+  neighbor_distances->resize(k, num_queries);
+  const QueryKernel query_kernel = getQueryKernel(getBestHammingKernel());
+  for (int query = 0; query < num_queries; ++query) {
+    int* indices = neighbor_indices->col(query).data();
+    int* distances = neighbor_distances->col(query).data();
+    resetHammingNeighbors(k, indices, distances);
+    const int begin = candidates.offsets[query];
+    const int end = candidates.offsets[query + 1];
+    CHECK_LE(begin, end);
+    updateNearestNeighbors(query_kernel, queries.data() + query * queries.rows(),
+                           descriptors.data(), static_cast<int>(descriptors.rows()),
+                           candidates.indices.data() + begin, end - begin, k, indices,
+                           distances);
+  }
+}
+
+}  // namespace common
+}  // namespace aslam
@@ -1,5 +1,10 @@
 #include <algorithm>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include <aslam/common/thread-pool.h>
 
 namespace aslam {
@@ -121,11 +126,56 @@ void ThreadPool::run() {
   }
 }
 
+size_t ThreadPool::numQueuedTasks() const {
+  std::unique_lock<std::mutex> lock(this->tasks_mutex_);
+  return numQueuedTasksImpl();
+}
+
+size_t ThreadPool::numQueuedTasksImpl() const {
+  return groupid_tasks_.size();
+}
+
+bool ThreadPool::isWorkerThread() const {
+  // The workers are only added in the constructor, so no lock is needed.
+  const std::thread::id this_thread_id = std::this_thread::get_id();
+  for (const std::thread& worker : workers_) {
+    if (worker.get_id() == this_thread_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
 size_t ThreadPool::numActiveThreads() const {
   std::unique_lock<std::mutex> lock(this->tasks_mutex_);
   return active_threads_;
 }
 
+bool ThreadPool::setCpuAffinity(const std::vector<int>& cpu_cores) {
+  CHECK(!cpu_cores.empty());
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (const int cpu_core : cpu_cores) {
+    CHECK_GE(cpu_core, 0);
+    CHECK_LT(cpu_core, CPU_SETSIZE);
+    CPU_SET(cpu_core, &cpu_set);
+  }
+  bool success = true;
+  for (std::thread& worker : workers_) {
+    const int error = pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set), &cpu_set);
+    if (error != 0) {
+      LOG(WARNING) << "Failed to set the CPU affinity of a worker thread, error " << error << ".";
+      success = false;
+    }
+  }
+  return success;
+#else
+  LOG(WARNING) << "Setting the CPU affinity is not supported on this platform.";
+  return false;
+#endif
+}
+
 void ThreadPool::waitForEmptyQueue() const {
   std::unique_lock<std::mutex> lock(this->tasks_mutex_);
   // Only exit if all tasks are complete by tracking the number of
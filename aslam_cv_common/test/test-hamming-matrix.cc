@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/hamming-matrix.h>
+
+namespace aslam {
+namespace common {
+namespace {
+typedef Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> DescriptorsType;
+
+int countDifferentBits(const unsigned char* a, const unsigned char* b, int size_bytes) {
+  int distance = 0;
+  for (int byte = 0; byte < size_bytes; ++byte) {
+    for (int bit = 0; bit < 8; ++bit) {
+      distance += ((a[byte] ^ b[byte]) >> bit) & 1;
+    }
+  }
+  return distance;
+}
+
+// The k nearest candidates of a query by sorting, the first of equally near candidates first.
+void findNearestBySorting(const unsigned char* query, const DescriptorsType& descriptors,
+                          const std::vector<int>& candidate_indices, int k,
+                          std::vector<int>* neighbor_indices,
+                          std::vector<int>* neighbor_distances) {
+  std::vector<std::pair<int, int>> distances_and_indices;
+  for (const int index : candidate_indices) {
+    distances_and_indices.emplace_back(
+        countDifferentBits(query, &descriptors.coeffRef(0, index), descriptors.rows()), index);
+  }
+  std::stable_sort(distances_and_indices.begin(), distances_and_indices.end(),
+                   [](const std::pair<int, int>& lhs, const std::pair<int, int>& rhs) {
+                     return lhs.first < rhs.first;
+                   });
+  neighbor_indices->assign(k, kNoHammingNeighbor);
+  neighbor_distances->assign(k, std::numeric_limits<int>::max());
+  for (size_t neighbor = 0u;
+       neighbor < std::min(static_cast<size_t>(k), distances_and_indices.size()); ++neighbor) {
+    (*neighbor_indices)[neighbor] = distances_and_indices[neighbor].second;
+    (*neighbor_distances)[neighbor] = distances_and_indices[neighbor].first;
+  }
+}
+}  // namespace
+
+TEST(HammingMatrix, MatchesBitCountForAllKernels) {
+  const std::vector<HammingKernel> kernels = {
+      HammingKernel::kScalar, HammingKernel::kPopcnt, HammingKernel::kSsse3,
+      HammingKernel::kAvx2, HammingKernel::kAvx512Vpopcntdq};
+  // Descriptor sizes with and without full SIMD registers and with a remainder of single bytes,
+  // and numbers of descriptors spanning several tiles and partial blocks.
+  for (const int size_bytes : {16, 20, 24, 32, 48, 64, 100}) {
+    DescriptorsType descriptors_a(size_bytes, 519);
+    DescriptorsType descriptors_b(size_bytes, 254);
+    descriptors_a.setRandom();
+    descriptors_b.setRandom();
+    for (const HammingKernel kernel : kernels) {
+      if (!isHammingKernelSupported(kernel)) {
+        continue;
+      }
+      Eigen::MatrixXi distances;
+      computeHammingDistanceMatrix(kernel, descriptors_a, descriptors_b, &distances);
+      ASSERT_EQ(descriptors_a.cols(), distances.rows());
+      ASSERT_EQ(descriptors_b.cols(), distances.cols());
+      for (int j = 0; j < descriptors_b.cols(); ++j) {
+        for (int i = 0; i < descriptors_a.cols(); ++i) {
+          ASSERT_EQ(countDifferentBits(&descriptors_a.coeffRef(0, i),
+                                       &descriptors_b.coeffRef(0, j), size_bytes),
+                    distances(i, j))
+              << getHammingKernelName(kernel) << ", " << size_bytes << " bytes";
+        }
+      }
+    }
+  }
+}
+
+TEST(HammingMatrix, HandlesEmptyOperands) {
+  DescriptorsType descriptors_a(48, 0);
+  DescriptorsType descriptors_b(48, 3);
+  descriptors_b.setRandom();
+  Eigen::MatrixXi distances;
+  computeHammingDistanceMatrix(descriptors_a, descriptors_b, &distances);
+  EXPECT_EQ(0, distances.rows());
+  EXPECT_EQ(3, distances.cols());
+  EXPECT_TRUE(isHammingKernelSupported(getBestHammingKernel()));
+}
+
+TEST(HammingMatrix, DistancesToQueryMatchBitCountForAllKernels) {
+  const std::vector<HammingKernel> kernels = {
+      HammingKernel::kScalar, HammingKernel::kPopcnt, HammingKernel::kSsse3,
+      HammingKernel::kAvx2, HammingKernel::kAvx512Vpopcntdq};
+  for (const int size_bytes : {16, 20, 24, 48, 64, 100}) {
+    DescriptorsType descriptors(size_bytes, 103);
+    DescriptorsType query(size_bytes, 1);
+    descriptors.setRandom();
+    query.setRandom();
+    // Every third descriptor backwards, ending with a partial block.
+    std::vector<int> candidate_indices;
+    for (int index = 102; index >= 0; index -= 3) {
+      candidate_indices.push_back(index);
+    }
+    for (const HammingKernel kernel : kernels) {
+      if (!isHammingKernelSupported(kernel)) {
+        continue;
+      }
+      std::vector<int> distances(descriptors.cols(), -1);
+      computeHammingDistancesToQuery(kernel, query.data(), descriptors, nullptr,
+                                     descriptors.cols(), distances.data());
+      for (int i = 0; i < descriptors.cols(); ++i) {
+        ASSERT_EQ(countDifferentBits(query.data(), &descriptors.coeffRef(0, i), size_bytes),
+                  distances[i]) << getHammingKernelName(kernel) << ", " << size_bytes << " bytes";
+      }
+
+      distances.assign(descriptors.cols(), -1);
+      computeHammingDistancesToQuery(kernel, query.data(), descriptors, candidate_indices.data(),
+                                     candidate_indices.size(), distances.data());
+      for (size_t i = 0u; i < candidate_indices.size(); ++i) {
+        ASSERT_EQ(countDifferentBits(query.data(),
+                                     &descriptors.coeffRef(0, candidate_indices[i]), size_bytes),
+                  distances[i]) << getHammingKernelName(kernel) << ", " << size_bytes << " bytes";
+      }
+      // Nothing is written after the candidates.
+      EXPECT_EQ(-1, distances[candidate_indices.size()]);
+    }
+  }
+}
+
+TEST(HammingMatrix, NearestNeighborsMatchSortedDistances) {
+  const int kSizeBytes = 48;
+  const int kNumNeighbors = 3;
+  // Short descriptors to get many equally near candidates.
+  for (const int size_bytes : {kSizeBytes, 2}) {
+    DescriptorsType queries(size_bytes, 37);
+    DescriptorsType descriptors(size_bytes, 600);
+    queries.setRandom();
+    descriptors.setRandom();
+
+    // All descriptors.
+    Eigen::MatrixXi neighbor_indices;
+    Eigen::MatrixXi neighbor_distances;
+    findNearestHammingNeighbors(queries, descriptors, kNumNeighbors, &neighbor_indices,
+                                &neighbor_distances);
+    ASSERT_EQ(kNumNeighbors, neighbor_indices.rows());
+    ASSERT_EQ(queries.cols(), neighbor_indices.cols());
+    ASSERT_EQ(kNumNeighbors, neighbor_distances.rows());
+    ASSERT_EQ(queries.cols(), neighbor_distances.cols());
+    std::vector<int> all_indices(descriptors.cols());
+    for (int index = 0; index < descriptors.cols(); ++index) {
+      all_indices[index] = index;
+    }
+    std::vector<int> expected_indices;
+    std::vector<int> expected_distances;
+    for (int query = 0; query < queries.cols(); ++query) {
+      findNearestBySorting(&queries.coeffRef(0, query), descriptors, all_indices, kNumNeighbors,
+                           &expected_indices, &expected_distances);
+      for (int neighbor = 0; neighbor < kNumNeighbors; ++neighbor) {
+        EXPECT_EQ(expected_indices[neighbor], neighbor_indices(neighbor, query));
+        EXPECT_EQ(expected_distances[neighbor], neighbor_distances(neighbor, query));
+      }
+    }
+
+    // Candidate lists of different lengths, some shorter than the number of neighbors.
+    HammingCandidateLists candidates;
+    for (int query = 0; query < queries.cols(); ++query) {
+      for (int index = query; index < descriptors.cols(); index += 1 + query * query) {
+        candidates.indices.push_back(index);
+      }
+      candidates.finishQuery();
+    }
+    findNearestHammingNeighbors(queries, descriptors, candidates, kNumNeighbors,
+                                &neighbor_indices, &neighbor_distances);
+    for (int query = 0; query < queries.cols(); ++query) {
+      const std::vector<int> query_candidates(
+          candidates.indices.begin() + candidates.offsets[query],
+          candidates.indices.begin() + candidates.offsets[query + 1]);
+      findNearestBySorting(&queries.coeffRef(0, query), descriptors, query_candidates,
+                           kNumNeighbors, &expected_indices, &expected_distances);
+      for (int neighbor = 0; neighbor < kNumNeighbors; ++neighbor) {
+        EXPECT_EQ(expected_indices[neighbor], neighbor_indices(neighbor, query));
+        EXPECT_EQ(expected_distances[neighbor], neighbor_distances(neighbor, query));
+      }
+    }
+  }
+}
+
+TEST(HammingMatrix, UpdatesNeighborsWithSeveralCandidateLists) {
+  DescriptorsType descriptors(32, 40);
+  descriptors.setRandom();
+  const DescriptorsType query = descriptors.col(7);
+  // The query itself is the nearest descriptor, whichever list it is in.
+  int neighbor_indices[2];
+  int neighbor_distances[2];
+  resetHammingNeighbors(2, neighbor_indices, neighbor_distances);
+  EXPECT_EQ(kNoHammingNeighbor, neighbor_indices[0]);
+  const std::vector<int> first_candidates = {3, 12, 25};
+  const std::vector<int> second_candidates = {30, 7, 1};
+  updateNearestHammingNeighbors(query.data(), descriptors, first_candidates.data(),
+                                first_candidates.size(), 2, neighbor_indices,
+                                neighbor_distances);
+  updateNearestHammingNeighbors(query.data(), descriptors, second_candidates.data(),
+                                second_candidates.size(), 2, neighbor_indices,
+                                neighbor_distances);
+  EXPECT_EQ(7, neighbor_indices[0]);
+  EXPECT_EQ(0, neighbor_distances[0]);
+  EXPECT_NE(kNoHammingNeighbor, neighbor_indices[1]);
+  EXPECT_GT(neighbor_distances[1], 0);
+}
+
+}  // namespace common
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
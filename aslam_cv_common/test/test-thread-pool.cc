@@ -81,4 +81,12 @@ TEST(ThreadPoolTests, ExecutionOrdering) {
   }
 }
 
+TEST(ThreadPoolTests, IsWorkerThread) {
+  aslam::ThreadPool pool(2);
+  aslam::ThreadPool other_pool(1);
+  EXPECT_FALSE(pool.isWorkerThread());
+  EXPECT_TRUE(pool.enqueue([&pool]() { return pool.isWorkerThread(); }).get());
+  EXPECT_FALSE(other_pool.enqueue([&pool]() { return pool.isWorkerThread(); }).get());
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
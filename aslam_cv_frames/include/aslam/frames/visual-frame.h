@@ -96,6 +96,10 @@ class VisualFrame  {
   /// KeypointOrientations, KeypointScores, KeypointScales, Descriptors, TrackIds
   void clearKeypointChannels();
 
+  /// Removes all named channels and empties the keypoint, descriptor, track id and raw image
+  /// channels without removing them, e.g. to reuse the frame for another image.
+  void resetChannels();
+
   /// The keypoint measurements stored in a frame.
   const Eigen::Matrix2Xd& getKeypointMeasurements() const;
 
@@ -216,6 +220,10 @@ class VisualFrame  {
   ///        should be owned by the VisualFrame.
   void setRawImage(const cv::Mat& image);
 
+  /// Replace the internal raw image by an image whose memory is owned externally.
+  ///        The owner is kept alive until the raw image is replaced or released.
+  void setRawImage(const cv::Mat& image, const std::shared_ptr<const void>& image_owner);
+
   template<typename CHANNEL_DATA_TYPE>
   void setChannelData(const std::string& channel,
                       const CHANNEL_DATA_TYPE& data_new) {
@@ -359,6 +367,8 @@ class VisualFrame  {
   aslam::channels::ChannelGroup channels_;
   Camera::ConstPtr camera_geometry_;
   Camera::ConstPtr raw_camera_geometry_;
+  /// Keeps externally owned raw image memory alive. Can be null.
+  std::shared_ptr<const void> raw_image_owner_;
 
   /// Validity flag: can be used by an external algorithm to flag frames that should
   /// be excluded/included when processing a list of frames. Does not have any internal
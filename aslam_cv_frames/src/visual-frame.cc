@@ -1,6 +1,8 @@
 #include "aslam/frames/visual-frame.h"
 
 #include <memory>
+#include <unordered_set>
+
 #include <aslam/common/channel-definitions.h>
 #include <aslam/common/stl-helpers.h>
 #include <aslam/common/time.h>
@@ -19,6 +21,7 @@ VisualFrame& VisualFrame::operator=(const VisualFrame& other) {
   id_ = other.id_;
   camera_geometry_ = other.camera_geometry_;
   raw_camera_geometry_ = other.raw_camera_geometry_;
+  raw_image_owner_ = other.raw_image_owner_;
 
   channels_ = channels::cloneChannelGroup(other.channels_);
   is_valid_ = other.is_valid_;
@@ -99,6 +102,7 @@ const cv::Mat& VisualFrame::getRawImage() const {
 
 void VisualFrame::releaseRawImage() {
   aslam::channels::remove_RAW_IMAGE_Channel(&channels_);
+  raw_image_owner_.reset();
 }
 
 Eigen::Matrix2Xd* VisualFrame::getKeypointMeasurementsMutable() {
@@ -265,6 +269,13 @@ void VisualFrame::setRawImage(const cv::Mat& image_new) {
   cv::Mat& image =
       aslam::channels::get_RAW_IMAGE_Data(channels_);
   image = image_new;
+  raw_image_owner_.reset();
+}
+
+void VisualFrame::setRawImage(const cv::Mat& image_new,
+                              const std::shared_ptr<const void>& image_owner) {
+  setRawImage(image_new);
+  raw_image_owner_ = image_owner;
 }
 
 void VisualFrame::swapKeypointMeasurements(Eigen::Matrix2Xd* keypoints_new) {
@@ -339,6 +350,52 @@ void VisualFrame::clearKeypointChannels() {
   setDescriptors(aslam::VisualFrame::DescriptorsT());
 }
 
+void VisualFrame::resetChannels() {
+  static const std::unordered_set<std::string> kKeptChannels = {
+      channels::VISUAL_KEYPOINT_MEASUREMENTS_CHANNEL,
+      channels::VISUAL_KEYPOINT_MEASUREMENT_UNCERTAINTIES_CHANNEL,
+      channels::VISUAL_KEYPOINT_ORIENTATIONS_CHANNEL, channels::VISUAL_KEYPOINT_SCALES_CHANNEL,
+      channels::VISUAL_KEYPOINT_SCORES_CHANNEL, channels::DESCRIPTORS_CHANNEL,
+      channels::TRACK_IDS_CHANNEL, channels::RAW_IMAGE_CHANNEL};
+  {
+    std::lock_guard<std::mutex> lock(channels_.m_channels_);
+    channels::ChannelMap& channels = channels_.channels_;
+    for (channels::ChannelMap::iterator it = channels.begin(); it != channels.end();) {
+      if (kKeptChannels.count(it->first) == 0u) {
+        it = channels.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  if (hasRawImage()) {
+    // Drops the reference to the image and to its owner.
+    setRawImage(cv::Mat());
+  }
+  if (hasKeypointMeasurements()) {
+    getKeypointMeasurementsMutable()->resize(Eigen::NoChange, 0);
+  }
+  if (hasKeypointMeasurementUncertainties()) {
+    getKeypointMeasurementUncertaintiesMutable()->resize(0);
+  }
+  if (hasKeypointOrientations()) {
+    getKeypointOrientationsMutable()->resize(0);
+  }
+  if (hasKeypointScores()) {
+    getKeypointScoresMutable()->resize(0);
+  }
+  if (hasKeypointScales()) {
+    getKeypointScalesMutable()->resize(0);
+  }
+  if (hasDescriptors()) {
+    getDescriptorsMutable()->resize(Eigen::NoChange, 0);
+  }
+  if (hasTrackIds()) {
+    getTrackIdsMutable()->resize(0);
+  }
+}
+
 const Camera::ConstPtr VisualFrame::getCameraGeometry() const {
   return camera_geometry_;
 }
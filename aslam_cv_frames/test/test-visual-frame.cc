@@ -141,6 +141,24 @@ TEST(Frame, NamedChannel) {
   EXPECT_TRUE(EIGEN_MATRIX_NEAR(data, data_2, 1e-6));
 }
 
+TEST(Frame, ResetChannels) {
+  aslam::VisualFrame frame;
+  frame.setKeypointMeasurements(Eigen::Matrix2Xd::Random(2, 10));
+  frame.setTrackIds(Eigen::VectorXi::Constant(10, -1));
+  frame.setRawImage(cv::Mat(10, 10, CV_8UC1));
+  frame.setChannelData<Eigen::VectorXd>("test_channel", Eigen::VectorXd::Random(10));
+
+  frame.resetChannels();
+  EXPECT_FALSE(frame.hasChannel("test_channel"));
+  ASSERT_TRUE(frame.hasKeypointMeasurements());
+  EXPECT_EQ(0u, frame.getNumKeypointMeasurements());
+  ASSERT_TRUE(frame.hasTrackIds());
+  EXPECT_EQ(0, frame.getTrackIds().size());
+  ASSERT_TRUE(frame.hasRawImage());
+  EXPECT_TRUE(frame.getRawImage().empty());
+  EXPECT_FALSE(frame.hasDescriptors());
+}
+
 TEST(Frame, SetGetImage) {
   aslam::VisualFrame frame;
   cv::Mat data(10,10,CV_8SC3,uint8_t(7));
@@ -0,0 +1,83 @@
+#ifndef ASLAM_MATCHER_BAG_OF_WORDS_INDEX_H_
+#define ASLAM_MATCHER_BAG_OF_WORDS_INDEX_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include <aslam/common/macros.h>
+#include <aslam/common/unique-id.h>
+#include <aslam/matcher/vocabulary-tree.h>
+
+namespace aslam {
+class VisualFrame;
+
+/// \class BagOfWordsIndex
+/// \brief An inverted index of the bags of words of frames, to retrieve the frames most similar
+///        to a query frame, e.g. the loop closure candidates among all keyframes.
+///
+/// Every word lists the frames containing it with their weights. A query only visits the lists
+/// of its own words, so it costs the number of frames sharing words with the query rather than
+/// the number of frames times the number of descriptors of a matching against every frame.
+/// The frames are scored by VocabularyTree::getSimilarity.
+class BagOfWordsIndex {
+public:
+  ASLAM_POINTER_TYPEDEFS(BagOfWordsIndex);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(BagOfWordsIndex);
+
+  /// A frame found by a query and its similarity to the query.
+  struct FrameScore {
+    FrameId frame_id;
+    double score;
+  };
+
+  /// \brief Create an empty index of the words of a trained vocabulary.
+  explicit BagOfWordsIndex(const VocabularyTree::ConstPtr& vocabulary);
+  virtual ~BagOfWordsIndex() {};
+
+  /// \brief Add the bag of words of the descriptors of a frame. The frame must not be in the
+  ///        index.
+  void addFrame(const VisualFrame& frame);
+
+  /// \brief Add a bag of words of the vocabulary under a frame id. The frame must not be in
+  ///        the index.
+  void addBagOfWords(const FrameId& frame_id, const VocabularyTree::BagOfWords& bag_of_words);
+
+  /// \brief Remove a frame.
+  /// @return Returns false if the frame is not in the index.
+  bool removeFrame(const FrameId& frame_id);
+
+  /// \brief Find the frames most similar to a set of descriptors, e.g. of a query frame.
+  /// \param[in]  descriptors    The descriptors, one per column.
+  /// \param[in]  max_num_frames The max. number of frames to return.
+  /// \param[out] frame_scores   The frames sharing words with the query, sorted by decreasing
+  ///                            score.
+  void query(const VocabularyTree::DescriptorsT& descriptors, size_t max_num_frames,
+             std::vector<FrameScore>* frame_scores) const;
+
+  /// \brief Same as above for the bag of words of the query.
+  void query(const VocabularyTree::BagOfWords& bag_of_words, size_t max_num_frames,
+             std::vector<FrameScore>* frame_scores) const;
+
+  inline const VocabularyTree& getVocabulary() const { return *vocabulary_; }
+  inline size_t getNumFrames() const { return frame_id_to_slot_.size(); }
+
+private:
+  /// A frame in the list of a word.
+  struct Posting {
+    int frame_slot;
+    double weight;
+  };
+
+  VocabularyTree::ConstPtr vocabulary_;
+
+  /// The frames containing each word.
+  std::vector<std::vector<Posting>> inverted_file_;
+  /// The frame ids and bags of words by slot. The slots of removed frames are reused.
+  std::vector<FrameId> slot_frame_ids_;
+  std::vector<VocabularyTree::BagOfWords> slot_bags_of_words_;
+  std::vector<int> free_slots_;
+  std::unordered_map<FrameId, int> frame_id_to_slot_;
+};
+}  // namespace aslam
+
+#endif  // ASLAM_MATCHER_BAG_OF_WORDS_INDEX_H_
@@ -0,0 +1,162 @@
+#ifndef ASLAM_MATCHER_BINARY_DESCRIPTOR_INDEX_H_
+#define ASLAM_MATCHER_BINARY_DESCRIPTOR_INDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <aslam/common/macros.h>
+#include <aslam/common/unique-id.h>
+#include <Eigen/Core>
+
+namespace aslam {
+class VisualFrame;
+
+/// \class BinaryDescriptorIndex
+/// \brief An index of the binary descriptors of many frames for radius and nearest neighbor
+///        queries in sublinear time, e.g. to match a frame against a map for relocalization.
+///
+/// The index implements multi-index hashing (Norouzi et al., "Fast Exact Search in Hamming
+/// Space with Multi-Index Hashing", PAMI 2014). The descriptors are split into m substrings and
+/// every substring is the key into its own hash table. If two descriptors are at most r bits
+/// apart, at least one of their substrings is at most r / m bits apart, so only the buckets
+/// near the substrings of a query have to be searched. The candidates found in the buckets are
+/// verified with their full distance, so the results are exact and equal to a linear search.
+///
+/// Frames can be added and removed at any time. The queries are const and can run in parallel,
+/// but not concurrently with adding or removing frames. Every query takes the buffers of its
+/// search from a pool of the index, so it does not allocate or clear memory proportional to
+/// the size of the index.
+class BinaryDescriptorIndex {
+public:
+  ASLAM_POINTER_TYPEDEFS(BinaryDescriptorIndex);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(BinaryDescriptorIndex);
+
+  typedef Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> DescriptorsT;
+
+  /// A descriptor in the index, identified by its frame and keypoint index.
+  struct DescriptorKey {
+    FrameId frame_id;
+    size_t keypoint_index;
+  };
+
+  /// A descriptor found by a query and its distance to the query in bits.
+  struct Neighbor {
+    DescriptorKey key;
+    int distance;
+  };
+
+  struct Options {
+    /// The size of the substrings in bytes, one or two. Each substring indexes a hash table of
+    /// 2^(8 * substring_size_bytes) buckets. The search is fastest if this is close to the
+    /// logarithm of the number of descriptors, so two bytes suit tens of thousands to millions
+    /// of descriptors.
+    size_t substring_size_bytes;
+    Options() :
+      substring_size_bytes(2u) {};
+  };
+
+  /// \brief Create an empty index for descriptors of the given size.
+  BinaryDescriptorIndex(size_t descriptor_size_bytes, const Options& options);
+  virtual ~BinaryDescriptorIndex() {};
+
+  /// \brief Add the descriptors of a frame. The frame must not be in the index.
+  void addFrame(const VisualFrame& frame);
+
+  /// \brief Add descriptors under a frame id. The frame must not be in the index.
+  /// \param[in] frame_id    The id of the frame, keypoint i is column i of the descriptors.
+  /// \param[in] descriptors One descriptor per column, as in VisualFrame::DescriptorsT.
+  void addDescriptors(const FrameId& frame_id, const DescriptorsT& descriptors);
+
+  /// \brief Remove the descriptors of a frame.
+  /// @return Returns false if the frame is not in the index.
+  bool removeFrame(const FrameId& frame_id);
+
+  /// \brief Find all descriptors at most radius bits away from the query.
+  /// \param[in]  query     The query descriptor of getDescriptorSizeBytes() bytes.
+  /// \param[in]  radius    The max. distance in bits.
+  /// \param[out] neighbors The descriptors found, sorted by increasing distance.
+  void findWithinRadius(const unsigned char* query, int radius,
+                        std::vector<Neighbor>* neighbors) const;
+
+  /// \brief Find the k nearest descriptors of the query.
+  /// \param[in]  query     The query descriptor of getDescriptorSizeBytes() bytes.
+  /// \param[in]  k         The number of neighbors.
+  /// \param[out] neighbors The k nearest descriptors sorted by increasing distance, fewer if
+  ///                       the index contains fewer descriptors.
+  void findNearestNeighbors(const unsigned char* query, int k,
+                            std::vector<Neighbor>* neighbors) const;
+
+  inline size_t getDescriptorSizeBytes() const { return descriptor_size_bytes_; }
+  inline size_t getNumDescriptors() const { return keys_.size(); }
+  inline size_t getNumFrames() const { return frame_id_to_slots_.size(); }
+  inline size_t getNumHashTables() const { return hash_tables_.size(); }
+
+private:
+  /// The slots of the descriptors in one bucket of a hash table.
+  typedef std::vector<int> Bucket;
+  typedef std::vector<Bucket> HashTable;
+
+  /// The memory of a query, reused by the following queries.
+  struct SearchBuffers {
+    /// The round a slot was last searched in. The rounds increase over all queries of these
+    /// buffers, so the slots searched by the current query are those of a round from
+    /// first_round on, and the buffers never have to be cleared between queries.
+    std::vector<uint32_t> slot_rounds;
+    uint32_t first_round;
+    uint32_t next_round;
+    std::vector<int> candidate_slots;
+    std::vector<int> distances;
+    SearchBuffers() : first_round(1u), next_round(1u) {};
+  };
+
+  /// \brief Take search buffers from the pool and start a query of up to max_num_rounds rounds.
+  std::unique_ptr<SearchBuffers> acquireSearchBuffers(uint32_t max_num_rounds) const;
+
+  /// \brief Return search buffers to the pool.
+  void releaseSearchBuffers(std::unique_ptr<SearchBuffers> buffers) const;
+
+  /// \brief The key of a descriptor into the given hash table.
+  uint32_t getSubstring(const unsigned char* descriptor, size_t table_index) const;
+
+  /// \brief The number of bits of the substrings of the given hash table.
+  int getSubstringSizeBits(size_t table_index) const;
+
+  /// \brief Search the buckets whose substrings differ from the substrings of the query in
+  ///        exactly substring_radius bits, or all remaining descriptors if that is cheaper,
+  ///        and compute the distances of the descriptors not searched before.
+  /// \param[in,out] buffers            The slots searched by the query. Their candidate slots
+  ///                                   are set to the slots searched in this round and their
+  ///                                   distances to the distances of these to the query.
+  /// \param[in,out] num_searched_slots The number of slots searched in all rounds.
+  void searchBuckets(const unsigned char* query, int substring_radius, SearchBuffers* buffers,
+                     size_t* num_searched_slots) const;
+
+  /// \brief The number of rounds of a search, one per substring radius.
+  uint32_t getMaxNumSearchRounds() const;
+
+  /// \brief Remove a descriptor and move the last descriptor into its slot.
+  void removeSlot(int slot);
+
+  const size_t descriptor_size_bytes_;
+  const size_t substring_size_bytes_;
+
+  /// One hash table per substring of the descriptors.
+  std::vector<HashTable> hash_tables_;
+  /// The descriptors by slot. Has more columns than descriptors to add frames in amortized
+  /// constant time per descriptor.
+  DescriptorsT descriptors_;
+  /// The keys of the descriptors by slot.
+  std::vector<DescriptorKey> keys_;
+  /// The slots of the descriptors of each frame, by keypoint index.
+  std::unordered_map<FrameId, std::vector<int>> frame_id_to_slots_;
+
+  /// The search buffers not in use by a query.
+  mutable std::vector<std::unique_ptr<SearchBuffers>> free_search_buffers_;
+  mutable std::mutex search_buffers_mutex_;
+};
+}  // namespace aslam
+
+#endif  // ASLAM_MATCHER_BINARY_DESCRIPTOR_INDEX_H_
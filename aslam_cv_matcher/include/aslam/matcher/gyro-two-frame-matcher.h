@@ -10,6 +10,7 @@
 #include <Eigen/Core>
 #include <glog/logging.h>
 
+#include "aslam/matcher/keypoint-grid-index.h"
 #include "aslam/matcher/match.h"
 
 namespace aslam {
@@ -62,30 +63,21 @@ class GyroTwoFrameMatcher {
   void match();
 
  private:
-  struct KeypointData {
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-    KeypointData(const Eigen::Vector2d& measurement, const int index)
-      : measurement(measurement), channel_index(index) {}
-    Eigen::Vector2d measurement;
-    int channel_index;
-  };
-
-  typedef typename Aligned<std::vector, KeypointData>::const_iterator KeyPointIterator;
   typedef typename FrameToFrameMatchesWithScore::iterator MatchesIterator;
 
   struct MatchData {
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     MatchData() = default;
     void addCandidate(
-        const KeyPointIterator keypoint_iterator_kp1, const double matching_score) {
+        const int keypoint_index_kp1, const double matching_score) {
       CHECK_GT(matching_score, 0.0);
       CHECK_LE(matching_score, 1.0);
-      keypoint_match_candidates_kp1.push_back(keypoint_iterator_kp1);
+      keypoint_match_candidates_kp1.push_back(keypoint_index_kp1);
       match_candidate_matching_scores.push_back(matching_score);
     }
-    // Iterators of keypoints of frame (k+1) that were candidates for the match
+    // Indices of keypoints of frame (k+1) that were candidates for the match
     // together with their scores.
-    std::vector<KeyPointIterator> keypoint_match_candidates_kp1;
+    std::vector<int> keypoint_match_candidates_kp1;
     std::vector<double> match_candidate_matching_scores;
   };
 
@@ -99,11 +91,19 @@ class GyroTwoFrameMatcher {
   /// already existing match.
   void matchKeypoint(const int idx_k);
 
-  void getKeypointIteratorsInWindow(
+  /// \brief Compute the distances of the candidates from candidates_begin on to the
+  ///        descriptor of frame k and add them to the match data and the best and second best
+  ///        candidates. Returns true if the best candidate is a match.
+  bool searchCandidates(const unsigned char* descriptor_k, const size_t candidates_begin,
+                        const int score_threshold, int* neighbor_candidate_indices,
+                        int* neighbor_distances, MatchData* match_data);
+
+  /// \brief Get the keypoints of frame (k+1) in the square window around the predicted
+  ///        keypoint position.
+  void getKeypointsInWindow(
       const Eigen::Vector2d& predicted_keypoint_position,
       const int window_half_side_length_px,
-      KeyPointIterator* it_keypoints_begin,
-      KeyPointIterator* it_keypoints_end) const;
+      std::vector<int>* keypoint_indices_kp1) const;
 
   /// \brief Try to match inferior matches without modifying initial matches.
   ///
@@ -112,8 +112,6 @@ class GyroTwoFrameMatcher {
   /// Returns true if matches are still found.
   bool matchInferiorMatches(std::vector<bool>* is_inferior_keypoint_kp1_matched);
 
-  int clamp(const int lower, const int upper, const int in) const;
-
   // The larger the matching score (which is smaller or equal to 1),
   // the higher the probability that a true match occurred.
   double computeMatchingScore(const int num_matching_bits,
@@ -150,15 +148,10 @@ class GyroTwoFrameMatcher {
   // to the ordering of the keypoint/descriptors in
   // the respective channels.
   FrameToFrameMatchesWithScore* const matches_kp1_k_;
-  // Descriptors of frame (k+1).
-  std::vector<common::FeatureDescriptorConstRef> descriptors_kp1_wrapped_;
   // Descriptors of frame k.
   std::vector<common::FeatureDescriptorConstRef> descriptors_k_wrapped_;
-  // Keypoints of frame (k+1) sorted from small to large y coordinates.
-  Aligned<std::vector, KeypointData> keypoints_kp1_sorted_by_y_;
-  // corner_row_LUT[i] is the number of keypoints that has y position
-  // lower than i in the image.
-  std::vector<int> corner_row_LUT_;
+  // Grid index of the keypoints of frame (k+1).
+  KeypointGridIndex keypoint_grid_kp1_;
   // Remember matched keypoints of frame (k+1).
   std::vector<bool> is_keypoint_kp1_matched_;
   // Map from keypoint indices of frame (k+1) to
@@ -167,6 +160,12 @@ class GyroTwoFrameMatcher {
   // Keep track of processed keypoints s.t. we don't process them again in the
   // large window. Set every element to false for each keypoint (of frame k) iteration!
   std::vector<bool> iteration_processed_keypoints_kp1_;
+  // The keypoints of frame (k+1) in the current search window, and the keypoints of frame
+  // (k+1) in the search windows of the current keypoint of frame k with their descriptor
+  // distances. Reused for every keypoint.
+  std::vector<int> window_keypoints_kp1_;
+  std::vector<int> candidate_channel_indices_kp1_;
+  std::vector<int> candidate_distances_;
   // The queried keypoints in frame (k+1) and the corresponding
   // matching score are stored for each attempted match.
   // A map from the keypoint in frame k to the corresponding
@@ -184,6 +183,8 @@ class GyroTwoFrameMatcher {
   static constexpr float kMatchingThresholdBitsRatioStrict = 0.85f;
   // Two descriptors could match if they pass the Lowe ratio test.
   static constexpr float kLoweRatio = 0.8f;
+  // The best and second best candidates are needed for the ratio test.
+  static constexpr int kNumNeighbors = 2;
   // Small image space distances for keypoint matches.
   const int small_search_distance_px_;
   // Large image space distances for keypoint matches.
@@ -193,34 +194,17 @@ class GyroTwoFrameMatcher {
   static constexpr size_t kMaxNumInferiorIterations = 3u;
 };
 
-void GyroTwoFrameMatcher::getKeypointIteratorsInWindow(
+inline void GyroTwoFrameMatcher::getKeypointsInWindow(
     const Eigen::Vector2d& predicted_keypoint_position,
     const int window_half_side_length_px,
-    KeyPointIterator* it_keypoints_begin,
-    KeyPointIterator* it_keypoints_end) const {
-  CHECK_NOTNULL(it_keypoints_begin);
-  CHECK_NOTNULL(it_keypoints_end);
-CHECK_GT(window_half_side_length_px, 0);
-
-  // Compute search area for LUT iterators row-wise.
-  int LUT_index_top = clamp(0, kImageHeight - 1, static_cast<int>(
-      predicted_keypoint_position(1) + 0.5 - window_half_side_length_px));
-  int LUT_index_bottom = clamp(0, kImageHeight - 1, static_cast<int>(
-      predicted_keypoint_position(1) + 0.5 + window_half_side_length_px));
-
-  *it_keypoints_begin = keypoints_kp1_sorted_by_y_.begin() + corner_row_LUT_[LUT_index_top];
-  *it_keypoints_end = keypoints_kp1_sorted_by_y_.begin() + corner_row_LUT_[LUT_index_bottom];
-
-  CHECK_LE(LUT_index_top, LUT_index_bottom);
-  CHECK_GE(LUT_index_bottom, 0);
-  CHECK_GE(LUT_index_top, 0);
-  CHECK_LT(LUT_index_top, static_cast<int>(kImageHeight));
-  CHECK_LT(LUT_index_bottom, static_cast<int>(kImageHeight));
-}
-
-inline int GyroTwoFrameMatcher::clamp(
-    const int lower, const int upper, const int in) const {
-  return std::min<int>(std::max<int>(in, lower), upper);
+    std::vector<int>* keypoint_indices_kp1) const {
+  CHECK_NOTNULL(keypoint_indices_kp1);
+  CHECK_GT(window_half_side_length_px, 0);
+  const Eigen::Vector2d window_half_size =
+      Eigen::Vector2d::Constant(window_half_side_length_px);
+  keypoint_grid_kp1_.getKeypointsInWindow(
+      predicted_keypoint_position - window_half_size,
+      predicted_keypoint_position + window_half_size, keypoint_indices_kp1);
 }
 
 inline double GyroTwoFrameMatcher::computeMatchingScore(
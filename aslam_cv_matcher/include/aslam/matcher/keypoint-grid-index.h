@@ -0,0 +1,76 @@
+#ifndef ASLAM_MATCHER_KEYPOINT_GRID_INDEX_H_
+#define ASLAM_MATCHER_KEYPOINT_GRID_INDEX_H_
+
+#include <vector>
+
+#include <aslam/common/macros.h>
+#include <Eigen/Core>
+
+namespace aslam {
+
+/// \class KeypointGridIndex
+/// \brief A grid of square cells over the keypoints of a frame to find the keypoints within a
+///        radius or a window around a position, e.g. around the predicted position of a
+///        keypoint of another frame.
+///
+/// The grid covers the bounding box of the keypoints. The keypoints are sorted into the cells
+/// with a counting sort, such that the keypoints of a cell and of a row of cells are stored
+/// contiguously together with their coordinates. A query only visits the cells overlapping
+/// its circle or window instead of a full-width band of image rows.
+class KeypointGridIndex {
+public:
+  ASLAM_POINTER_TYPEDEFS(KeypointGridIndex);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(KeypointGridIndex);
+
+  /// \brief Create an empty index.
+  KeypointGridIndex();
+  virtual ~KeypointGridIndex() {};
+
+  /// \brief Replace the keypoints of the index.
+  /// \param[in] keypoints         The keypoints, one per column.
+  /// \param[in] cell_size_px      The side length of the cells. The queries are fastest if this
+  ///                              is around the query radius or half side length. The cells
+  ///                              are enlarged if there would be many more cells than keypoints.
+  /// \param[in] is_keypoint_valid Only the keypoints flagged valid are indexed. All keypoints
+  ///                              are indexed if this is nullptr.
+  void build(const Eigen::Matrix2Xd& keypoints, double cell_size_px,
+             const std::vector<bool>* is_keypoint_valid);
+
+  /// \brief Find the keypoints closer than radius_px to the center.
+  /// \param[out] keypoint_indices The column indices of the keypoints in the built matrix,
+  ///                              ordered by cell.
+  void getKeypointsInRadius(const Eigen::Vector2d& center, double radius_px,
+                            std::vector<int>* keypoint_indices) const;
+
+  /// \brief Find the keypoints within the window, including its borders.
+  /// \param[out] keypoint_indices The column indices of the keypoints in the built matrix,
+  ///                              ordered by cell.
+  void getKeypointsInWindow(const Eigen::Vector2d& window_min, const Eigen::Vector2d& window_max,
+                            std::vector<int>* keypoint_indices) const;
+
+  inline size_t getNumKeypoints() const { return cell_keypoint_indices_.size(); }
+  inline int getNumCells() const { return num_cells_x_ * num_cells_y_; }
+  inline double getCellSize() const { return cell_size_px_; }
+
+private:
+  /// \brief Get the range of cells overlapping [min, max] along one axis, clamped to the grid.
+  /// @return Returns false if the range does not overlap the grid.
+  bool getCellRange(double min, double max, double origin, int num_cells, int* cell_begin,
+                    int* cell_end) const;
+
+  /// The position of the corner of the first cell and the size of the cells.
+  Eigen::Vector2d origin_;
+  double cell_size_px_;
+  double inverse_cell_size_;
+  int num_cells_x_;
+  int num_cells_y_;
+
+  /// The keypoints of cell c are the entries cell_offsets_[c] to cell_offsets_[c + 1] of the
+  /// keypoint indices and coordinates, where the cells are numbered row by row.
+  std::vector<int> cell_offsets_;
+  std::vector<int> cell_keypoint_indices_;
+  Eigen::Matrix2Xd cell_keypoints_;
+};
+}  // namespace aslam
+
+#endif  // ASLAM_MATCHER_KEYPOINT_GRID_INDEX_H_
@@ -6,16 +6,15 @@
 ///
 /// @}
 
-#include <map>
 #include <memory>
 #include <vector>
 
 #include <aslam/common/macros.h>
 #include <aslam/common/memory.h>
 #include <aslam/common/pose-types.h>
-#include <aslam/common/feature-descriptor-ref.h>
 #include <Eigen/Core>
 
+#include "aslam/matcher/keypoint-grid-index.h"
 #include "aslam/matcher/match.h"
 #include "aslam/matcher/matching-problem.h"
 
@@ -73,31 +72,8 @@ public:
     return static_cast<double>(384 - hamming_distance) / 384.0;
   }
 
-  inline int computeHammingDistance(int banana_index, int apple_index) {
-    CHECK_LT(apple_index, static_cast<int>(apple_descriptors_.size()))
-        << "No descriptor for this apple.";
-    CHECK_LT(banana_index, static_cast<int>(banana_descriptors_.size()))
-        << "No descriptor for this banana.";
-    CHECK_LT(apple_index, static_cast<int>(valid_apples_.size()))
-        << "No valid flag for this apple.";
-    CHECK_LT(banana_index, static_cast<int>(valid_bananas_.size()))
-        << "No valid flag for this apple.";
-    CHECK(valid_apples_[apple_index]) << "The given apple is not valid.";
-    CHECK(valid_bananas_[banana_index]) << "The given banana is not valid.";
-
-    const common::FeatureDescriptorConstRef& apple_descriptor =
-        apple_descriptors_[apple_index];
-    const common::FeatureDescriptorConstRef& banana_descriptor =
-        banana_descriptors_[banana_index];
-
-    CHECK_NOTNULL(apple_descriptor.data());
-    CHECK_NOTNULL(banana_descriptor.data());
-
-    return common::GetNumBitsDifferent(banana_descriptor, apple_descriptor);
-  }
-
   /// \brief Gets called at the beginning of the matching problem.
-  /// Creates a y-coordinate LUT for all apple keypoints and projects all banana keypoints into the
+  /// Creates a grid index of all valid apple keypoints and projects all banana keypoints into the
   /// apple frame.
   virtual bool doSetup();
 
@@ -108,8 +84,8 @@ private:
   const VisualFrame& banana_frame_;
   /// Rotation matrix taking vectors from the banana frame into the apple frame.
   aslam::Quaternion q_A_B_;
-  /// Map mapping y coordinates in the image plane onto keypoint indices of apple keypoints.
-  std::multimap<size_t, size_t> y_coordinate_to_apple_keypoint_index_map_;
+  /// Grid index of the valid apple keypoints in the image plane.
+  KeypointGridIndex apple_keypoint_grid_;
 
   /// Index marking apples as valid or invalid.
   std::vector<bool> valid_apples_;
@@ -119,21 +95,17 @@ private:
   /// The banana keypoints projected into the apple frame, expressed in the apple frame.
   Aligned<std::vector, Eigen::Vector2d> A_projected_keypoints_banana_;
 
-  /// The apple descriptors.
-  std::vector<common::FeatureDescriptorConstRef> apple_descriptors_;
-
-  /// The banana descriptors.
-  std::vector<common::FeatureDescriptorConstRef> banana_descriptors_;
+  /// The apples within the image space distance of the queried banana and their descriptor
+  /// distances. Reused for every banana.
+  std::vector<int> apple_candidate_indices_;
+  std::vector<int> apple_candidate_distances_;
 
   /// Descriptor size in bytes.
   size_t descriptor_size_bytes_;
 
-  /// Half width of the vertical band used for match lookup in pixels.
-  int vertical_band_halfwidth_pixels_;
-
-  /// Pairs with image space distance >= image_space_distance_threshold_pixels_ are
+  /// Pairs with image space distance >= image_space_distance_threshold_px_ are
   /// excluded from matches.
-  double squared_image_space_distance_threshold_px_sq_;
+  double image_space_distance_threshold_px_;
 
   /// Pairs with descriptor distance >= hamming_distance_threshold_ are
   /// excluded from matches.
@@ -0,0 +1,133 @@
+#ifndef ASLAM_MATCHER_VOCABULARY_TREE_H_
+#define ASLAM_MATCHER_VOCABULARY_TREE_H_
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <aslam/common/hamming-matrix.h>
+#include <aslam/common/macros.h>
+#include <aslam/common/yaml-file-serialization.h>
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <yaml-cpp/yaml.h>
+
+namespace aslam {
+
+/// \class VocabularyTree
+/// \brief A hierarchical vocabulary of binary descriptors for place recognition.
+///
+/// The tree is trained by binary k-medians: the descriptors of a node are clustered into
+/// branching_factor children, whose centers are the bitwise majority of their descriptors, and
+/// the children are clustered again down to num_levels levels. The leaves are the words. A
+/// descriptor is quantized to a word by descending to the nearest child on every level, which
+/// costs branching_factor * num_levels distances instead of one per word.
+///
+/// The words are weighted by their inverse document frequency in the training frames, such that
+/// words seen in many places count less, and a set of descriptors is summarized as an
+/// L1-normalized tf-idf bag of words (Nister and Stewenius, "Scalable Recognition with a
+/// Vocabulary Tree", CVPR 2006, and Galvez-Lopez and Tardos, "Bags of Binary Words for Fast
+/// Place Recognition in Image Sequences", T-RO 2012).
+class VocabularyTree : public YamlFileSerializable {
+public:
+  ASLAM_POINTER_TYPEDEFS(VocabularyTree);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(VocabularyTree);
+
+  typedef Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> DescriptorsT;
+  typedef int WordId;
+  /// The weights of the words of a set of descriptors, in increasing order of the word ids and
+  /// summing up to one. Words with zero weight are left out.
+  typedef std::vector<std::pair<WordId, double>> BagOfWords;
+
+  struct Options {
+    /// The max. number of children of a node.
+    size_t branching_factor;
+    /// The number of levels below the root, such that there are at most
+    /// branching_factor^num_levels words.
+    size_t num_levels;
+    /// The max. number of k-medians iterations per node.
+    size_t max_num_iterations;
+    /// The seed of the random initial cluster centers, to train the same tree every time.
+    unsigned int random_seed;
+    Options() :
+      branching_factor(10u),
+      num_levels(4u),
+      max_num_iterations(10u),
+      random_seed(42u) {};
+  };
+
+  /// \brief Create an empty vocabulary, to be trained or deserialized.
+  VocabularyTree();
+  virtual ~VocabularyTree() {};
+
+  /// \brief Train the vocabulary, replacing the current one.
+  /// \param[in] frame_descriptors The descriptors of each training frame, one descriptor per
+  ///                              column. The frames define the inverse document frequencies.
+  void train(const std::vector<DescriptorsT>& frame_descriptors, const Options& options);
+
+  /// \brief Is the vocabulary trained or deserialized?
+  inline bool isTrained() const { return !word_weights_.empty(); }
+
+  /// \brief Quantize a descriptor of getDescriptorSizeBytes() bytes to its word.
+  WordId getWord(const unsigned char* descriptor) const;
+
+  /// \brief Quantize descriptors, the word of column i at words[i].
+  void getWords(const DescriptorsT& descriptors, std::vector<WordId>* words) const;
+
+  /// \brief The tf-idf bag of words of a set of descriptors, e.g. of a frame.
+  void getBagOfWords(const DescriptorsT& descriptors, BagOfWords* bag_of_words) const;
+
+  /// \brief The similarity of two bags of words, 1 - |a - b|_1 / 2, which is one for equal and
+  ///        zero for disjoint bags of words.
+  static double getSimilarity(const BagOfWords& bag_of_words_a,
+                              const BagOfWords& bag_of_words_b);
+
+  /// \brief The inverse document frequency of a word.
+  inline double getWordWeight(WordId word) const {
+    CHECK_GE(word, 0);
+    CHECK_LT(static_cast<size_t>(word), word_weights_.size());
+    return word_weights_[word];
+  }
+
+  inline size_t getDescriptorSizeBytes() const { return descriptor_size_bytes_; }
+  inline size_t getNumWords() const { return word_weights_.size(); }
+  inline size_t getNumNodes() const { return node_words_.size(); }
+
+  virtual void serialize(YAML::Node* yaml_node) const override;
+  virtual bool deserialize(const YAML::Node& yaml_node) override;
+
+private:
+  /// The word of a node that is not a leaf.
+  static constexpr WordId kNoWord = -1;
+
+  /// \brief Cluster the descriptors of a node into at most branching_factor clusters.
+  /// \param[in]  descriptors         The descriptors of the node.
+  /// \param[out] centers             The center of each non-empty cluster in a column.
+  /// \param[out] cluster_descriptors The columns of descriptors in each cluster.
+  void clusterDescriptors(const DescriptorsT& descriptors, const Options& options,
+                          std::mt19937* random_engine, DescriptorsT* centers,
+                          std::vector<std::vector<int>>* cluster_descriptors) const;
+
+  /// \brief Clear the tree and add the root.
+  void clear();
+
+  /// \brief Number the leaves in breadth-first order as the words, after the children of all
+  ///        nodes were added.
+  /// @return The number of words.
+  size_t setNodeWords();
+
+  size_t descriptor_size_bytes_;
+
+  /// The nodes are numbered in breadth-first order, starting with the root. The center of
+  /// node n is column n, the center of the root is unused.
+  DescriptorsT node_centers_;
+  /// The children of node n are the candidates of query n.
+  common::HammingCandidateLists node_children_;
+  /// The word of each leaf, kNoWord for the other nodes.
+  std::vector<WordId> node_words_;
+  /// The inverse document frequency of each word.
+  std::vector<double> word_weights_;
+};
+}  // namespace aslam
+
+#endif  // ASLAM_MATCHER_VOCABULARY_TREE_H_
@@ -0,0 +1,115 @@
+#include "aslam/matcher/bag-of-words-index.h"
+
+#include <algorithm>
+
+#include <aslam/frames/visual-frame.h>
+#include <glog/logging.h>
+
+namespace aslam {
+
+BagOfWordsIndex::BagOfWordsIndex(const VocabularyTree::ConstPtr& vocabulary)
+  : vocabulary_(vocabulary) {
+  CHECK(vocabulary_);
+  CHECK(vocabulary_->isTrained());
+  inverted_file_.resize(vocabulary_->getNumWords());
+}
+
+void BagOfWordsIndex::addFrame(const VisualFrame& frame) {
+  CHECK(frame.getId().isValid());
+  CHECK(frame.hasDescriptors());
+  VocabularyTree::BagOfWords bag_of_words;
+  vocabulary_->getBagOfWords(frame.getDescriptors(), &bag_of_words);
+  addBagOfWords(frame.getId(), bag_of_words);
+}
+
+void BagOfWordsIndex::addBagOfWords(
+    const FrameId& frame_id, const VocabularyTree::BagOfWords& bag_of_words) {
+  int frame_slot = static_cast<int>(slot_frame_ids_.size());
+  if (!free_slots_.empty()) {
+    frame_slot = free_slots_.back();
+  }
+  CHECK(frame_id_to_slot_.emplace(frame_id, frame_slot).second)
+      << "The frame " << frame_id << " is already in the index.";
+  if (free_slots_.empty()) {
+    slot_frame_ids_.push_back(frame_id);
+    slot_bags_of_words_.push_back(bag_of_words);
+  } else {
+    free_slots_.pop_back();
+    slot_frame_ids_[frame_slot] = frame_id;
+    slot_bags_of_words_[frame_slot] = bag_of_words;
+  }
+
+  for (const std::pair<VocabularyTree::WordId, double>& word_weight : bag_of_words) {
+    CHECK_GE(word_weight.first, 0);
+    CHECK_LT(static_cast<size_t>(word_weight.first), inverted_file_.size());
+    inverted_file_[word_weight.first].push_back(Posting{frame_slot, word_weight.second});
+  }
+}
+
+bool BagOfWordsIndex::removeFrame(const FrameId& frame_id) {
+  auto it = frame_id_to_slot_.find(frame_id);
+  if (it == frame_id_to_slot_.end()) {
+    return false;
+  }
+  const int frame_slot = it->second;
+  frame_id_to_slot_.erase(it);
+
+  for (const std::pair<VocabularyTree::WordId, double>& word_weight :
+       slot_bags_of_words_[frame_slot]) {
+    std::vector<Posting>& postings = inverted_file_[word_weight.first];
+    std::vector<Posting>::iterator posting = std::find_if(
+        postings.begin(), postings.end(),
+        [frame_slot](const Posting& posting) { return posting.frame_slot == frame_slot; });
+    CHECK(posting != postings.end());
+    *posting = postings.back();
+    postings.pop_back();
+  }
+  slot_bags_of_words_[frame_slot].clear();
+  free_slots_.push_back(frame_slot);
+  return true;
+}
+
+void BagOfWordsIndex::query(
+    const VocabularyTree::DescriptorsT& descriptors, size_t max_num_frames,
+    std::vector<FrameScore>* frame_scores) const {
+  VocabularyTree::BagOfWords bag_of_words;
+  vocabulary_->getBagOfWords(descriptors, &bag_of_words);
+  query(bag_of_words, max_num_frames, frame_scores);
+}
+
+void BagOfWordsIndex::query(
+    const VocabularyTree::BagOfWords& bag_of_words, size_t max_num_frames,
+    std::vector<FrameScore>* frame_scores) const {
+  CHECK_NOTNULL(frame_scores)->clear();
+
+  // The scores are sums over the words in both the query and a frame, see
+  // VocabularyTree::getSimilarity, so only the frames in the lists of the query words are
+  // scored.
+  std::vector<double> slot_scores(slot_frame_ids_.size(), 0.0);
+  std::vector<int> scored_slots;
+  for (const std::pair<VocabularyTree::WordId, double>& word_weight : bag_of_words) {
+    CHECK_GE(word_weight.first, 0);
+    CHECK_LT(static_cast<size_t>(word_weight.first), inverted_file_.size());
+    for (const Posting& posting : inverted_file_[word_weight.first]) {
+      if (slot_scores[posting.frame_slot] == 0.0) {
+        scored_slots.push_back(posting.frame_slot);
+      }
+      slot_scores[posting.frame_slot] += std::min(word_weight.second, posting.weight);
+    }
+  }
+
+  // Equal scores are sorted by slot to return the same frames every time.
+  const size_t num_frames = std::min(max_num_frames, scored_slots.size());
+  std::partial_sort(scored_slots.begin(), scored_slots.begin() + num_frames, scored_slots.end(),
+                    [&slot_scores](int lhs, int rhs) {
+                      return slot_scores[lhs] > slot_scores[rhs] ||
+                          (slot_scores[lhs] == slot_scores[rhs] && lhs < rhs);
+                    });
+  frame_scores->reserve(num_frames);
+  for (size_t frame = 0u; frame < num_frames; ++frame) {
+    const int frame_slot = scored_slots[frame];
+    frame_scores->push_back(FrameScore{slot_frame_ids_[frame_slot], slot_scores[frame_slot]});
+  }
+}
+
+}  // namespace aslam
@@ -0,0 +1,125 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/hamming-matrix.h>
+#include <aslam/common/timer.h>
+#include <aslam/common/unique-id.h>
+#include <aslam/matcher/binary-descriptor-index.h>
+
+// Compares the nearest neighbor and radius queries of the multi-index hashing index to a
+// linear search over a map of BRISK sized descriptors. The queries are descriptors of the map
+// with some flipped bits, as the descriptors of a keypoint observed again from another view.
+
+constexpr int kDescriptorSizeBytes = 48;
+constexpr int kNumFrames = 200;
+constexpr int kNumDescriptorsPerFrame = 500;
+constexpr int kNumQueries = 500;
+constexpr int kMaxFlippedBits = 40;
+constexpr int kNumNeighbors = 2;
+constexpr int kRadius = 50;
+
+typedef aslam::BinaryDescriptorIndex::DescriptorsT DescriptorsType;
+
+class BinaryDescriptorIndexBenchmark : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::srand(42);
+    map_descriptors_.resize(kDescriptorSizeBytes, kNumFrames * kNumDescriptorsPerFrame);
+    map_descriptors_.setRandom();
+    queries_.resize(kDescriptorSizeBytes, kNumQueries);
+    for (int query = 0; query < kNumQueries; ++query) {
+      queries_.col(query) = map_descriptors_.col(std::rand() % map_descriptors_.cols());
+      const int num_flipped_bits = std::rand() % (kMaxFlippedBits + 1);
+      for (int bit = 0; bit < num_flipped_bits; ++bit) {
+        const int flipped_bit = std::rand() % (8 * kDescriptorSizeBytes);
+        queries_(flipped_bit / 8, query) ^= static_cast<unsigned char>(1u << (flipped_bit % 8));
+      }
+    }
+
+    timing::TimerImpl timer("linear search");
+    aslam::common::findNearestHammingNeighbors(
+        queries_, map_descriptors_, kNumNeighbors, &linear_neighbor_indices_,
+        &linear_neighbor_distances_);
+    timer.Stop();
+    LOG(INFO) << "linear search: "
+              << timing::Timing::GetMeanSeconds("linear search") / kNumQueries * 1e6
+              << " us per query";
+  }
+
+  /// Add the map to an index frame by frame.
+  void fillIndex(const std::string& timer_name, aslam::BinaryDescriptorIndex* index) {
+    CHECK_NOTNULL(index);
+    for (int frame = 0; frame < kNumFrames; ++frame) {
+      aslam::FrameId frame_id;
+      aslam::generateId(&frame_id);
+      const DescriptorsType descriptors = map_descriptors_.middleCols(
+          frame * kNumDescriptorsPerFrame, kNumDescriptorsPerFrame);
+      timing::TimerImpl timer(timer_name);
+      index->addDescriptors(frame_id, descriptors);
+      timer.Stop();
+    }
+  }
+
+  DescriptorsType map_descriptors_;
+  DescriptorsType queries_;
+  Eigen::MatrixXi linear_neighbor_indices_;
+  Eigen::MatrixXi linear_neighbor_distances_;
+};
+
+TEST_F(BinaryDescriptorIndexBenchmark, CompareToLinearSearch) {
+  for (size_t substring_size_bytes = 1u; substring_size_bytes <= 2u; ++substring_size_bytes) {
+    aslam::BinaryDescriptorIndex::Options options;
+    options.substring_size_bytes = substring_size_bytes;
+    aslam::BinaryDescriptorIndex index(kDescriptorSizeBytes, options);
+    const std::string name = std::to_string(substring_size_bytes) + " byte substrings";
+    fillIndex(name + " add frame", &index);
+    LOG(INFO) << name << ": "
+              << timing::Timing::GetMeanSeconds(name + " add frame") * 1e3
+              << " ms per frame of " << kNumDescriptorsPerFrame << " descriptors";
+
+    // The index is exact, the recall is the fraction of queries with the same neighbor
+    // distances as the linear search. The second neighbor of a random descriptor is far, such
+    // that the search for two neighbors, as for the ratio test, is the worst case.
+    for (int num_neighbors = 1; num_neighbors <= kNumNeighbors; ++num_neighbors) {
+      const std::string timer_name = name + " " + std::to_string(num_neighbors) + "-nn";
+      int num_recalled_queries = 0;
+      std::vector<aslam::BinaryDescriptorIndex::Neighbor> neighbors;
+      for (int query = 0; query < kNumQueries; ++query) {
+        timing::TimerImpl timer(timer_name);
+        index.findNearestNeighbors(&queries_.coeffRef(0, query), num_neighbors, &neighbors);
+        timer.Stop();
+        bool is_recalled = neighbors.size() == static_cast<size_t>(num_neighbors);
+        for (size_t neighbor = 0u; is_recalled && neighbor < neighbors.size(); ++neighbor) {
+          is_recalled = neighbors[neighbor].distance ==
+              linear_neighbor_distances_(neighbor, query);
+        }
+        num_recalled_queries += is_recalled ? 1 : 0;
+      }
+      EXPECT_EQ(kNumQueries, num_recalled_queries);
+      LOG(INFO) << timer_name << ": " << timing::Timing::GetMeanSeconds(timer_name) * 1e6
+                << " us per query, recall "
+                << static_cast<double>(num_recalled_queries) / kNumQueries;
+    }
+
+    size_t num_radius_neighbors = 0u;
+    std::vector<aslam::BinaryDescriptorIndex::Neighbor> neighbors;
+    for (int query = 0; query < kNumQueries; ++query) {
+      timing::TimerImpl timer(name + " radius");
+      index.findWithinRadius(&queries_.coeffRef(0, query), kRadius, &neighbors);
+      timer.Stop();
+      num_radius_neighbors += neighbors.size();
+    }
+    LOG(INFO) << name << ": "
+              << timing::Timing::GetMeanSeconds(name + " radius") * 1e6
+              << " us per radius query, " << num_radius_neighbors << " neighbors within "
+              << kRadius << " bits";
+  }
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,89 @@
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+#include <aslam/matcher/keypoint-grid-index.h>
+
+// Compares finding the keypoints within a radius of many query positions with a grid index to
+// a multimap from the image rows to the keypoints, which visits all keypoints in a full-width
+// band of rows around every query and filters them by their distance.
+
+constexpr int kImageWidth = 752;
+constexpr int kImageHeight = 480;
+constexpr int kNumKeypoints = 2000;
+constexpr int kNumQueries = 2000;
+constexpr int kNumRepetitions = 20;
+constexpr double kRadius = 20.0;
+
+TEST(KeypointGridIndexBenchmark, CompareToRowMultimap) {
+  std::srand(42);
+  Eigen::Matrix2Xd keypoints(2, kNumKeypoints);
+  for (int i = 0; i < kNumKeypoints; ++i) {
+    keypoints.col(i) << static_cast<double>(kImageWidth) * std::rand() / RAND_MAX,
+        static_cast<double>(kImageHeight - 1) * std::rand() / RAND_MAX;
+  }
+  Eigen::Matrix2Xd queries(2, kNumQueries);
+  for (int i = 0; i < kNumQueries; ++i) {
+    queries.col(i) << static_cast<double>(kImageWidth) * std::rand() / RAND_MAX,
+        static_cast<double>(kImageHeight) * std::rand() / RAND_MAX;
+  }
+
+  size_t num_multimap_keypoints = 0u;
+  std::vector<int> keypoint_indices;
+  for (int repetition = 0; repetition < kNumRepetitions; ++repetition) {
+    timing::TimerImpl build_timer("multimap build");
+    std::multimap<int, int> row_to_keypoint_index;
+    for (int i = 0; i < kNumKeypoints; ++i) {
+      row_to_keypoint_index.emplace(static_cast<int>(keypoints(1, i)), i);
+    }
+    build_timer.Stop();
+
+    timing::TimerImpl query_timer("multimap queries");
+    const int band_half_width = static_cast<int>(std::ceil(kRadius));
+    for (int query = 0; query < kNumQueries; ++query) {
+      keypoint_indices.clear();
+      const int row = static_cast<int>(queries(1, query));
+      auto it_end = row_to_keypoint_index.upper_bound(row + band_half_width);
+      for (auto it = row_to_keypoint_index.lower_bound(row - band_half_width); it != it_end;
+           ++it) {
+        if ((keypoints.col(it->second) - queries.col(query)).squaredNorm() < kRadius * kRadius) {
+          keypoint_indices.push_back(it->second);
+        }
+      }
+      num_multimap_keypoints += keypoint_indices.size();
+    }
+    query_timer.Stop();
+  }
+
+  size_t num_grid_keypoints = 0u;
+  for (int repetition = 0; repetition < kNumRepetitions; ++repetition) {
+    timing::TimerImpl build_timer("grid build");
+    aslam::KeypointGridIndex index;
+    index.build(keypoints, kRadius, nullptr);
+    build_timer.Stop();
+
+    timing::TimerImpl query_timer("grid queries");
+    for (int query = 0; query < kNumQueries; ++query) {
+      index.getKeypointsInRadius(queries.col(query), kRadius, &keypoint_indices);
+      num_grid_keypoints += keypoint_indices.size();
+    }
+    query_timer.Stop();
+  }
+
+  LOG(INFO) << "multimap: build " << timing::Timing::GetMeanSeconds("multimap build") * 1e3
+            << " ms, " << kNumQueries << " queries "
+            << timing::Timing::GetMeanSeconds("multimap queries") * 1e3 << " ms";
+  LOG(INFO) << "grid: build " << timing::Timing::GetMeanSeconds("grid build") * 1e3
+            << " ms, " << kNumQueries << " queries "
+            << timing::Timing::GetMeanSeconds("grid queries") * 1e3 << " ms";
+  EXPECT_EQ(num_multimap_keypoints, num_grid_keypoints);
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
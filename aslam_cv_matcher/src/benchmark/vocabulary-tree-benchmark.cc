@@ -0,0 +1,143 @@
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/hamming-matrix.h>
+#include <aslam/common/memory.h>
+#include <aslam/common/timer.h>
+#include <aslam/common/unique-id.h>
+#include <aslam/matcher/bag-of-words-index.h>
+#include <aslam/matcher/vocabulary-tree.h>
+
+// Compares retrieving the keyframe of the same place as a query frame from a bag of words
+// index to matching the query frame against every keyframe with the ratio test and taking the
+// keyframe with the most matches. The places are sets of noisy copies of random true words, and
+// the query is a new view of a place of which a quarter of the descriptors is not seen again.
+
+constexpr int kDescriptorSizeBytes = 48;
+constexpr int kNumTrueWords = 5000;
+constexpr int kMaxFlippedBits = 20;
+constexpr int kNumKeyframes = 300;
+constexpr int kNumDescriptorsPerFrame = 500;
+constexpr int kNumQueries = 20;
+constexpr int kPercentKeptInQuery = 75;
+constexpr double kRatioTestThreshold = 0.8;
+
+typedef aslam::VocabularyTree::DescriptorsT DescriptorsType;
+
+class VocabularyTreeBenchmark : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::srand(42);
+    true_words_.resize(kDescriptorSizeBytes, kNumTrueWords);
+    true_words_.setRandom();
+    place_true_words_.resize(kNumKeyframes);
+    for (std::vector<int>& true_words : place_true_words_) {
+      for (int i = 0; i < kNumDescriptorsPerFrame; ++i) {
+        true_words.push_back(std::rand() % kNumTrueWords);
+      }
+    }
+    for (int place = 0; place < kNumKeyframes; ++place) {
+      keyframes_.push_back(createView(place, 100));
+    }
+  }
+
+  DescriptorsType createView(int place, int percent_kept) const {
+    std::vector<int> true_words;
+    for (const int true_word : place_true_words_[place]) {
+      if (std::rand() % 100 < percent_kept) {
+        true_words.push_back(true_word);
+      }
+    }
+    DescriptorsType descriptors(kDescriptorSizeBytes, true_words.size());
+    for (size_t i = 0u; i < true_words.size(); ++i) {
+      descriptors.col(i) = true_words_.col(true_words[i]);
+      const int num_flipped_bits = std::rand() % (kMaxFlippedBits + 1);
+      for (int bit = 0; bit < num_flipped_bits; ++bit) {
+        const int flipped_bit = std::rand() % (8 * kDescriptorSizeBytes);
+        descriptors(flipped_bit / 8, i) ^= static_cast<unsigned char>(1u << (flipped_bit % 8));
+      }
+    }
+    return descriptors;
+  }
+
+  DescriptorsType true_words_;
+  std::vector<std::vector<int>> place_true_words_;
+  std::vector<DescriptorsType> keyframes_;
+};
+
+TEST_F(VocabularyTreeBenchmark, CompareToMatchingAgainstEveryKeyframe) {
+  std::vector<int> query_places;
+  std::vector<DescriptorsType> queries;
+  for (int query = 0; query < kNumQueries; ++query) {
+    query_places.push_back(std::rand() % kNumKeyframes);
+    queries.push_back(createView(query_places.back(), kPercentKeptInQuery));
+  }
+
+  // The vocabulary is trained on the keyframes, as it would be on frames of similar scenes.
+  aslam::VocabularyTree::UniquePtr vocabulary = aligned_unique<aslam::VocabularyTree>();
+  timing::TimerImpl train_timer("train");
+  vocabulary->train(keyframes_, aslam::VocabularyTree::Options());
+  train_timer.Stop();
+  LOG(INFO) << "train: " << timing::Timing::GetMeanSeconds("train") << " s for "
+            << vocabulary->getNumWords() << " words";
+
+  aslam::BagOfWordsIndex index(std::move(vocabulary));
+  std::vector<aslam::FrameId> keyframe_ids(kNumKeyframes);
+  for (int keyframe = 0; keyframe < kNumKeyframes; ++keyframe) {
+    aslam::generateId(&keyframe_ids[keyframe]);
+    aslam::VocabularyTree::BagOfWords bag_of_words;
+    timing::TimerImpl timer("add keyframe");
+    index.getVocabulary().getBagOfWords(keyframes_[keyframe], &bag_of_words);
+    index.addBagOfWords(keyframe_ids[keyframe], bag_of_words);
+    timer.Stop();
+  }
+  LOG(INFO) << "add keyframe: " << timing::Timing::GetMeanSeconds("add keyframe") * 1e3
+            << " ms";
+
+  int num_retrieved_places = 0;
+  std::vector<aslam::BagOfWordsIndex::FrameScore> frame_scores;
+  for (int query = 0; query < kNumQueries; ++query) {
+    timing::TimerImpl timer("bag of words query");
+    index.query(queries[query], 1u, &frame_scores);
+    timer.Stop();
+    num_retrieved_places +=
+        !frame_scores.empty() && frame_scores[0].frame_id == keyframe_ids[query_places[query]];
+  }
+  LOG(INFO) << "bag of words query: "
+            << timing::Timing::GetMeanSeconds("bag of words query") * 1e3 << " ms, recall "
+            << static_cast<double>(num_retrieved_places) / kNumQueries;
+
+  int num_matched_places = 0;
+  Eigen::MatrixXi neighbor_indices;
+  Eigen::MatrixXi neighbor_distances;
+  for (int query = 0; query < kNumQueries; ++query) {
+    timing::TimerImpl timer("matching");
+    int best_keyframe = -1;
+    int best_num_matches = 0;
+    for (int keyframe = 0; keyframe < kNumKeyframes; ++keyframe) {
+      aslam::common::findNearestHammingNeighbors(queries[query], keyframes_[keyframe], 2,
+                                                 &neighbor_indices, &neighbor_distances);
+      int num_matches = 0;
+      for (int i = 0; i < neighbor_distances.cols(); ++i) {
+        num_matches += neighbor_distances(0, i) < kRatioTestThreshold * neighbor_distances(1, i);
+      }
+      if (num_matches > best_num_matches) {
+        best_num_matches = num_matches;
+        best_keyframe = keyframe;
+      }
+    }
+    timer.Stop();
+    num_matched_places += best_keyframe == query_places[query];
+  }
+  LOG(INFO) << "matching: " << timing::Timing::GetMeanSeconds("matching") * 1e3
+            << " ms, recall " << static_cast<double>(num_matched_places) / kNumQueries;
+  EXPECT_EQ(num_matched_places, num_retrieved_places);
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,353 @@
+#include "aslam/matcher/binary-descriptor-index.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+
+#include <aslam/common/hamming-matrix.h>
+#include <aslam/frames/visual-frame.h>
+#include <glog/logging.h>
+
+namespace aslam {
+namespace {
+/// The number of masks of num_bits bits with num_set_bits bits set.
+size_t getNumBitPermutations(int num_bits, int num_set_bits) {
+  if (num_set_bits < 0 || num_set_bits > num_bits) {
+    return 0u;
+  }
+  // Exact in every step, as the product of i consecutive integers is divisible by i!.
+  size_t num_permutations = 1u;
+  for (int i = 1; i <= num_set_bits; ++i) {
+    num_permutations = num_permutations * (num_bits - num_set_bits + i) / i;
+  }
+  return num_permutations;
+}
+}  // namespace
+
+BinaryDescriptorIndex::BinaryDescriptorIndex(
+    size_t descriptor_size_bytes, const Options& options)
+  : descriptor_size_bytes_(descriptor_size_bytes),
+    substring_size_bytes_(options.substring_size_bytes),
+    descriptors_(descriptor_size_bytes, 0) {
+  CHECK_GT(descriptor_size_bytes_, 0u);
+  CHECK_GE(substring_size_bytes_, 1u);
+  CHECK_LE(substring_size_bytes_, 2u)
+      << "Hash tables of larger substrings do not fit into memory.";
+
+  const size_t num_hash_tables =
+      (descriptor_size_bytes_ + substring_size_bytes_ - 1u) / substring_size_bytes_;
+  hash_tables_.resize(num_hash_tables);
+  for (size_t table_index = 0u; table_index < num_hash_tables; ++table_index) {
+    hash_tables_[table_index].resize(1u << getSubstringSizeBits(table_index));
+  }
+}
+
+void BinaryDescriptorIndex::addFrame(const VisualFrame& frame) {
+  CHECK(frame.getId().isValid());
+  CHECK(frame.hasDescriptors());
+  addDescriptors(frame.getId(), frame.getDescriptors());
+}
+
+void BinaryDescriptorIndex::addDescriptors(
+    const FrameId& frame_id, const DescriptorsT& descriptors) {
+  CHECK_EQ(static_cast<size_t>(descriptors.rows()), descriptor_size_bytes_)
+      << "The descriptors need to be of the size of the index.";
+  auto insertion = frame_id_to_slots_.emplace(frame_id, std::vector<int>());
+  CHECK(insertion.second) << "The frame " << frame_id << " is already in the index.";
+  std::vector<int>& frame_slots = insertion.first->second;
+
+  const int num_descriptors = static_cast<int>(descriptors.cols());
+  const int num_slots = static_cast<int>(keys_.size()) + num_descriptors;
+  if (num_slots > descriptors_.cols()) {
+    descriptors_.conservativeResize(
+        Eigen::NoChange, std::max<int>(num_slots, 2 * descriptors_.cols()));
+  }
+
+  frame_slots.reserve(num_descriptors);
+  for (int keypoint_index = 0; keypoint_index < num_descriptors; ++keypoint_index) {
+    const int slot = static_cast<int>(keys_.size());
+    descriptors_.col(slot) = descriptors.col(keypoint_index);
+    keys_.push_back(DescriptorKey{frame_id, static_cast<size_t>(keypoint_index)});
+    const unsigned char* descriptor = &descriptors_.coeffRef(0, slot);
+    for (size_t table_index = 0u; table_index < hash_tables_.size(); ++table_index) {
+      hash_tables_[table_index][getSubstring(descriptor, table_index)].push_back(slot);
+    }
+    frame_slots.push_back(slot);
+  }
+}
+
+bool BinaryDescriptorIndex::removeFrame(const FrameId& frame_id) {
+  auto it = frame_id_to_slots_.find(frame_id);
+  if (it == frame_id_to_slots_.end()) {
+    return false;
+  }
+  std::vector<int> frame_slots;
+  frame_slots.swap(it->second);
+  frame_id_to_slots_.erase(it);
+
+  // The last descriptor is moved into a removed slot. Removing the slots from the back ensures
+  // that the last descriptor is never a descriptor of this frame that is still to be removed.
+  std::sort(frame_slots.begin(), frame_slots.end(), std::greater<int>());
+  for (const int slot : frame_slots) {
+    removeSlot(slot);
+  }
+  return true;
+}
+
+void BinaryDescriptorIndex::removeSlot(int slot) {
+  CHECK_GE(slot, 0);
+  CHECK_LT(slot, static_cast<int>(keys_.size()));
+  const int last_slot = static_cast<int>(keys_.size()) - 1;
+
+  const unsigned char* descriptor = &descriptors_.coeffRef(0, slot);
+  for (size_t table_index = 0u; table_index < hash_tables_.size(); ++table_index) {
+    Bucket& bucket = hash_tables_[table_index][getSubstring(descriptor, table_index)];
+    Bucket::iterator it = std::find(bucket.begin(), bucket.end(), slot);
+    CHECK(it != bucket.end());
+    *it = bucket.back();
+    bucket.pop_back();
+  }
+
+  if (slot != last_slot) {
+    const unsigned char* last_descriptor = &descriptors_.coeffRef(0, last_slot);
+    for (size_t table_index = 0u; table_index < hash_tables_.size(); ++table_index) {
+      Bucket& bucket = hash_tables_[table_index][getSubstring(last_descriptor, table_index)];
+      Bucket::iterator it = std::find(bucket.begin(), bucket.end(), last_slot);
+      CHECK(it != bucket.end());
+      *it = slot;
+    }
+    auto last_frame_it = frame_id_to_slots_.find(keys_[last_slot].frame_id);
+    CHECK(last_frame_it != frame_id_to_slots_.end());
+    // The slots of a frame are stored by keypoint index.
+    int& last_frame_slot = last_frame_it->second[keys_[last_slot].keypoint_index];
+    CHECK_EQ(last_frame_slot, last_slot);
+    last_frame_slot = slot;
+
+    descriptors_.col(slot) = descriptors_.col(last_slot);
+    keys_[slot] = keys_[last_slot];
+  }
+  keys_.pop_back();
+}
+
+void BinaryDescriptorIndex::findWithinRadius(
+    const unsigned char* query, int radius, std::vector<Neighbor>* neighbors) const {
+  CHECK_NOTNULL(query);
+  CHECK_GE(radius, 0);
+  CHECK_NOTNULL(neighbors)->clear();
+
+  // A descriptor within the radius has a substring that is at most this many bits away from
+  // the substring of the query.
+  const int max_substring_radius = radius / static_cast<int>(hash_tables_.size());
+  std::unique_ptr<SearchBuffers> buffers = acquireSearchBuffers(getMaxNumSearchRounds());
+  const std::vector<int>& candidate_slots = buffers->candidate_slots;
+  const std::vector<int>& distances = buffers->distances;
+  size_t num_searched_slots = 0u;
+  for (int substring_radius = 0; substring_radius <= max_substring_radius &&
+       num_searched_slots < keys_.size(); ++substring_radius) {
+    searchBuckets(query, substring_radius, buffers.get(), &num_searched_slots);
+    for (size_t candidate = 0u; candidate < candidate_slots.size(); ++candidate) {
+      if (distances[candidate] <= radius) {
+        neighbors->push_back(Neighbor{keys_[candidate_slots[candidate]], distances[candidate]});
+      }
+    }
+  }
+  releaseSearchBuffers(std::move(buffers));
+  std::stable_sort(neighbors->begin(), neighbors->end(),
+                   [](const Neighbor& lhs, const Neighbor& rhs) {
+                     return lhs.distance < rhs.distance;
+                   });
+}
+
+void BinaryDescriptorIndex::findNearestNeighbors(
+    const unsigned char* query, int k, std::vector<Neighbor>* neighbors) const {
+  CHECK_NOTNULL(query);
+  CHECK_GT(k, 0);
+  CHECK_NOTNULL(neighbors)->clear();
+
+  std::vector<int> neighbor_slots(k);
+  std::vector<int> neighbor_distances(k);
+  common::resetHammingNeighbors(k, neighbor_slots.data(), neighbor_distances.data());
+
+  std::unique_ptr<SearchBuffers> buffers = acquireSearchBuffers(getMaxNumSearchRounds());
+  const std::vector<int>& candidate_slots = buffers->candidate_slots;
+  const std::vector<int>& distances = buffers->distances;
+  size_t num_searched_slots = 0u;
+  for (int substring_radius = 0; num_searched_slots < keys_.size(); ++substring_radius) {
+    searchBuckets(query, substring_radius, buffers.get(), &num_searched_slots);
+    for (size_t candidate = 0u; candidate < candidate_slots.size(); ++candidate) {
+      common::insertHammingNeighbor(candidate_slots[candidate], distances[candidate], k,
+                                    neighbor_slots.data(), neighbor_distances.data());
+    }
+
+    // All substrings of the descriptors not found yet are more than substring_radius bits away
+    // from the substrings of the query.
+    const int min_distance_not_searched =
+        static_cast<int>(hash_tables_.size()) * (substring_radius + 1);
+    if (neighbor_distances[k - 1] < min_distance_not_searched) {
+      break;
+    }
+  }
+  releaseSearchBuffers(std::move(buffers));
+
+  for (int neighbor = 0; neighbor < k; ++neighbor) {
+    if (neighbor_slots[neighbor] == common::kNoHammingNeighbor) {
+      break;
+    }
+    neighbors->push_back(Neighbor{keys_[neighbor_slots[neighbor]], neighbor_distances[neighbor]});
+  }
+}
+
+std::unique_ptr<BinaryDescriptorIndex::SearchBuffers>
+BinaryDescriptorIndex::acquireSearchBuffers(uint32_t max_num_rounds) const {
+  std::unique_ptr<SearchBuffers> buffers;
+  {
+    std::lock_guard<std::mutex> lock(search_buffers_mutex_);
+    if (!free_search_buffers_.empty()) {
+      buffers = std::move(free_search_buffers_.back());
+      free_search_buffers_.pop_back();
+    }
+  }
+  if (!buffers) {
+    buffers.reset(new SearchBuffers);
+  }
+
+  // Slots added since the buffers were last used were not searched by any round.
+  if (buffers->slot_rounds.size() < keys_.size()) {
+    buffers->slot_rounds.resize(keys_.size(), 0u);
+  }
+  // The rounds restart at 1 once they would overflow, which needs the only clear.
+  if (buffers->next_round > std::numeric_limits<uint32_t>::max() - max_num_rounds) {
+    std::fill(buffers->slot_rounds.begin(), buffers->slot_rounds.end(), 0u);
+    buffers->next_round = 1u;
+  }
+  buffers->first_round = buffers->next_round;
+  buffers->next_round += max_num_rounds;
+  return buffers;
+}
+
+void BinaryDescriptorIndex::releaseSearchBuffers(std::unique_ptr<SearchBuffers> buffers) const {
+  CHECK(buffers);
+  std::lock_guard<std::mutex> lock(search_buffers_mutex_);
+  free_search_buffers_.push_back(std::move(buffers));
+}
+
+uint32_t BinaryDescriptorIndex::getMaxNumSearchRounds() const {
+  // A search ends at the latest after the round of the radius of the largest substrings, by
+  // which every descriptor has been found in every table.
+  return 8u * static_cast<uint32_t>(substring_size_bytes_) + 1u;
+}
+
+void BinaryDescriptorIndex::searchBuckets(
+    const unsigned char* query, int substring_radius, SearchBuffers* buffers,
+    size_t* num_searched_slots) const {
+  CHECK_NOTNULL(buffers);
+  CHECK_NOTNULL(num_searched_slots);
+  CHECK_GE(buffers->slot_rounds.size(), keys_.size());
+  CHECK_LT(static_cast<uint32_t>(substring_radius), getMaxNumSearchRounds());
+  std::vector<uint32_t>& slot_rounds = buffers->slot_rounds;
+  std::vector<int>& candidate_slots = buffers->candidate_slots;
+  std::vector<int>& distances = buffers->distances;
+  candidate_slots.clear();
+  const uint32_t first_round = buffers->first_round;
+  const uint32_t round = first_round + static_cast<uint32_t>(substring_radius);
+
+  // A descriptor is found in every table where its substring is close enough, but it is
+  // verified only once. The buckets are not looked up if that costs more than verifying all
+  // remaining descriptors in one pass over the contiguous descriptors, e.g. if most buckets are
+  // empty or most descriptors are found. Relative to a descriptor of that pass, a bucket costs
+  // a cache miss and a candidate in a bucket the verification of a scattered descriptor.
+  const double kBucketCost = 16.0;
+  const double kCandidateCost = 2.0;
+  const double max_cost = static_cast<double>(keys_.size() - *num_searched_slots);
+  double expected_cost = 0.0;
+  for (size_t table_index = 0u; table_index < hash_tables_.size(); ++table_index) {
+    const int substring_size_bits = getSubstringSizeBits(table_index);
+    expected_cost += getNumBitPermutations(substring_size_bits, substring_radius) *
+        (kBucketCost + kCandidateCost * static_cast<double>(keys_.size()) /
+         (1u << substring_size_bits));
+  }
+  // The buckets can be fuller than expected, so the search falls back to the pass over all
+  // descriptors as soon as the buckets cost more.
+  bool is_searching_all = expected_cost > max_cost;
+  double cost = 0.0;
+  for (size_t table_index = 0u; table_index < hash_tables_.size() && !is_searching_all;
+       ++table_index) {
+    const int substring_size_bits = getSubstringSizeBits(table_index);
+    if (substring_radius > substring_size_bits) {
+      continue;
+    }
+    const HashTable& hash_table = hash_tables_[table_index];
+    const uint32_t query_substring = getSubstring(query, table_index);
+    // Enumerate all masks of substring_radius bits in increasing order, see
+    // https://graphics.stanford.edu/~seander/bithacks.html#NextBitPermutation.
+    const uint32_t end_mask = 1u << substring_size_bits;
+    uint32_t mask = (1u << substring_radius) - 1u;
+    while (mask < end_mask) {
+      const Bucket& bucket = hash_table[query_substring ^ mask];
+      cost += kBucketCost + kCandidateCost * bucket.size();
+      if (cost > max_cost) {
+        is_searching_all = true;
+        break;
+      }
+      for (const int slot : bucket) {
+        if (slot_rounds[slot] < first_round) {
+          slot_rounds[slot] = round;
+          candidate_slots.push_back(slot);
+        }
+      }
+      if (mask == 0u) {
+        break;
+      }
+      const uint32_t lowest_bit = mask & (~mask + 1u);
+      const uint32_t ripple = mask + lowest_bit;
+      mask = (((ripple ^ mask) >> 2) / lowest_bit) | ripple;
+    }
+  }
+
+  if (!is_searching_all) {
+    *num_searched_slots += candidate_slots.size();
+    distances.resize(candidate_slots.size());
+    common::computeHammingDistancesToQuery(query, descriptors_, candidate_slots.data(),
+                                           static_cast<int>(candidate_slots.size()),
+                                           distances.data());
+    return;
+  }
+
+  // Verify all descriptors and keep those not searched in an earlier round.
+  const int num_slots = static_cast<int>(keys_.size());
+  distances.resize(num_slots);
+  common::computeHammingDistancesToQuery(query, descriptors_, nullptr, num_slots,
+                                         distances.data());
+  candidate_slots.clear();
+  int num_candidates = 0;
+  for (int slot = 0; slot < num_slots; ++slot) {
+    if (slot_rounds[slot] < first_round || slot_rounds[slot] == round) {
+      slot_rounds[slot] = round;
+      candidate_slots.push_back(slot);
+      distances[num_candidates] = distances[slot];
+      ++num_candidates;
+    }
+  }
+  distances.resize(num_candidates);
+  *num_searched_slots = keys_.size();
+}
+
+uint32_t BinaryDescriptorIndex::getSubstring(
+    const unsigned char* descriptor, size_t table_index) const {
+  const size_t begin = table_index * substring_size_bytes_;
+  const size_t end = std::min(begin + substring_size_bytes_, descriptor_size_bytes_);
+  uint32_t substring = 0u;
+  for (size_t byte = begin; byte < end; ++byte) {
+    substring |= static_cast<uint32_t>(descriptor[byte]) << (8u * (byte - begin));
+  }
+  return substring;
+}
+
+int BinaryDescriptorIndex::getSubstringSizeBits(size_t table_index) const {
+  const size_t begin = table_index * substring_size_bytes_;
+  return static_cast<int>(
+      8u * (std::min(begin + substring_size_bytes_, descriptor_size_bytes_) - begin));
+}
+
+}  // namespace aslam
@@ -1,5 +1,6 @@
 #include "aslam/matcher/gyro-two-frame-matcher.h"
 
+#include <aslam/common/hamming-matrix.h>
 #include <aslam/common/statistics/statistics.h>
 #include <glog/logging.h>
 
@@ -54,54 +55,28 @@ GyroTwoFrameMatcher::GyroTwoFrameMatcher(
   CHECK_GT(large_search_distance_px_, 0);
   CHECK_GE(large_search_distance_px_, small_search_distance_px_);
 
-  descriptors_kp1_wrapped_.reserve(kNumPointsKp1);
-  keypoints_kp1_sorted_by_y_.reserve(kNumPointsKp1);
+  window_keypoints_kp1_.reserve(kNumPointsKp1);
+  candidate_channel_indices_kp1_.reserve(kNumPointsKp1);
+  candidate_distances_.reserve(kNumPointsKp1);
   descriptors_k_wrapped_.reserve(kNumPointsK);
   matches_kp1_k_->reserve(kNumPointsK);
-  corner_row_LUT_.reserve(kImageHeight);
 }
 
 void GyroTwoFrameMatcher::initialize() {
   // Prepare descriptors for efficient matching.
-  const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_kp1 =
-      frame_kp1_.getDescriptors();
   const Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic>& descriptors_k =
       frame_k_.getDescriptors();
 
-  for (int descriptor_kp1_idx = 0; descriptor_kp1_idx < kNumPointsKp1;
-      ++descriptor_kp1_idx) {
-    descriptors_kp1_wrapped_.emplace_back(
-        &(descriptors_kp1.coeffRef(0, descriptor_kp1_idx)), kDescriptorSizeBytes);
-  }
-
   for (int descriptor_k_idx = 0; descriptor_k_idx < kNumPointsK;
       ++descriptor_k_idx) {
     descriptors_k_wrapped_.emplace_back(
         &(descriptors_k.coeffRef(0, descriptor_k_idx)), kDescriptorSizeBytes);
   }
 
-  // Sort keypoints of frame (k+1) from small to large y coordinates.
-  for (int i = 0; i < kNumPointsKp1; ++i) {
-    keypoints_kp1_sorted_by_y_.emplace_back(frame_kp1_.getKeypointMeasurement(i), i);
-  }
-
-  std::sort(keypoints_kp1_sorted_by_y_.begin(), keypoints_kp1_sorted_by_y_.end(),
-            [](const KeypointData& lhs, const KeypointData& rhs)-> bool {
-              return lhs.measurement(1) < rhs.measurement(1);
-            });
-
-  // Lookup table construction.
-  // TODO(magehrig):  Sort by y if image height >= image width,
-  //                  otherwise sort by x.
-  int v = 0;
-  for (size_t y = 0u; y < kImageHeight; ++y) {
-    while (v < kNumPointsKp1 &&
-        y > static_cast<size_t>(keypoints_kp1_sorted_by_y_[v].measurement(1))) {
-      ++v;
-    }
-    corner_row_LUT_.push_back(v);
-  }
-  CHECK_EQ(corner_row_LUT_.size(), kImageHeight);
+  // Index the keypoints of frame (k+1) in cells of half the size of the small search window,
+  // such that the search windows overlap only a few cells.
+  keypoint_grid_kp1_.build(
+      frame_kp1_.getKeypointMeasurements(), small_search_distance_px_, nullptr);
 }
 
 void GyroTwoFrameMatcher::match() {
@@ -133,113 +108,69 @@ void GyroTwoFrameMatcher::matchKeypoint(const int idx_k) {
 
   bool found = false;
   bool passed_ratio_test = false;
-  int n_processed_corners = 0;
-  KeyPointIterator it_best;
+  int best_match_keypoint_idx_kp1 = -1;
   const static unsigned int kDescriptorSizeBits = 8 * kDescriptorSizeBytes;
-  int best_score = static_cast<int>(
+  const int score_threshold = static_cast<int>(
       kDescriptorSizeBits * kMatchingThresholdBitsRatioRelaxed);
-  unsigned int distance_best = kDescriptorSizeBits + 1;
-  unsigned int distance_second_best = kDescriptorSizeBits + 1;
-  const common::FeatureDescriptorConstRef& descriptor_k =
-      descriptors_k_wrapped_[idx_k];
+  const unsigned char* descriptor_k = descriptors_k_wrapped_[idx_k].data();
+
+  // The best and second best candidates for the ratio test, indexed into the candidates of
+  // both search windows.
+  int neighbor_candidate_indices[kNumNeighbors];
+  int neighbor_distances[kNumNeighbors];
+  common::resetHammingNeighbors(
+      kNumNeighbors, neighbor_candidate_indices, neighbor_distances);
+  candidate_channel_indices_kp1_.clear();
 
   Eigen::Vector2d predicted_keypoint_position_kp1 =
       predicted_keypoint_positions_kp1_.block<2, 1>(0, idx_k);
-  KeyPointIterator nearest_corners_begin, nearest_corners_end;
-  getKeypointIteratorsInWindow(
-      predicted_keypoint_position_kp1, small_search_distance_px_, &nearest_corners_begin, &nearest_corners_end);
-
-  const int bound_left_nearest =
-      predicted_keypoint_position_kp1(0) - small_search_distance_px_;
-  const int bound_right_nearest =
-      predicted_keypoint_position_kp1(0) + small_search_distance_px_;
+  getKeypointsInWindow(
+      predicted_keypoint_position_kp1, small_search_distance_px_, &window_keypoints_kp1_);
 
   MatchData current_match_data;
 
   // First search small window.
-  for (KeyPointIterator it = nearest_corners_begin; it != nearest_corners_end; ++it) {
-    if (it->measurement(0) < bound_left_nearest ||
-        it->measurement(0) > bound_right_nearest) {
-      continue;
-    }
-
-    CHECK_LT(it->channel_index, kNumPointsKp1);
-    CHECK_GE(it->channel_index, 0);
-    const common::FeatureDescriptorConstRef& descriptor_kp1 =
-        descriptors_kp1_wrapped_[it->channel_index];
-    unsigned int distance = common::GetNumBitsDifferent(descriptor_k, descriptor_kp1);
-    int current_score = kDescriptorSizeBits - distance;
-    if (current_score > best_score) {
-      best_score = current_score;
-      distance_second_best = distance_best;
-      distance_best = distance;
-      it_best = it;
-      found = true;
-    } else if (distance < distance_second_best) {
-      // The second best distance can also belong
-      // to two descriptors that do not qualify as match.
-      distance_second_best = distance;
-    }
-    iteration_processed_keypoints_kp1_[it->channel_index] = true;
-    ++n_processed_corners;
-    const double current_matching_score =
-        computeMatchingScore(current_score, kDescriptorSizeBits);
-    current_match_data.addCandidate(it, current_matching_score);
+  for (const int keypoint_idx_kp1 : window_keypoints_kp1_) {
+    CHECK_LT(keypoint_idx_kp1, kNumPointsKp1);
+    CHECK_GE(keypoint_idx_kp1, 0);
+    candidate_channel_indices_kp1_.push_back(keypoint_idx_kp1);
+    iteration_processed_keypoints_kp1_[keypoint_idx_kp1] = true;
   }
+  found = searchCandidates(descriptor_k, 0u, score_threshold, neighbor_candidate_indices,
+                           neighbor_distances, &current_match_data);
 
   // If no match in small window, increase window and search again.
   if (!found) {
-    const int bound_left_near =
-        predicted_keypoint_position_kp1(0) - large_search_distance_px_;
-    const int bound_right_near =
-        predicted_keypoint_position_kp1(0) + large_search_distance_px_;
-
-    KeyPointIterator near_corners_begin, near_corners_end;
-    getKeypointIteratorsInWindow(
-        predicted_keypoint_position_kp1, large_search_distance_px_, &near_corners_begin, &near_corners_end);
-
-    for (KeyPointIterator it = near_corners_begin; it != near_corners_end; ++it) {
-      if (iteration_processed_keypoints_kp1_[it->channel_index]) {
-        continue;
-      }
-      if (it->measurement(0) < bound_left_near ||
-          it->measurement(0) > bound_right_near) {
+    getKeypointsInWindow(
+        predicted_keypoint_position_kp1, large_search_distance_px_, &window_keypoints_kp1_);
+
+    const size_t num_nearest_candidates = candidate_channel_indices_kp1_.size();
+    for (const int keypoint_idx_kp1 : window_keypoints_kp1_) {
+      CHECK_LT(keypoint_idx_kp1, kNumPointsKp1);
+      CHECK_GE(keypoint_idx_kp1, 0);
+      if (iteration_processed_keypoints_kp1_[keypoint_idx_kp1]) {
         continue;
       }
-      CHECK_LT(it->channel_index, kNumPointsKp1);
-      CHECK_GE(it->channel_index, 0);
-      const common::FeatureDescriptorConstRef& descriptor_kp1 =
-          descriptors_kp1_wrapped_[it->channel_index];
-      unsigned int distance =
-          common::GetNumBitsDifferent(descriptor_k, descriptor_kp1);
-      int current_score = kDescriptorSizeBits - distance;
-      if (current_score > best_score) {
-        best_score = current_score;
-        distance_second_best = distance_best;
-        distance_best = distance;
-        it_best = it;
-        found = true;
-      } else if (distance < distance_second_best) {
-        // The second best distance can also belong
-        // to two descriptors that do not qualify as match.
-        distance_second_best = distance;
-      }
-      ++n_processed_corners;
-      const double current_matching_score =
-          computeMatchingScore(current_score, kDescriptorSizeBits);
-      current_match_data.addCandidate(it, current_matching_score);
+      candidate_channel_indices_kp1_.push_back(keypoint_idx_kp1);
     }
+    found = searchCandidates(descriptor_k, num_nearest_candidates, score_threshold,
+                             neighbor_candidate_indices, neighbor_distances,
+                             &current_match_data);
   }
 
+  const int n_processed_corners = static_cast<int>(candidate_channel_indices_kp1_.size());
+  int best_score = score_threshold;
   if (found) {
-    passed_ratio_test = ratioTest(kDescriptorSizeBits, distance_best,
-                                  distance_second_best);
+    best_match_keypoint_idx_kp1 = candidate_channel_indices_kp1_[neighbor_candidate_indices[0]];
+    best_score = static_cast<int>(kDescriptorSizeBits) - neighbor_distances[0];
+    // A missing second best candidate has a distance larger than the descriptor size.
+    passed_ratio_test = ratioTest(kDescriptorSizeBits, neighbor_distances[0],
+                                  neighbor_distances[1]);
   }
 
   if (passed_ratio_test) {
     CHECK(idx_k_to_attempted_match_data_map_.insert(
         std::make_pair(idx_k, current_match_data)).second);
-    const int best_match_keypoint_idx_kp1 = it_best->channel_index;
     const double matching_score = computeMatchingScore(
         best_score, kDescriptorSizeBits);
     if (is_keypoint_kp1_matched_[best_match_keypoint_idx_kp1]) {
@@ -284,6 +215,37 @@ void GyroTwoFrameMatcher::matchKeypoint(const int idx_k) {
   stats_count_processed.AddSample(n_processed_corners);
 }
 
+bool GyroTwoFrameMatcher::searchCandidates(
+    const unsigned char* descriptor_k, const size_t candidates_begin, const int score_threshold,
+    int* neighbor_candidate_indices, int* neighbor_distances, MatchData* match_data) {
+  CHECK_NOTNULL(descriptor_k);
+  CHECK_NOTNULL(neighbor_candidate_indices);
+  CHECK_NOTNULL(neighbor_distances);
+  CHECK_NOTNULL(match_data);
+  CHECK_LE(candidates_begin, candidate_channel_indices_kp1_.size());
+  const int num_candidates =
+      static_cast<int>(candidate_channel_indices_kp1_.size() - candidates_begin);
+  const unsigned int descriptor_size_bits = 8u * kDescriptorSizeBytes;
+
+  candidate_distances_.resize(num_candidates);
+  common::computeHammingDistancesToQuery(
+      descriptor_k, frame_kp1_.getDescriptors(),
+      candidate_channel_indices_kp1_.data() + candidates_begin, num_candidates,
+      candidate_distances_.data());
+  for (int i = 0; i < num_candidates; ++i) {
+    const int distance = candidate_distances_[i];
+    common::insertHammingNeighbor(
+        static_cast<int>(candidates_begin) + i, distance, kNumNeighbors,
+        neighbor_candidate_indices, neighbor_distances);
+    const int current_score = descriptor_size_bits - distance;
+    match_data->addCandidate(candidate_channel_indices_kp1_[candidates_begin + i],
+                             computeMatchingScore(current_score, descriptor_size_bits));
+  }
+  // The best candidate is a match if its score is above the threshold.
+  return neighbor_candidate_indices[0] != common::kNoHammingNeighbor &&
+      static_cast<int>(descriptor_size_bits) - neighbor_distances[0] > score_threshold;
+}
+
 bool GyroTwoFrameMatcher::matchInferiorMatches(
     std::vector<bool>* is_inferior_keypoint_kp1_matched) {
   CHECK_NOTNULL(is_inferior_keypoint_kp1_matched);
@@ -297,16 +259,16 @@ bool GyroTwoFrameMatcher::matchInferiorMatches(
         idx_k_to_attempted_match_data_map_[inferior_keypoint_idx_k];
     bool found = false;
     double best_matching_score = static_cast<double>(kMatchingThresholdBitsRatioStrict);
-    KeyPointIterator it_best;
+    int best_match_keypoint_idx_kp1 = -1;
 
     for (size_t i = 0u; i < match_data.keypoint_match_candidates_kp1.size(); ++i) {
-      const KeyPointIterator& keypoint_kp1 = match_data.keypoint_match_candidates_kp1[i];
+      const int keypoint_idx_kp1 = match_data.keypoint_match_candidates_kp1[i];
       const double matching_score = match_data.match_candidate_matching_scores[i];
       // Make sure that we don't try to match with already matched keypoints
       // of frame (k+1) (also previous inferior matches).
-      if (is_keypoint_kp1_matched_[keypoint_kp1->channel_index]) continue;
+      if (is_keypoint_kp1_matched_[keypoint_idx_kp1]) continue;
       if (matching_score > best_matching_score) {
-        it_best = keypoint_kp1;
+        best_match_keypoint_idx_kp1 = keypoint_idx_kp1;
         best_matching_score = matching_score;
         found = true;
       }
@@ -314,7 +276,6 @@ bool GyroTwoFrameMatcher::matchInferiorMatches(
 
     if (found) {
       found_inferior_match = true;
-      const int best_match_keypoint_idx_kp1 = it_best->channel_index;
       if ((*is_inferior_keypoint_kp1_matched)[best_match_keypoint_idx_kp1]) {
         if (best_matching_score > kp1_idx_to_matches_iterator_map_
             [best_match_keypoint_idx_kp1]->getScore()) {
@@ -0,0 +1,167 @@
+#include "aslam/matcher/keypoint-grid-index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace {
+/// The cells are enlarged if there would be more cells per keypoint, to bound the memory and
+/// the number of empty cells visited by the queries.
+constexpr int kMaxNumCellsPerKeypoint = 16;
+/// The cell ranges of the queries are widened by this fraction of a cell, such that rounding
+/// cannot exclude a keypoint on the border of a cell from a query.
+constexpr double kCellRangeMargin = 1e-6;
+}  // namespace
+
+KeypointGridIndex::KeypointGridIndex()
+  : origin_(Eigen::Vector2d::Zero()), cell_size_px_(1.0), inverse_cell_size_(1.0),
+    num_cells_x_(0), num_cells_y_(0), cell_offsets_(1u, 0) {}
+
+void KeypointGridIndex::build(const Eigen::Matrix2Xd& keypoints, double cell_size_px,
+                              const std::vector<bool>* is_keypoint_valid) {
+  CHECK_GT(cell_size_px, 0.0);
+  if (is_keypoint_valid != nullptr) {
+    CHECK_EQ(static_cast<int>(is_keypoint_valid->size()), keypoints.cols());
+  }
+
+  int num_keypoints = 0;
+  Eigen::Vector2d keypoints_min = Eigen::Vector2d::Constant(
+      std::numeric_limits<double>::max());
+  Eigen::Vector2d keypoints_max = -keypoints_min;
+  for (int i = 0; i < keypoints.cols(); ++i) {
+    if (is_keypoint_valid == nullptr || (*is_keypoint_valid)[i]) {
+      CHECK(keypoints.col(i).allFinite()) << "Keypoint " << i << " is not finite.";
+      keypoints_min = keypoints_min.cwiseMin(keypoints.col(i));
+      keypoints_max = keypoints_max.cwiseMax(keypoints.col(i));
+      ++num_keypoints;
+    }
+  }
+
+  cell_keypoint_indices_.resize(num_keypoints);
+  cell_keypoints_.resize(Eigen::NoChange, num_keypoints);
+  if (num_keypoints == 0) {
+    num_cells_x_ = 0;
+    num_cells_y_ = 0;
+    cell_offsets_.assign(1u, 0);
+    return;
+  }
+
+  // Grow the cells until there are not too many of them for the keypoints.
+  const Eigen::Vector2d extent = keypoints_max - keypoints_min;
+  const double max_num_cells = static_cast<double>(kMaxNumCellsPerKeypoint) * num_keypoints;
+  cell_size_px_ = cell_size_px;
+  while ((std::floor(extent(0) / cell_size_px_) + 1.0) *
+         (std::floor(extent(1) / cell_size_px_) + 1.0) > max_num_cells) {
+    cell_size_px_ *= 2.0;
+  }
+  inverse_cell_size_ = 1.0 / cell_size_px_;
+  origin_ = keypoints_min;
+  num_cells_x_ = static_cast<int>(extent(0) * inverse_cell_size_) + 1;
+  num_cells_y_ = static_cast<int>(extent(1) * inverse_cell_size_) + 1;
+
+  // Counting sort of the keypoints by cell: count the keypoints of every cell, accumulate the
+  // counts to the offsets of the cells and scatter the keypoints into their cells.
+  std::vector<int> keypoint_cells(keypoints.cols(), -1);
+  cell_offsets_.assign(getNumCells() + 1, 0);
+  for (int i = 0; i < keypoints.cols(); ++i) {
+    if (is_keypoint_valid == nullptr || (*is_keypoint_valid)[i]) {
+      const int cell_x = std::min(static_cast<int>(
+          (keypoints(0, i) - origin_(0)) * inverse_cell_size_), num_cells_x_ - 1);
+      const int cell_y = std::min(static_cast<int>(
+          (keypoints(1, i) - origin_(1)) * inverse_cell_size_), num_cells_y_ - 1);
+      keypoint_cells[i] = cell_y * num_cells_x_ + cell_x;
+      ++cell_offsets_[keypoint_cells[i] + 1];
+    }
+  }
+  for (size_t cell = 1u; cell < cell_offsets_.size(); ++cell) {
+    cell_offsets_[cell] += cell_offsets_[cell - 1u];
+  }
+  std::vector<int> cell_ends(cell_offsets_.begin(), cell_offsets_.end() - 1);
+  for (int i = 0; i < keypoints.cols(); ++i) {
+    if (keypoint_cells[i] >= 0) {
+      const int position = cell_ends[keypoint_cells[i]]++;
+      cell_keypoint_indices_[position] = i;
+      cell_keypoints_.col(position) = keypoints.col(i);
+    }
+  }
+}
+
+void KeypointGridIndex::getKeypointsInRadius(
+    const Eigen::Vector2d& center, double radius_px, std::vector<int>* keypoint_indices) const {
+  CHECK_NOTNULL(keypoint_indices)->clear();
+  CHECK_GE(radius_px, 0.0);
+  int cell_y_begin, cell_y_end;
+  if (!getCellRange(center(1) - radius_px, center(1) + radius_px, origin_(1), num_cells_y_,
+                    &cell_y_begin, &cell_y_end)) {
+    return;
+  }
+
+  const double squared_radius = radius_px * radius_px;
+  for (int cell_y = cell_y_begin; cell_y < cell_y_end; ++cell_y) {
+    // The circle is widest in a row of cells where the row is closest to the center.
+    const double row_min = origin_(1) + cell_y * cell_size_px_;
+    const double row_max = row_min + cell_size_px_;
+    const double distance_y = std::max(0.0, std::max(row_min - center(1), center(1) - row_max));
+    const double half_width = std::sqrt(std::max(0.0, squared_radius - distance_y * distance_y));
+    int cell_x_begin, cell_x_end;
+    if (!getCellRange(center(0) - half_width, center(0) + half_width, origin_(0), num_cells_x_,
+                      &cell_x_begin, &cell_x_end)) {
+      continue;
+    }
+
+    // The cells of a row are contiguous.
+    const int row_begin = cell_offsets_[cell_y * num_cells_x_ + cell_x_begin];
+    const int row_end = cell_offsets_[cell_y * num_cells_x_ + cell_x_end];
+    for (int position = row_begin; position < row_end; ++position) {
+      if ((cell_keypoints_.col(position) - center).squaredNorm() < squared_radius) {
+        keypoint_indices->push_back(cell_keypoint_indices_[position]);
+      }
+    }
+  }
+}
+
+void KeypointGridIndex::getKeypointsInWindow(
+    const Eigen::Vector2d& window_min, const Eigen::Vector2d& window_max,
+    std::vector<int>* keypoint_indices) const {
+  CHECK_NOTNULL(keypoint_indices)->clear();
+  CHECK_LE(window_min(0), window_max(0));
+  CHECK_LE(window_min(1), window_max(1));
+  int cell_x_begin, cell_x_end, cell_y_begin, cell_y_end;
+  if (!getCellRange(window_min(0), window_max(0), origin_(0), num_cells_x_,
+                    &cell_x_begin, &cell_x_end) ||
+      !getCellRange(window_min(1), window_max(1), origin_(1), num_cells_y_,
+                    &cell_y_begin, &cell_y_end)) {
+    return;
+  }
+
+  for (int cell_y = cell_y_begin; cell_y < cell_y_end; ++cell_y) {
+    const int row_begin = cell_offsets_[cell_y * num_cells_x_ + cell_x_begin];
+    const int row_end = cell_offsets_[cell_y * num_cells_x_ + cell_x_end];
+    for (int position = row_begin; position < row_end; ++position) {
+      const Eigen::Vector2d& keypoint = cell_keypoints_.col(position);
+      if (keypoint(0) >= window_min(0) && keypoint(0) <= window_max(0) &&
+          keypoint(1) >= window_min(1) && keypoint(1) <= window_max(1)) {
+        keypoint_indices->push_back(cell_keypoint_indices_[position]);
+      }
+    }
+  }
+}
+
+bool KeypointGridIndex::getCellRange(double min, double max, double origin, int num_cells,
+                                     int* cell_begin, int* cell_end) const {
+  CHECK_NOTNULL(cell_begin);
+  CHECK_NOTNULL(cell_end);
+  const double first_cell = std::floor((min - origin) * inverse_cell_size_ - kCellRangeMargin);
+  const double last_cell = std::floor((max - origin) * inverse_cell_size_ + kCellRangeMargin);
+  if (num_cells == 0 || last_cell < 0.0 || first_cell >= num_cells) {
+    return false;
+  }
+  *cell_begin = static_cast<int>(std::max(first_cell, 0.0));
+  *cell_end = static_cast<int>(std::min(last_cell, num_cells - 1.0)) + 1;
+  return true;
+}
+
+}  // namespace aslam
@@ -0,0 +1,418 @@
+#include "aslam/matcher/vocabulary-tree.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <string>
+
+#include <aslam/common/descriptor-utils.h>
+#include <aslam/common/yaml-serialization.h>
+
+namespace aslam {
+namespace {
+constexpr const char kYamlFieldNameDescriptorSizeBytes[] = "descriptor_size_bytes";
+constexpr const char kYamlFieldNameNodeCenters[] = "node_centers";
+constexpr const char kYamlFieldNameNodeNumChildren[] = "node_num_children";
+constexpr const char kYamlFieldNameWordWeights[] = "word_weights";
+
+std::string toHexString(const unsigned char* data, size_t num_bytes) {
+  static const char kHexDigits[] = "0123456789abcdef";
+  std::string hex_string(2u * num_bytes, '0');
+  for (size_t byte = 0u; byte < num_bytes; ++byte) {
+    hex_string[2u * byte] = kHexDigits[data[byte] >> 4];
+    hex_string[2u * byte + 1u] = kHexDigits[data[byte] & 0xf];
+  }
+  return hex_string;
+}
+
+bool fromHexString(const std::string& hex_string, size_t num_bytes, unsigned char* data) {
+  if (hex_string.size() != 2u * num_bytes) {
+    return false;
+  }
+  for (size_t byte = 0u; byte < num_bytes; ++byte) {
+    const std::string hex_byte = hex_string.substr(2u * byte, 2u);
+    if (!std::isxdigit(static_cast<unsigned char>(hex_byte[0])) ||
+        !std::isxdigit(static_cast<unsigned char>(hex_byte[1]))) {
+      return false;
+    }
+    data[byte] = static_cast<unsigned char>(std::stoul(hex_byte, nullptr, 16));
+  }
+  return true;
+}
+}  // namespace
+
+constexpr VocabularyTree::WordId VocabularyTree::kNoWord;
+
+VocabularyTree::VocabularyTree() : descriptor_size_bytes_(0u) {
+  clear();
+}
+
+void VocabularyTree::clear() {
+  node_centers_.setZero(descriptor_size_bytes_, 1);
+  node_children_.clear();
+  node_words_.assign(1u, kNoWord);
+  word_weights_.clear();
+}
+
+void VocabularyTree::train(
+    const std::vector<DescriptorsT>& frame_descriptors, const Options& options) {
+  CHECK(!frame_descriptors.empty());
+  CHECK_GE(options.branching_factor, 2u);
+  CHECK_GE(options.num_levels, 1u);
+  descriptor_size_bytes_ = frame_descriptors.front().rows();
+  CHECK_GT(descriptor_size_bytes_, 0u);
+  int num_descriptors = 0;
+  for (const DescriptorsT& descriptors : frame_descriptors) {
+    CHECK_EQ(static_cast<size_t>(descriptors.rows()), descriptor_size_bytes_);
+    num_descriptors += descriptors.cols();
+  }
+  CHECK_GT(num_descriptors, 0);
+  DescriptorsT training_descriptors(descriptor_size_bytes_, num_descriptors);
+  int column = 0;
+  for (const DescriptorsT& descriptors : frame_descriptors) {
+    training_descriptors.middleCols(column, descriptors.cols()) = descriptors;
+    column += descriptors.cols();
+  }
+
+  clear();
+  std::mt19937 random_engine(options.random_seed);
+
+  // The nodes are clustered in breadth-first order, so the children of every node get the next
+  // node ids. The training descriptors of a node are kept until it is clustered.
+  std::vector<std::vector<int>> node_descriptors(1u);
+  node_descriptors[0].resize(num_descriptors);
+  std::iota(node_descriptors[0].begin(), node_descriptors[0].end(), 0);
+  std::vector<size_t> node_levels(1u, 0u);
+  std::vector<unsigned char> node_center_bytes(descriptor_size_bytes_, 0u);
+  DescriptorsT descriptors;
+  DescriptorsT centers;
+  std::vector<std::vector<int>> cluster_descriptors;
+  for (size_t node = 0u; node < node_descriptors.size(); ++node) {
+    std::vector<int> descriptor_indices;
+    descriptor_indices.swap(node_descriptors[node]);
+    if (node_levels[node] < options.num_levels && descriptor_indices.size() > 1u) {
+      descriptors.resize(descriptor_size_bytes_, descriptor_indices.size());
+      for (size_t i = 0u; i < descriptor_indices.size(); ++i) {
+        descriptors.col(i) = training_descriptors.col(descriptor_indices[i]);
+      }
+      clusterDescriptors(descriptors, options, &random_engine, &centers, &cluster_descriptors);
+
+      // A node whose descriptors are all equal stays a leaf.
+      if (cluster_descriptors.size() > 1u) {
+        for (size_t cluster = 0u; cluster < cluster_descriptors.size(); ++cluster) {
+          node_children_.indices.push_back(static_cast<int>(node_descriptors.size()));
+          node_center_bytes.insert(node_center_bytes.end(), centers.col(cluster).data(),
+                                   centers.col(cluster).data() + descriptor_size_bytes_);
+          node_descriptors.emplace_back();
+          std::vector<int>& child_descriptors = node_descriptors.back();
+          child_descriptors.reserve(cluster_descriptors[cluster].size());
+          for (const int i : cluster_descriptors[cluster]) {
+            child_descriptors.push_back(descriptor_indices[i]);
+          }
+          node_levels.push_back(node_levels[node] + 1u);
+        }
+      }
+    }
+    node_children_.finishQuery();
+  }
+  node_centers_ = Eigen::Map<const DescriptorsT>(
+      node_center_bytes.data(), descriptor_size_bytes_, node_descriptors.size());
+  word_weights_.assign(setNodeWords(), 0.0);
+
+  // The inverse document frequency of a word is the log of the inverse fraction of the
+  // training frames containing it.
+  std::vector<int> num_frames_with_word(word_weights_.size(), 0);
+  std::vector<WordId> words;
+  for (const DescriptorsT& frame : frame_descriptors) {
+    getWords(frame, &words);
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    for (const WordId word : words) {
+      ++num_frames_with_word[word];
+    }
+  }
+  const double num_frames = static_cast<double>(frame_descriptors.size());
+  for (size_t word = 0u; word < word_weights_.size(); ++word) {
+    word_weights_[word] = std::log(num_frames / std::max(num_frames_with_word[word], 1));
+  }
+  VLOG(1) << "Trained a vocabulary of " << word_weights_.size() << " words from "
+          << num_descriptors << " descriptors in " << frame_descriptors.size() << " frames.";
+}
+
+void VocabularyTree::clusterDescriptors(
+    const DescriptorsT& descriptors, const Options& options, std::mt19937* random_engine,
+    DescriptorsT* centers, std::vector<std::vector<int>>* cluster_descriptors) const {
+  CHECK_NOTNULL(random_engine);
+  CHECK_NOTNULL(centers);
+  CHECK_NOTNULL(cluster_descriptors)->clear();
+  const int num_descriptors = static_cast<int>(descriptors.cols());
+  CHECK_GT(num_descriptors, 0);
+
+  // k-means++ seeding: the first center is a random descriptor, every next one is drawn with a
+  // probability proportional to the distance of a descriptor to its nearest center so far.
+  std::vector<int> seed_columns(
+      1u, std::uniform_int_distribution<int>(0, num_descriptors - 1)(*random_engine));
+  std::vector<int> min_distances(num_descriptors);
+  std::vector<int> distances(num_descriptors);
+  common::computeHammingDistancesToQuery(&descriptors.coeffRef(0, seed_columns.back()),
+                                         descriptors, nullptr, num_descriptors,
+                                         min_distances.data());
+  while (seed_columns.size() < options.branching_factor) {
+    const int64_t sum_of_distances =
+        std::accumulate(min_distances.begin(), min_distances.end(), static_cast<int64_t>(0));
+    if (sum_of_distances == 0) {
+      // All descriptors are equal to a center.
+      break;
+    }
+    int64_t drawn_distance =
+        std::uniform_int_distribution<int64_t>(0, sum_of_distances - 1)(*random_engine);
+    int seed_column = 0;
+    while (drawn_distance >= min_distances[seed_column]) {
+      drawn_distance -= min_distances[seed_column];
+      ++seed_column;
+    }
+    seed_columns.push_back(seed_column);
+    common::computeHammingDistancesToQuery(&descriptors.coeffRef(0, seed_column), descriptors,
+                                           nullptr, num_descriptors, distances.data());
+    for (int i = 0; i < num_descriptors; ++i) {
+      min_distances[i] = std::min(min_distances[i], distances[i]);
+    }
+  }
+  const int num_centers = static_cast<int>(seed_columns.size());
+  centers->resize(descriptor_size_bytes_, num_centers);
+  for (int center = 0; center < num_centers; ++center) {
+    centers->col(center) = descriptors.col(seed_columns[center]);
+  }
+
+  // Lloyd iterations, the centers are the bitwise majority of their descriptors. An empty
+  // cluster keeps its center. The last assignment is to the final centers.
+  Eigen::MatrixXi nearest_centers;
+  Eigen::MatrixXi nearest_center_distances;
+  std::vector<int> assignments(num_descriptors, -1);
+  std::vector<std::vector<int>> clusters(num_centers);
+  DescriptorsT cluster;
+  common::descriptor_utils::DescriptorType center;
+  for (size_t iteration = 0u; ; ++iteration) {
+    common::findNearestHammingNeighbors(descriptors, *centers, 1, &nearest_centers,
+                                        &nearest_center_distances);
+    bool is_assignment_changed = false;
+    for (int i = 0; i < num_descriptors; ++i) {
+      is_assignment_changed |= assignments[i] != nearest_centers(0, i);
+      assignments[i] = nearest_centers(0, i);
+    }
+    for (std::vector<int>& cluster_columns : clusters) {
+      cluster_columns.clear();
+    }
+    for (int i = 0; i < num_descriptors; ++i) {
+      clusters[assignments[i]].push_back(i);
+    }
+    if (!is_assignment_changed || iteration == options.max_num_iterations) {
+      break;
+    }
+
+    for (int center_index = 0; center_index < num_centers; ++center_index) {
+      const std::vector<int>& cluster_columns = clusters[center_index];
+      if (cluster_columns.empty()) {
+        continue;
+      }
+      cluster.resize(descriptor_size_bytes_, cluster_columns.size());
+      for (size_t i = 0u; i < cluster_columns.size(); ++i) {
+        cluster.col(i) = descriptors.col(cluster_columns[i]);
+      }
+      common::descriptor_utils::descriptorMeanRoundedToBinaryValue(cluster, &center);
+      centers->col(center_index) = center;
+    }
+  }
+
+  // Only the non-empty clusters become children.
+  int num_clusters = 0;
+  for (int center_index = 0; center_index < num_centers; ++center_index) {
+    if (clusters[center_index].empty()) {
+      continue;
+    }
+    centers->col(num_clusters) = centers->col(center_index);
+    cluster_descriptors->push_back(std::move(clusters[center_index]));
+    ++num_clusters;
+  }
+  centers->conservativeResize(Eigen::NoChange, num_clusters);
+}
+
+size_t VocabularyTree::setNodeWords() {
+  const int num_nodes = node_children_.getNumQueries();
+  CHECK_EQ(static_cast<int>(node_centers_.cols()), num_nodes);
+  node_words_.assign(num_nodes, kNoWord);
+  WordId num_words = 0;
+  for (int node = 0; node < num_nodes; ++node) {
+    if (node_children_.offsets[node + 1] == node_children_.offsets[node]) {
+      node_words_[node] = num_words;
+      ++num_words;
+    }
+  }
+  return static_cast<size_t>(num_words);
+}
+
+VocabularyTree::WordId VocabularyTree::getWord(const unsigned char* descriptor) const {
+  CHECK_NOTNULL(descriptor);
+  CHECK(isTrained());
+  int node = 0;
+  while (node_words_[node] == kNoWord) {
+    const int children_begin = node_children_.offsets[node];
+    int nearest_child;
+    int nearest_child_distance;
+    common::resetHammingNeighbors(1, &nearest_child, &nearest_child_distance);
+    common::updateNearestHammingNeighbors(
+        descriptor, node_centers_, &node_children_.indices[children_begin],
+        node_children_.offsets[node + 1] - children_begin, 1, &nearest_child,
+        &nearest_child_distance);
+    node = nearest_child;
+  }
+  return node_words_[node];
+}
+
+void VocabularyTree::getWords(const DescriptorsT& descriptors, std::vector<WordId>* words) const {
+  CHECK_NOTNULL(words);
+  CHECK_EQ(static_cast<size_t>(descriptors.rows()), descriptor_size_bytes_);
+  words->resize(descriptors.cols());
+  for (int i = 0; i < descriptors.cols(); ++i) {
+    (*words)[i] = getWord(&descriptors.coeffRef(0, i));
+  }
+}
+
+void VocabularyTree::getBagOfWords(
+    const DescriptorsT& descriptors, BagOfWords* bag_of_words) const {
+  CHECK_NOTNULL(bag_of_words)->clear();
+  std::vector<WordId> words;
+  getWords(descriptors, &words);
+  std::sort(words.begin(), words.end());
+
+  // The term frequency times the inverse document frequency. The normalization divides by the
+  // number of descriptors of the term frequency as well.
+  double sum_of_weights = 0.0;
+  for (size_t begin = 0u; begin < words.size(); ) {
+    size_t end = begin + 1u;
+    while (end < words.size() && words[end] == words[begin]) {
+      ++end;
+    }
+    const double weight = (end - begin) * word_weights_[words[begin]];
+    if (weight > 0.0) {
+      bag_of_words->emplace_back(words[begin], weight);
+      sum_of_weights += weight;
+    }
+    begin = end;
+  }
+  for (std::pair<WordId, double>& word_weight : *bag_of_words) {
+    word_weight.second /= sum_of_weights;
+  }
+}
+
+double VocabularyTree::getSimilarity(
+    const BagOfWords& bag_of_words_a, const BagOfWords& bag_of_words_b) {
+  // For two vectors with unit L1 norm, 1 - |a - b|_1 / 2 is the sum of min(a_i, b_i), which is
+  // non-zero only for the words in both.
+  double similarity = 0.0;
+  BagOfWords::const_iterator it_a = bag_of_words_a.begin();
+  BagOfWords::const_iterator it_b = bag_of_words_b.begin();
+  while (it_a != bag_of_words_a.end() && it_b != bag_of_words_b.end()) {
+    if (it_a->first < it_b->first) {
+      ++it_a;
+    } else if (it_b->first < it_a->first) {
+      ++it_b;
+    } else {
+      similarity += std::min(it_a->second, it_b->second);
+      ++it_a;
+      ++it_b;
+    }
+  }
+  return similarity;
+}
+
+void VocabularyTree::serialize(YAML::Node* yaml_node) const {
+  YAML::Node& node = *CHECK_NOTNULL(yaml_node);
+  CHECK(isTrained());
+  node[static_cast<std::string>(kYamlFieldNameDescriptorSizeBytes)] = descriptor_size_bytes_;
+  YAML::Node centers_node;
+  YAML::Node num_children_node;
+  for (size_t tree_node = 0u; tree_node < getNumNodes(); ++tree_node) {
+    centers_node.push_back(
+        toHexString(&node_centers_.coeffRef(0, tree_node), descriptor_size_bytes_));
+    num_children_node.push_back(
+        node_children_.offsets[tree_node + 1u] - node_children_.offsets[tree_node]);
+  }
+  node[static_cast<std::string>(kYamlFieldNameNodeCenters)] = centers_node;
+  node[static_cast<std::string>(kYamlFieldNameNodeNumChildren)] = num_children_node;
+  node[static_cast<std::string>(kYamlFieldNameWordWeights)] = word_weights_;
+}
+
+bool VocabularyTree::deserialize(const YAML::Node& yaml_node) {
+  size_t descriptor_size_bytes;
+  std::vector<std::string> node_centers;
+  std::vector<int> node_num_children;
+  std::vector<double> word_weights;
+  if (!YAML::safeGet(yaml_node, static_cast<std::string>(kYamlFieldNameDescriptorSizeBytes),
+                     &descriptor_size_bytes) ||
+      !YAML::safeGet(yaml_node, static_cast<std::string>(kYamlFieldNameNodeCenters),
+                     &node_centers) ||
+      !YAML::safeGet(yaml_node, static_cast<std::string>(kYamlFieldNameNodeNumChildren),
+                     &node_num_children) ||
+      !YAML::safeGet(yaml_node, static_cast<std::string>(kYamlFieldNameWordWeights),
+                     &word_weights)) {
+    LOG(ERROR) << "Unable to retrieve the vocabulary from the YAML node.";
+    return false;
+  }
+
+  // The children of the nodes are the next nodes in breadth-first order.
+  const size_t num_nodes = node_centers.size();
+  if (descriptor_size_bytes == 0u || num_nodes == 0u ||
+      node_num_children.size() != num_nodes) {
+    LOG(ERROR) << "The vocabulary has " << num_nodes << " node centers of "
+               << descriptor_size_bytes << " bytes and " << node_num_children.size()
+               << " numbers of children.";
+    return false;
+  }
+  size_t num_leaves = 0u;
+  size_t num_children = 0u;
+  for (size_t node = 0u; node < num_nodes; ++node) {
+    if (node_num_children[node] < 0 ||
+        (node_num_children[node] > 0 && num_children + 1u <= node)) {
+      LOG(ERROR) << "The children of node " << node << " are not in breadth-first order.";
+      return false;
+    }
+    num_children += node_num_children[node];
+    num_leaves += node_num_children[node] == 0 ? 1u : 0u;
+  }
+  if (num_children + 1u != num_nodes || num_leaves != word_weights.size()) {
+    LOG(ERROR) << "The vocabulary has " << num_nodes << " nodes, " << num_children
+               << " children, " << num_leaves << " leaves and " << word_weights.size()
+               << " word weights.";
+    return false;
+  }
+
+  DescriptorsT centers(descriptor_size_bytes, num_nodes);
+  for (size_t node = 0u; node < num_nodes; ++node) {
+    if (!fromHexString(node_centers[node], descriptor_size_bytes,
+                       &centers.coeffRef(0, node))) {
+      LOG(ERROR) << "The center of node " << node << " is not a hex string of "
+                 << descriptor_size_bytes << " bytes.";
+      return false;
+    }
+  }
+
+  descriptor_size_bytes_ = descriptor_size_bytes;
+  clear();
+  node_centers_.swap(centers);
+  int next_child = 1;
+  for (size_t node = 0u; node < num_nodes; ++node) {
+    for (int child = 0; child < node_num_children[node]; ++child) {
+      node_children_.indices.push_back(next_child);
+      ++next_child;
+    }
+    node_children_.finishQuery();
+  }
+  CHECK_EQ(setNodeWords(), word_weights.size());
+  word_weights_.swap(word_weights);
+  return true;
+}
+
+}  // namespace aslam
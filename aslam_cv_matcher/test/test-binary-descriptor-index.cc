@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/memory.h>
+#include <aslam/common/unique-id.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/matcher/binary-descriptor-index.h>
+
+namespace aslam {
+
+constexpr int kDescriptorSizeBytes = 48;
+constexpr int kNumFrames = 8;
+constexpr int kNumDescriptorsPerFrame = 500;
+
+class BinaryDescriptorIndexTest : public ::testing::TestWithParam<size_t> {
+ protected:
+  typedef BinaryDescriptorIndex::DescriptorsT DescriptorsT;
+
+  virtual void SetUp() {
+    std::srand(7);
+    BinaryDescriptorIndex::Options options;
+    options.substring_size_bytes = GetParam();
+    index_ = aligned_unique<BinaryDescriptorIndex>(kDescriptorSizeBytes, options);
+
+    for (int frame_index = 0; frame_index < kNumFrames; ++frame_index) {
+      FrameId frame_id;
+      generateId(&frame_id);
+      DescriptorsT descriptors(kDescriptorSizeBytes, kNumDescriptorsPerFrame);
+      descriptors.setRandom();
+      frames_.emplace_back(frame_id, descriptors);
+      if (frame_index == 0) {
+        VisualFrame frame;
+        frame.setId(frame_id);
+        frame.setDescriptors(descriptors);
+        index_->addFrame(frame);
+      } else {
+        index_->addDescriptors(frame_id, descriptors);
+      }
+    }
+  }
+
+  /// A query close to a random descriptor of the given frame, with up to max_flipped_bits
+  /// flipped bits.
+  DescriptorsT createQuery(int frame_index, int max_flipped_bits) const {
+    DescriptorsT query =
+        frames_[frame_index].second.col(std::rand() % kNumDescriptorsPerFrame);
+    const int num_flipped_bits = std::rand() % (max_flipped_bits + 1);
+    for (int bit = 0; bit < num_flipped_bits; ++bit) {
+      const int flipped_bit = std::rand() % (8 * kDescriptorSizeBytes);
+      query(flipped_bit / 8, 0) ^= static_cast<unsigned char>(1u << (flipped_bit % 8));
+    }
+    return query;
+  }
+
+  /// The distances of the query to all descriptors in the index, sorted.
+  std::vector<std::pair<int, std::pair<size_t, size_t>>> searchLinearly(
+      const DescriptorsT& query) const {
+    std::vector<std::pair<int, std::pair<size_t, size_t>>> distances;
+    for (size_t frame_index = 0u; frame_index < frames_.size(); ++frame_index) {
+      const DescriptorsT& descriptors = frames_[frame_index].second;
+      for (int keypoint_index = 0; keypoint_index < descriptors.cols(); ++keypoint_index) {
+        int distance = 0;
+        for (int byte = 0; byte < kDescriptorSizeBytes; ++byte) {
+          distance += __builtin_popcount(query(byte, 0) ^ descriptors(byte, keypoint_index));
+        }
+        distances.emplace_back(distance, std::make_pair(frame_index, keypoint_index));
+      }
+    }
+    std::sort(distances.begin(), distances.end());
+    return distances;
+  }
+
+  /// The index of a frame in frames_ and the keypoint index of a descriptor key.
+  std::pair<size_t, size_t> getFrameAndKeypointIndex(
+      const BinaryDescriptorIndex::DescriptorKey& key) const {
+    for (size_t frame_index = 0u; frame_index < frames_.size(); ++frame_index) {
+      if (frames_[frame_index].first == key.frame_id) {
+        return std::make_pair(frame_index, key.keypoint_index);
+      }
+    }
+    ADD_FAILURE() << "The frame " << key.frame_id << " is not in the test.";
+    return std::make_pair(frames_.size(), key.keypoint_index);
+  }
+
+  void expectEqualToLinearSearch(const DescriptorsT& query) const {
+    const std::vector<std::pair<int, std::pair<size_t, size_t>>> linear_distances =
+        searchLinearly(query);
+
+    // The neighbors can differ between equally near descriptors, their distances not.
+    const int kNumNeighbors = 5;
+    std::vector<BinaryDescriptorIndex::Neighbor> neighbors;
+    index_->findNearestNeighbors(query.data(), kNumNeighbors, &neighbors);
+    ASSERT_EQ(static_cast<size_t>(kNumNeighbors), neighbors.size());
+    for (int neighbor = 0; neighbor < kNumNeighbors; ++neighbor) {
+      EXPECT_EQ(linear_distances[neighbor].first, neighbors[neighbor].distance);
+      const std::pair<size_t, size_t> frame_and_keypoint_index =
+          getFrameAndKeypointIndex(neighbors[neighbor].key);
+      EXPECT_EQ(
+          neighbors[neighbor].distance,
+          std::find_if(linear_distances.begin(), linear_distances.end(),
+                       [&](const std::pair<int, std::pair<size_t, size_t>>& distance) {
+                         return distance.second == frame_and_keypoint_index;
+                       })->first);
+    }
+
+    const int kRadius = 120;
+    index_->findWithinRadius(query.data(), kRadius, &neighbors);
+    std::vector<std::pair<int, std::pair<size_t, size_t>>> radius_distances;
+    for (const BinaryDescriptorIndex::Neighbor& neighbor : neighbors) {
+      radius_distances.emplace_back(neighbor.distance, getFrameAndKeypointIndex(neighbor.key));
+    }
+    EXPECT_TRUE(std::is_sorted(radius_distances.begin(), radius_distances.end(),
+                               [](const std::pair<int, std::pair<size_t, size_t>>& lhs,
+                                  const std::pair<int, std::pair<size_t, size_t>>& rhs) {
+                                 return lhs.first < rhs.first;
+                               }));
+    std::sort(radius_distances.begin(), radius_distances.end());
+    std::vector<std::pair<int, std::pair<size_t, size_t>>> expected_radius_distances;
+    for (const std::pair<int, std::pair<size_t, size_t>>& distance : linear_distances) {
+      if (distance.first <= kRadius) {
+        expected_radius_distances.push_back(distance);
+      }
+    }
+    EXPECT_EQ(expected_radius_distances, radius_distances);
+  }
+
+  std::vector<std::pair<FrameId, DescriptorsT>> frames_;
+  BinaryDescriptorIndex::UniquePtr index_;
+};
+
+TEST_P(BinaryDescriptorIndexTest, MatchesLinearSearch) {
+  EXPECT_EQ(static_cast<size_t>(kNumFrames), index_->getNumFrames());
+  EXPECT_EQ(static_cast<size_t>(kNumFrames * kNumDescriptorsPerFrame),
+            index_->getNumDescriptors());
+  for (int query_index = 0; query_index < 40; ++query_index) {
+    // Queries near a descriptor of the index and far from all of them.
+    expectEqualToLinearSearch(createQuery(query_index % kNumFrames, 100));
+    DescriptorsT random_query(kDescriptorSizeBytes, 1);
+    random_query.setRandom();
+    expectEqualToLinearSearch(random_query);
+  }
+}
+
+TEST_P(BinaryDescriptorIndexTest, ParallelQueriesMatchLinearSearch) {
+  // The queries share the search buffers of the index, which must not mix them up.
+  std::vector<DescriptorsT> queries;
+  for (int query_index = 0; query_index < 16; ++query_index) {
+    queries.push_back(createQuery(query_index % kNumFrames, 60));
+  }
+  std::vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < 4; ++thread_index) {
+    threads.emplace_back([this, &queries]() {
+      for (const DescriptorsT& query : queries) {
+        expectEqualToLinearSearch(query);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST_P(BinaryDescriptorIndexTest, RemovesAndAddsFrames) {
+  const FrameId removed_frame_id = frames_[1].first;
+  EXPECT_TRUE(index_->removeFrame(removed_frame_id));
+  EXPECT_FALSE(index_->removeFrame(removed_frame_id));
+  frames_.erase(frames_.begin() + 1);
+  EXPECT_EQ(static_cast<size_t>(kNumFrames - 1), index_->getNumFrames());
+  EXPECT_EQ(static_cast<size_t>((kNumFrames - 1) * kNumDescriptorsPerFrame),
+            index_->getNumDescriptors());
+  for (int query_index = 0; query_index < 20; ++query_index) {
+    expectEqualToLinearSearch(createQuery(query_index % (kNumFrames - 1), 30));
+  }
+
+  FrameId added_frame_id;
+  generateId(&added_frame_id);
+  DescriptorsT descriptors(kDescriptorSizeBytes, 17);
+  descriptors.setRandom();
+  frames_.emplace_back(added_frame_id, descriptors);
+  index_->addDescriptors(added_frame_id, descriptors);
+  std::vector<BinaryDescriptorIndex::Neighbor> neighbors;
+  index_->findNearestNeighbors(descriptors.col(3).data(), 1, &neighbors);
+  ASSERT_EQ(1u, neighbors.size());
+  EXPECT_EQ(added_frame_id, neighbors[0].key.frame_id);
+  EXPECT_EQ(3u, neighbors[0].key.keypoint_index);
+  EXPECT_EQ(0, neighbors[0].distance);
+
+  // Removing all frames empties the index.
+  for (const std::pair<FrameId, DescriptorsT>& frame : frames_) {
+    EXPECT_TRUE(index_->removeFrame(frame.first));
+  }
+  EXPECT_EQ(0u, index_->getNumDescriptors());
+  index_->findNearestNeighbors(descriptors.col(3).data(), 1, &neighbors);
+  EXPECT_TRUE(neighbors.empty());
+}
+
+INSTANTIATE_TEST_CASE_P(SubstringSizes, BinaryDescriptorIndexTest, ::testing::Values(1u, 2u));
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
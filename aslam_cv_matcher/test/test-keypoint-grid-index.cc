@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/matcher/keypoint-grid-index.h>
+
+namespace aslam {
+
+constexpr int kNumKeypoints = 1000;
+constexpr double kImageWidth = 640.0;
+constexpr double kImageHeight = 480.0;
+
+class KeypointGridIndexTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::srand(5);
+    // Half of the keypoints at subpixel positions, the other half on the pixel grid, i.e. on
+    // the borders of the cells and of the query windows.
+    keypoints_.resize(Eigen::NoChange, kNumKeypoints);
+    for (int i = 0; i < kNumKeypoints; ++i) {
+      if (i % 2 == 0) {
+        keypoints_.col(i) << kImageWidth * std::rand() / RAND_MAX,
+            kImageHeight * std::rand() / RAND_MAX;
+      } else {
+        keypoints_.col(i) << std::rand() % static_cast<int>(kImageWidth),
+            std::rand() % static_cast<int>(kImageHeight);
+      }
+    }
+    is_keypoint_valid_.resize(kNumKeypoints);
+    for (int i = 0; i < kNumKeypoints; ++i) {
+      is_keypoint_valid_[i] = std::rand() % 4 != 0;
+    }
+  }
+
+  Eigen::Vector2d createQueryPosition(int query) const {
+    if (query % 2 == 0) {
+      return Eigen::Vector2d(std::rand() % static_cast<int>(kImageWidth),
+                             std::rand() % static_cast<int>(kImageHeight));
+    }
+    // Also query around positions outside of the image.
+    return Eigen::Vector2d((kImageWidth + 100.0) * std::rand() / RAND_MAX - 50.0,
+                           (kImageHeight + 100.0) * std::rand() / RAND_MAX - 50.0);
+  }
+
+  void expectRadiusQueriesEqualLinearSearch(
+      const KeypointGridIndex& index, const std::vector<bool>* is_keypoint_valid) const {
+    std::vector<int> keypoint_indices;
+    for (int query = 0; query < 200; ++query) {
+      const Eigen::Vector2d center = createQueryPosition(query);
+      const double radius = query % 10 == 0 ? 0.0 : 1.0 + std::rand() % 40;
+      index.getKeypointsInRadius(center, radius, &keypoint_indices);
+      std::vector<int> expected_keypoint_indices;
+      for (int i = 0; i < kNumKeypoints; ++i) {
+        if ((is_keypoint_valid == nullptr || (*is_keypoint_valid)[i]) &&
+            (keypoints_.col(i) - center).squaredNorm() < radius * radius) {
+          expected_keypoint_indices.push_back(i);
+        }
+      }
+      std::sort(keypoint_indices.begin(), keypoint_indices.end());
+      EXPECT_EQ(expected_keypoint_indices, keypoint_indices);
+    }
+  }
+
+  void expectWindowQueriesEqualLinearSearch(
+      const KeypointGridIndex& index, const std::vector<bool>* is_keypoint_valid) const {
+    std::vector<int> keypoint_indices;
+    for (int query = 0; query < 200; ++query) {
+      const Eigen::Vector2d center = createQueryPosition(query);
+      const Eigen::Vector2d half_size(1 + std::rand() % 20, 1 + std::rand() % 20);
+      const Eigen::Vector2d window_min = center - half_size;
+      const Eigen::Vector2d window_max = center + half_size;
+      index.getKeypointsInWindow(window_min, window_max, &keypoint_indices);
+      std::vector<int> expected_keypoint_indices;
+      for (int i = 0; i < kNumKeypoints; ++i) {
+        if ((is_keypoint_valid == nullptr || (*is_keypoint_valid)[i]) &&
+            (keypoints_.col(i).array() >= window_min.array()).all() &&
+            (keypoints_.col(i).array() <= window_max.array()).all()) {
+          expected_keypoint_indices.push_back(i);
+        }
+      }
+      std::sort(keypoint_indices.begin(), keypoint_indices.end());
+      EXPECT_EQ(expected_keypoint_indices, keypoint_indices);
+    }
+  }
+
+  Eigen::Matrix2Xd keypoints_;
+  std::vector<bool> is_keypoint_valid_;
+};
+
+TEST_F(KeypointGridIndexTest, QueriesEqualLinearSearch) {
+  for (const double cell_size : {5.0, 10.0, 25.0, 1000.0}) {
+    KeypointGridIndex index;
+    index.build(keypoints_, cell_size, nullptr);
+    EXPECT_EQ(static_cast<size_t>(kNumKeypoints), index.getNumKeypoints());
+    EXPECT_DOUBLE_EQ(cell_size, index.getCellSize());
+    expectRadiusQueriesEqualLinearSearch(index, nullptr);
+    expectWindowQueriesEqualLinearSearch(index, nullptr);
+  }
+}
+
+TEST_F(KeypointGridIndexTest, IndexesOnlyValidKeypoints) {
+  KeypointGridIndex index;
+  index.build(keypoints_, 10.0, &is_keypoint_valid_);
+  EXPECT_EQ(static_cast<size_t>(std::count(
+      is_keypoint_valid_.begin(), is_keypoint_valid_.end(), true)), index.getNumKeypoints());
+  expectRadiusQueriesEqualLinearSearch(index, &is_keypoint_valid_);
+  expectWindowQueriesEqualLinearSearch(index, &is_keypoint_valid_);
+
+  // Rebuilding replaces the keypoints.
+  index.build(keypoints_, 10.0, nullptr);
+  EXPECT_EQ(static_cast<size_t>(kNumKeypoints), index.getNumKeypoints());
+  expectRadiusQueriesEqualLinearSearch(index, nullptr);
+}
+
+TEST_F(KeypointGridIndexTest, EnlargesTooSmallCells) {
+  KeypointGridIndex index;
+  index.build(keypoints_, 0.01, nullptr);
+  EXPECT_GT(index.getCellSize(), 0.01);
+  EXPECT_LE(index.getNumCells(), 16 * kNumKeypoints);
+  expectRadiusQueriesEqualLinearSearch(index, nullptr);
+  expectWindowQueriesEqualLinearSearch(index, nullptr);
+}
+
+TEST_F(KeypointGridIndexTest, HandlesEmptyAndSinglePointGrids) {
+  KeypointGridIndex index;
+  std::vector<int> keypoint_indices(1u, 0);
+  index.getKeypointsInRadius(Eigen::Vector2d(10.0, 10.0), 5.0, &keypoint_indices);
+  EXPECT_TRUE(keypoint_indices.empty());
+
+  const std::vector<bool> no_valid_keypoints(kNumKeypoints, false);
+  index.build(keypoints_, 10.0, &no_valid_keypoints);
+  EXPECT_EQ(0u, index.getNumKeypoints());
+  index.getKeypointsInWindow(Eigen::Vector2d::Zero(), Eigen::Vector2d(kImageWidth, kImageHeight),
+                             &keypoint_indices);
+  EXPECT_TRUE(keypoint_indices.empty());
+
+  const Eigen::Matrix2Xd single_keypoint = Eigen::Vector2d(20.0, 30.0);
+  index.build(single_keypoint, 10.0, nullptr);
+  EXPECT_EQ(1, index.getNumCells());
+  index.getKeypointsInRadius(Eigen::Vector2d(23.0, 34.0), 5.0 + 1e-12, &keypoint_indices);
+  EXPECT_EQ(std::vector<int>(1u, 0), keypoint_indices);
+  // The radius excludes the keypoints at exactly the radius, the window includes its borders.
+  index.getKeypointsInRadius(Eigen::Vector2d(23.0, 34.0), 5.0, &keypoint_indices);
+  EXPECT_TRUE(keypoint_indices.empty());
+  index.getKeypointsInWindow(Eigen::Vector2d(20.0, 20.0), Eigen::Vector2d(30.0, 30.0),
+                             &keypoint_indices);
+  EXPECT_EQ(std::vector<int>(1u, 0), keypoint_indices);
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
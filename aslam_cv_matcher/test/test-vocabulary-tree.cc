@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+#include <yaml-cpp/yaml.h>
+
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/memory.h>
+#include <aslam/common/unique-id.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/matcher/bag-of-words-index.h>
+#include <aslam/matcher/vocabulary-tree.h>
+
+namespace aslam {
+
+constexpr int kDescriptorSizeBytes = 48;
+constexpr int kNumTrueWords = 100;
+constexpr int kMaxFlippedBits = 8;
+constexpr int kNumPlaces = 30;
+constexpr int kNumDescriptorsPerPlace = 60;
+
+/// Places whose descriptors are noisy copies of a random subset of well separated true words,
+/// such that different views of a place share their words.
+class VocabularyTreeTest : public ::testing::Test {
+ protected:
+  typedef VocabularyTree::DescriptorsT DescriptorsT;
+
+  virtual void SetUp() {
+    std::srand(3);
+    true_words_.resize(kDescriptorSizeBytes, kNumTrueWords);
+    true_words_.setRandom();
+    place_true_words_.resize(kNumPlaces);
+    for (std::vector<int>& true_words : place_true_words_) {
+      for (int i = 0; i < kNumDescriptorsPerPlace; ++i) {
+        true_words.push_back(std::rand() % kNumTrueWords);
+      }
+    }
+
+    std::vector<DescriptorsT> training_frames;
+    for (int place = 0; place < kNumPlaces; ++place) {
+      training_frames.push_back(createView(place));
+    }
+    VocabularyTree::Options options;
+    options.branching_factor = 6u;
+    options.num_levels = 3u;
+    vocabulary_ = aligned_unique<VocabularyTree>();
+    vocabulary_->train(training_frames, options);
+  }
+
+  /// A view of a place with new noise, of which a fraction of the descriptors is kept.
+  DescriptorsT createView(int place, int percent_kept = 100) const {
+    std::vector<int> true_words;
+    for (const int true_word : place_true_words_[place]) {
+      if (std::rand() % 100 < percent_kept) {
+        true_words.push_back(true_word);
+      }
+    }
+    DescriptorsT descriptors(kDescriptorSizeBytes, true_words.size());
+    for (size_t i = 0u; i < true_words.size(); ++i) {
+      descriptors.col(i) = createNoisyCopy(true_words[i]);
+    }
+    return descriptors;
+  }
+
+  DescriptorsT createNoisyCopy(int true_word) const {
+    DescriptorsT descriptor = true_words_.col(true_word);
+    const int num_flipped_bits = std::rand() % (kMaxFlippedBits + 1);
+    for (int bit = 0; bit < num_flipped_bits; ++bit) {
+      const int flipped_bit = std::rand() % (8 * kDescriptorSizeBytes);
+      descriptor(flipped_bit / 8, 0) ^= static_cast<unsigned char>(1u << (flipped_bit % 8));
+    }
+    return descriptor;
+  }
+
+  DescriptorsT true_words_;
+  std::vector<std::vector<int>> place_true_words_;
+  VocabularyTree::UniquePtr vocabulary_;
+};
+
+TEST_F(VocabularyTreeTest, QuantizesNoisyCopiesToTheSameWord) {
+  ASSERT_TRUE(vocabulary_->isTrained());
+  EXPECT_EQ(static_cast<size_t>(kDescriptorSizeBytes), vocabulary_->getDescriptorSizeBytes());
+  EXPECT_GT(vocabulary_->getNumWords(), 1u);
+  EXPECT_LE(vocabulary_->getNumWords(), 6u * 6u * 6u);
+  EXPECT_LT(vocabulary_->getNumWords(), vocabulary_->getNumNodes());
+
+  // The true words are far apart compared to the noise, so their copies end up in the same
+  // leaf, except if k-medians splits a true word at a border between two clusters.
+  int num_equal_words = 0;
+  int num_copies = 0;
+  for (int true_word = 0; true_word < kNumTrueWords; ++true_word) {
+    const DescriptorsT true_word_descriptor = true_words_.col(true_word);
+    const VocabularyTree::WordId word = vocabulary_->getWord(true_word_descriptor.data());
+    for (int copy = 0; copy < 10; ++copy) {
+      const DescriptorsT noisy_copy = createNoisyCopy(true_word);
+      num_equal_words += vocabulary_->getWord(noisy_copy.data()) == word ? 1 : 0;
+      ++num_copies;
+    }
+  }
+  EXPECT_GE(num_equal_words, num_copies * 95 / 100);
+
+  const DescriptorsT view = createView(0);
+  std::vector<VocabularyTree::WordId> words;
+  vocabulary_->getWords(view, &words);
+  ASSERT_EQ(static_cast<size_t>(view.cols()), words.size());
+  for (int i = 0; i < view.cols(); ++i) {
+    EXPECT_EQ(vocabulary_->getWord(&view.coeffRef(0, i)), words[i]);
+    EXPECT_GE(words[i], 0);
+    EXPECT_LT(static_cast<size_t>(words[i]), vocabulary_->getNumWords());
+  }
+}
+
+TEST_F(VocabularyTreeTest, ComputesNormalizedBagsOfWords) {
+  VocabularyTree::BagOfWords bag_of_words;
+  vocabulary_->getBagOfWords(createView(0), &bag_of_words);
+  ASSERT_FALSE(bag_of_words.empty());
+  double sum_of_weights = 0.0;
+  for (size_t i = 0u; i < bag_of_words.size(); ++i) {
+    EXPECT_GT(bag_of_words[i].second, 0.0);
+    if (i > 0u) {
+      EXPECT_LT(bag_of_words[i - 1u].first, bag_of_words[i].first);
+    }
+    sum_of_weights += bag_of_words[i].second;
+  }
+  EXPECT_NEAR(1.0, sum_of_weights, 1e-12);
+  EXPECT_NEAR(1.0, VocabularyTree::getSimilarity(bag_of_words, bag_of_words), 1e-12);
+  EXPECT_EQ(0.0, VocabularyTree::getSimilarity(bag_of_words, VocabularyTree::BagOfWords()));
+
+  VocabularyTree::BagOfWords same_place_bag_of_words;
+  vocabulary_->getBagOfWords(createView(0, 75), &same_place_bag_of_words);
+  VocabularyTree::BagOfWords other_place_bag_of_words;
+  vocabulary_->getBagOfWords(createView(1), &other_place_bag_of_words);
+  EXPECT_GT(VocabularyTree::getSimilarity(bag_of_words, same_place_bag_of_words),
+            VocabularyTree::getSimilarity(bag_of_words, other_place_bag_of_words));
+}
+
+TEST_F(VocabularyTreeTest, SerializesAndDeserializes) {
+  YAML::Node node;
+  vocabulary_->serialize(&node);
+  VocabularyTree deserialized_vocabulary;
+  EXPECT_FALSE(deserialized_vocabulary.isTrained());
+  ASSERT_TRUE(deserialized_vocabulary.deserialize(YAML::Load(YAML::Dump(node))));
+  ASSERT_TRUE(deserialized_vocabulary.isTrained());
+  EXPECT_EQ(vocabulary_->getDescriptorSizeBytes(),
+            deserialized_vocabulary.getDescriptorSizeBytes());
+  EXPECT_EQ(vocabulary_->getNumNodes(), deserialized_vocabulary.getNumNodes());
+  ASSERT_EQ(vocabulary_->getNumWords(), deserialized_vocabulary.getNumWords());
+  for (size_t word = 0u; word < vocabulary_->getNumWords(); ++word) {
+    EXPECT_DOUBLE_EQ(vocabulary_->getWordWeight(word),
+                     deserialized_vocabulary.getWordWeight(word));
+  }
+
+  for (int place = 0; place < kNumPlaces; ++place) {
+    const DescriptorsT view = createView(place);
+    std::vector<VocabularyTree::WordId> words;
+    std::vector<VocabularyTree::WordId> deserialized_words;
+    vocabulary_->getWords(view, &words);
+    deserialized_vocabulary.getWords(view, &deserialized_words);
+    EXPECT_EQ(words, deserialized_words);
+  }
+
+  // A vocabulary whose children are not in breadth-first order is rejected.
+  YAML::Node broken_node = YAML::Load(YAML::Dump(node));
+  broken_node["node_num_children"][0] = 0;
+  EXPECT_FALSE(deserialized_vocabulary.deserialize(broken_node));
+}
+
+TEST_F(VocabularyTreeTest, RetrievesFramesOfTheSamePlace) {
+  BagOfWordsIndex index(std::move(vocabulary_));
+  std::vector<FrameId> place_frame_ids(kNumPlaces);
+  for (int place = 0; place < kNumPlaces; ++place) {
+    generateId(&place_frame_ids[place]);
+    if (place == 0) {
+      VisualFrame frame;
+      frame.setId(place_frame_ids[place]);
+      frame.setDescriptors(createView(place));
+      index.addFrame(frame);
+    } else {
+      VocabularyTree::BagOfWords bag_of_words;
+      index.getVocabulary().getBagOfWords(createView(place), &bag_of_words);
+      index.addBagOfWords(place_frame_ids[place], bag_of_words);
+    }
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumPlaces), index.getNumFrames());
+
+  // A new view of a place, of which a quarter of the descriptors is not seen again.
+  const size_t kMaxNumFrames = 5u;
+  std::vector<BagOfWordsIndex::FrameScore> frame_scores;
+  for (int place = 0; place < kNumPlaces; ++place) {
+    index.query(createView(place, 75), kMaxNumFrames, &frame_scores);
+    ASSERT_EQ(kMaxNumFrames, frame_scores.size());
+    EXPECT_EQ(place_frame_ids[place], frame_scores[0].frame_id);
+    for (size_t i = 1u; i < frame_scores.size(); ++i) {
+      EXPECT_GE(frame_scores[i - 1u].score, frame_scores[i].score);
+    }
+  }
+
+  // Removed frames are not retrieved and their slots are reused.
+  EXPECT_TRUE(index.removeFrame(place_frame_ids[3]));
+  EXPECT_FALSE(index.removeFrame(place_frame_ids[3]));
+  EXPECT_EQ(static_cast<size_t>(kNumPlaces - 1), index.getNumFrames());
+  index.query(createView(3), kNumPlaces, &frame_scores);
+  for (const BagOfWordsIndex::FrameScore& frame_score : frame_scores) {
+    EXPECT_NE(place_frame_ids[3], frame_score.frame_id);
+  }
+  generateId(&place_frame_ids[3]);
+  VocabularyTree::BagOfWords bag_of_words;
+  index.getVocabulary().getBagOfWords(createView(3), &bag_of_words);
+  index.addBagOfWords(place_frame_ids[3], bag_of_words);
+  index.query(bag_of_words, 1u, &frame_scores);
+  ASSERT_EQ(1u, frame_scores.size());
+  EXPECT_EQ(place_frame_ids[3], frame_scores[0].frame_id);
+  EXPECT_NEAR(1.0, frame_scores[0].score, 1e-12);
+}
+
+}  // namespace aslam
+
+ASLAM_UNITTEST_ENTRYPOINT
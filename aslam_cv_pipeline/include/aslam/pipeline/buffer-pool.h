@@ -0,0 +1,85 @@
+#ifndef ASLAM_PIPELINE_BUFFER_POOL_H_
+#define ASLAM_PIPELINE_BUFFER_POOL_H_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <aslam/common/macros.h>
+#include <aslam/frames/visual-frame.h>
+
+namespace aslam {
+
+/// \class ImageBufferPool
+/// \brief Recycles the memory of images once all cv::Mat sharing it are released.
+///
+/// A buffer is free again when the pool holds the only reference to it, so the images can be
+/// handed to downstream consumers without tracking them. If all buffers are in use, acquire()
+/// allocates an image that is not pooled.
+class ImageBufferPool {
+public:
+  ASLAM_POINTER_TYPEDEFS(ImageBufferPool);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(ImageBufferPool);
+
+  /// Default number of buffers of a pool.
+  enum { kDefaultMaxNumBuffers = 8 };
+
+  /// \brief Create a pool holding up to max_num_buffers buffers.
+  explicit ImageBufferPool(size_t max_num_buffers = kDefaultMaxNumBuffers);
+
+  /// \brief Get an image of the given size and type. The content is undefined.
+  cv::Mat acquire(int rows, int cols, int type);
+
+  /// \brief Number of buffers held by the pool.
+  size_t getNumBuffers() const;
+
+private:
+  /// \brief Is the pool holding the only reference to the buffer?
+  static bool isFree(const cv::Mat& buffer);
+
+  mutable std::mutex mutex_;
+  const size_t max_num_buffers_;
+  std::vector<cv::Mat> buffers_;
+};
+
+/// \class VisualFramePool
+/// \brief Recycles VisualFrames once all shared pointers to them are released.
+///
+/// Recycled frames are reset to the state of a new frame, except that their keypoint, descriptor,
+/// track id and raw image channels are kept with empty data so they do not have to be added
+/// again. All named channels are removed. The emptied matrices don't keep their memory, so new
+/// keypoints and descriptors are still allocated for every frame. A frame is free again when
+/// the pool holds the only shared pointer to it; weak pointers to handed out frames must not be
+/// locked after the frame was released. If all frames are in use, acquire() allocates a frame
+/// that is not pooled.
+class VisualFramePool {
+public:
+  ASLAM_POINTER_TYPEDEFS(VisualFramePool);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(VisualFramePool);
+
+  /// Default number of frames of a pool.
+  enum { kDefaultMaxNumFrames = 8 };
+
+  /// \brief Create a pool holding up to max_num_frames frames.
+  explicit VisualFramePool(size_t max_num_frames = kDefaultMaxNumFrames);
+
+  /// \brief Get an empty frame.
+  VisualFrame::Ptr acquire();
+
+  /// \brief Number of frames held by the pool.
+  size_t getNumFrames() const;
+
+private:
+  /// \brief Reset a recycled frame, keeping its channels.
+  static void resetFrame(VisualFrame* frame);
+
+  mutable std::mutex mutex_;
+  const size_t max_num_frames_;
+  std::vector<VisualFrame::Ptr> frames_;
+};
+
+}  // namespace aslam
+
+#endif // ASLAM_PIPELINE_BUFFER_POOL_H_
@@ -0,0 +1,144 @@
+#ifndef ASLAM_PIPELINE_NFRAME_ASSEMBLER_H_
+#define ASLAM_PIPELINE_NFRAME_ASSEMBLER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/common/macros.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/frames/visual-nframe.h>
+
+namespace aslam {
+
+/// \class NFrameAssembler
+/// \brief Groups the frames of a camera system with nearby timestamps into VisualNFrames.
+///
+/// A frame joins the nframe whose timestamp (the timestamp of its first frame) is closest and
+/// within the tolerance, otherwise it starts a new nframe. The nframes in progress are stored in
+/// buckets of the timestamp, such that the candidates of a frame are in the bucket of its
+/// timestamp or the two neighboring ones. The buckets are spread over shards with separate locks,
+/// every nframe has one slot per camera and an atomic counter of the set frames, so frames of
+/// different timestamps do not contend and completion is detected in O(1).
+///
+/// Complete nframes are handed to the output callback in chronological order: an nframe is held
+/// back until all older nframes are complete. If two consecutive nframes are complete while an
+/// older one is not, a camera dropped an image and the older nframes are discarded. If stale
+/// nframes are dropped, a complete nframe is released right away and the older incomplete
+/// nframes are discarded, which trades completeness for latency.
+class NFrameAssembler {
+public:
+  ASLAM_POINTER_TYPEDEFS(NFrameAssembler);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(NFrameAssembler);
+
+  /// Default number of shards of the nframes in progress.
+  enum { kDefaultNumShards = 64 };
+
+  /// \brief Called with the complete nframes in chronological order.
+  typedef std::function<void(int64_t timestamp_nanoseconds,
+                             const std::shared_ptr<VisualNFrame>& nframe)> OutputCallback;
+
+  /// \brief Create an assembler.
+  ///
+  /// \param[in] camera_system          The camera system of the frames.
+  /// \param[in] timestamp_tolerance_ns How close should two frame timestamps be for us to
+  ///                                   consider them part of the same nframe?
+  /// \param[in] output_callback        Called with every complete nframe, in chronological order.
+  ///                                   Calls are serialized.
+  /// \param[in] num_shards             The number of shards of the nframes in progress.
+  NFrameAssembler(const NCamera::Ptr& camera_system, int64_t timestamp_tolerance_ns,
+                  const OutputCallback& output_callback, size_t num_shards = kDefaultNumShards);
+
+  ~NFrameAssembler();
+
+  /// \brief Add the frame of a camera. Thread-safe.
+  void addFrame(size_t camera_index, const std::shared_ptr<VisualFrame>& frame);
+
+  /// \brief Discard the nframes in progress up to and including the given timestamp.
+  void discardNFramesUpTo(int64_t timestamp_nanoseconds);
+
+  /// \brief Number of nframes that are incomplete or wait for older nframes to complete.
+  size_t getNumNFramesInProgress() const;
+
+  /// \brief Release a complete nframe right away and discard the older incomplete ones instead
+  ///        of waiting for them. Late nframes older than the last released one are discarded.
+  void setDropStaleNFrames(bool drop_stale_nframes);
+
+  /// \brief Number of nframes discarded because of a frame drop or because they were stale.
+  ///        Does not count the nframes discarded by discardNFramesUpTo().
+  size_t getNumDroppedNFrames() const;
+
+private:
+  /// An nframe in progress.
+  struct PendingNFrame {
+    PendingNFrame(const NCamera::Ptr& camera_system, int64_t timestamp);
+
+    /// The timestamp of the first frame.
+    const int64_t timestamp_nanoseconds;
+    std::shared_ptr<VisualNFrame> nframe;
+    /// Is the slot of a camera taken? Every camera sets its frame once.
+    std::unique_ptr<std::atomic<bool>[]> is_camera_set;
+    /// The number of frames set.
+    std::atomic<size_t> num_frames_set;
+    /// Set when the nframe is discarded, the nframe is then skipped.
+    std::atomic<bool> is_discarded;
+  };
+  typedef std::shared_ptr<PendingNFrame> PendingNFramePtr;
+
+  /// The nframes in progress of some buckets, keyed by bucket.
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<int64_t, PendingNFramePtr> pending_nframes;
+  };
+
+  /// \brief The bucket of a timestamp.
+  int64_t getBucket(int64_t timestamp_nanoseconds) const;
+
+  /// \brief The shard of a bucket.
+  Shard& getShard(int64_t bucket);
+
+  /// \brief Find the nframe a frame joins or create a new one.
+  PendingNFramePtr findOrCreateNFrame(int64_t timestamp_nanoseconds);
+
+  /// \brief Remove an nframe from its shard if it is still stored there.
+  void removeFromShard(const PendingNFramePtr& pending_nframe);
+
+  /// \brief Move a complete nframe to the output if all older nframes are complete.
+  void completeNFrame(const PendingNFramePtr& pending_nframe);
+
+  /// \brief Release the complete nframes that are not waiting for an older nframe. Returns the
+  ///        discarded nframes, which have to be removed from their shards.
+  void releaseCompleteNFrames(std::vector<PendingNFramePtr>* discarded_nframes);
+
+  const NCamera::Ptr camera_system_;
+  const size_t num_cameras_;
+  const int64_t timestamp_tolerance_ns_;
+  /// The width of a bucket, larger than the tolerance.
+  const int64_t bucket_width_ns_;
+  const OutputCallback output_callback_;
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  /// A mutex to protect the order of the nframes. Taken once per nframe when it is created and
+  /// when it is complete; it can be taken while holding a shard mutex, never the other way round.
+  mutable std::mutex order_mutex_;
+  /// The incomplete nframes, keyed by timestamp.
+  std::map<int64_t, PendingNFramePtr> incomplete_nframes_;
+  /// The complete nframes waiting for older nframes, keyed by timestamp.
+  std::map<int64_t, PendingNFramePtr> complete_nframes_;
+  /// Release complete nframes without waiting for older ones.
+  bool drop_stale_nframes_;
+  /// The timestamp of the last nframe handed to the output callback.
+  int64_t last_released_timestamp_;
+  size_t num_dropped_nframes_;
+};
+
+}  // namespace aslam
+
+#endif // ASLAM_PIPELINE_NFRAME_ASSEMBLER_H_
@@ -0,0 +1,98 @@
+#ifndef ASLAM_PIPELINE_UNDISTORT_MAP_CACHE_H_
+#define ASLAM_PIPELINE_UNDISTORT_MAP_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <aslam/cameras/camera.h>
+#include <aslam/common/macros.h>
+#include <aslam/common/types.h>
+
+namespace aslam {
+
+// Defined in undistorter-mapped.h, which includes this header.
+enum class UndistortMapType;
+
+/// \class UndistortMapCache
+/// \brief A persistent on-disk cache for the maps of a \ref MappedUndistorter.
+///
+/// The maps are keyed by the camera type, intrinsics, distortion, resolution and the parameters
+/// of the undistorter factory. Every entry is a binary file holding the full key and the raw map
+/// data, which is memory-mapped on load so the maps are not copied. A re-calibration changes the
+/// key and leads to a new entry; outdated entries can be removed with clear(). Entries that do
+/// not match the format or the key are removed and rebuilt.
+///
+/// Entries are written to a temporary file that is renamed into place, so several processes can
+/// share a cache directory.
+class UndistortMapCache {
+public:
+  ASLAM_POINTER_TYPEDEFS(UndistortMapCache);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(UndistortMapCache);
+
+  /// \brief The parameters that determine the maps, serialized to bytes.
+  typedef std::vector<char> Key;
+
+  /// \brief Create a cache in the given directory. The directory is created if it does not exist.
+  explicit UndistortMapCache(const std::string& directory);
+
+  /// \brief Build the key of the maps created by the undistorter factories.
+  /// @param[in] input_camera         The camera that produces the input images.
+  /// @param[in] alpha                The free scaling parameter of the factory.
+  /// @param[in] scale                The output image size scaling parameter of the factory.
+  /// @param[in] interpolation        The interpolation method of the undistorter.
+  /// @param[in] map_type             The storage format of the maps.
+  /// @param[in] undistort_to_pinhole Are the maps undistorting to a pinhole camera?
+  static Key computeKey(const Camera& input_camera, float alpha, float scale,
+                        InterpolationMethod interpolation, UndistortMapType map_type,
+                        bool undistort_to_pinhole);
+
+  /// \brief Load the maps of the given key without copying the data.
+  /// @param[in]  key             The key of the maps.
+  /// @param[out] map_u           The map of the u-coordinates. Read-only.
+  /// @param[out] map_v           The map of the v-coordinates. Read-only.
+  /// @param[out] map_subsampling The distance between the map nodes in output pixels.
+  /// @param[out] map_storage     Keeps the memory-mapped file alive as long as the maps are used.
+  /// @return False if there is no valid entry for the key.
+  bool load(const Key& key, cv::Mat* map_u, cv::Mat* map_v, int* map_subsampling,
+            std::shared_ptr<const void>* map_storage) const;
+
+  /// \brief Store the maps of the given key, replacing an existing entry.
+  /// @return False if the entry could not be written.
+  bool store(const Key& key, const cv::Mat& map_u, const cv::Mat& map_v,
+             int map_subsampling) const;
+
+  /// \brief Remove the entry of the given key.
+  void remove(const Key& key) const;
+
+  /// \brief Remove all entries of the cache directory.
+  void clear() const;
+
+  /// \brief The path of the entry of the given key.
+  std::string getFilePath(const Key& key) const;
+
+  /// \brief The directory of the cache.
+  const std::string& getDirectory() const { return directory_; }
+
+  /// \brief Number of successful loads.
+  size_t getNumHits() const { return num_hits_; }
+
+  /// \brief Number of unsuccessful loads.
+  size_t getNumMisses() const { return num_misses_; }
+
+private:
+  /// \brief The directory of the cache.
+  const std::string directory_;
+  /// \brief Number of successful loads.
+  mutable std::atomic<size_t> num_hits_;
+  /// \brief Number of unsuccessful loads.
+  mutable std::atomic<size_t> num_misses_;
+};
+
+}  // namespace aslam
+
+#endif // ASLAM_PIPELINE_UNDISTORT_MAP_CACHE_H_
@@ -0,0 +1,84 @@
+#ifndef ASLAM_PIPELINE_KEYPOINT_UNDISTORTER_H_
+#define ASLAM_PIPELINE_KEYPOINT_UNDISTORTER_H_
+
+#include <memory>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <aslam/cameras/camera.h>
+#include <aslam/common/macros.h>
+#include <aslam/pipeline/undistorter.h>
+
+namespace aslam {
+
+class KeypointUndistorter;
+
+/// \brief Factory method to create a keypoint undistorter for this camera geometry. The output
+///        camera geometry is the same as the one of \ref createMappedUndistorter for the same
+///        parameters.
+///        NOTE: The undistorter stores a copy of this camera and changes to the original geometry
+///              are not connected with the undistorter!
+/// @param[in] camera The camera object a keypoint undistorter should be created for. Currently
+///                   the method supports pinhole and unified projection cameras. Any other type
+///                   of camera will result in the hard failure.
+/// @param[in] alpha Free scaling parameter between 0 (when all the pixels in the undistorted image
+///                  will be valid) and 1 (when all the source image pixels will be retained in the
+///                  undistorted image)
+/// @param[in] scale Output image size scaling parameter wrt. to input image size.
+/// @return Pointer to the created keypoint undistorter.
+std::unique_ptr<KeypointUndistorter> createKeypointUndistorter(
+    const Camera& camera, float alpha, float scale);
+
+/// \class KeypointUndistorter
+/// \brief An undistorter that leaves the image untouched and maps the detected keypoints instead.
+///
+/// The features are detected and described on the raw image. Afterwards only the keypoints,
+/// their orientations and their scales are mapped through the camera models to the output camera
+/// geometry. This saves the remap of the full image for pipelines that only need undistorted
+/// keypoints. Keypoints that do not map into the output image are removed from the frame.
+class KeypointUndistorter : public Undistorter {
+public:
+  ASLAM_POINTER_TYPEDEFS(KeypointUndistorter);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(KeypointUndistorter);
+
+protected:
+  KeypointUndistorter() = default;
+
+public:
+  /// \brief Create a keypoint undistorter from the input and output cameras.
+  ///
+  /// \param[in] input_camera  The camera intrinsics for the original image.
+  /// \param[in] output_camera The camera intrinsics of the keypoints after undistortion.
+  KeypointUndistorter(Camera::Ptr input_camera, Camera::Ptr output_camera);
+
+  virtual ~KeypointUndistorter() = default;
+
+  /// \brief Passes the input image through without copying the data.
+  virtual void processImage(const cv::Mat& input_image, cv::Mat* output_image) const;
+
+  /// \brief The image stays in the input camera geometry.
+  virtual bool transformsImage() const { return false; }
+
+  /// \brief Map the keypoints of the frame to the output camera geometry and remove the ones
+  ///        outside of the output image from all keypoint channels.
+  virtual void processKeypoints(VisualFrame* frame) const;
+
+  /// \brief Map keypoints from the input to the output camera geometry.
+  ///
+  /// The orientations (in degrees, negative if not computed) and scales follow the local
+  /// rotation and scaling of the mapping, which is obtained from two neighboring points per
+  /// keypoint.
+  /// @param[in,out] keypoints    The keypoints in the input image.
+  /// @param[in,out] orientations The keypoint orientations. Can be null.
+  /// @param[in,out] scales       The keypoint scales. Can be null.
+  /// @param[out]    out_success  Was the keypoint mapped into the output image? Unsuccessful
+  ///                             keypoints are left unchanged.
+  void undistortKeypoints(Eigen::Matrix2Xd* keypoints, Eigen::VectorXd* orientations,
+                          Eigen::VectorXd* scales,
+                          std::vector<unsigned char>* out_success) const;
+};
+
+}  // namespace aslam
+
+#endif // ASLAM_PIPELINE_KEYPOINT_UNDISTORTER_H_
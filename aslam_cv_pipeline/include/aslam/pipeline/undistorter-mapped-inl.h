@@ -4,25 +4,84 @@
 #include <aslam/cameras/camera-factory.h>
 #include <aslam/cameras/camera.h>
 #include <aslam/common/undistort-helpers.h>
+#include <aslam/pipeline/undistort-map-cache.h>
 
 namespace aslam {
+namespace internal {
+/// \brief Build the undistortion maps in the given storage format.
+/// @return The distance between the map nodes in output pixels.
+template <typename InputCameraType, typename OutputCameraType>
+int buildUndistortMaps(
+    const InputCameraType& input_camera, const OutputCameraType& output_camera,
+    UndistortMapType map_type, cv::Mat* map_u, cv::Mat* map_v) {
+  CHECK_NOTNULL(map_u);
+  CHECK_NOTNULL(map_v);
+  switch (map_type) {
+    case UndistortMapType::kFloat:
+      common::buildUndistortMap(input_camera, output_camera, CV_32FC1, *map_u, *map_v);
+      return 1;
+    case UndistortMapType::kFixedPoint:
+      common::buildUndistortMap(input_camera, output_camera, CV_16SC2, *map_u, *map_v);
+      return 1;
+    case UndistortMapType::kSubsampled:
+      common::buildSubsampledUndistortMap(
+          input_camera, output_camera, MappedUndistorter::kDefaultMapSubsampling, map_u,
+          map_v);
+      return MappedUndistorter::kDefaultMapSubsampling;
+    default:
+      LOG(FATAL) << "Unknown map type: " << static_cast<int>(map_type);
+  }
+  return 1;
+}
+
+/// \brief Create a mapped undistorter, loading the maps from the cache if possible. Maps that are
+///        built are stored to the cache.
+template <typename InputCameraType, typename OutputCameraType>
+std::unique_ptr<MappedUndistorter> createMappedUndistorterWithMaps(
+    const std::shared_ptr<InputCameraType>& input_camera,
+    const std::shared_ptr<OutputCameraType>& output_camera, float alpha, float scale,
+    aslam::InterpolationMethod interpolation_type, UndistortMapType map_type,
+    bool undistort_to_pinhole, const UndistortMapCache* map_cache) {
+  CHECK(input_camera);
+  CHECK(output_camera);
+  cv::Mat map_u, map_v;
+  int map_subsampling = 1;
+  std::shared_ptr<const void> map_storage;
+  if (map_cache != nullptr) {
+    const UndistortMapCache::Key key = UndistortMapCache::computeKey(
+        *input_camera, alpha, scale, interpolation_type, map_type, undistort_to_pinhole);
+    if (!map_cache->load(key, &map_u, &map_v, &map_subsampling, &map_storage)) {
+      map_subsampling = buildUndistortMaps(
+          *input_camera, *output_camera, map_type, &map_u, &map_v);
+      map_cache->store(key, map_u, map_v, map_subsampling);
+    }
+  } else {
+    map_subsampling = buildUndistortMaps(
+        *input_camera, *output_camera, map_type, &map_u, &map_v);
+  }
+  return std::unique_ptr<MappedUndistorter>(new MappedUndistorter(
+      input_camera, output_camera, map_u, map_v, interpolation_type, map_subsampling,
+      map_storage));
+}
+}  // namespace internal
 
 template <>
 inline std::unique_ptr<MappedUndistorter> createMappedUndistorter(
     const aslam::Camera& camera, float alpha, float scale,
-    aslam::InterpolationMethod interpolation_type) {
+    aslam::InterpolationMethod interpolation_type, UndistortMapType map_type,
+    const UndistortMapCache* map_cache) {
   switch (camera.getType()) {
     case Camera::Type::kUnifiedProjection: {
       const aslam::UnifiedProjectionCamera& unified_projection_cam =
           static_cast<const aslam::UnifiedProjectionCamera&>(camera);
       return createMappedUndistorter(
-          unified_projection_cam, alpha, scale, interpolation_type);
+          unified_projection_cam, alpha, scale, interpolation_type, map_type, map_cache);
     }
     case Camera::Type::kPinhole: {
       const aslam::PinholeCamera& pinhole_cam =
           static_cast<const aslam::PinholeCamera&>(camera);
       return createMappedUndistorter(
-          pinhole_cam, alpha, scale, interpolation_type);
+          pinhole_cam, alpha, scale, interpolation_type, map_type, map_cache);
     }
     default: {
       LOG(FATAL) << "Unknown camera model: "
@@ -36,7 +95,8 @@ inline std::unique_ptr<MappedUndistorter> createMappedUndistorter(
 template <typename CameraType>
 inline std::unique_ptr<MappedUndistorter> createMappedUndistorter(
     const CameraType& camera, float alpha, float scale,
-    aslam::InterpolationMethod interpolation_type) {
+    aslam::InterpolationMethod interpolation_type, UndistortMapType map_type,
+    const UndistortMapCache* map_cache) {
   CHECK_GE(alpha, 0.0);
   CHECK_LE(alpha, 1.0);
   CHECK_GT(scale, 0.0);
@@ -46,50 +106,12 @@ inline std::unique_ptr<MappedUndistorter> createMappedUndistorter(
   CHECK(input_camera);
 
   // Create the scaled output camera with removed distortion.
-  const bool kUndistortToPinhole = false;
-  Eigen::Matrix3d output_camera_matrix = common::getOptimalNewCameraMatrix(
-      *input_camera, alpha, scale, kUndistortToPinhole);
-
-  const int output_width = static_cast<int>(scale * input_camera->imageWidth());
-  const int output_height =
-      static_cast<int>(scale * input_camera->imageHeight());
+  Camera::Ptr output_camera = internal::createUndistortedOutputCamera(*input_camera, alpha, scale);
 
-  Camera::Ptr output_camera;
-  Eigen::MatrixXd intrinsics(input_camera->getParameterSize(), 1);
-  switch (input_camera->getType()) {
-    case Camera::Type::kPinhole:
-      intrinsics << output_camera_matrix(0, 0), output_camera_matrix(1, 1),
-          output_camera_matrix(0, 2), output_camera_matrix(1, 2);
-      output_camera.reset(
-          new PinholeCamera(intrinsics, output_width, output_height));
-      CHECK(output_camera);
-      break;
-    case Camera::Type::kUnifiedProjection: {
-      aslam::UnifiedProjectionCamera::ConstPtr unified_proj_cam_ptr =
-          std::dynamic_pointer_cast<const aslam::UnifiedProjectionCamera>(
-              input_camera);
-      CHECK(unified_proj_cam_ptr != nullptr)
-          << "Cast to unified projection camera failed.";
-      intrinsics << unified_proj_cam_ptr->xi(), output_camera_matrix(0, 0),
-          output_camera_matrix(1, 1), output_camera_matrix(0, 2),
-          output_camera_matrix(1, 2);
-      output_camera.reset(
-          new UnifiedProjectionCamera(intrinsics, output_width, output_height));
-      CHECK(output_camera);
-      break;
-    }
-    default:
-      LOG(FATAL) << "Unknown camera model: "
-                 << static_cast<std::underlying_type<Camera::Type>::type>(
-                        input_camera->getType());
-  }
-
-  cv::Mat map_u, map_v;
-  common::buildUndistortMap(
-      *input_camera, *output_camera, CV_16SC2, map_u, map_v);
-
-  return std::unique_ptr<MappedUndistorter>(new MappedUndistorter(
-      input_camera, output_camera, map_u, map_v, interpolation_type));
+  const bool kUndistortToPinhole = false;
+  return internal::createMappedUndistorterWithMaps(
+      input_camera, output_camera, alpha, scale, interpolation_type, map_type,
+      kUndistortToPinhole, map_cache);
 }
 
 }  // namespace aslam
@@ -11,6 +11,32 @@
 
 namespace aslam {
 
+class UndistortMapCache;
+
+/// \brief Storage format of the maps of a \ref MappedUndistorter.
+enum class UndistortMapType {
+  /// Two CV_32FC1 maps, 8 bytes per output pixel.
+  kFloat,
+  /// CV_16SC2 integer coordinates and a CV_16UC1 index into the interpolation table of
+  /// cv::remap (1/32 pixel resolution), 6 bytes per output pixel.
+  kFixedPoint,
+  /// Two CV_32FC1 maps holding every n-th pixel in each direction. The maps are expanded
+  /// bilinearly in strips of rows while remapping, 8 / n^2 bytes per output pixel.
+  kSubsampled
+};
+
+namespace internal {
+/// \brief Create the scaled output camera of the same model as the input camera with removed
+///        distortion. Shared by the undistorter factories to obtain the same output geometry.
+/// @param[in] input_camera The camera that produces the input images.
+/// @param[in] alpha Free scaling parameter between 0 (when all the pixels in the undistorted image
+///                  will be valid) and 1 (when all the source image pixels will be retained in the
+///                  undistorted image)
+/// @param[in] scale Output image size scaling parameter wrt. to input image size.
+/// @return The output camera. Supports pinhole and unified projection cameras.
+Camera::Ptr createUndistortedOutputCamera(const Camera& input_camera, float alpha, float scale);
+}  // namespace internal
+
 /// \brief Factory method to create a mapped undistorter for this camera geometry.
 ///        NOTE: The undistorter stores a copy of this camera and changes to the original geometry
 ///              are not connected with the undistorter!
@@ -22,11 +48,15 @@ namespace aslam {
 ///                  undistorted image)
 /// @param[in] scale Output image size scaling parameter wrt. to input image size.
 /// @param[in] interpolation_type Check \ref InterpolationMethod to see the available types.
+/// @param[in] map_type Storage format of the maps. Check \ref UndistortMapType.
+/// @param[in] map_cache Cache to load the maps from or store them to. Can be null.
 /// @return Pointer to the created mapped undistorter.
 template <typename CameraType>
 std::unique_ptr<MappedUndistorter> createMappedUndistorter(
     const CameraType& camera, float alpha, float scale,
-    aslam::InterpolationMethod interpolation_type);
+    aslam::InterpolationMethod interpolation_type,
+    UndistortMapType map_type = UndistortMapType::kFixedPoint,
+    const UndistortMapCache* map_cache = nullptr);
 
 /// \brief Factory method to create a mapped undistorter for this camera geometry to undistorts
 ///        the image to a pinhole view.
@@ -38,10 +68,14 @@ std::unique_ptr<MappedUndistorter> createMappedUndistorter(
 ///                  undistorted image)
 /// @param[in] scale Output image size scaling parameter wrt. to input image size.
 /// @param[in] interpolation_type Check \ref MappedUndistorter to see the available types.
+/// @param[in] map_type Storage format of the maps. Check \ref UndistortMapType.
+/// @param[in] map_cache Cache to load the maps from or store them to. Can be null.
 /// @return Pointer to the created mapped undistorter.
 std::unique_ptr<MappedUndistorter> createMappedUndistorterToPinhole(
     const aslam::UnifiedProjectionCamera& unified_proj_camera,
-    float alpha, float scale, aslam::InterpolationMethod interpolation_type);
+    float alpha, float scale, aslam::InterpolationMethod interpolation_type,
+    UndistortMapType map_type = UndistortMapType::kFixedPoint,
+    const UndistortMapCache* map_cache = nullptr);
 
 /// \class MappedUndistorter
 /// \brief A class that encapsulates image undistortion for building frames from images.
@@ -57,38 +91,82 @@ protected:
   MappedUndistorter();
 
 public:
+  /// Default distance between the map nodes in output pixels for
+  /// UndistortMapType::kSubsampled.
+  enum { kDefaultMapSubsampling = 8 };
+
   /// \brief Create a mapped undistorter using externally provided maps.
   ///
-  /// Map matrices (map_u and map_v) must be the size of the output camera geometry.
-  /// This will be checked by the constructor.
+  /// Map matrices (map_u and map_v) must be the size of the output camera geometry, or of the
+  /// subsampled geometry (see \ref common::buildSubsampledUndistortMap) if map_subsampling is
+  /// larger than one. This will be checked by the constructor.
   ///
-  /// \param[in] input_camera  The camera intrinsics for the original image.
-  /// \param[in] output_camera The camera intrinsics after undistortion.
-  /// \param[in] map_u         The map from input to output u coordinates.
-  /// \param[in] map_v         The map from input to output v coordinates.
-  /// \param[in] interpolation Interpolation method used for undistortion.
-  ///                          (\ref InterpolationMethod)
+  /// \param[in] input_camera    The camera intrinsics for the original image.
+  /// \param[in] output_camera   The camera intrinsics after undistortion.
+  /// \param[in] map_u           The map from input to output u coordinates.
+  /// \param[in] map_v           The map from input to output v coordinates.
+  /// \param[in] interpolation   Interpolation method used for undistortion.
+  ///                            (\ref InterpolationMethod)
+  /// \param[in] map_subsampling Distance between the map nodes in output pixels. Larger than
+  ///                            one for subsampled CV_32FC1 maps.
+  /// \param[in] map_storage     Keeps externally owned memory of the maps alive, e.g. a
+  ///                            memory-mapped \ref UndistortMapCache entry. Can be null.
   MappedUndistorter(aslam::Camera::Ptr input_camera, aslam::Camera::Ptr output_camera,
-                    const cv::Mat& map_u, const cv::Mat& map_v, InterpolationMethod interpolation);
+                    const cv::Mat& map_u, const cv::Mat& map_v, InterpolationMethod interpolation,
+                    int map_subsampling = 1,
+                    const std::shared_ptr<const void>& map_storage = nullptr);
 
   virtual ~MappedUndistorter() = default;
 
   /// \brief Produce an undistorted image from an input image.
   virtual void processImage(const cv::Mat& input_image, cv::Mat* output_image) const;
 
-  /// Get the undistorter map for the u-coordinate.
+  /// \brief Produce the output rows [row_begin, row_end) of the undistorted image. Rows are
+  ///        independent of each other, such that disjoint row ranges can be processed in
+  ///        parallel.
+  /// @param[in]     input_image  The input image.
+  /// @param[in]     row_begin    The first output row.
+  /// @param[in]     row_end      One past the last output row.
+  /// @param[in,out] output_image The output image. Must be allocated with the size of the output
+  ///                             camera and the type of the input image.
+  void processImageRows(const cv::Mat& input_image, int row_begin, int row_end,
+                        cv::Mat* output_image) const;
+
+  /// Get the undistorter map for the u-coordinate. Subsampled for UndistortMapType::kSubsampled.
   const cv::Mat& getUndistortMapU() const { return map_u_; };
 
-  /// Get the undistorter map for the u-coordinate.
+  /// Get the undistorter map for the u-coordinate. Subsampled for UndistortMapType::kSubsampled.
   const cv::Mat& getUndistortMapV() const { return map_v_; };
 
+  /// Get the storage format of the maps.
+  UndistortMapType getUndistortMapType() const { return map_type_; }
+
+  /// Get the distance between the map nodes in output pixels. One if not subsampled.
+  int getMapSubsampling() const { return map_subsampling_; }
+
+  /// Get the memory used by the maps in bytes.
+  size_t getMapMemoryBytes() const;
+
+  /// \brief Get full-resolution CV_32FC1 maps of the output image, regardless of the storage
+  ///        format. The values are the ones used by processImage.
+  void getDenseUndistortMaps(cv::Mat* map_u, cv::Mat* map_v) const;
+
 private:
+  /// \brief Bilinearly expand the subsampled maps for the output rows [row_begin, row_end).
+  void expandSubsampledMaps(int row_begin, int row_end, cv::Mat* map_u, cv::Mat* map_v) const;
+
   /// \brief LUT for u coordinates.
   const cv::Mat map_u_;
   /// \brief LUT for v coordinates.
   const cv::Mat map_v_;
   /// \brief Interpolation strategy
   InterpolationMethod interpolation_method_;
+  /// \brief Storage format of the maps.
+  UndistortMapType map_type_;
+  /// \brief Distance between the map nodes in output pixels.
+  int map_subsampling_;
+  /// \brief Externally owned memory of the maps. Can be null.
+  std::shared_ptr<const void> map_storage_;
 };
 
 }  // namespace aslam
@@ -0,0 +1,86 @@
+#ifndef ASLAM_PIPELINE_TILED_UNDISTORTER_H_
+#define ASLAM_PIPELINE_TILED_UNDISTORTER_H_
+
+#include <functional>
+#include <memory>
+
+#include <aslam/common/macros.h>
+#include <aslam/pipeline/undistorter-mapped.h>
+#include <aslam/pipeline/undistorter.h>
+
+namespace aslam {
+
+class ThreadPool;
+
+/// \class TiledUndistorter
+/// \brief Splits the remap of a \ref MappedUndistorter into tiles that are processed in parallel.
+///
+/// The output image is split into tiles of full rows, sized such that a tile of the output image
+/// and its part of the maps fit into the cache. The calling thread processes tiles itself and
+/// the threads of the pool help out. The calling thread never waits on a task in the pool, so
+/// the pool may be the one that runs the pipelines (e.g. of a \ref VisualNPipeline) without
+/// risking a deadlock.
+///
+/// processImageStreaming() hands out every tile as soon as it and all tiles above it are
+/// remapped, such that processing of a tile (e.g. feature detection) overlaps with the remap of
+/// the following tiles.
+class TiledUndistorter : public Undistorter {
+public:
+  ASLAM_POINTER_TYPEDEFS(TiledUndistorter);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(TiledUndistorter);
+
+  /// Default size of a tile in bytes of output image and maps. About the size of a L2 cache.
+  enum { kDefaultTileBytes = 512 * 1024 };
+
+  /// \brief Called with the output rows [row_begin, row_end) of a finished tile.
+  typedef std::function<void(int row_begin, int row_end)> TileCallback;
+
+  /// \brief Create a tiled undistorter that shares a thread pool.
+  ///
+  /// \param[in] undistorter The undistorter that remaps the tiles. Ownership is transferred.
+  /// \param[in] thread_pool The pool whose threads help with the tiles. If null, all tiles are
+  ///                        processed on the calling thread.
+  /// \param[in] tile_bytes  The size of a tile in bytes of output image and maps.
+  TiledUndistorter(std::unique_ptr<MappedUndistorter>& undistorter,
+                   const std::shared_ptr<ThreadPool>& thread_pool,
+                   size_t tile_bytes = kDefaultTileBytes);
+
+  /// \brief Create a tiled undistorter with its own thread pool.
+  ///
+  /// \param[in] undistorter The undistorter that remaps the tiles. Ownership is transferred.
+  /// \param[in] num_threads The number of threads processing the tiles, including the calling
+  ///                        thread.
+  /// \param[in] tile_bytes  The size of a tile in bytes of output image and maps.
+  TiledUndistorter(std::unique_ptr<MappedUndistorter>& undistorter, size_t num_threads,
+                   size_t tile_bytes = kDefaultTileBytes);
+
+  virtual ~TiledUndistorter();
+
+  /// \brief Produce an undistorted image from an input image.
+  virtual void processImage(const cv::Mat& input_image, cv::Mat* output_image) const;
+
+  /// \brief Produce an undistorted image and call tile_callback on the calling thread for
+  ///        every tile, top to bottom, as soon as all rows up to the end of the tile are
+  ///        remapped. The rows of the output image below the tile may still be written to while
+  ///        the callback runs.
+  void processImageStreaming(const cv::Mat& input_image, cv::Mat* output_image,
+                             const TileCallback& tile_callback) const;
+
+  /// \brief Number of output rows per tile for images of the given type.
+  int getTileRows(int image_type) const;
+
+  /// \brief The undistorter that remaps the tiles.
+  const MappedUndistorter& getMappedUndistorter() const { return *undistorter_; }
+
+private:
+  /// \brief The undistorter that remaps the tiles.
+  const std::unique_ptr<MappedUndistorter> undistorter_;
+  /// \brief The pool whose threads help with the tiles. Can be null.
+  std::shared_ptr<ThreadPool> thread_pool_;
+  /// \brief The size of a tile in bytes of output image and maps.
+  const size_t tile_bytes_;
+};
+
+}  // namespace aslam
+
+#endif // ASLAM_PIPELINE_TILED_UNDISTORTER_H_
@@ -8,6 +8,7 @@
 namespace cv { class Mat; };
 
 namespace aslam {
+class VisualFrame;
 
 /// \class Undistorter
 /// \brief A base class for image undistortion and resizing.
@@ -31,6 +32,15 @@ public:
   /// \brief Produce an undistorted image from an input image.
   virtual void processImage(const cv::Mat& input_image, cv::Mat* output_image) const = 0;
 
+  /// \brief Does processImage() transform the image to the output camera geometry? If not, the
+  ///        keypoints are detected on the input image and mapped to the output camera geometry
+  ///        by processKeypoints().
+  virtual bool transformsImage() const { return true; }
+
+  /// \brief Map the keypoints of a frame that were detected on the input image to the output
+  ///        camera geometry. Only called if transformsImage() returns false.
+  virtual void processKeypoints(VisualFrame* /* frame */) const { }
+
   /// \brief Get the input camera that corresponds to the image
   ///        passed in to processImage().
   ///
@@ -0,0 +1,129 @@
+#ifndef ASLAM_PIPELINE_VISUAL_NPIPELINE_BATCH_H_
+#define ASLAM_PIPELINE_VISUAL_NPIPELINE_BATCH_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/common/macros.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/visual-pipeline.h>
+#include <opencv2/core/core.hpp>
+
+namespace aslam {
+class ThreadPool;
+
+/// \class BatchVisualNPipeline
+/// \brief Turns a recorded sequence of synchronized images into VisualNFrames with maximum
+///        throughput.
+///
+/// Other than VisualNPipeline, the images of an nframe are handed in together, so there is no
+/// search for the images with matching timestamps. The images of all cameras and nframes in
+/// flight are processed out of order on all threads, and the VisualNFrames are handed to the
+/// output callback in the order of the input. The number of nframes in flight is bounded such
+/// that a long sequence does not have to fit into memory.
+///
+/// Progress is reported to a checkpoint callback with the index of the next nframe to process.
+/// All nframes before it were handed to the output, so a run can resume from this index.
+class BatchVisualNPipeline {
+public:
+  ASLAM_POINTER_TYPEDEFS(BatchVisualNPipeline);
+  ASLAM_DISALLOW_EVIL_CONSTRUCTORS(BatchVisualNPipeline);
+
+  /// The images of all cameras taken at the same time.
+  struct SynchronizedImages {
+    /// The timestamp of the nframe.
+    int64_t timestamp_nanoseconds;
+    /// The images, indexed by camera.
+    std::vector<cv::Mat> images;
+    SynchronizedImages() : timestamp_nanoseconds(0) {};
+  };
+
+  /// \brief Fill in the images of the nframe with the given index of the sequence.
+  /// @return Returns false at the end of the sequence.
+  typedef std::function<bool(size_t nframe_index, SynchronizedImages* images)> InputCallback;
+  /// \brief Called with the VisualNFrames in the order of the sequence.
+  typedef std::function<void(size_t nframe_index, int64_t timestamp_nanoseconds,
+                             const std::shared_ptr<VisualNFrame>& nframe)> OutputCallback;
+  /// \brief Called with the index of the next nframe to process. All nframes before it were
+  ///        handed to the output callback.
+  typedef std::function<void(size_t next_nframe_index)> CheckpointCallback;
+
+  struct Options {
+    /// The number of threads. Zero to use all cores.
+    size_t num_threads;
+    /// The max. number of nframes read but not yet handed to the output.
+    size_t max_nframes_in_flight;
+    /// Call the checkpoint callback after this many nframes. Zero to never call it.
+    size_t checkpoint_interval_nframes;
+    Options() :
+      num_threads(0u),
+      max_nframes_in_flight(64u),
+      checkpoint_interval_nframes(1000u) {};
+  };
+
+  /// \brief Create a batch pipeline.
+  ///
+  /// \param[in] options              The threads, nframes in flight and checkpoint interval.
+  /// \param[in] pipelines            The ordered image pipelines, one pipeline
+  ///                                 per camera in the same order as they are
+  ///                                 indexed in the camera system.
+  /// \param[in] output_camera_system The camera system of the processed images.
+  BatchVisualNPipeline(const Options& options,
+                       const std::vector<VisualPipeline::Ptr>& pipelines,
+                       const NCamera::Ptr& output_camera_system);
+
+  ~BatchVisualNPipeline();
+
+  /// \brief Process a sequence of synchronized images. Blocks until the input ends.
+  ///
+  /// \param[in] first_nframe_index The index of the first nframe to read, zero or the index of
+  ///                               the last checkpoint to resume.
+  /// \param[in] input              Provides the images of the sequence.
+  /// \param[in] output             Called with the VisualNFrames in the order of the sequence.
+  /// \param[in] checkpoint         Called every checkpoint interval and at the end. May be null.
+  /// @return Returns the index after the last nframe of the sequence.
+  size_t process(size_t first_nframe_index, const InputCallback& input,
+                 const OutputCallback& output, const CheckpointCallback& checkpoint);
+
+  /// \brief Number of threads processing the images.
+  size_t getNumThreads() const;
+
+private:
+  /// An nframe read but not yet handed to the output.
+  struct BatchNFrame {
+    size_t nframe_index;
+    int64_t timestamp_nanoseconds;
+    std::shared_ptr<VisualNFrame> nframe;
+    /// The number of images still being processed. Protected by mutex_.
+    size_t num_images_remaining;
+  };
+
+  /// \brief Process the image of a camera and add the frame to its nframe.
+  void processImage(size_t camera_index, const cv::Mat& image,
+                    const std::shared_ptr<BatchNFrame>& batch_nframe);
+
+  const size_t max_nframes_in_flight_;
+  const size_t checkpoint_interval_nframes_;
+
+  /// One visual pipeline for each camera.
+  std::vector<VisualPipeline::Ptr> pipelines_;
+  /// The camera system of the processed images.
+  NCamera::Ptr output_camera_system_;
+
+  /// A mutex to protect the number of images remaining.
+  std::mutex mutex_;
+  /// Condition variable signaling that an nframe is complete.
+  std::condition_variable condition_nframe_complete_;
+
+  /// The threads processing the images. Declared last to be joined first on destruction.
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+}  // namespace aslam
+
+#endif  // ASLAM_PIPELINE_VISUAL_NPIPELINE_BATCH_H_
@@ -1,10 +1,15 @@
 #ifndef VISUAL_NPIPELINE_H_
 #define VISUAL_NPIPELINE_H_
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 #include <opencv2/core/core.hpp>
@@ -14,6 +19,7 @@
 #include <aslam/common/thread-pool.h>
 #include <aslam/frames/visual-frame.h>
 #include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/nframe-assembler.h>
 #include <aslam/pipeline/visual-pipeline.h>
 
 namespace aslam {
@@ -43,11 +49,141 @@ namespace aslam {
 /// function retrieves the oldest complete VisualNFrames and leaves the remaining.
 /// The getLatestAndClear() function gets the newest VisualNFrames and discards
 /// anything older.
+///
+/// By default, every image is processed by one task in a thread pool. In the staged
+/// execution mode, preprocessing, keypoint detection, descriptor extraction and the
+/// assembly of the VisualNFrames run in separate stages with their own threads, such
+/// that a camera can detect keypoints on one image while it extracts the descriptors
+/// of the previous one. The stages are connected by bounded queues. The images of a
+/// camera pass every stage in order, so the threads of a stage work on different
+/// cameras.
+///
+/// In the scheduled execution mode, the cameras are assigned to worker sets with their own
+/// threads, which can be pinned to CPU cores. Within a worker set, the images are processed
+/// according to the priority weights of the cameras, so the cameras with a high weight keep
+/// their frame rate when the worker set is overloaded. The images are taken by weighted fair
+/// queuing in virtual time, such that a camera doesn't build up credit while it is idle.
 class VisualNPipeline final {
  public:
   ASLAM_POINTER_TYPEDEFS(VisualNPipeline);
   ASLAM_DISALLOW_EVIL_CONSTRUCTORS(VisualNPipeline);
 
+  /// The stages of the staged execution mode, in processing order.
+  enum class Stage {
+    kPreprocessing = 0,
+    kDetection = 1,
+    kExtraction = 2,
+    kAssembly = 3
+  };
+  static constexpr size_t kNumStages = 4u;
+
+  /// Threads and queue sizes of the staged execution mode.
+  struct StagedExecutionOptions {
+    /// The number of threads of every stage, indexed by \ref Stage.
+    std::array<size_t, kNumStages> num_threads;
+    /// The max. number of images waiting in front of the detection, extraction and
+    /// assembly stages. A stage blocks once the queue of the following stage is full.
+    /// The queue in front of the preprocessing stage is not bounded.
+    size_t max_queue_size;
+    StagedExecutionOptions() :
+      num_threads({{1u, 1u, 1u, 1u}}),
+      max_queue_size(4u) {};
+  };
+
+  /// Queue depth and timing of a stage of the staged execution mode.
+  struct StageStatistics {
+    /// The number of images currently waiting in front of the stage.
+    size_t queue_size;
+    /// The max. number of images that were waiting in front of the stage.
+    size_t max_queue_size;
+    /// The number of images the stage has processed.
+    size_t num_processed;
+    /// The mean and max. processing time of an image. [s]
+    double mean_processing_time_seconds;
+    double max_processing_time_seconds;
+    /// The total time the stage has been waiting for space in the following queue. [s]
+    double total_blocked_time_seconds;
+    StageStatistics() :
+      queue_size(0u),
+      max_queue_size(0u),
+      num_processed(0u),
+      mean_processing_time_seconds(0.0),
+      max_processing_time_seconds(0.0),
+      total_blocked_time_seconds(0.0) {};
+  };
+
+  /// Worker sets and priorities of the cameras in the scheduled execution mode.
+  struct CameraSchedulingOptions {
+    /// The threads of a worker set and the CPU cores they are pinned to.
+    struct WorkerSet {
+      size_t num_threads;
+      /// The CPU cores the threads may run on. Empty to not pin the threads.
+      std::vector<int> cpu_cores;
+      WorkerSet() : num_threads(1u) {};
+    };
+    std::vector<WorkerSet> worker_sets;
+    /// The worker set of every camera, indexed by camera. The cameras of a worker set
+    /// share its threads.
+    std::vector<size_t> camera_worker_sets;
+    /// The priority weight of every camera, indexed by camera. Empty for equal weights.
+    /// If a worker set is overloaded, a camera with weight 2 is given twice the images of a
+    /// camera with weight 1.
+    std::vector<double> camera_priority_weights;
+    /// The max. number of images of a camera waiting for a worker. Once reached, the oldest
+    /// waiting image of the camera is dropped. Zero for no limit.
+    size_t max_queued_images_per_camera;
+    CameraSchedulingOptions() :
+      max_queued_images_per_camera(0u) {};
+  };
+
+  /// Processed and dropped images of a camera in the scheduled execution mode.
+  struct CameraSchedulingStatistics {
+    /// The number of images waiting for a worker.
+    size_t num_queued;
+    /// The number of images processed.
+    size_t num_processed;
+    /// The number of images dropped because too many images of the camera were waiting.
+    size_t num_dropped;
+    CameraSchedulingStatistics() :
+      num_queued(0u),
+      num_processed(0u),
+      num_dropped(0u) {};
+  };
+
+  /// The bins of the latency histogram of the latency budget mode.
+  static constexpr size_t kNumLatencyHistogramBins = 100u;
+  static constexpr double kLatencyHistogramBinWidthSeconds = 1e-3;
+
+  /// Drop counts and end-to-end latencies of the latency budget mode.
+  struct LatencyStatistics {
+    /// The number of images skipped because their VisualNFrame was not expected to be
+    /// complete within the latency budget.
+    size_t num_skipped_images;
+    /// The number of VisualNFrames dropped because they completed after their deadline.
+    size_t num_late_nframes;
+    /// The number of incomplete or out-of-order VisualNFrames dropped by the assembly.
+    size_t num_dropped_nframes;
+    /// The number of VisualNFrames that completed within their deadline.
+    size_t num_output_nframes;
+    /// The mean and max. time from handing the first image of a VisualNFrame to the
+    /// pipeline until the VisualNFrame is complete, including late VisualNFrames. [s]
+    double mean_latency_seconds;
+    double max_latency_seconds;
+    /// The number of VisualNFrames per latency bin. Bin i counts the latencies in
+    /// [i, i + 1) * latency_histogram_bin_width_seconds, the last bin counts all longer ones.
+    std::vector<size_t> latency_histogram;
+    double latency_histogram_bin_width_seconds;
+    LatencyStatistics() :
+      num_skipped_images(0u),
+      num_late_nframes(0u),
+      num_dropped_nframes(0u),
+      num_output_nframes(0u),
+      mean_latency_seconds(0.0),
+      max_latency_seconds(0.0),
+      latency_histogram(kNumLatencyHistogramBins, 0u),
+      latency_histogram_bin_width_seconds(kLatencyHistogramBinWidthSeconds) {};
+  };
+
   /// \brief Initialize a working pipeline.
   ///
   /// \param[in] num_threads            The number of processing threads.
@@ -65,6 +201,40 @@ class VisualNPipeline final {
                   const NCamera::Ptr& output_camera_system,
                   int64_t timestamp_tolerance_ns);
 
+  /// \brief Initialize a working pipeline in the staged execution mode.
+  ///
+  /// \param[in] options                The threads and queue sizes of the stages.
+  /// \param[in] pipelines              The ordered image pipelines, one pipeline
+  ///                                   per camera in the same order as they are
+  ///                                   indexed in the camera system.
+  /// \param[in] input_camera_system    The camera system of the raw images.
+  /// \param[in] output_camera_system   The camera system of the processed images.
+  /// \param[in] timestamp_tolerance_ns How close should two image timestamps be
+  ///                                   for us to consider them part of the same
+  ///                                   synchronized frame?
+  VisualNPipeline(const StagedExecutionOptions& options,
+                  const std::vector<VisualPipeline::Ptr>& pipelines,
+                  const NCamera::Ptr& input_camera_system,
+                  const NCamera::Ptr& output_camera_system,
+                  int64_t timestamp_tolerance_ns);
+
+  /// \brief Initialize a working pipeline in the scheduled execution mode.
+  ///
+  /// \param[in] options                The worker sets and priorities of the cameras.
+  /// \param[in] pipelines              The ordered image pipelines, one pipeline
+  ///                                   per camera in the same order as they are
+  ///                                   indexed in the camera system.
+  /// \param[in] input_camera_system    The camera system of the raw images.
+  /// \param[in] output_camera_system   The camera system of the processed images.
+  /// \param[in] timestamp_tolerance_ns How close should two image timestamps be
+  ///                                   for us to consider them part of the same
+  ///                                   synchronized frame?
+  VisualNPipeline(const CameraSchedulingOptions& options,
+                  const std::vector<VisualPipeline::Ptr>& pipelines,
+                  const NCamera::Ptr& input_camera_system,
+                  const NCamera::Ptr& output_camera_system,
+                  int64_t timestamp_tolerance_ns);
+
   ~VisualNPipeline();
 
   /// Shutdown the thread pool and release blocking waiters.
@@ -111,6 +281,27 @@ class VisualNPipeline final {
       size_t camera_index, const cv::Mat &image, int64_t timestamp,
       size_t max_output_queue_size);
 
+  /// \brief Same as \ref processImage, but the image is skipped if its VisualNFrame is not
+  ///        expected to be complete within the latency budget. The expected latency is
+  ///        predicted from the measured processing times and the images queued in front.
+  ///
+  /// The first call switches the pipeline to the latency budget mode: a complete VisualNFrame
+  /// is moved to the output queue right away and the older incomplete ones are dropped, and a
+  /// VisualNFrame that completes after the deadline of any of its images is dropped. The drop
+  /// counts and latencies are reported by \ref getLatencyStatistics.
+  ///
+  /// \param[in] camera_index The index of the camera that this image corresponds to.
+  /// \param[in] image the image data.
+  /// \param[in] timestamp the time in integer nanoseconds.
+  /// \param[in] latency_budget_ns The max. time from this call until the VisualNFrame of the
+  ///            image is complete. [ns]
+  /// @return    Returns false if the image was skipped.
+  bool processImageWithinLatencyBudget(size_t camera_index, const cv::Mat& image,
+                                       int64_t timestamp, int64_t latency_budget_ns);
+
+  /// Get the drop counts and latencies of the latency budget mode.
+  LatencyStatistics getLatencyStatistics() const;
+
   /// How many completed VisualNFrames are waiting to be retrieved?
   size_t getNumFramesComplete() const;
 
@@ -152,6 +343,19 @@ class VisualNPipeline final {
   /// Blocks until all waiting frames are processed.
   void waitForAllWorkToComplete() const;
 
+  /// Is the pipeline running in the staged execution mode?
+  bool isStaged() const { return !stages_.empty(); }
+
+  /// Get the queue depth and timing of a stage. Only available in the staged execution mode.
+  StageStatistics getStageStatistics(Stage stage) const;
+
+  /// Is the pipeline running in the scheduled execution mode?
+  bool isScheduled() const { return !worker_sets_.empty(); }
+
+  /// Get the processed and dropped images of a camera. Only available in the scheduled
+  /// execution mode.
+  CameraSchedulingStatistics getCameraSchedulingStatistics(size_t camera_index) const;
+
   /// \brief  Create a test visual npipeline.
   ///
   /// @param[in]  num_cameras   The number of cameras in the pipeline (determines the number of
@@ -171,6 +375,56 @@ class VisualNPipeline final {
   /// \param[in] timestamp_nanoseconds The time in integer nanoseconds.
   void work(size_t camera_index, const cv::Mat& image, int64_t timestamp_nanoseconds);
 
+  /// \brief Check that the pipelines match the camera systems.
+  void checkPipelines() const;
+
+  /// \brief Add a processed frame to its VisualNFrame. The complete VisualNFrames are moved
+  ///        to the output queue by the assembler.
+  void assembleNFrame(size_t camera_index, const std::shared_ptr<VisualFrame>& frame);
+
+  /// \brief Called by the assembler with the complete VisualNFrames in chronological order.
+  void addCompleteNFrame(int64_t timestamp_nanoseconds,
+                         const std::shared_ptr<VisualNFrame>& nframe);
+
+  /// An image on its way through the stages of the staged execution mode.
+  struct StagedImage {
+    size_t camera_index;
+    int64_t timestamp_nanoseconds;
+    /// The raw image until preprocessed, the preprocessed image afterwards.
+    cv::Mat image;
+    std::shared_ptr<VisualFrame> frame;
+  };
+
+  /// A stage of the staged execution mode: the threads and the queue in front of them.
+  struct ExecutionStage {
+    std::unique_ptr<ThreadPool> thread_pool;
+    StageStatistics statistics;
+    double total_processing_time_seconds;
+  };
+
+  /// \brief Enqueue an image to a stage. Blocks while the queue of the stage is full unless
+  ///        the stage is the preprocessing stage.
+  void enqueueToStage(Stage stage, const std::shared_ptr<StagedImage>& staged_image);
+
+  /// \brief Run a stage on an image and pass it on to the next stage.
+  void runStage(Stage stage, const std::shared_ptr<StagedImage>& staged_image);
+
+  /// \brief Process the next image of a worker set in the scheduled execution mode. The image
+  ///        with the earliest virtual finish time is taken.
+  void workScheduled(size_t worker_set_index);
+
+  /// \brief Predict the time until the VisualNFrame of an image handed in now is complete.
+  double predictLatencySeconds(size_t camera_index) const;
+
+  /// \brief Key the deadline of an image by the timestamp of its frame, which a timestamp
+  ///        corrector of the pipeline may have changed from the submitted timestamp.
+  void moveImageDeadlineToFrame(size_t camera_index, int64_t submitted_timestamp_nanoseconds,
+                                const VisualFrame& frame);
+
+  /// \brief Update the latency statistics with a complete VisualNFrame.
+  /// @return Returns false if the VisualNFrame completed after its deadline.
+  bool checkNFrameDeadline(const VisualNFrame& nframe, int64_t timestamp_nanoseconds);
+
   std::shared_ptr<VisualNFrame> getNextImpl();
 
   void processImageImpl(size_t camera_index, const cv::Mat& image,
@@ -179,7 +433,7 @@ class VisualNPipeline final {
   /// One visual pipeline for each camera.
   std::vector<std::shared_ptr<VisualPipeline>> pipelines_;
 
-  /// A mutex to protect the processing and completed queues.
+  /// A mutex to protect the completed queue.
   mutable std::mutex mutex_;
   /// Condition variable signaling that the output queue is not full.
   std::condition_variable condition_not_full_;
@@ -189,14 +443,73 @@ class VisualNPipeline final {
   std::atomic<bool> shutdown_;
 
   typedef std::map<int64_t, std::shared_ptr<VisualNFrame>> TimestampVisualNFrameMap;
-  /// The frames that are in progress.
-  TimestampVisualNFrameMap processing_;
   /// The output queue of completed frames.
   TimestampVisualNFrameMap completed_;
 
-  /// A thread pool for processing.
+  /// Groups the processed frames into VisualNFrames.
+  std::unique_ptr<NFrameAssembler> assembler_;
+
+  /// A thread pool for processing. Null in the staged and scheduled execution modes.
   std::shared_ptr<aslam::ThreadPool> thread_pool_;
 
+  /// The stages, indexed by \ref Stage. Empty unless in the staged execution mode.
+  std::vector<ExecutionStage> stages_;
+  /// The max. number of images waiting in front of a stage.
+  size_t max_stage_queue_size_;
+  /// A mutex to protect the stage queues and statistics.
+  mutable std::mutex stage_mutex_;
+  /// Condition variable signaling that a stage queue is not full.
+  std::condition_variable condition_stage_not_full_;
+
+  /// The time an image was handed to the pipeline and its deadline in the latency budget mode.
+  struct ImageDeadline {
+    std::chrono::steady_clock::time_point submission_time;
+    std::chrono::steady_clock::time_point deadline;
+  };
+  /// Is the pipeline in the latency budget mode?
+  std::atomic<bool> is_latency_budget_enabled_;
+  /// A mutex to protect the deadlines, latency statistics and work times.
+  mutable std::mutex latency_mutex_;
+  /// The deadlines of the images waiting for their frame, keyed by camera index and submitted
+  /// timestamp.
+  std::map<std::pair<size_t, int64_t>, ImageDeadline> image_deadlines_;
+  /// The deadlines of the frames waiting for their VisualNFrame, keyed by frame timestamp and
+  /// camera index. Ordered by timestamp, such that the deadlines of the frames older than an
+  /// output VisualNFrame are a prefix of the map.
+  std::map<std::pair<int64_t, size_t>, ImageDeadline> frame_deadlines_;
+  LatencyStatistics latency_statistics_;
+  double total_latency_seconds_;
+  /// The number of thread pool tasks and their total processing time. [s]
+  size_t num_work_done_;
+  double total_work_time_seconds_;
+
+  /// A worker set of the scheduled execution mode.
+  struct WorkerSet {
+    WorkerSet() : virtual_time(0.0) {}
+    std::unique_ptr<ThreadPool> thread_pool;
+    std::vector<size_t> camera_indices;
+    /// The virtual start time of the image taken last. An image takes 1 / weight of its camera
+    /// in virtual time.
+    double virtual_time;
+  };
+  /// The images of a camera waiting for a worker in the scheduled execution mode.
+  struct ScheduledCamera {
+    ScheduledCamera() : worker_set_index(0u), priority_weight(1.0), virtual_finish_time(0.0) {}
+    size_t worker_set_index;
+    double priority_weight;
+    /// The virtual finish time of the image of the camera taken last.
+    double virtual_finish_time;
+    std::deque<std::pair<cv::Mat, int64_t>> queued_images;
+    CameraSchedulingStatistics statistics;
+  };
+  /// The worker sets. Empty unless in the scheduled execution mode.
+  std::vector<WorkerSet> worker_sets_;
+  /// The cameras, indexed by camera. Empty unless in the scheduled execution mode.
+  std::vector<ScheduledCamera> scheduled_cameras_;
+  size_t max_queued_images_per_camera_;
+  /// A mutex to protect the scheduled cameras and the virtual times of the worker sets.
+  mutable std::mutex scheduling_mutex_;
+
   /// The camera system of the raw images.
   std::shared_ptr<NCamera> input_camera_system_;
   /// The camera system of the processed images.
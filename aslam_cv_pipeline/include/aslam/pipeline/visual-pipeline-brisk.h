@@ -83,7 +83,18 @@ protected:
   /// \param[in/out] frame The visual frame. This will be constructed before calling.
   virtual void processFrameImpl(const cv::Mat& image,
                                 VisualFrame* frame) const;
+
+  /// \brief Detect the keypoints and store them in the frame.
+  virtual void detectKeypointsImpl(const cv::Mat& image, VisualFrame* frame) const;
+
+  /// \brief Compute the descriptors of the keypoints stored in the frame.
+  virtual void computeDescriptorsImpl(const cv::Mat& image, VisualFrame* frame) const;
 private:
+  /// \brief Compute the descriptors and store them together with the keypoints in the frame.
+  ///        The extractor may remove keypoints.
+  void describeKeypoints(const cv::Mat& image, std::vector<cv::KeyPoint>* keypoints,
+                         VisualFrame* frame) const;
+
   std::shared_ptr<cv::Feature2D> detector_;
   std::shared_ptr<cv::Feature2D> extractor_;
 
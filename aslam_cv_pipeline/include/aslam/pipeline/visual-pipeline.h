@@ -1,12 +1,15 @@
 #ifndef VISUAL_PROCESSOR_H
 #define VISUAL_PROCESSOR_H
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include <opencv2/core/core.hpp>
 
 #include <aslam/cameras/camera.h>
 #include <aslam/common/macros.h>
+#include <aslam/pipeline/buffer-pool.h>
 #include <aslam/pipeline/undistorter.h>
 #include <aslam/frames/visual-frame.h>
 
@@ -32,6 +35,9 @@ public:
   ASLAM_POINTER_TYPEDEFS(VisualPipeline);
   ASLAM_DISALLOW_EVIL_CONSTRUCTORS(VisualPipeline);
 
+  /// \brief Called once an externally owned image is no longer used.
+  typedef std::function<void()> ImageReleaseCallback;
+
 protected:
   VisualPipeline() : copy_images_(false) {};
 
@@ -47,6 +53,7 @@ public:
   /// \brief Construct a visual pipeline from the input and output cameras
   ///
   /// \param[in] preprocessing Preprocessing to apply to the image before sending to the pipeline.
+  ///                          A \ref KeypointUndistorter maps the detected keypoints instead.
   /// \param[in] copy_images    Should we copy the image before storing it in the frame?
   VisualPipeline(std::unique_ptr<Undistorter>& preprocessing, bool copy_images);
 
@@ -63,6 +70,53 @@ public:
   /// \returns                  The visual frame built from the image data.
   VisualFrame::Ptr processImage(const cv::Mat& image, int64_t timestamp) const;
 
+  /// \brief Add an image whose memory is owned externally, e.g. by a camera driver.
+  ///
+  /// The image is not copied unless the pipeline copies images. release_callback is called
+  /// once neither the pipeline nor the returned frame use the image any more, which is at the
+  /// end of this call if the image is copied.
+  ///
+  /// \param[in] image            The image data.
+  /// \param[in] timestamp        The time in integer nanoseconds.
+  /// \param[in] release_callback Called once the image is no longer used. Can be empty.
+  /// \returns                    The visual frame built from the image data.
+  VisualFrame::Ptr processImage(const cv::Mat& image, int64_t timestamp,
+                                const ImageReleaseCallback& release_callback) const;
+
+  /// \brief Recycle the frames, the copied raw images and the preprocessed images across calls
+  ///        of processImage(), such that processing does not allocate them in steady state.
+  ///
+  /// Frames and images are recycled once all shared pointers and cv::Mat referencing them are
+  /// released. Frames holding an externally owned image are not recycled. The keypoints and
+  /// descriptors, and the temporaries of the feature detection and extraction, are still
+  /// allocated for every frame. Must not be called concurrently with processImage().
+  ///
+  /// \param[in] max_num_frames The number of frames that can be in use at the same time before
+  ///                           new frames are allocated.
+  void enableBufferPools(size_t max_num_frames = VisualFramePool::kDefaultMaxNumFrames);
+
+  /// \name Stages of processImage()
+  /// processImage() runs these stages in order. They are exposed such that a
+  /// \ref VisualNPipeline can run the stages of consecutive images in parallel.
+  /// @{
+
+  /// \brief Construct the frame and preprocess the image.
+  ///
+  /// \param[in]  raw_image The image data.
+  /// \param[in]  timestamp The time in integer nanoseconds.
+  /// \param[out] image     The preprocessed image, input to the following stages.
+  /// \returns              The visual frame without keypoints.
+  VisualFrame::Ptr preprocessImage(const cv::Mat& raw_image, int64_t timestamp,
+                                   cv::Mat* image) const;
+
+  /// \brief Detect the keypoints on the preprocessed image.
+  void detectKeypoints(const cv::Mat& image, VisualFrame* frame) const;
+
+  /// \brief Compute the descriptors of the detected keypoints and map the keypoints to the
+  ///        output camera if the preprocessing did not transform the image.
+  void computeDescriptors(const cv::Mat& image, VisualFrame* frame) const;
+  /// @}
+
   /// \brief Get the input camera that corresponds to the image
   ///        passed in to processImage().
   ///
@@ -101,6 +155,33 @@ protected:
   virtual void processFrameImpl(const cv::Mat& image,
                                 VisualFrame* frame) const = 0;
 
+  /// \brief Detect the keypoints and store them in the frame.
+  ///
+  /// Pipelines that can split detection and description override this and
+  /// computeDescriptorsImpl(). By default, the whole processFrameImpl() runs here.
+  virtual void detectKeypointsImpl(const cv::Mat& image, VisualFrame* frame) const {
+    processFrameImpl(image, frame);
+  }
+
+  /// \brief Compute the descriptors of the keypoints stored in the frame.
+  virtual void computeDescriptorsImpl(const cv::Mat& /* image */,
+                                      VisualFrame* /* frame */) const { }
+
+  /// \brief Store OpenCV keypoints in the keypoint channels of the frame.
+  static void setFrameKeypoints(const std::vector<cv::KeyPoint>& keypoints, VisualFrame* frame);
+
+  /// \brief Rebuild the OpenCV keypoints from the keypoint channels of the frame.
+  static void getFrameKeypoints(const VisualFrame& frame, std::vector<cv::KeyPoint>* keypoints);
+
+  /// \brief Build the frame. image_owner is null unless the image is owned externally.
+  VisualFrame::Ptr processImageImpl(const cv::Mat& raw_image, int64_t timestamp,
+                                    const std::shared_ptr<const void>& image_owner) const;
+
+  /// \brief Construct the frame and preprocess the image.
+  VisualFrame::Ptr preprocessImageImpl(const cv::Mat& raw_image, int64_t timestamp,
+                                       const std::shared_ptr<const void>& image_owner,
+                                       cv::Mat* image) const;
+
   /// \brief Preprocessing for the image. Can be null.
   const std::unique_ptr<Undistorter> preprocessing_;
   /// \brief The intrinsics of the raw image.
@@ -109,6 +190,11 @@ protected:
   std::shared_ptr<const Camera> output_camera_;
   /// \brief Should we copy the image before storing it in the frame?
   bool copy_images_;
+  /// \brief Recycles the frames. Null unless the buffer pools are enabled.
+  std::unique_ptr<VisualFramePool> frame_pool_;
+  /// \brief Recycles the copied raw images and the preprocessed images. Null unless the buffer
+  ///        pools are enabled.
+  std::unique_ptr<ImageBufferPool> image_pool_;
 };
 }  // namespace aslam
 
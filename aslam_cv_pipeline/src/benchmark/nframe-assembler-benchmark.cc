@@ -0,0 +1,70 @@
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/cameras/random-camera-generator.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/nframe-assembler.h>
+
+// Measures the throughput of NFrameAssembler for camera systems of increasing size. As in
+// VisualNPipeline, every camera hands in its frames from its own thread.
+
+constexpr size_t kNumNFrames = 20000u;
+constexpr int64_t kFramePeriodNs = 1000;
+constexpr int64_t kToleranceNs = 100;
+
+TEST(NFrameAssemblerBenchmark, ScaleNumCameras) {
+  for (size_t num_cameras : {2u, 4u, 8u, 16u}) {
+    aslam::NCamera::Ptr camera_system = aslam::createTestNCamera(num_cameras);
+    std::atomic<size_t> num_nframes_out(0u);
+    aslam::NFrameAssembler assembler(
+        camera_system, kToleranceNs,
+        [&num_nframes_out](int64_t /* timestamp_nanoseconds */,
+                           const std::shared_ptr<aslam::VisualNFrame>& /* nframe */) {
+          ++num_nframes_out;
+        });
+
+    // Create the frames up front to only measure the assembly.
+    std::vector<std::vector<aslam::VisualFrame::Ptr>> frames(num_cameras);
+    for (size_t camera_index = 0u; camera_index < num_cameras; ++camera_index) {
+      frames[camera_index].reserve(kNumNFrames);
+      for (size_t nframe_index = 0u; nframe_index < kNumNFrames; ++nframe_index) {
+        aslam::VisualFrame::Ptr frame(new aslam::VisualFrame);
+        frame->setTimestampNanoseconds(static_cast<int64_t>(nframe_index) * kFramePeriodNs +
+                                       static_cast<int64_t>(camera_index));
+        frames[camera_index].push_back(frame);
+      }
+    }
+
+    const std::string timer_name = std::to_string(num_cameras) + " cameras";
+    timing::TimerImpl timer(timer_name);
+    std::vector<std::thread> threads;
+    for (size_t camera_index = 0u; camera_index < num_cameras; ++camera_index) {
+      threads.emplace_back([&assembler, &frames, camera_index]() {
+        for (const aslam::VisualFrame::Ptr& frame : frames[camera_index]) {
+          assembler.addFrame(camera_index, frame);
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    timer.Stop();
+
+    LOG(INFO) << timer_name << ": "
+              << timing::Timing::GetMeanSeconds(timer_name) * 1e6 / kNumNFrames
+              << " us per nframe, " << num_nframes_out << " of " << kNumNFrames
+              << " nframes complete";
+  }
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+#include <aslam/pipeline/undistorter-keypoint.h>
+#include <aslam/pipeline/undistorter-mapped.h>
+#include <aslam/pipeline/undistorter-tiled.h>
+
+// Compares the throughput and the map memory of MappedUndistorter for the different map types
+// on a 2 MP camera, the full-image remap to mapping only the keypoints with
+// KeypointUndistorter, and the single-threaded to the tiled remap on a 12 MP camera.
+
+constexpr int kNumRepetitions = 50;
+constexpr int kNumKeypoints = 1000;
+
+TEST(MappedUndistorterBenchmark, CompareMapTypes) {
+  Eigen::VectorXd distortion_parameters(4);
+  distortion_parameters << -0.28, 0.08, -0.00026, -0.00024;
+  aslam::Distortion::UniquePtr distortion(new aslam::RadTanDistortion(distortion_parameters));
+  aslam::PinholeCamera camera(1200, 1200, 960, 540, 1920, 1080, distortion);
+
+  cv::Mat input_image(camera.imageHeight(), camera.imageWidth(), CV_8UC1);
+  cv::randu(input_image, 0, 255);
+  cv::Mat output_image;
+
+  const std::pair<aslam::UndistortMapType, std::string> map_types[] = {
+      {aslam::UndistortMapType::kFloat, "float"},
+      {aslam::UndistortMapType::kFixedPoint, "fixed-point"},
+      {aslam::UndistortMapType::kSubsampled, "subsampled"}};
+  for (const std::pair<aslam::UndistortMapType, std::string>& map_type : map_types) {
+    std::unique_ptr<aslam::MappedUndistorter> undistorter = aslam::createMappedUndistorter(
+        camera, 0.0, 1.0, aslam::InterpolationMethod::Linear, map_type.first);
+    for (int rep = 0; rep < kNumRepetitions; ++rep) {
+      timing::TimerImpl timer(map_type.second);
+      undistorter->processImage(input_image, &output_image);
+      timer.Stop();
+    }
+    LOG(INFO) << map_type.second << ": "
+              << timing::Timing::GetMeanSeconds(map_type.second) * 1e3 << " ms per image, "
+              << undistorter->getMapMemoryBytes() / 1e6 << " MB of maps";
+  }
+}
+
+TEST(MappedUndistorterBenchmark, CompareToKeypointUndistorter) {
+  Eigen::VectorXd distortion_parameters(4);
+  distortion_parameters << -0.28, 0.08, -0.00026, -0.00024;
+  aslam::Distortion::UniquePtr distortion(new aslam::RadTanDistortion(distortion_parameters));
+  aslam::PinholeCamera camera(1200, 1200, 960, 540, 1920, 1080, distortion);
+
+  cv::Mat input_image(camera.imageHeight(), camera.imageWidth(), CV_8UC1);
+  cv::randu(input_image, 0, 255);
+  cv::Mat output_image;
+  Eigen::Matrix2Xd input_keypoints(2, kNumKeypoints);
+  for (int i = 0; i < kNumKeypoints; ++i) {
+    input_keypoints.col(i) = camera.createRandomKeypoint();
+  }
+  const Eigen::VectorXd input_orientations = Eigen::VectorXd::Constant(kNumKeypoints, 45.0);
+  const Eigen::VectorXd input_scales = Eigen::VectorXd::Constant(kNumKeypoints, 12.0);
+
+  std::unique_ptr<aslam::MappedUndistorter> mapped_undistorter = aslam::createMappedUndistorter(
+      camera, 0.0, 1.0, aslam::InterpolationMethod::Linear);
+  std::unique_ptr<aslam::KeypointUndistorter> keypoint_undistorter =
+      aslam::createKeypointUndistorter(camera, 0.0, 1.0);
+  Eigen::Matrix2Xd keypoints;
+  Eigen::VectorXd orientations, scales;
+  std::vector<unsigned char> success;
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer_remap("image remap");
+    mapped_undistorter->processImage(input_image, &output_image);
+    timer_remap.Stop();
+
+    keypoints = input_keypoints;
+    orientations = input_orientations;
+    scales = input_scales;
+    timing::TimerImpl timer_keypoints("keypoint mapping");
+    keypoint_undistorter->undistortKeypoints(&keypoints, &orientations, &scales, &success);
+    timer_keypoints.Stop();
+  }
+  LOG(INFO) << "image remap: " << timing::Timing::GetMeanSeconds("image remap") * 1e3
+            << " ms per image, mapping " << kNumKeypoints << " keypoints: "
+            << timing::Timing::GetMeanSeconds("keypoint mapping") * 1e3 << " ms per image";
+}
+
+TEST(MappedUndistorterBenchmark, CompareToTiledUndistorter) {
+  Eigen::VectorXd distortion_parameters(4);
+  distortion_parameters << -0.28, 0.08, -0.00026, -0.00024;
+  aslam::Distortion::UniquePtr distortion(new aslam::RadTanDistortion(distortion_parameters));
+  aslam::PinholeCamera camera(2500, 2500, 2000, 1500, 4000, 3000, distortion);
+
+  cv::Mat input_image(camera.imageHeight(), camera.imageWidth(), CV_8UC1);
+  cv::randu(input_image, 0, 255);
+  cv::Mat output_image;
+
+  const size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  std::unique_ptr<aslam::MappedUndistorter> mapped_undistorter = aslam::createMappedUndistorter(
+      camera, 0.0, 1.0, aslam::InterpolationMethod::Linear);
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer("single-threaded");
+    mapped_undistorter->processImage(input_image, &output_image);
+    timer.Stop();
+  }
+  aslam::TiledUndistorter tiled_undistorter(mapped_undistorter, num_threads);
+  for (int rep = 0; rep < kNumRepetitions; ++rep) {
+    timing::TimerImpl timer("tiled");
+    tiled_undistorter.processImage(input_image, &output_image);
+    timer.Stop();
+  }
+  LOG(INFO) << "single-threaded: " << timing::Timing::GetMeanSeconds("single-threaded") * 1e3
+            << " ms per image, tiled on " << num_threads << " threads ("
+            << tiled_undistorter.getTileRows(input_image.type()) << " rows per tile): "
+            << timing::Timing::GetMeanSeconds("tiled") * 1e3 << " ms per image";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
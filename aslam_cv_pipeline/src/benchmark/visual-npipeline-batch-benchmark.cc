@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/cameras/random-camera-generator.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/timer.h>
+#include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/visual-npipeline.h>
+#include <aslam/pipeline/visual-npipeline-batch.h>
+#include <aslam/pipeline/visual-pipeline-null.h>
+
+// Measures the frames per second of BatchVisualNPipeline on a recorded sequence for an
+// increasing number of threads, and of VisualNPipeline fed with the same images one by one.
+
+constexpr size_t kNumCameras = 4u;
+constexpr size_t kNumNFrames = 500u;
+constexpr int64_t kFramePeriodNs = 50000000;
+
+namespace {
+std::vector<aslam::VisualPipeline::Ptr> createPipelines(
+    const aslam::NCamera::Ptr& camera_system) {
+  // Copying the images gives the pipelines some memory bound work.
+  const bool kCopyImages = true;
+  std::vector<aslam::VisualPipeline::Ptr> pipelines;
+  for (size_t camera_index = 0u; camera_index < camera_system->getNumCameras();
+       ++camera_index) {
+    pipelines.emplace_back(new aslam::NullVisualPipeline(
+        camera_system->getCameraShared(camera_index), kCopyImages));
+  }
+  return pipelines;
+}
+
+std::vector<cv::Mat> createImages(const aslam::NCamera& camera_system) {
+  std::vector<cv::Mat> images;
+  for (size_t camera_index = 0u; camera_index < camera_system.getNumCameras(); ++camera_index) {
+    const aslam::Camera& camera = camera_system.getCamera(camera_index);
+    cv::Mat image(camera.imageHeight(), camera.imageWidth(), CV_8UC1);
+    cv::randu(image, 0, 255);
+    images.push_back(image);
+  }
+  return images;
+}
+}  // namespace
+
+TEST(VisualNPipelineBatchBenchmark, ScaleNumThreads) {
+  aslam::NCamera::Ptr camera_system = aslam::createTestNCamera(kNumCameras);
+  const std::vector<cv::Mat> images = createImages(*camera_system);
+  const size_t max_num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+  for (size_t num_threads = 1u; num_threads <= max_num_threads; num_threads *= 2u) {
+    aslam::BatchVisualNPipeline::Options options;
+    options.num_threads = num_threads;
+    aslam::BatchVisualNPipeline pipeline(options, createPipelines(camera_system), camera_system);
+
+    size_t num_nframes_out = 0u;
+    const std::string timer_name = "batch, " + std::to_string(num_threads) + " threads";
+    timing::TimerImpl timer(timer_name);
+    pipeline.process(
+        0u,
+        [&images](size_t nframe_index, aslam::BatchVisualNPipeline::SynchronizedImages* input) {
+          if (nframe_index == kNumNFrames) {
+            return false;
+          }
+          input->timestamp_nanoseconds = static_cast<int64_t>(nframe_index) * kFramePeriodNs;
+          input->images = images;
+          return true;
+        },
+        [&num_nframes_out](size_t /* nframe_index */, int64_t /* timestamp_nanoseconds */,
+                           const std::shared_ptr<aslam::VisualNFrame>& /* nframe */) {
+          ++num_nframes_out;
+        },
+        aslam::BatchVisualNPipeline::CheckpointCallback());
+    timer.Stop();
+    EXPECT_EQ(kNumNFrames, num_nframes_out);
+
+    LOG(INFO) << timer_name << ": "
+              << kNumNFrames / timing::Timing::GetMeanSeconds(timer_name) << " nframes/s";
+  }
+}
+
+TEST(VisualNPipelineBatchBenchmark, CompareToVisualNPipeline) {
+  aslam::NCamera::Ptr camera_system = aslam::createTestNCamera(kNumCameras);
+  const std::vector<cv::Mat> images = createImages(*camera_system);
+  const size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  aslam::VisualNPipeline pipeline(num_threads, createPipelines(camera_system), camera_system,
+                                  camera_system, kFramePeriodNs / 2);
+
+  size_t num_nframes_out = 0u;
+  const std::string timer_name = "live, " + std::to_string(num_threads) + " threads";
+  timing::TimerImpl timer(timer_name);
+  for (size_t nframe_index = 0u; nframe_index < kNumNFrames; ++nframe_index) {
+    for (size_t camera_index = 0u; camera_index < kNumCameras; ++camera_index) {
+      pipeline.processImage(camera_index, images[camera_index],
+                            static_cast<int64_t>(nframe_index) * kFramePeriodNs);
+    }
+    while (pipeline.getNext()) {
+      ++num_nframes_out;
+    }
+  }
+  pipeline.waitForAllWorkToComplete();
+  while (pipeline.getNext()) {
+    ++num_nframes_out;
+  }
+  timer.Stop();
+
+  LOG(INFO) << timer_name << ": "
+            << num_nframes_out / timing::Timing::GetMeanSeconds(timer_name) << " nframes/s, "
+            << num_nframes_out << " of " << kNumNFrames << " nframes complete";
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
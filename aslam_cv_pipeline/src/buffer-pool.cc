@@ -0,0 +1,87 @@
+#include "aslam/pipeline/buffer-pool.h"
+
+#include <aslam/common/time.h>
+#include <glog/logging.h>
+
+namespace aslam {
+
+ImageBufferPool::ImageBufferPool(size_t max_num_buffers)
+    : max_num_buffers_(max_num_buffers) {
+  CHECK_GT(max_num_buffers_, 0u);
+  buffers_.reserve(max_num_buffers_);
+}
+
+bool ImageBufferPool::isFree(const cv::Mat& buffer) {
+  // The reference count is modified atomically by the cv::Mat sharing the buffer.
+  return buffer.u != nullptr && CV_XADD(&buffer.u->refcount, 0) == 1;
+}
+
+cv::Mat ImageBufferPool::acquire(int rows, int cols, int type) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv::Mat* free_buffer = nullptr;
+  for (cv::Mat& buffer : buffers_) {
+    if (!isFree(buffer)) {
+      continue;
+    }
+    if (buffer.rows == rows && buffer.cols == cols && buffer.type() == type) {
+      return buffer;
+    }
+    free_buffer = &buffer;
+  }
+  if (buffers_.size() < max_num_buffers_) {
+    buffers_.emplace_back(rows, cols, type);
+    return buffers_.back();
+  }
+  if (free_buffer != nullptr) {
+    // Replace a free buffer of a different size, e.g. after the image size changed.
+    free_buffer->create(rows, cols, type);
+    return *free_buffer;
+  }
+  VLOG(3) << "All " << max_num_buffers_ << " image buffers are in use, allocating a new image.";
+  return cv::Mat(rows, cols, type);
+}
+
+size_t ImageBufferPool::getNumBuffers() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return buffers_.size();
+}
+
+VisualFramePool::VisualFramePool(size_t max_num_frames)
+    : max_num_frames_(max_num_frames) {
+  CHECK_GT(max_num_frames_, 0u);
+  frames_.reserve(max_num_frames_);
+}
+
+void VisualFramePool::resetFrame(VisualFrame* frame) {
+  CHECK_NOTNULL(frame);
+  frame->setTimestampNanoseconds(time::getInvalidTime());
+  frame->setId(FrameId());
+  frame->setCameraGeometry(nullptr);
+  frame->setRawCameraGeometry(nullptr);
+  frame->validate();
+  // Also drops the reference to the image buffer, such that it can be recycled.
+  frame->resetChannels();
+}
+
+VisualFrame::Ptr VisualFramePool::acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (const VisualFrame::Ptr& frame : frames_) {
+    if (frame.use_count() == 1) {
+      resetFrame(frame.get());
+      return frame;
+    }
+  }
+  if (frames_.size() < max_num_frames_) {
+    frames_.emplace_back(new VisualFrame);
+    return frames_.back();
+  }
+  VLOG(3) << "All " << max_num_frames_ << " frames are in use, allocating a new frame.";
+  return VisualFrame::Ptr(new VisualFrame);
+}
+
+size_t VisualFramePool::getNumFrames() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return frames_.size();
+}
+
+}  // namespace aslam
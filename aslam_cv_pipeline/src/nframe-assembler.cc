@@ -0,0 +1,294 @@
+#include "aslam/pipeline/nframe-assembler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace {
+// Erase the entry holding the value from a map keyed by timestamp.
+template <typename MapType>
+bool eraseValue(const typename MapType::key_type& key,
+                const typename MapType::mapped_type& value, MapType* map) {
+  CHECK_NOTNULL(map);
+  typename MapType::iterator it = map->find(key);
+  if (it == map->end() || it->second != value) {
+    return false;
+  }
+  map->erase(it);
+  return true;
+}
+}  // namespace
+
+NFrameAssembler::PendingNFrame::PendingNFrame(const NCamera::Ptr& camera_system,
+                                              int64_t timestamp)
+    : timestamp_nanoseconds(timestamp), nframe(new VisualNFrame(camera_system)),
+      is_camera_set(new std::atomic<bool>[camera_system->getNumCameras()]),
+      num_frames_set(0u), is_discarded(false) {
+  for (size_t camera_index = 0u; camera_index < camera_system->getNumCameras();
+       ++camera_index) {
+    is_camera_set[camera_index] = false;
+  }
+}
+
+NFrameAssembler::NFrameAssembler(const NCamera::Ptr& camera_system,
+                                 int64_t timestamp_tolerance_ns,
+                                 const OutputCallback& output_callback, size_t num_shards)
+    : camera_system_(camera_system),
+      num_cameras_(CHECK_NOTNULL(camera_system.get())->getNumCameras()),
+      timestamp_tolerance_ns_(timestamp_tolerance_ns),
+      bucket_width_ns_(timestamp_tolerance_ns + 1),
+      output_callback_(output_callback),
+      drop_stale_nframes_(false),
+      last_released_timestamp_(std::numeric_limits<int64_t>::min()),
+      num_dropped_nframes_(0u) {
+  CHECK_GT(num_cameras_, 0u);
+  CHECK_GE(timestamp_tolerance_ns_, 0);
+  CHECK(output_callback_);
+  CHECK_GT(num_shards, 0u);
+  shards_.reserve(num_shards);
+  for (size_t shard_index = 0u; shard_index < num_shards; ++shard_index) {
+    shards_.emplace_back(new Shard);
+  }
+}
+
+NFrameAssembler::~NFrameAssembler() {}
+
+int64_t NFrameAssembler::getBucket(int64_t timestamp_nanoseconds) const {
+  // Round towards negative infinity, such that all buckets have the same width.
+  if (timestamp_nanoseconds >= 0) {
+    return timestamp_nanoseconds / bucket_width_ns_;
+  }
+  return -((-timestamp_nanoseconds + bucket_width_ns_ - 1) / bucket_width_ns_);
+}
+
+NFrameAssembler::Shard& NFrameAssembler::getShard(int64_t bucket) {
+  const int64_t num_shards = static_cast<int64_t>(shards_.size());
+  return *shards_[static_cast<size_t>(((bucket % num_shards) + num_shards) % num_shards)];
+}
+
+void NFrameAssembler::addFrame(size_t camera_index, const std::shared_ptr<VisualFrame>& frame) {
+  CHECK_LT(camera_index, num_cameras_);
+  CHECK(frame);
+  const PendingNFramePtr pending_nframe = findOrCreateNFrame(frame->getTimestampNanoseconds());
+  CHECK(pending_nframe);
+
+  // Every camera owns one slot of the nframe, so the frames are set without a lock.
+  if (pending_nframe->is_camera_set[camera_index].exchange(true)) {
+    LOG(ERROR) << "Dropping the frame of camera " << camera_index << " with timestamp "
+               << frame->getTimestampNanoseconds() << " because the nframe with timestamp "
+               << pending_nframe->timestamp_nanoseconds
+               << " already has a frame of this camera.";
+    return;
+  }
+  pending_nframe->nframe->setFrame(camera_index, frame);
+  // The thread that sets the last frame completes the nframe, it sees all frames set before.
+  if (pending_nframe->num_frames_set.fetch_add(1u) + 1u == num_cameras_) {
+    removeFromShard(pending_nframe);
+    completeNFrame(pending_nframe);
+  }
+}
+
+NFrameAssembler::PendingNFramePtr NFrameAssembler::findOrCreateNFrame(
+    int64_t timestamp_nanoseconds) {
+  // The candidates are within the tolerance and thus in this or the neighboring buckets. Lock
+  // their shards in a fixed order.
+  const int64_t bucket = getBucket(timestamp_nanoseconds);
+  std::vector<Shard*> shards = {&getShard(bucket - 1), &getShard(bucket), &getShard(bucket + 1)};
+  std::sort(shards.begin(), shards.end());
+  shards.erase(std::unique(shards.begin(), shards.end()), shards.end());
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(shards.size());
+  for (Shard* shard : shards) {
+    locks.emplace_back(shard->mutex);
+  }
+
+  PendingNFramePtr closest_nframe;
+  int64_t min_time_diff = std::numeric_limits<int64_t>::max();
+  for (int64_t candidate_bucket = bucket - 1; candidate_bucket <= bucket + 1;
+       ++candidate_bucket) {
+    Shard& shard = getShard(candidate_bucket);
+    std::unordered_map<int64_t, PendingNFramePtr>::iterator it =
+        shard.pending_nframes.find(candidate_bucket);
+    if (it == shard.pending_nframes.end()) {
+      continue;
+    }
+    if (it->second->is_discarded) {
+      shard.pending_nframes.erase(it);
+      continue;
+    }
+    const int64_t time_diff =
+        std::abs(it->second->timestamp_nanoseconds - timestamp_nanoseconds);
+    if (time_diff <= timestamp_tolerance_ns_ && time_diff < min_time_diff) {
+      closest_nframe = it->second;
+      min_time_diff = time_diff;
+    }
+  }
+  if (closest_nframe) {
+    return closest_nframe;
+  }
+
+  // A bucket is tolerance + 1 wide, so any two timestamps of a bucket are at most the tolerance
+  // apart. A pending nframe in the bucket of the new one would have been returned above, so the
+  // bucket is free.
+  PendingNFramePtr pending_nframe =
+      std::make_shared<PendingNFrame>(camera_system_, timestamp_nanoseconds);
+  Shard& shard = getShard(bucket);
+  CHECK(shard.pending_nframes.emplace(bucket, pending_nframe).second);
+  {
+    std::lock_guard<std::mutex> lock(order_mutex_);
+    incomplete_nframes_.emplace(timestamp_nanoseconds, pending_nframe);
+  }
+  return pending_nframe;
+}
+
+void NFrameAssembler::removeFromShard(const PendingNFramePtr& pending_nframe) {
+  CHECK(pending_nframe);
+  const int64_t bucket = getBucket(pending_nframe->timestamp_nanoseconds);
+  Shard& shard = getShard(bucket);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  eraseValue(bucket, pending_nframe, &shard.pending_nframes);
+}
+
+void NFrameAssembler::completeNFrame(const PendingNFramePtr& pending_nframe) {
+  CHECK(pending_nframe);
+  std::vector<PendingNFramePtr> discarded_nframes;
+  {
+    std::lock_guard<std::mutex> lock(order_mutex_);
+    if (!eraseValue(pending_nframe->timestamp_nanoseconds, pending_nframe,
+                    &incomplete_nframes_)) {
+      // The nframe was discarded while its last frame was added.
+      return;
+    }
+    complete_nframes_.emplace(pending_nframe->timestamp_nanoseconds, pending_nframe);
+    releaseCompleteNFrames(&discarded_nframes);
+  }
+  for (const PendingNFramePtr& discarded_nframe : discarded_nframes) {
+    removeFromShard(discarded_nframe);
+  }
+}
+
+void NFrameAssembler::releaseCompleteNFrames(std::vector<PendingNFramePtr>* discarded_nframes) {
+  CHECK_NOTNULL(discarded_nframes);
+  if (drop_stale_nframes_ && !incomplete_nframes_.empty() && !complete_nframes_.empty()) {
+    // Do not wait for the incomplete nframes older than the newest complete one.
+    const std::map<int64_t, PendingNFramePtr>::iterator it_discard_end =
+        incomplete_nframes_.lower_bound(complete_nframes_.rbegin()->first);
+    for (std::map<int64_t, PendingNFramePtr>::iterator it_discard = incomplete_nframes_.begin();
+         it_discard != it_discard_end; ++it_discard) {
+      it_discard->second->is_discarded = true;
+      discarded_nframes->push_back(it_discard->second);
+      ++num_dropped_nframes_;
+    }
+    incomplete_nframes_.erase(incomplete_nframes_.begin(), it_discard_end);
+  }
+
+  // Find the first two consecutive complete nframes that are newer than an incomplete one.
+  // E.g. N=2    I C I C C   (I: incomplete, C: complete)
+  //                   # --> the nframes older than this one are discarded.
+  // All frames below this nframe will probably never complete as one camera in the rig dropped
+  // an image.
+  const size_t kNumMinConsecutiveCompleteThreshold = 2u;
+  if (!drop_stale_nframes_ && !incomplete_nframes_.empty() && !complete_nframes_.empty() &&
+      incomplete_nframes_.size() + complete_nframes_.size() >
+          kNumMinConsecutiveCompleteThreshold + 1u) {
+    const int64_t oldest_incomplete_timestamp = incomplete_nframes_.begin()->first;
+    std::map<int64_t, PendingNFramePtr>::const_iterator it_run_begin =
+        complete_nframes_.upper_bound(oldest_incomplete_timestamp);
+    size_t num_consecutive_complete = 0u;
+    for (std::map<int64_t, PendingNFramePtr>::const_iterator it = it_run_begin;
+         it != complete_nframes_.end(); ++it) {
+      // Is there an incomplete nframe between the start of the run and this nframe?
+      const std::map<int64_t, PendingNFramePtr>::const_iterator it_incomplete =
+          incomplete_nframes_.upper_bound(it_run_begin->first);
+      if (it_incomplete != incomplete_nframes_.end() && it_incomplete->first < it->first) {
+        it_run_begin = it;
+        num_consecutive_complete = 0u;
+      }
+      ++num_consecutive_complete;
+      if (num_consecutive_complete >= kNumMinConsecutiveCompleteThreshold) {
+        const std::map<int64_t, PendingNFramePtr>::iterator it_discard_end =
+            incomplete_nframes_.lower_bound(it_run_begin->first);
+        size_t num_discarded = 0u;
+        for (std::map<int64_t, PendingNFramePtr>::iterator it_discard =
+                 incomplete_nframes_.begin();
+             it_discard != it_discard_end; ++it_discard) {
+          it_discard->second->is_discarded = true;
+          discarded_nframes->push_back(it_discard->second);
+          ++num_discarded;
+        }
+        incomplete_nframes_.erase(incomplete_nframes_.begin(), it_discard_end);
+        // The complete nframes in between are dropped as well.
+        num_discarded += std::distance(complete_nframes_.cbegin(), it_run_begin);
+        complete_nframes_.erase(complete_nframes_.begin(), it_run_begin);
+        num_dropped_nframes_ += num_discarded;
+        LOG(WARNING) << "Detected frame drop: removing " << num_discarded
+                     << " nframes from the queue.";
+        break;
+      }
+    }
+  }
+
+  // Release the complete nframes that are older than all incomplete ones.
+  while (!complete_nframes_.empty() &&
+         (incomplete_nframes_.empty() ||
+          complete_nframes_.begin()->first < incomplete_nframes_.begin()->first)) {
+    const int64_t timestamp_nanoseconds = complete_nframes_.begin()->first;
+    if (drop_stale_nframes_ && timestamp_nanoseconds <= last_released_timestamp_) {
+      // A late nframe, the output has already moved on.
+      ++num_dropped_nframes_;
+    } else {
+      output_callback_(timestamp_nanoseconds, complete_nframes_.begin()->second->nframe);
+      last_released_timestamp_ = std::max(last_released_timestamp_, timestamp_nanoseconds);
+    }
+    complete_nframes_.erase(complete_nframes_.begin());
+  }
+}
+
+void NFrameAssembler::discardNFramesUpTo(int64_t timestamp_nanoseconds) {
+  std::vector<PendingNFramePtr> discarded_nframes;
+  {
+    std::lock_guard<std::mutex> lock(order_mutex_);
+    const std::map<int64_t, PendingNFramePtr>::iterator it_incomplete_end =
+        incomplete_nframes_.upper_bound(timestamp_nanoseconds);
+    for (std::map<int64_t, PendingNFramePtr>::iterator it = incomplete_nframes_.begin();
+         it != it_incomplete_end; ++it) {
+      it->second->is_discarded = true;
+      discarded_nframes.push_back(it->second);
+    }
+    incomplete_nframes_.erase(incomplete_nframes_.begin(), it_incomplete_end);
+    complete_nframes_.erase(complete_nframes_.begin(),
+                            complete_nframes_.upper_bound(timestamp_nanoseconds));
+    releaseCompleteNFrames(&discarded_nframes);
+  }
+  for (const PendingNFramePtr& discarded_nframe : discarded_nframes) {
+    removeFromShard(discarded_nframe);
+  }
+}
+
+size_t NFrameAssembler::getNumNFramesInProgress() const {
+  std::lock_guard<std::mutex> lock(order_mutex_);
+  return incomplete_nframes_.size() + complete_nframes_.size();
+}
+
+void NFrameAssembler::setDropStaleNFrames(bool drop_stale_nframes) {
+  std::vector<PendingNFramePtr> discarded_nframes;
+  {
+    std::lock_guard<std::mutex> lock(order_mutex_);
+    drop_stale_nframes_ = drop_stale_nframes;
+    releaseCompleteNFrames(&discarded_nframes);
+  }
+  for (const PendingNFramePtr& discarded_nframe : discarded_nframes) {
+    removeFromShard(discarded_nframe);
+  }
+}
+
+size_t NFrameAssembler::getNumDroppedNFrames() const {
+  std::lock_guard<std::mutex> lock(order_mutex_);
+  return num_dropped_nframes_;
+}
+
+}  // namespace aslam
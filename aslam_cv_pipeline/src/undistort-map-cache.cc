@@ -0,0 +1,283 @@
+#include "aslam/pipeline/undistort-map-cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+namespace aslam {
+namespace {
+constexpr char kFilePrefix[] = "undistort-map-";
+constexpr char kFileSuffix[] = ".bin";
+constexpr char kMagic[8] = {'A', 'S', 'L', 'A', 'M', 'U', 'M', '\0'};
+// Increase whenever the file layout or the map computation changes.
+constexpr uint32_t kFormatVersion = 1u;
+// Alignment of the map data in the file.
+constexpr uint64_t kDataAlignment = 64u;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t key_size;
+  int32_t map_subsampling;
+  int32_t map_u_rows;
+  int32_t map_u_cols;
+  int32_t map_u_type;
+  int32_t map_v_rows;
+  int32_t map_v_cols;
+  int32_t map_v_type;
+  int32_t padding;
+  uint64_t map_u_offset;
+  uint64_t map_v_offset;
+  uint64_t file_size;
+};
+
+template <typename Type>
+void appendToKey(const Type& value, UndistortMapCache::Key* key) {
+  CHECK_NOTNULL(key);
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  key->insert(key->end(), bytes, bytes + sizeof(Type));
+}
+
+void appendToKey(const Eigen::VectorXd& values, UndistortMapCache::Key* key) {
+  appendToKey(static_cast<int64_t>(values.size()), key);
+  for (int i = 0; i < values.size(); ++i) {
+    appendToKey(values[i], key);
+  }
+}
+
+// 64 bit FNV-1a hash, stable across platforms and standard libraries.
+uint64_t hashKey(const UndistortMapCache::Key& key) {
+  uint64_t hash = 14695981039346656037ull;
+  for (const char byte : key) {
+    hash ^= static_cast<unsigned char>(byte);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t alignOffset(uint64_t offset) {
+  return (offset + kDataAlignment - 1u) / kDataAlignment * kDataAlignment;
+}
+
+size_t getMapBytes(int rows, int cols, int type) {
+  return static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+}
+
+// Writes all bytes, resuming after partial and interrupted writes.
+bool writeAll(int file_descriptor, const void* data, size_t num_bytes) {
+  const char* bytes = static_cast<const char*>(data);
+  while (num_bytes > 0u) {
+    const ssize_t num_written = write(file_descriptor, bytes, num_bytes);
+    if (num_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    bytes += num_written;
+    num_bytes -= static_cast<size_t>(num_written);
+  }
+  return true;
+}
+}  // namespace
+
+UndistortMapCache::UndistortMapCache(const std::string& directory)
+    : directory_(directory), num_hits_(0u), num_misses_(0u) {
+  CHECK(!directory_.empty());
+  if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+    LOG(ERROR) << "Failed to create the undistort map cache directory " << directory_ << ": "
+               << std::strerror(errno);
+  }
+}
+
+UndistortMapCache::Key UndistortMapCache::computeKey(
+    const Camera& input_camera, float alpha, float scale, InterpolationMethod interpolation,
+    UndistortMapType map_type, bool undistort_to_pinhole) {
+  Key key;
+  appendToKey(static_cast<int32_t>(input_camera.getType()), &key);
+  appendToKey(static_cast<uint64_t>(input_camera.imageWidth()), &key);
+  appendToKey(static_cast<uint64_t>(input_camera.imageHeight()), &key);
+  appendToKey(input_camera.getParameters(), &key);
+  appendToKey(static_cast<int32_t>(input_camera.getDistortion().getType()), &key);
+  appendToKey(input_camera.getDistortion().getParameters(), &key);
+  appendToKey(alpha, &key);
+  appendToKey(scale, &key);
+  appendToKey(static_cast<int32_t>(interpolation), &key);
+  appendToKey(static_cast<int32_t>(map_type), &key);
+  appendToKey(static_cast<int32_t>(undistort_to_pinhole), &key);
+  return key;
+}
+
+std::string UndistortMapCache::getFilePath(const Key& key) const {
+  char hash[17];
+  std::snprintf(hash, sizeof(hash), "%016llx",
+                static_cast<unsigned long long>(hashKey(key)));  // NOLINT
+  return directory_ + "/" + kFilePrefix + hash + kFileSuffix;
+}
+
+bool UndistortMapCache::load(const Key& key, cv::Mat* map_u, cv::Mat* map_v,
+                             int* map_subsampling,
+                             std::shared_ptr<const void>* map_storage) const {
+  CHECK_NOTNULL(map_u);
+  CHECK_NOTNULL(map_v);
+  CHECK_NOTNULL(map_subsampling);
+  CHECK_NOTNULL(map_storage);
+  const std::string file_path = getFilePath(key);
+  const int file_descriptor = open(file_path.c_str(), O_RDONLY);
+  if (file_descriptor < 0) {
+    ++num_misses_;
+    return false;
+  }
+  struct stat file_status;
+  const bool has_size = fstat(file_descriptor, &file_status) == 0;
+  const size_t file_size = has_size ? static_cast<size_t>(file_status.st_size) : 0u;
+  void* data = MAP_FAILED;
+  if (file_size >= sizeof(FileHeader)) {
+    data = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+  }
+  // The mapping stays valid after closing the file.
+  close(file_descriptor);
+  if (data == MAP_FAILED) {
+    LOG(WARNING) << "Removing the invalid undistort map cache entry " << file_path << ".";
+    remove(key);
+    ++num_misses_;
+    return false;
+  }
+  std::shared_ptr<const void> storage(data, [file_size](const void* mapped_data) {
+    munmap(const_cast<void*>(mapped_data), file_size);
+  });
+
+  // Validate the header and the key, the key is compared in full to rule out hash collisions.
+  const char* bytes = static_cast<const char*>(data);
+  FileHeader header;
+  std::memcpy(&header, bytes, sizeof(FileHeader));
+  const uint64_t map_u_bytes =
+      getMapBytes(header.map_u_rows, header.map_u_cols, header.map_u_type);
+  const uint64_t map_v_bytes =
+      getMapBytes(header.map_v_rows, header.map_v_cols, header.map_v_type);
+  const bool is_valid =
+      std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+      header.format_version == kFormatVersion && header.file_size == file_size &&
+      header.key_size == key.size() && sizeof(FileHeader) + key.size() <= file_size &&
+      std::memcmp(bytes + sizeof(FileHeader), key.data(), key.size()) == 0 &&
+      header.map_subsampling >= 1 && header.map_u_rows > 0 && header.map_u_cols > 0 &&
+      header.map_v_rows > 0 && header.map_v_cols > 0 &&
+      header.map_u_offset % kDataAlignment == 0u && header.map_v_offset % kDataAlignment == 0u &&
+      header.map_u_offset >= sizeof(FileHeader) + key.size() &&
+      header.map_u_offset + map_u_bytes <= header.map_v_offset &&
+      header.map_v_offset + map_v_bytes <= file_size;
+  if (!is_valid) {
+    LOG(WARNING) << "Removing the outdated or invalid undistort map cache entry " << file_path
+                 << ".";
+    storage.reset();
+    remove(key);
+    ++num_misses_;
+    return false;
+  }
+
+  // The maps point into the read-only mapping.
+  *map_u = cv::Mat(header.map_u_rows, header.map_u_cols, header.map_u_type,
+                   const_cast<char*>(bytes + header.map_u_offset));
+  *map_v = cv::Mat(header.map_v_rows, header.map_v_cols, header.map_v_type,
+                   const_cast<char*>(bytes + header.map_v_offset));
+  *map_subsampling = header.map_subsampling;
+  *map_storage = storage;
+  ++num_hits_;
+  return true;
+}
+
+bool UndistortMapCache::store(const Key& key, const cv::Mat& map_u, const cv::Mat& map_v,
+                              int map_subsampling) const {
+  CHECK(!map_u.empty());
+  CHECK(!map_v.empty());
+  CHECK_GE(map_subsampling, 1);
+  const cv::Mat map_u_continuous = map_u.isContinuous() ? map_u : map_u.clone();
+  const cv::Mat map_v_continuous = map_v.isContinuous() ? map_v : map_v.clone();
+  const size_t map_u_bytes = getMapBytes(map_u.rows, map_u.cols, map_u.type());
+  const size_t map_v_bytes = getMapBytes(map_v.rows, map_v.cols, map_v.type());
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(FileHeader));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.format_version = kFormatVersion;
+  header.key_size = static_cast<uint32_t>(key.size());
+  header.map_subsampling = map_subsampling;
+  header.map_u_rows = map_u.rows;
+  header.map_u_cols = map_u.cols;
+  header.map_u_type = map_u.type();
+  header.map_v_rows = map_v.rows;
+  header.map_v_cols = map_v.cols;
+  header.map_v_type = map_v.type();
+  header.map_u_offset = alignOffset(sizeof(FileHeader) + key.size());
+  header.map_v_offset = alignOffset(header.map_u_offset + map_u_bytes);
+  header.file_size = header.map_v_offset + map_v_bytes;
+
+  // Write to a temporary file and rename it, such that readers never see a partial entry.
+  // mkstemp picks a name no other thread or process writes to.
+  const std::string file_path = getFilePath(key);
+  const std::string temporary_file_template = file_path + ".tmp.XXXXXX";
+  std::vector<char> temporary_file_path(
+      temporary_file_template.c_str(),
+      temporary_file_template.c_str() + temporary_file_template.size() + 1u);
+  const int file_descriptor = mkstemp(temporary_file_path.data());
+  if (file_descriptor < 0) {
+    LOG(WARNING) << "Failed to create a temporary file for " << file_path << ": "
+                 << std::strerror(errno);
+    return false;
+  }
+  // mkstemp creates the file readable by the owner only.
+  fchmod(file_descriptor, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  const std::vector<char> padding(kDataAlignment, 0);
+  bool success = writeAll(file_descriptor, &header, sizeof(FileHeader));
+  success = success && writeAll(file_descriptor, key.data(), key.size());
+  success = success && writeAll(file_descriptor, padding.data(),
+                                header.map_u_offset - sizeof(FileHeader) - key.size());
+  success = success && writeAll(file_descriptor, map_u_continuous.data, map_u_bytes);
+  success = success && writeAll(file_descriptor, padding.data(),
+                                header.map_v_offset - header.map_u_offset - map_u_bytes);
+  success = success && writeAll(file_descriptor, map_v_continuous.data, map_v_bytes);
+  success = close(file_descriptor) == 0 && success;
+  if (!success) {
+    LOG(WARNING) << "Failed to write " << temporary_file_path.data() << ": "
+                 << std::strerror(errno);
+    std::remove(temporary_file_path.data());
+    return false;
+  }
+  if (std::rename(temporary_file_path.data(), file_path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to move " << temporary_file_path.data() << " to " << file_path << ": "
+                 << std::strerror(errno);
+    std::remove(temporary_file_path.data());
+    return false;
+  }
+  return true;
+}
+
+void UndistortMapCache::remove(const Key& key) const {
+  std::remove(getFilePath(key).c_str());
+}
+
+void UndistortMapCache::clear() const {
+  DIR* directory = opendir(directory_.c_str());
+  if (directory == nullptr) {
+    return;
+  }
+  const std::string prefix(kFilePrefix);
+  while (const struct dirent* entry = readdir(directory)) {
+    const std::string file_name(entry->d_name);
+    if (file_name.compare(0, prefix.size(), prefix) == 0) {
+      std::remove((directory_ + "/" + file_name).c_str());
+    }
+  }
+  closedir(directory);
+}
+
+}  // namespace aslam
@@ -0,0 +1,180 @@
+#include "aslam/pipeline/undistorter-keypoint.h"
+
+#include <cmath>
+
+#include <aslam/common/stl-helpers.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/pipeline/undistorter-mapped.h>
+#include <glog/logging.h>
+#include <opencv2/core/core.hpp>
+
+namespace aslam {
+namespace {
+// Distance of the neighboring points to the keypoint in input pixels, used to map the
+// orientations and scales.
+constexpr double kNeighborDistancePixels = 0.5;
+}  // namespace
+
+std::unique_ptr<KeypointUndistorter> createKeypointUndistorter(
+    const Camera& camera, float alpha, float scale) {
+  CHECK_GE(alpha, 0.0);
+  CHECK_LE(alpha, 1.0);
+  CHECK_GT(scale, 0.0);
+
+  // Create a copy of the input camera.
+  Camera::Ptr input_camera(camera.clone());
+  CHECK(input_camera);
+
+  // Create the scaled output camera with removed distortion.
+  Camera::Ptr output_camera = internal::createUndistortedOutputCamera(*input_camera, alpha, scale);
+
+  return std::unique_ptr<KeypointUndistorter>(
+      new KeypointUndistorter(input_camera, output_camera));
+}
+
+KeypointUndistorter::KeypointUndistorter(Camera::Ptr input_camera, Camera::Ptr output_camera)
+    : Undistorter(input_camera, output_camera) {
+  CHECK(input_camera_);
+  CHECK(output_camera_);
+}
+
+void KeypointUndistorter::processImage(const cv::Mat& input_image, cv::Mat* output_image) const {
+  CHECK_NOTNULL(output_image);
+  CHECK_EQ(static_cast<int>(input_camera_->imageWidth()), input_image.cols);
+  CHECK_EQ(static_cast<int>(input_camera_->imageHeight()), input_image.rows);
+  *output_image = input_image;
+}
+
+void KeypointUndistorter::undistortKeypoints(
+    Eigen::Matrix2Xd* keypoints, Eigen::VectorXd* orientations, Eigen::VectorXd* scales,
+    std::vector<unsigned char>* out_success) const {
+  CHECK_NOTNULL(keypoints);
+  CHECK_NOTNULL(out_success);
+  const int num_keypoints = keypoints->cols();
+  if (orientations != nullptr) {
+    CHECK_EQ(orientations->size(), num_keypoints);
+  }
+  if (scales != nullptr) {
+    CHECK_EQ(scales->size(), num_keypoints);
+  }
+
+  // The keypoints are mapped in one batch together with two neighbors each, one along the
+  // keypoint orientation and one perpendicular to it. They give the local Jacobian of the mapping.
+  const bool map_neighbors = orientations != nullptr || scales != nullptr;
+  Eigen::Matrix2Xd samples(2, (map_neighbors ? 3 : 1) * num_keypoints);
+  samples.leftCols(num_keypoints) = *keypoints;
+  if (map_neighbors) {
+    for (int i = 0; i < num_keypoints; ++i) {
+      const bool has_orientation = orientations != nullptr && (*orientations)[i] >= 0.0;
+      const double angle = has_orientation ? (*orientations)[i] * M_PI / 180.0 : 0.0;
+      const Eigen::Vector2d direction(std::cos(angle), std::sin(angle));
+      samples.col(num_keypoints + i) =
+          keypoints->col(i) + kNeighborDistancePixels * direction;
+      samples.col(2 * num_keypoints + i) =
+          keypoints->col(i) + kNeighborDistancePixels * Eigen::Vector2d(-direction[1],
+                                                                       direction[0]);
+    }
+  }
+
+  Eigen::Matrix3Xd points_3d;
+  std::vector<unsigned char> backprojection_success;
+  input_camera_->backProject3Vectorized(samples, &points_3d, &backprojection_success);
+  Eigen::Matrix2Xd mapped_samples;
+  std::vector<ProjectionResult> projection_results;
+  output_camera_->project3Vectorized(points_3d, &mapped_samples, &projection_results);
+
+  // Neighbors may fall slightly outside of the output image, they only need a valid projection.
+  auto is_sample_valid = [&](int index) {
+    const ProjectionResult::Status status = projection_results[index].getDetailedStatus();
+    return backprojection_success[index] &&
+        (status == ProjectionResult::Status::KEYPOINT_VISIBLE ||
+         status == ProjectionResult::Status::KEYPOINT_OUTSIDE_IMAGE_BOX);
+  };
+
+  out_success->resize(num_keypoints);
+  for (int i = 0; i < num_keypoints; ++i) {
+    (*out_success)[i] =
+        backprojection_success[i] && projection_results[i].isKeypointVisible() &&
+        (!map_neighbors ||
+         (is_sample_valid(num_keypoints + i) && is_sample_valid(2 * num_keypoints + i)));
+    if (!(*out_success)[i]) {
+      continue;
+    }
+    keypoints->col(i) = mapped_samples.col(i);
+    if (!map_neighbors) {
+      continue;
+    }
+
+    // Images of the unit vectors along and perpendicular to the orientation.
+    const Eigen::Vector2d along =
+        (mapped_samples.col(num_keypoints + i) - mapped_samples.col(i)) /
+        kNeighborDistancePixels;
+    const Eigen::Vector2d across =
+        (mapped_samples.col(2 * num_keypoints + i) - mapped_samples.col(i)) /
+        kNeighborDistancePixels;
+    if (orientations != nullptr && (*orientations)[i] >= 0.0) {
+      double angle = std::atan2(along[1], along[0]) * 180.0 / M_PI;
+      if (angle < 0.0) {
+        angle += 360.0;
+      }
+      (*orientations)[i] = angle;
+    }
+    if (scales != nullptr) {
+      (*scales)[i] *= std::sqrt(std::abs(along[0] * across[1] - along[1] * across[0]));
+    }
+  }
+}
+
+void KeypointUndistorter::processKeypoints(VisualFrame* frame) const {
+  CHECK_NOTNULL(frame);
+  if (!frame->hasKeypointMeasurements()) {
+    return;
+  }
+  const size_t num_keypoints = frame->getNumKeypointMeasurements();
+  std::vector<unsigned char> success;
+  undistortKeypoints(
+      frame->getKeypointMeasurementsMutable(),
+      frame->hasKeypointOrientations() ? frame->getKeypointOrientationsMutable() : nullptr,
+      frame->hasKeypointScales() ? frame->getKeypointScalesMutable() : nullptr, &success);
+
+  // Remove the keypoints outside of the output image from all keypoint channels.
+  std::vector<size_t> discarded_indices;
+  for (size_t i = 0u; i < num_keypoints; ++i) {
+    if (!success[i]) {
+      discarded_indices.emplace_back(i);
+    }
+  }
+  if (discarded_indices.empty()) {
+    return;
+  }
+  common::stl_helpers::eraseIndicesFromContainer(
+      discarded_indices, num_keypoints, frame->getKeypointMeasurementsMutable());
+  if (frame->hasKeypointMeasurementUncertainties()) {
+    common::stl_helpers::eraseIndicesFromContainer(
+        discarded_indices, num_keypoints, frame->getKeypointMeasurementUncertaintiesMutable());
+  }
+  if (frame->hasKeypointOrientations()) {
+    common::stl_helpers::eraseIndicesFromContainer(
+        discarded_indices, num_keypoints, frame->getKeypointOrientationsMutable());
+  }
+  if (frame->hasKeypointScores()) {
+    common::stl_helpers::eraseIndicesFromContainer(
+        discarded_indices, num_keypoints, frame->getKeypointScoresMutable());
+  }
+  if (frame->hasKeypointScales()) {
+    common::stl_helpers::eraseIndicesFromContainer(
+        discarded_indices, num_keypoints, frame->getKeypointScalesMutable());
+  }
+  if (frame->hasDescriptors()) {
+    common::stl_helpers::OneDimensionAdapter<unsigned char,
+    common::stl_helpers::kColumns> adapter(frame->getDescriptorsMutable());
+    common::stl_helpers::eraseIndicesFromContainer(
+        discarded_indices, num_keypoints, &adapter);
+  }
+  if (frame->hasTrackIds()) {
+    common::stl_helpers::eraseIndicesFromContainer(
+        discarded_indices, num_keypoints, frame->getTrackIdsMutable());
+  }
+}
+
+}  // namespace aslam
@@ -1,16 +1,66 @@
 #include "aslam/pipeline/undistorter-mapped.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <aslam/cameras/camera-factory.h>
 #include <aslam/common/undistort-helpers.h>
 #include <aslam/frames/visual-frame.h>
+#include <aslam/pipeline/convert-maps-legacy.h>
 #include <glog/logging.h>
 #include <opencv2/imgproc/imgproc.hpp> // cv::remap
 
 namespace aslam {
+namespace {
+// Minimum number of output rows remapped at once from the expanded subsampled maps.
+constexpr int kMinStripRows = 16;
+}  // namespace
+
+namespace internal {
+Camera::Ptr createUndistortedOutputCamera(const Camera& input_camera, float alpha, float scale) {
+  const bool kUndistortToPinhole = false;
+  Eigen::Matrix3d output_camera_matrix = common::getOptimalNewCameraMatrix(
+      input_camera, alpha, scale, kUndistortToPinhole);
+
+  const int output_width = static_cast<int>(scale * input_camera.imageWidth());
+  const int output_height = static_cast<int>(scale * input_camera.imageHeight());
+
+  Camera::Ptr output_camera;
+  Eigen::MatrixXd intrinsics(input_camera.getParameterSize(), 1);
+  switch (input_camera.getType()) {
+    case Camera::Type::kPinhole:
+      intrinsics << output_camera_matrix(0, 0), output_camera_matrix(1, 1),
+          output_camera_matrix(0, 2), output_camera_matrix(1, 2);
+      output_camera.reset(
+          new PinholeCamera(intrinsics, output_width, output_height));
+      CHECK(output_camera);
+      break;
+    case Camera::Type::kUnifiedProjection: {
+      const UnifiedProjectionCamera* unified_proj_cam_ptr =
+          dynamic_cast<const UnifiedProjectionCamera*>(&input_camera);
+      CHECK(unified_proj_cam_ptr != nullptr)
+          << "Cast to unified projection camera failed.";
+      intrinsics << unified_proj_cam_ptr->xi(), output_camera_matrix(0, 0),
+          output_camera_matrix(1, 1), output_camera_matrix(0, 2),
+          output_camera_matrix(1, 2);
+      output_camera.reset(
+          new UnifiedProjectionCamera(intrinsics, output_width, output_height));
+      CHECK(output_camera);
+      break;
+    }
+    default:
+      LOG(FATAL) << "Unknown camera model: "
+                 << static_cast<std::underlying_type<Camera::Type>::type>(
+                        input_camera.getType());
+  }
+  return output_camera;
+}
+}  // namespace internal
 
 std::unique_ptr<MappedUndistorter> createMappedUndistorterToPinhole(
     const aslam::UnifiedProjectionCamera& unified_proj_camera, float alpha,
-    float scale, aslam::InterpolationMethod interpolation_type) {
+    float scale, aslam::InterpolationMethod interpolation_type,
+    UndistortMapType map_type, const UndistortMapCache* map_cache) {
   CHECK_GE(alpha, 0.0);
   CHECK_LE(alpha, 1.0);
   CHECK_GT(scale, 0.0);
@@ -35,21 +85,42 @@ std::unique_ptr<MappedUndistorter> createMappedUndistorterToPinhole(
       intrinsics, output_width, output_height);
   CHECK(output_camera);
 
-  cv::Mat map_u, map_v;
-  common::buildUndistortMap(*input_camera, *output_camera, CV_16SC2, map_u, map_v);
-
-  return std::unique_ptr<MappedUndistorter>(
-      new MappedUndistorter(input_camera, output_camera, map_u, map_v, interpolation_type));
+  return internal::createMappedUndistorterWithMaps(
+      input_camera, output_camera, alpha, scale, interpolation_type, map_type,
+      kUndistortToPinhole, map_cache);
 }
 
 MappedUndistorter::MappedUndistorter()
-    : interpolation_method_(aslam::InterpolationMethod::Linear) {}
+    : interpolation_method_(aslam::InterpolationMethod::Linear),
+      map_type_(UndistortMapType::kFixedPoint),
+      map_subsampling_(1) {}
 
 MappedUndistorter::MappedUndistorter(Camera::Ptr input_camera, Camera::Ptr output_camera,
                                      const cv::Mat& map_u, const cv::Mat& map_v,
-                                     aslam::InterpolationMethod interpolation)
+                                     aslam::InterpolationMethod interpolation,
+                                     int map_subsampling,
+                                     const std::shared_ptr<const void>& map_storage)
 : Undistorter(input_camera, output_camera), map_u_(map_u), map_v_(map_v),
-  interpolation_method_(interpolation) {
+  interpolation_method_(interpolation), map_subsampling_(map_subsampling),
+  map_storage_(map_storage) {
+  CHECK_GE(map_subsampling_, 1);
+  if (map_subsampling_ > 1) {
+    map_type_ = UndistortMapType::kSubsampled;
+    CHECK_EQ(map_u_.type(), CV_32FC1);
+    CHECK_EQ(map_v_.type(), CV_32FC1);
+    const int num_rows = (static_cast<int>(output_camera->imageHeight()) - 1) /
+        map_subsampling_ + 2;
+    const int num_cols = (static_cast<int>(output_camera->imageWidth()) - 1) /
+        map_subsampling_ + 2;
+    CHECK_EQ(map_u_.rows, num_rows);
+    CHECK_EQ(map_u_.cols, num_cols);
+    CHECK_EQ(map_v_.rows, num_rows);
+    CHECK_EQ(map_v_.cols, num_cols);
+    return;
+  }
+
+  map_type_ = map_u_.type() == CV_16SC2 ?
+      UndistortMapType::kFixedPoint : UndistortMapType::kFloat;
   CHECK_EQ(static_cast<size_t>(map_u_.rows), output_camera->imageHeight());
   CHECK_EQ(static_cast<size_t>(map_u_.cols), output_camera->imageWidth());
   CHECK_EQ(static_cast<size_t>(map_v_.rows), output_camera->imageHeight());
@@ -60,7 +131,114 @@ void MappedUndistorter::processImage(const cv::Mat& input_image, cv::Mat* output
   CHECK_EQ(input_camera_->imageWidth(), static_cast<size_t>(input_image.cols));
   CHECK_EQ(input_camera_->imageHeight(), static_cast<size_t>(input_image.rows));
   CHECK_NOTNULL(output_image);
-  cv::remap(input_image, *output_image, map_u_, map_v_, static_cast<int>(interpolation_method_));
+  if (map_type_ != UndistortMapType::kSubsampled) {
+    cv::remap(input_image, *output_image, map_u_, map_v_,
+              static_cast<int>(interpolation_method_));
+    return;
+  }
+
+  output_image->create(static_cast<int>(output_camera_->imageHeight()),
+                       static_cast<int>(output_camera_->imageWidth()), input_image.type());
+  processImageRows(input_image, 0, output_image->rows, output_image);
+}
+
+void MappedUndistorter::processImageRows(const cv::Mat& input_image, int row_begin, int row_end,
+                                         cv::Mat* output_image) const {
+  CHECK_NOTNULL(output_image);
+  const int output_height = static_cast<int>(output_camera_->imageHeight());
+  CHECK_EQ(output_image->rows, output_height);
+  CHECK_EQ(static_cast<size_t>(output_image->cols), output_camera_->imageWidth());
+  CHECK_EQ(output_image->type(), input_image.type());
+  CHECK_GE(row_begin, 0);
+  CHECK_LT(row_begin, row_end);
+  CHECK_LE(row_end, output_height);
+  if (map_type_ != UndistortMapType::kSubsampled) {
+    cv::Mat output_rows = output_image->rowRange(row_begin, row_end);
+    cv::remap(input_image, output_rows, map_u_.rowRange(row_begin, row_end),
+              map_v_.rowRange(row_begin, row_end), static_cast<int>(interpolation_method_));
+    return;
+  }
+
+  // Remap strips of rows such that the expanded maps stay in the cache.
+  const int strip_rows =
+      (kMinStripRows + map_subsampling_ - 1) / map_subsampling_ * map_subsampling_;
+  cv::Mat strip_map_u, strip_map_v;
+  for (int strip_begin = row_begin; strip_begin < row_end; strip_begin += strip_rows) {
+    const int strip_end = std::min(strip_begin + strip_rows, row_end);
+    expandSubsampledMaps(strip_begin, strip_end, &strip_map_u, &strip_map_v);
+    cv::Mat output_strip = output_image->rowRange(strip_begin, strip_end);
+    cv::remap(input_image, output_strip, strip_map_u, strip_map_v,
+              static_cast<int>(interpolation_method_));
+  }
+}
+
+void MappedUndistorter::expandSubsampledMaps(
+    int row_begin, int row_end, cv::Mat* map_u, cv::Mat* map_v) const {
+  CHECK_NOTNULL(map_u);
+  CHECK_NOTNULL(map_v);
+  CHECK(map_type_ == UndistortMapType::kSubsampled);
+  const int output_width = static_cast<int>(output_camera_->imageWidth());
+  map_u->create(row_end - row_begin, output_width, CV_32FC1);
+  map_v->create(row_end - row_begin, output_width, CV_32FC1);
+
+  // Column nodes and interpolation weights are the same for all rows.
+  const float inverse_subsampling = 1.0f / map_subsampling_;
+  std::vector<int> node_cols(output_width);
+  std::vector<float> col_weights(output_width);
+  for (int col = 0; col < output_width; ++col) {
+    node_cols[col] = col / map_subsampling_;
+    col_weights[col] = (col % map_subsampling_) * inverse_subsampling;
+  }
+
+  const int num_node_cols = map_u_.cols;
+  std::vector<float> node_row_u(num_node_cols), node_row_v(num_node_cols);
+  for (int row = row_begin; row < row_end; ++row) {
+    // Interpolate the nodes vertically, then each pixel horizontally.
+    const int node_row = row / map_subsampling_;
+    const float row_weight = (row % map_subsampling_) * inverse_subsampling;
+    const float* top_u = map_u_.ptr<float>(node_row);
+    const float* bottom_u = map_u_.ptr<float>(node_row + 1);
+    const float* top_v = map_v_.ptr<float>(node_row);
+    const float* bottom_v = map_v_.ptr<float>(node_row + 1);
+    for (int col = 0; col < num_node_cols; ++col) {
+      node_row_u[col] = top_u[col] + row_weight * (bottom_u[col] - top_u[col]);
+      node_row_v[col] = top_v[col] + row_weight * (bottom_v[col] - top_v[col]);
+    }
+
+    float* out_u = map_u->ptr<float>(row - row_begin);
+    float* out_v = map_v->ptr<float>(row - row_begin);
+    for (int col = 0; col < output_width; ++col) {
+      const int node_col = node_cols[col];
+      const float col_weight = col_weights[col];
+      out_u[col] = node_row_u[node_col] +
+          col_weight * (node_row_u[node_col + 1] - node_row_u[node_col]);
+      out_v[col] = node_row_v[node_col] +
+          col_weight * (node_row_v[node_col + 1] - node_row_v[node_col]);
+    }
+  }
+}
+
+size_t MappedUndistorter::getMapMemoryBytes() const {
+  return map_u_.total() * map_u_.elemSize() + map_v_.total() * map_v_.elemSize();
+}
+
+void MappedUndistorter::getDenseUndistortMaps(cv::Mat* map_u, cv::Mat* map_v) const {
+  CHECK_NOTNULL(map_u);
+  CHECK_NOTNULL(map_v);
+  switch (map_type_) {
+    case UndistortMapType::kFloat:
+      *map_u = map_u_.clone();
+      *map_v = map_v_.clone();
+      break;
+    case UndistortMapType::kFixedPoint:
+      convertMapsLegacy(map_u_, map_v_, *map_u, *map_v, CV_32FC1);
+      break;
+    case UndistortMapType::kSubsampled:
+      expandSubsampledMaps(0, static_cast<int>(output_camera_->imageHeight()), map_u, map_v);
+      break;
+    default:
+      LOG(FATAL) << "Unknown map type: " << static_cast<int>(map_type_);
+  }
 }
 
 }  // namespace aslam
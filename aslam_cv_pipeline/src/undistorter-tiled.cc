@@ -0,0 +1,131 @@
+#include "aslam/pipeline/undistorter-tiled.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <aslam/common/thread-pool.h>
+#include <glog/logging.h>
+#include <opencv2/core/core.hpp>
+
+namespace aslam {
+namespace {
+// The tiles of one image, shared with the tasks in the thread pool. Tasks that start after all
+// tiles were claimed return without touching the undistorter, so they may outlive the call.
+struct TileQueue {
+  TileQueue(const cv::Mat& input, const cv::Mat& output, int rows_per_tile)
+      : input_image(input), output_image(output), tile_rows(rows_per_tile),
+        num_tiles((output.rows + rows_per_tile - 1) / rows_per_tile), next_tile(0),
+        tile_done(num_tiles, false) {}
+
+  const cv::Mat input_image;
+  // Shares the data with the output image of the caller.
+  cv::Mat output_image;
+  const int tile_rows;
+  const int num_tiles;
+
+  std::atomic<int> next_tile;
+  std::mutex mutex;
+  std::condition_variable tile_done_condition;
+  std::vector<bool> tile_done;
+};
+
+// Claims and remaps the next tile. Returns false if all tiles are claimed.
+bool processNextTile(const MappedUndistorter* undistorter, TileQueue* queue) {
+  CHECK_NOTNULL(undistorter);
+  CHECK_NOTNULL(queue);
+  const int tile = queue->next_tile++;
+  if (tile >= queue->num_tiles) {
+    return false;
+  }
+  const int row_begin = tile * queue->tile_rows;
+  const int row_end = std::min(row_begin + queue->tile_rows, queue->output_image.rows);
+  undistorter->processImageRows(queue->input_image, row_begin, row_end, &queue->output_image);
+  {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    queue->tile_done[tile] = true;
+  }
+  queue->tile_done_condition.notify_all();
+  return true;
+}
+}  // namespace
+
+TiledUndistorter::TiledUndistorter(std::unique_ptr<MappedUndistorter>& undistorter,
+                                   const std::shared_ptr<ThreadPool>& thread_pool,
+                                   size_t tile_bytes)
+    : Undistorter(CHECK_NOTNULL(undistorter.get())->getInputCameraShared(),
+                  undistorter->getOutputCameraShared()),
+      undistorter_(std::move(undistorter)), thread_pool_(thread_pool), tile_bytes_(tile_bytes) {
+  CHECK_GT(tile_bytes_, 0u);
+}
+
+TiledUndistorter::TiledUndistorter(std::unique_ptr<MappedUndistorter>& undistorter,
+                                   size_t num_threads, size_t tile_bytes)
+    : TiledUndistorter(undistorter, nullptr, tile_bytes) {
+  CHECK_GT(num_threads, 0u);
+  // The calling thread processes tiles as well.
+  if (num_threads > 1u) {
+    thread_pool_.reset(new ThreadPool(num_threads - 1u));
+  }
+}
+
+TiledUndistorter::~TiledUndistorter() {}
+
+int TiledUndistorter::getTileRows(int image_type) const {
+  const size_t bytes_per_row = output_camera_->imageWidth() * CV_ELEM_SIZE(image_type) +
+      undistorter_->getMapMemoryBytes() / std::max<size_t>(output_camera_->imageHeight(), 1u);
+  return static_cast<int>(std::max<size_t>(tile_bytes_ / std::max<size_t>(bytes_per_row, 1u),
+                                           1u));
+}
+
+void TiledUndistorter::processImage(const cv::Mat& input_image, cv::Mat* output_image) const {
+  processImageStreaming(input_image, output_image, TileCallback());
+}
+
+void TiledUndistorter::processImageStreaming(const cv::Mat& input_image, cv::Mat* output_image,
+                                             const TileCallback& tile_callback) const {
+  CHECK_EQ(input_camera_->imageWidth(), static_cast<size_t>(input_image.cols));
+  CHECK_EQ(input_camera_->imageHeight(), static_cast<size_t>(input_image.rows));
+  CHECK_NOTNULL(output_image);
+  output_image->create(static_cast<int>(output_camera_->imageHeight()),
+                       static_cast<int>(output_camera_->imageWidth()), input_image.type());
+
+  std::shared_ptr<TileQueue> queue = std::make_shared<TileQueue>(
+      input_image, *output_image, getTileRows(input_image.type()));
+  if (thread_pool_) {
+    const MappedUndistorter* undistorter = undistorter_.get();
+    const int num_helpers = std::min<int>(thread_pool_->numThreads(), queue->num_tiles - 1);
+    for (int i = 0; i < num_helpers; ++i) {
+      thread_pool_->enqueue([undistorter, queue]() {
+        while (processNextTile(undistorter, queue.get())) {}
+      });
+    }
+  }
+
+  // Hand out the finished tiles in order and remap tiles while the next one is not finished.
+  for (int tile = 0; tile < queue->num_tiles; ++tile) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        if (queue->tile_done[tile]) {
+          break;
+        }
+      }
+      if (processNextTile(undistorter_.get(), queue.get())) {
+        continue;
+      }
+      // All tiles are claimed, wait for the helper that remaps this one.
+      std::unique_lock<std::mutex> lock(queue->mutex);
+      queue->tile_done_condition.wait(lock, [&queue, tile]() { return queue->tile_done[tile]; });
+      break;
+    }
+    if (tile_callback) {
+      const int row_begin = tile * queue->tile_rows;
+      tile_callback(row_begin, std::min(row_begin + queue->tile_rows, output_image->rows));
+    }
+  }
+}
+
+}  // namespace aslam
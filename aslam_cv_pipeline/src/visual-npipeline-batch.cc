@@ -0,0 +1,123 @@
+#include "aslam/pipeline/visual-npipeline-batch.h"
+
+#include <algorithm>
+#include <deque>
+#include <thread>
+
+#include <aslam/common/thread-pool.h>
+#include <glog/logging.h>
+
+namespace aslam {
+
+BatchVisualNPipeline::BatchVisualNPipeline(
+    const Options& options, const std::vector<VisualPipeline::Ptr>& pipelines,
+    const NCamera::Ptr& output_camera_system)
+    : max_nframes_in_flight_(options.max_nframes_in_flight),
+      checkpoint_interval_nframes_(options.checkpoint_interval_nframes),
+      pipelines_(pipelines),
+      output_camera_system_(output_camera_system) {
+  CHECK(output_camera_system_);
+  CHECK_EQ(output_camera_system_->getNumCameras(), pipelines_.size());
+  for (size_t camera_index = 0u; camera_index < pipelines_.size(); ++camera_index) {
+    CHECK(pipelines_[camera_index]);
+    CHECK_EQ(output_camera_system_->getCameraShared(camera_index).get(),
+             pipelines_[camera_index]->getOutputCameraShared().get());
+  }
+  CHECK_GT(max_nframes_in_flight_, 0u);
+  size_t num_threads = options.num_threads;
+  if (num_threads == 0u) {
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  thread_pool_.reset(new ThreadPool(num_threads));
+}
+
+BatchVisualNPipeline::~BatchVisualNPipeline() {}
+
+size_t BatchVisualNPipeline::getNumThreads() const {
+  return thread_pool_->numThreads();
+}
+
+size_t BatchVisualNPipeline::process(
+    size_t first_nframe_index, const InputCallback& input, const OutputCallback& output,
+    const CheckpointCallback& checkpoint) {
+  CHECK(input);
+  CHECK(output);
+  std::deque<std::shared_ptr<BatchNFrame>> nframes_in_flight;
+  size_t next_nframe_index = first_nframe_index;
+  size_t num_nframes_since_checkpoint = 0u;
+  bool is_input_done = false;
+  while (true) {
+    // Keep all threads busy by reading ahead up to the max. number of nframes in flight.
+    while (!is_input_done && nframes_in_flight.size() < max_nframes_in_flight_) {
+      SynchronizedImages images;
+      if (!input(next_nframe_index, &images)) {
+        is_input_done = true;
+        break;
+      }
+      CHECK_EQ(images.images.size(), pipelines_.size())
+          << "The nframe " << next_nframe_index << " does not have an image for every camera.";
+      std::shared_ptr<BatchNFrame> batch_nframe = std::make_shared<BatchNFrame>();
+      batch_nframe->nframe_index = next_nframe_index;
+      batch_nframe->timestamp_nanoseconds = images.timestamp_nanoseconds;
+      batch_nframe->nframe = std::make_shared<VisualNFrame>(output_camera_system_);
+      batch_nframe->num_images_remaining = pipelines_.size();
+      for (size_t camera_index = 0u; camera_index < pipelines_.size(); ++camera_index) {
+        thread_pool_->enqueue(&BatchVisualNPipeline::processImage, this, camera_index,
+                              images.images[camera_index], batch_nframe);
+      }
+      nframes_in_flight.push_back(batch_nframe);
+      ++next_nframe_index;
+    }
+    if (nframes_in_flight.empty()) {
+      break;
+    }
+
+    // Hand the complete nframes at the front to the output, the others are still in flight.
+    std::vector<std::shared_ptr<BatchNFrame>> complete_nframes;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_nframe_complete_.wait(lock, [&nframes_in_flight]() {
+        return nframes_in_flight.front()->num_images_remaining == 0u;
+      });
+      while (!nframes_in_flight.empty() &&
+             nframes_in_flight.front()->num_images_remaining == 0u) {
+        complete_nframes.push_back(nframes_in_flight.front());
+        nframes_in_flight.pop_front();
+      }
+    }
+    for (const std::shared_ptr<BatchNFrame>& batch_nframe : complete_nframes) {
+      output(batch_nframe->nframe_index, batch_nframe->timestamp_nanoseconds,
+             batch_nframe->nframe);
+      ++num_nframes_since_checkpoint;
+      if (checkpoint && checkpoint_interval_nframes_ > 0u &&
+          num_nframes_since_checkpoint == checkpoint_interval_nframes_) {
+        checkpoint(batch_nframe->nframe_index + 1u);
+        num_nframes_since_checkpoint = 0u;
+      }
+    }
+  }
+  if (checkpoint && num_nframes_since_checkpoint > 0u) {
+    checkpoint(next_nframe_index);
+  }
+  return next_nframe_index;
+}
+
+void BatchVisualNPipeline::processImage(size_t camera_index, const cv::Mat& image,
+                                        const std::shared_ptr<BatchNFrame>& batch_nframe) {
+  CHECK_LT(camera_index, pipelines_.size());
+  CHECK(batch_nframe);
+  // The timestamp is taken from the input, the pipeline of the camera may correct the one of
+  // the frame.
+  std::shared_ptr<VisualFrame> frame =
+      pipelines_[camera_index]->processImage(image, batch_nframe->timestamp_nanoseconds);
+  CHECK(frame);
+  // Every camera sets its own frame of the nframe.
+  batch_nframe->nframe->setFrame(camera_index, frame);
+  // Notify under the lock, the pipeline may be destroyed as soon as the last nframe is output.
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK_GT(batch_nframe->num_images_remaining, 0u);
+  if (--batch_nframe->num_images_remaining == 0u) {
+    condition_nframe_complete_.notify_all();
+  }
+}
+}  // namespace aslam
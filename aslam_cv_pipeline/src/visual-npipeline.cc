@@ -1,5 +1,10 @@
 #include <aslam/pipeline/visual-npipeline.h>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+
 #include <aslam/cameras/camera.h>
 #include <aslam/cameras/ncamera.h>
 #include <aslam/cameras/random-camera-generator.h>
@@ -14,6 +19,10 @@
 
 namespace aslam {
 
+constexpr size_t VisualNPipeline::kNumStages;
+constexpr size_t VisualNPipeline::kNumLatencyHistogramBins;
+constexpr double VisualNPipeline::kLatencyHistogramBinWidthSeconds;
+
 VisualNPipeline::VisualNPipeline(
     size_t num_threads,
     const std::vector<std::shared_ptr<VisualPipeline> >& pipelines,
@@ -22,29 +31,125 @@ VisualNPipeline::VisualNPipeline(
     int64_t timestamp_tolerance_ns) :
       pipelines_(pipelines),
       shutdown_(false),
+      max_stage_queue_size_(0u),
+      is_latency_budget_enabled_(false),
+      total_latency_seconds_(0.0),
+      num_work_done_(0u),
+      total_work_time_seconds_(0.0),
+      max_queued_images_per_camera_(0u),
       input_camera_system_(input_camera_system),
       output_camera_system_(output_camera_system),
       timestamp_tolerance_ns_(timestamp_tolerance_ns)  {
+  checkPipelines();
+  assembler_.reset(new NFrameAssembler(
+      output_camera_system_, timestamp_tolerance_ns_,
+      std::bind(&VisualNPipeline::addCompleteNFrame, this, std::placeholders::_1,
+                std::placeholders::_2)));
+  CHECK_GT(num_threads, 0u);
+  thread_pool_.reset(new ThreadPool(num_threads));
+}
+
+VisualNPipeline::VisualNPipeline(
+    const StagedExecutionOptions& options,
+    const std::vector<std::shared_ptr<VisualPipeline> >& pipelines,
+    const std::shared_ptr<NCamera>& input_camera_system,
+    const std::shared_ptr<NCamera>& output_camera_system,
+    int64_t timestamp_tolerance_ns) :
+      pipelines_(pipelines),
+      shutdown_(false),
+      max_stage_queue_size_(options.max_queue_size),
+      is_latency_budget_enabled_(false),
+      total_latency_seconds_(0.0),
+      num_work_done_(0u),
+      total_work_time_seconds_(0.0),
+      max_queued_images_per_camera_(0u),
+      input_camera_system_(input_camera_system),
+      output_camera_system_(output_camera_system),
+      timestamp_tolerance_ns_(timestamp_tolerance_ns)  {
+  checkPipelines();
+  assembler_.reset(new NFrameAssembler(
+      output_camera_system_, timestamp_tolerance_ns_,
+      std::bind(&VisualNPipeline::addCompleteNFrame, this, std::placeholders::_1,
+                std::placeholders::_2)));
+  CHECK_GT(max_stage_queue_size_, 0u);
+  stages_.resize(kNumStages);
+  for (size_t stage_index = 0u; stage_index < kNumStages; ++stage_index) {
+    CHECK_GT(options.num_threads[stage_index], 0u);
+    stages_[stage_index].thread_pool.reset(new ThreadPool(options.num_threads[stage_index]));
+    stages_[stage_index].total_processing_time_seconds = 0.0;
+  }
+}
+
+VisualNPipeline::VisualNPipeline(
+    const CameraSchedulingOptions& options,
+    const std::vector<std::shared_ptr<VisualPipeline> >& pipelines,
+    const std::shared_ptr<NCamera>& input_camera_system,
+    const std::shared_ptr<NCamera>& output_camera_system,
+    int64_t timestamp_tolerance_ns) :
+      pipelines_(pipelines),
+      shutdown_(false),
+      max_stage_queue_size_(0u),
+      is_latency_budget_enabled_(false),
+      total_latency_seconds_(0.0),
+      num_work_done_(0u),
+      total_work_time_seconds_(0.0),
+      max_queued_images_per_camera_(options.max_queued_images_per_camera),
+      input_camera_system_(input_camera_system),
+      output_camera_system_(output_camera_system),
+      timestamp_tolerance_ns_(timestamp_tolerance_ns)  {
+  checkPipelines();
+  assembler_.reset(new NFrameAssembler(
+      output_camera_system_, timestamp_tolerance_ns_,
+      std::bind(&VisualNPipeline::addCompleteNFrame, this, std::placeholders::_1,
+                std::placeholders::_2)));
+  CHECK(!options.worker_sets.empty());
+  CHECK_EQ(options.camera_worker_sets.size(), pipelines_.size());
+  CHECK(options.camera_priority_weights.empty() ||
+        options.camera_priority_weights.size() == pipelines_.size());
+  worker_sets_.resize(options.worker_sets.size());
+  for (size_t worker_set_index = 0u; worker_set_index < worker_sets_.size();
+       ++worker_set_index) {
+    const CameraSchedulingOptions::WorkerSet& worker_set_options =
+        options.worker_sets[worker_set_index];
+    CHECK_GT(worker_set_options.num_threads, 0u);
+    worker_sets_[worker_set_index].thread_pool.reset(
+        new ThreadPool(worker_set_options.num_threads));
+    if (!worker_set_options.cpu_cores.empty()) {
+      // Not pinning the threads is not fatal, the pipeline still works.
+      worker_sets_[worker_set_index].thread_pool->setCpuAffinity(worker_set_options.cpu_cores);
+    }
+  }
+  scheduled_cameras_.resize(pipelines_.size());
+  for (size_t camera_index = 0u; camera_index < pipelines_.size(); ++camera_index) {
+    ScheduledCamera& camera = scheduled_cameras_[camera_index];
+    camera.worker_set_index = options.camera_worker_sets[camera_index];
+    CHECK_LT(camera.worker_set_index, worker_sets_.size());
+    camera.priority_weight = options.camera_priority_weights.empty() ?
+        1.0 : options.camera_priority_weights[camera_index];
+    CHECK_GT(camera.priority_weight, 0.0);
+    worker_sets_[camera.worker_set_index].camera_indices.push_back(camera_index);
+  }
+}
+
+void VisualNPipeline::checkPipelines() const {
   // Defensive programming ninjitsu.
   CHECK_NOTNULL(input_camera_system_.get());
-  CHECK_NOTNULL(output_camera_system.get());
+  CHECK_NOTNULL(output_camera_system_.get());
   CHECK_GT(input_camera_system_->numCameras(), 0u);
   CHECK_EQ(input_camera_system_->numCameras(),
            output_camera_system_->numCameras());
-  CHECK_EQ(input_camera_system_->numCameras(), pipelines.size());
-  CHECK_GE(timestamp_tolerance_ns, 0);
+  CHECK_EQ(input_camera_system_->numCameras(), pipelines_.size());
+  CHECK_GE(timestamp_tolerance_ns_, 0);
 
-  for (size_t i = 0; i < pipelines.size(); ++i) {
-    CHECK_NOTNULL(pipelines[i].get());
+  for (size_t i = 0; i < pipelines_.size(); ++i) {
+    CHECK_NOTNULL(pipelines_[i].get());
     // Check that the input cameras actually point to the same object.
     CHECK_EQ(input_camera_system_->getCameraShared(i).get(),
-             pipelines[i]->getInputCameraShared().get());
+             pipelines_[i]->getInputCameraShared().get());
     // Check that the output cameras actually point to the same object.
     CHECK_EQ(output_camera_system_->getCameraShared(i).get(),
-             pipelines[i]->getOutputCameraShared().get());
+             pipelines_[i]->getOutputCameraShared().get());
   }
-  CHECK_GT(num_threads, 0u);
-  thread_pool_.reset(new ThreadPool(num_threads));
 }
 
 VisualNPipeline::~VisualNPipeline() {
@@ -56,7 +161,20 @@ void VisualNPipeline::shutdown() {
   shutdown_ = true;
   condition_not_empty_.notify_all();
   condition_not_full_.notify_all();
-  thread_pool_->stop();
+  {
+    // Release the stages waiting for space in a queue.
+    std::lock_guard<std::mutex> lock(stage_mutex_);
+    condition_stage_not_full_.notify_all();
+  }
+  if (thread_pool_) {
+    thread_pool_->stop();
+  }
+  for (ExecutionStage& stage : stages_) {
+    stage.thread_pool->stop();
+  }
+  for (WorkerSet& worker_set : worker_sets_) {
+    worker_set.thread_pool->stop();
+  }
 }
 
 bool VisualNPipeline::processImageBlockingIfFull(
@@ -113,8 +231,150 @@ bool VisualNPipeline::getNextBlocking(std::shared_ptr<VisualNFrame>* nframe) {
 
 void VisualNPipeline::processImage(
     size_t camera_index, const cv::Mat& image, int64_t timestamp) {
-  thread_pool_->enqueue(&VisualNPipeline::work, this, camera_index, image,
-                        timestamp);
+  processImageImpl(camera_index, image, timestamp);
+}
+
+bool VisualNPipeline::processImageWithinLatencyBudget(
+    size_t camera_index, const cv::Mat& image, int64_t timestamp, int64_t latency_budget_ns) {
+  CHECK_LT(camera_index, pipelines_.size());
+  CHECK_GE(latency_budget_ns, 0);
+  if (!is_latency_budget_enabled_.exchange(true)) {
+    // Waiting for an incomplete VisualNFrame delays all newer ones.
+    assembler_->setDropStaleNFrames(true);
+  }
+
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const double latency_budget_seconds = static_cast<double>(latency_budget_ns) * 1e-9;
+  const bool is_expected_late = predictLatencySeconds(camera_index) > latency_budget_seconds;
+  {
+    std::lock_guard<std::mutex> lock(latency_mutex_);
+    if (is_expected_late) {
+      ++latency_statistics_.num_skipped_images;
+      return false;
+    }
+    ImageDeadline& image_deadline = image_deadlines_[std::make_pair(camera_index, timestamp)];
+    image_deadline.submission_time = now;
+    image_deadline.deadline = now + std::chrono::nanoseconds(latency_budget_ns);
+  }
+  processImageImpl(camera_index, image, timestamp);
+  return true;
+}
+
+VisualNPipeline::LatencyStatistics VisualNPipeline::getLatencyStatistics() const {
+  const size_t num_dropped_nframes = assembler_->getNumDroppedNFrames();
+  std::lock_guard<std::mutex> lock(latency_mutex_);
+  LatencyStatistics statistics = latency_statistics_;
+  statistics.num_dropped_nframes = num_dropped_nframes;
+  return statistics;
+}
+
+double VisualNPipeline::predictLatencySeconds(size_t camera_index) const {
+  // Every image waits for the images queued in front of it, which are shared by the threads.
+  if (isStaged()) {
+    double latency_seconds = 0.0;
+    std::lock_guard<std::mutex> lock(stage_mutex_);
+    for (const ExecutionStage& stage : stages_) {
+      latency_seconds += stage.statistics.mean_processing_time_seconds *
+          (1.0 + static_cast<double>(stage.statistics.queue_size) /
+              stage.thread_pool->numThreads());
+    }
+    return latency_seconds;
+  }
+  size_t num_queued_tasks;
+  size_t num_threads;
+  if (isScheduled()) {
+    // Only the images of the cameras sharing the worker set are in front.
+    CHECK_LT(camera_index, scheduled_cameras_.size());
+    std::lock_guard<std::mutex> lock(scheduling_mutex_);
+    const WorkerSet& worker_set =
+        worker_sets_[scheduled_cameras_[camera_index].worker_set_index];
+    num_queued_tasks = 0u;
+    for (const size_t worker_set_camera_index : worker_set.camera_indices) {
+      num_queued_tasks += scheduled_cameras_[worker_set_camera_index].queued_images.size();
+    }
+    num_threads = worker_set.thread_pool->numThreads();
+  } else {
+    num_queued_tasks = thread_pool_->numQueuedTasks();
+    num_threads = thread_pool_->numThreads();
+  }
+  std::lock_guard<std::mutex> lock(latency_mutex_);
+  if (num_work_done_ == 0u) {
+    return 0.0;
+  }
+  return total_work_time_seconds_ / num_work_done_ *
+      (1.0 + static_cast<double>(num_queued_tasks) / num_threads);
+}
+
+void VisualNPipeline::moveImageDeadlineToFrame(
+    size_t camera_index, int64_t submitted_timestamp_nanoseconds, const VisualFrame& frame) {
+  if (!is_latency_budget_enabled_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(latency_mutex_);
+  std::map<std::pair<size_t, int64_t>, ImageDeadline>::iterator it = image_deadlines_.find(
+      std::make_pair(camera_index, submitted_timestamp_nanoseconds));
+  if (it == image_deadlines_.end()) {
+    // The image was handed in without a latency budget.
+    return;
+  }
+  frame_deadlines_[std::make_pair(frame.getTimestampNanoseconds(), camera_index)] = it->second;
+  image_deadlines_.erase(it);
+}
+
+bool VisualNPipeline::checkNFrameDeadline(const VisualNFrame& nframe,
+                                          int64_t timestamp_nanoseconds) {
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(latency_mutex_);
+  bool has_deadline = false;
+  std::chrono::steady_clock::time_point first_submission_time;
+  std::chrono::steady_clock::time_point deadline;
+  for (size_t frame_index = 0u; frame_index < nframe.getNumFrames(); ++frame_index) {
+    const std::shared_ptr<const VisualFrame> frame = nframe.getFrameShared(frame_index);
+    if (!frame) {
+      continue;
+    }
+    std::map<std::pair<int64_t, size_t>, ImageDeadline>::iterator it = frame_deadlines_.find(
+        std::make_pair(frame->getTimestampNanoseconds(), frame_index));
+    if (it == frame_deadlines_.end()) {
+      continue;
+    }
+    if (!has_deadline || it->second.submission_time < first_submission_time) {
+      first_submission_time = it->second.submission_time;
+    }
+    if (!has_deadline || it->second.deadline < deadline) {
+      deadline = it->second.deadline;
+    }
+    has_deadline = true;
+    frame_deadlines_.erase(it);
+  }
+  // The frames of older VisualNFrames are not output any more.
+  frame_deadlines_.erase(
+      frame_deadlines_.begin(),
+      frame_deadlines_.lower_bound(std::make_pair(
+          timestamp_nanoseconds - timestamp_tolerance_ns_, static_cast<size_t>(0u))));
+  if (!has_deadline) {
+    // The images were handed in without a latency budget.
+    return true;
+  }
+
+  const double latency_seconds =
+      std::chrono::duration<double>(now - first_submission_time).count();
+  const size_t num_nframes =
+      latency_statistics_.num_output_nframes + latency_statistics_.num_late_nframes + 1u;
+  total_latency_seconds_ += latency_seconds;
+  latency_statistics_.mean_latency_seconds = total_latency_seconds_ / num_nframes;
+  latency_statistics_.max_latency_seconds =
+      std::max(latency_statistics_.max_latency_seconds, latency_seconds);
+  const size_t bin_index = std::min(
+      static_cast<size_t>(latency_seconds / kLatencyHistogramBinWidthSeconds),
+      kNumLatencyHistogramBins - 1u);
+  ++latency_statistics_.latency_histogram[bin_index];
+  if (now > deadline) {
+    ++latency_statistics_.num_late_nframes;
+    return false;
+  }
+  ++latency_statistics_.num_output_nframes;
+  return true;
 }
 
 size_t VisualNPipeline::getNumFramesComplete() const {
@@ -143,27 +403,64 @@ std::shared_ptr<VisualNFrame> VisualNPipeline::getNextImpl() {
 
 void VisualNPipeline::processImageImpl(
     size_t camera_index, const cv::Mat& image, int64_t timestamp) {
+  if (isStaged()) {
+    std::shared_ptr<StagedImage> staged_image = std::make_shared<StagedImage>();
+    staged_image->camera_index = camera_index;
+    staged_image->timestamp_nanoseconds = timestamp;
+    staged_image->image = image;
+    enqueueToStage(Stage::kPreprocessing, staged_image);
+    return;
+  }
+  if (isScheduled()) {
+    CHECK_LT(camera_index, scheduled_cameras_.size());
+    size_t worker_set_index;
+    bool is_oldest_dropped = false;
+    int64_t dropped_timestamp = 0;
+    {
+      std::lock_guard<std::mutex> lock(scheduling_mutex_);
+      ScheduledCamera& camera = scheduled_cameras_[camera_index];
+      worker_set_index = camera.worker_set_index;
+      if (max_queued_images_per_camera_ > 0u &&
+          camera.queued_images.size() >= max_queued_images_per_camera_) {
+        // The task enqueued for the dropped image takes the new one.
+        dropped_timestamp = camera.queued_images.front().second;
+        camera.queued_images.pop_front();
+        ++camera.statistics.num_dropped;
+        is_oldest_dropped = true;
+      }
+      camera.queued_images.emplace_back(image, timestamp);
+      camera.statistics.num_queued = camera.queued_images.size();
+    }
+    if (!is_oldest_dropped) {
+      worker_sets_[worker_set_index].thread_pool->enqueue(
+          &VisualNPipeline::workScheduled, this, worker_set_index);
+    } else if (is_latency_budget_enabled_) {
+      std::lock_guard<std::mutex> lock(latency_mutex_);
+      image_deadlines_.erase(std::make_pair(camera_index, dropped_timestamp));
+    }
+    return;
+  }
   thread_pool_->enqueue(&VisualNPipeline::work, this, camera_index, image,
                         timestamp);
 }
 
 std::shared_ptr<VisualNFrame> VisualNPipeline::getLatestAndClear() {
   std::shared_ptr<VisualNFrame> nframe;
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (completed_.empty()) {
-    return nframe;
-  }
-  auto reverse_it_completed = completed_.rbegin();
-  nframe = reverse_it_completed->second;
-  const int64_t timestamp_nanoseconds = reverse_it_completed->first;
-  completed_.clear();
-  condition_not_full_.notify_all();
-  // Clear any processing frames older than this one.
-  auto it_processing = processing_.begin();
-  while (it_processing != processing_.end()
-      && it_processing->first <= timestamp_nanoseconds) {
-    it_processing = processing_.erase(it_processing);
+  int64_t timestamp_nanoseconds;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (completed_.empty()) {
+      return nframe;
+    }
+    auto reverse_it_completed = completed_.rbegin();
+    nframe = reverse_it_completed->second;
+    timestamp_nanoseconds = reverse_it_completed->first;
+    completed_.clear();
+    condition_not_full_.notify_all();
   }
+  // Clear any processing frames older than this one. The assembler calls back into the
+  // output queue, so this is done without holding the lock.
+  assembler_->discardNFramesUpTo(timestamp_nanoseconds);
   return nframe;
 }
 
@@ -187,13 +484,9 @@ bool VisualNPipeline::getLatestAndClearBlocking(
     const int64_t timestamp_nanoseconds = nframe_iterator->first;
     completed_.clear();
     condition_not_full_.notify_all();
+    lock.unlock();
     // Clear any processing frames older than this one.
-    TimestampVisualNFrameMap::iterator processing_iterator =
-        processing_.begin();
-    while (processing_iterator != processing_.end() &&
-        processing_iterator->first <= timestamp_nanoseconds) {
-      processing_iterator = processing_.erase(processing_iterator);
-    }
+    assembler_->discardNFramesUpTo(timestamp_nanoseconds);
     return true;
   }
   return false;
@@ -208,131 +501,204 @@ std::shared_ptr<const NCamera> VisualNPipeline::getOutputNCameras() const {
 }
 
 size_t VisualNPipeline::getNumFramesProcessing() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return processing_.size();
+  return assembler_->getNumNFramesInProgress();
 }
 
 void VisualNPipeline::work(size_t camera_index, const cv::Mat& image,
                            int64_t timestamp_nanoseconds) {
   CHECK_LE(camera_index, pipelines_.size());
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
   std::shared_ptr<VisualFrame> frame;
   frame = pipelines_[camera_index]->processImage(image, timestamp_nanoseconds);
+  moveImageDeadlineToFrame(camera_index, timestamp_nanoseconds, *frame);
+  {
+    std::lock_guard<std::mutex> lock(latency_mutex_);
+    ++num_work_done_;
+    total_work_time_seconds_ +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  assembleNFrame(camera_index, frame);
+}
 
-  /// Create an iterator into the processing queue.
-  std::map<int64_t, std::shared_ptr<VisualNFrame>>::iterator proc_it;
+void VisualNPipeline::workScheduled(size_t worker_set_index) {
+  CHECK_LT(worker_set_index, worker_sets_.size());
+  size_t camera_index = 0u;
+  std::pair<cv::Mat, int64_t> image;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    bool create_new_nframes = false;
-    if (processing_.empty()) {
-      create_new_nframes = true;
-    } else {
-      // Try to find an existing NFrame in the processing list.
-      // Use the timestamp of the frame because there may be a timestamp
-      // corrector used in the pipeline.
-      auto it_processing = processing_.lower_bound(
-          frame->getTimestampNanoseconds());
-      // Lower bound returns the first element that is not less than the value
-      // (i.e. greater than or equal to the value).
-      if (it_processing != processing_.begin()) { --it_processing; }
-      // Now it_processing points to the first element that is less than the
-      // value. Check both this value, and the one >=.
-      int64_t min_time_diff = std::abs(
-          it_processing->first - frame->getTimestampNanoseconds());
-      proc_it = it_processing;
-      if (++it_processing != processing_.end()) {
-        const int64_t time_diff = std::abs(
-            it_processing->first - frame->getTimestampNanoseconds());
-        if (time_diff < min_time_diff) {
-          proc_it = it_processing;
-          min_time_diff = time_diff;
-        }
+    std::lock_guard<std::mutex> lock(scheduling_mutex_);
+    // Every task takes one image, so there is an image waiting. The next image of a camera
+    // starts in virtual time when its previous image finished, but not before the virtual
+    // time of the worker set, so an idle camera does not build up credit. The image that
+    // finishes first is taken.
+    WorkerSet& worker_set = worker_sets_[worker_set_index];
+    bool is_image_found = false;
+    double min_virtual_finish_time = std::numeric_limits<double>::max();
+    double virtual_start_time = 0.0;
+    for (const size_t worker_set_camera_index : worker_set.camera_indices) {
+      const ScheduledCamera& camera = scheduled_cameras_[worker_set_camera_index];
+      if (camera.queued_images.empty()) {
+        continue;
       }
-      // Now proc_it points to the closest nframes element.
-      if (min_time_diff > timestamp_tolerance_ns_) {
-       create_new_nframes = true;
+      const double camera_virtual_start_time =
+          std::max(camera.virtual_finish_time, worker_set.virtual_time);
+      const double virtual_finish_time =
+          camera_virtual_start_time + 1.0 / camera.priority_weight;
+      if (virtual_finish_time < min_virtual_finish_time) {
+        min_virtual_finish_time = virtual_finish_time;
+        virtual_start_time = camera_virtual_start_time;
+        camera_index = worker_set_camera_index;
+        is_image_found = true;
       }
     }
+    CHECK(is_image_found);
+    worker_set.virtual_time = virtual_start_time;
+    ScheduledCamera& camera = scheduled_cameras_[camera_index];
+    camera.virtual_finish_time = min_virtual_finish_time;
+    image = camera.queued_images.front();
+    camera.queued_images.pop_front();
+    camera.statistics.num_queued = camera.queued_images.size();
+    ++camera.statistics.num_processed;
+  }
+  work(camera_index, image.first, image.second);
+}
 
-    if (create_new_nframes) {
-      std::shared_ptr<VisualNFrame> nframes(
-          new VisualNFrame(output_camera_system_));
-      bool not_replaced;
-      std::tie(proc_it, not_replaced) = processing_.insert(
-          std::make_pair(frame->getTimestampNanoseconds(), nframes)
-      );
-      CHECK(not_replaced);
-    }
-    // Now proc_it points to the correct place in the processing_ list and
-    // the NFrame has been created if necessary.
-    VisualFrame::Ptr existing_frame = proc_it->second->getFrameShared(
-        camera_index);
-    if (existing_frame) {
-      LOG(ERROR) << "Overwriting a frame at index " << camera_index
-          << ":" << std::endl
-          << *existing_frame << std::endl << "with a new frame: "
-          << *frame << std::endl << "because the timestamp was the same.";
+VisualNPipeline::CameraSchedulingStatistics VisualNPipeline::getCameraSchedulingStatistics(
+    size_t camera_index) const {
+  CHECK(isScheduled())
+      << "Camera scheduling statistics are only available in the scheduled execution mode.";
+  CHECK_LT(camera_index, scheduled_cameras_.size());
+  std::lock_guard<std::mutex> lock(scheduling_mutex_);
+  return scheduled_cameras_[camera_index].statistics;
+}
+
+void VisualNPipeline::enqueueToStage(
+    Stage stage, const std::shared_ptr<StagedImage>& staged_image) {
+  CHECK(staged_image);
+  const size_t stage_index = static_cast<size_t>(stage);
+  CHECK_LT(stage_index, stages_.size());
+  ExecutionStage& execution_stage = stages_[stage_index];
+  {
+    std::unique_lock<std::mutex> lock(stage_mutex_);
+    if (stage != Stage::kPreprocessing) {
+      // Wait for space in the queue, the previous stage is blocked meanwhile.
+      const std::chrono::steady_clock::time_point wait_start = std::chrono::steady_clock::now();
+      condition_stage_not_full_.wait(lock, [this, &execution_stage]() {
+        return shutdown_ || execution_stage.statistics.queue_size < max_stage_queue_size_;
+      });
+      stages_[stage_index - 1u].statistics.total_blocked_time_seconds +=
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
     }
-    proc_it->second->setFrame(camera_index, frame);
-
-    // Find the first index that has N consecutive complete nframes following in chronological
-    // ordering.
-    // E.g. N=3    I I C I C C C C C   (I: incomplete, C: complete)
-    //      idx    0 1 2 3 4 5 6 7 8
-    //                     # --> first index with N complete = 4
-    const size_t kNumMinConsecutiveCompleteThreshold = 2u;
-    int delete_upto_including_index = -1;
-    if (processing_.size() > kNumMinConsecutiveCompleteThreshold + 1) {
-      size_t num_consecutive_complete = 0u;
-      size_t idx = 0u;
-      auto it_processing = processing_.begin();
-      while (it_processing != processing_.end()) {
-        bool is_complete = CHECK_NOTNULL(it_processing->second.get())->areAllFramesSet();
-        if (is_complete) {
-          ++num_consecutive_complete;
-        } else {
-          num_consecutive_complete = 0u;
-        }
-        if (num_consecutive_complete >= kNumMinConsecutiveCompleteThreshold) {
-          delete_upto_including_index = static_cast<int>(idx) -
-              static_cast<int>(kNumMinConsecutiveCompleteThreshold);
-          break;
-        }
-        ++it_processing;
-        ++idx;
-      }
+    if (shutdown_) {
+      return;
     }
+    ++execution_stage.statistics.queue_size;
+    execution_stage.statistics.max_queue_size = std::max(
+        execution_stage.statistics.max_queue_size, execution_stage.statistics.queue_size);
+  }
+  // The images of a camera pass every stage one after the other and in order.
+  execution_stage.thread_pool->enqueueOrdered(
+      staged_image->camera_index, &VisualNPipeline::runStage, this, stage, staged_image);
+}
 
-    // Now drop all incomplete nframes up to delete_upto_including_index. All frames below this
-    // index will probably never complete as one camera in the rig dropped an image.
-    if (delete_upto_including_index >= 0) {
-      int num_nframes_to_delete = delete_upto_including_index + 1;
-      auto it_processing = processing_.begin();
-      while (it_processing != processing_.end() && num_nframes_to_delete-- > 0) {
-        it_processing = processing_.erase(it_processing);
-      }
-      LOG(WARNING) << "Detected frame drop: removing " << delete_upto_including_index + 1
-                   << " nframes from the queue.";
-    }
+void VisualNPipeline::runStage(
+    Stage stage, const std::shared_ptr<StagedImage>& staged_image) {
+  CHECK(staged_image);
+  const size_t stage_index = static_cast<size_t>(stage);
+  CHECK_LT(stage_index, stages_.size());
+  CHECK_LT(staged_image->camera_index, pipelines_.size());
+  {
+    std::lock_guard<std::mutex> lock(stage_mutex_);
+    --stages_[stage_index].statistics.queue_size;
+  }
+  condition_stage_not_full_.notify_all();
 
-    // Move all completed nframes from the processed_ queue to the completed_ queue chronologically.
-    auto it_processing = processing_.begin();
-    while (it_processing != processing_.end()) {
-      // Check if all images have been received.
-      if (it_processing->second->areAllFramesSet()) {
-        completed_.insert(*it_processing);
-        it_processing = processing_.erase(it_processing);
-        condition_not_empty_.notify_all();
-      } else {
-        // As we are iterating over the map in chronological order we have to abort once an nframe
-        // is not yet finished processing to keep chronological ordering in the destination queue.
-        break;
-      }
+  const VisualPipeline& pipeline = *pipelines_[staged_image->camera_index];
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  switch (stage) {
+    case Stage::kPreprocessing: {
+      cv::Mat image;
+      staged_image->frame = pipeline.preprocessImage(
+          staged_image->image, staged_image->timestamp_nanoseconds, &image);
+      staged_image->image = image;
+      break;
     }
+    case Stage::kDetection:
+      pipeline.detectKeypoints(staged_image->image, staged_image->frame.get());
+      break;
+    case Stage::kExtraction:
+      pipeline.computeDescriptors(staged_image->image, staged_image->frame.get());
+      // The preprocessed image is not needed any more.
+      staged_image->image.release();
+      break;
+    case Stage::kAssembly:
+      // The frame timestamp is final only now, as the pipeline may correct it in any of the
+      // earlier stages, e.g. in processFrameImpl, which runs in the detection stage.
+      moveImageDeadlineToFrame(staged_image->camera_index, staged_image->timestamp_nanoseconds,
+                               *staged_image->frame);
+      assembleNFrame(staged_image->camera_index, staged_image->frame);
+      break;
+    default:
+      LOG(FATAL) << "Unknown stage " << stage_index << ".";
   }
+  const double processing_time_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  {
+    std::lock_guard<std::mutex> lock(stage_mutex_);
+    ExecutionStage& execution_stage = stages_[stage_index];
+    StageStatistics& statistics = execution_stage.statistics;
+    ++statistics.num_processed;
+    execution_stage.total_processing_time_seconds += processing_time_seconds;
+    statistics.mean_processing_time_seconds =
+        execution_stage.total_processing_time_seconds / statistics.num_processed;
+    statistics.max_processing_time_seconds =
+        std::max(statistics.max_processing_time_seconds, processing_time_seconds);
+  }
+
+  if (stage != Stage::kAssembly) {
+    enqueueToStage(static_cast<Stage>(stage_index + 1u), staged_image);
+  }
+}
+
+VisualNPipeline::StageStatistics VisualNPipeline::getStageStatistics(Stage stage) const {
+  CHECK(isStaged()) << "Stage statistics are only available in the staged execution mode.";
+  const size_t stage_index = static_cast<size_t>(stage);
+  CHECK_LT(stage_index, stages_.size());
+  std::lock_guard<std::mutex> lock(stage_mutex_);
+  return stages_[stage_index].statistics;
+}
+
+void VisualNPipeline::assembleNFrame(size_t camera_index,
+                                     const std::shared_ptr<VisualFrame>& frame) {
+  CHECK(frame);
+  // Use the timestamp of the frame because there may be a timestamp corrector used in the
+  // pipeline.
+  assembler_->addFrame(camera_index, frame);
+}
+
+void VisualNPipeline::addCompleteNFrame(int64_t timestamp_nanoseconds,
+                                        const std::shared_ptr<VisualNFrame>& nframe) {
+  CHECK(nframe);
+  if (is_latency_budget_enabled_ && !checkNFrameDeadline(*nframe, timestamp_nanoseconds)) {
+    // A late VisualNFrame is worse than a missing one.
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  completed_.insert(std::make_pair(timestamp_nanoseconds, nframe));
+  condition_not_empty_.notify_all();
 }
 
 void VisualNPipeline::waitForAllWorkToComplete() const {
-  thread_pool_->waitForEmptyQueue();
+  if (thread_pool_) {
+    thread_pool_->waitForEmptyQueue();
+  }
+  // An image only moves on to later stages, so the stages are empty once every stage was
+  // empty in processing order.
+  for (const ExecutionStage& stage : stages_) {
+    stage.thread_pool->waitForEmptyQueue();
+  }
+  for (const WorkerSet& worker_set : worker_sets_) {
+    worker_set.thread_pool->waitForEmptyQueue();
+  }
 }
 
 VisualNPipeline::Ptr VisualNPipeline::createTestVisualNPipeline(
@@ -65,10 +65,30 @@ void FreakVisualPipeline::processFrameImpl(const cv::Mat& image, VisualFrame* fr
   // Now we use the image from the frame. It might be undistorted.
   std::vector<cv::KeyPoint> keypoints;
   detector_->detect(image, keypoints);
+  describeKeypoints(image, &keypoints, frame);
+}
+
+void FreakVisualPipeline::detectKeypointsImpl(const cv::Mat& image, VisualFrame* frame) const {
+  CHECK_NOTNULL(frame);
+  std::vector<cv::KeyPoint> keypoints;
+  detector_->detect(image, keypoints);
+  setFrameKeypoints(keypoints, frame);
+}
 
+void FreakVisualPipeline::computeDescriptorsImpl(const cv::Mat& image, VisualFrame* frame) const {
+  CHECK_NOTNULL(frame);
+  std::vector<cv::KeyPoint> keypoints;
+  getFrameKeypoints(*frame, &keypoints);
+  describeKeypoints(image, &keypoints, frame);
+}
+
+void FreakVisualPipeline::describeKeypoints(
+    const cv::Mat& image, std::vector<cv::KeyPoint>* keypoints, VisualFrame* frame) const {
+  CHECK_NOTNULL(keypoints);
+  CHECK_NOTNULL(frame);
   cv::Mat descriptors;
-  if(!keypoints.empty()) {
-    extractor_->compute(image, keypoints, descriptors);
+  if(!keypoints->empty()) {
+    extractor_->compute(image, *keypoints, descriptors);
   } else {
     descriptors = cv::Mat(0, 0, CV_8UC1);
     LOG(WARNING) << "Frame produced no keypoints:\n" << *frame;
@@ -86,32 +106,7 @@ void FreakVisualPipeline::processFrameImpl(const cv::Mat& image, VisualFrame* fr
                                             descriptors.cols,
                                             descriptors.rows)
   );
-
-  // The keypoint uncertainty is set to a constant value.
-  const double kKeypointUncertaintyPixelSigma = 0.8;
-
-  Eigen::Matrix2Xd ikeypoints(2, keypoints.size());
-  Eigen::VectorXd scales(keypoints.size());
-  Eigen::VectorXd orientations(keypoints.size());
-  Eigen::VectorXd scores(keypoints.size());
-  Eigen::VectorXd uncertainties(keypoints.size());
-
-  // \TODO(ptf) Who knows a good formula for uncertainty based on octave?
-  //            See https://github.com/ethz-asl/aslam_cv2/issues/73
-  for(size_t i = 0; i < keypoints.size(); ++i) {
-    const cv::KeyPoint& kp = keypoints[i];
-    ikeypoints(0,i)  = kp.pt.x;
-    ikeypoints(1,i)  = kp.pt.y;
-    scales[i]        = kp.size;
-    orientations[i]  = kp.angle;
-    scores[i]        = kp.response;
-    uncertainties[i] = kKeypointUncertaintyPixelSigma;
-  }
-  frame->swapKeypointMeasurements(&ikeypoints);
-  frame->swapKeypointScores(&scores);
-  frame->swapKeypointOrientations(&orientations);
-  frame->swapKeypointScales(&scales);
-  frame->swapKeypointMeasurementUncertainties(&uncertainties);
+  setFrameKeypoints(*keypoints, frame);
 }
 
 }  // namespace aslam
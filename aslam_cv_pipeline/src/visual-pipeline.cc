@@ -25,13 +25,61 @@ VisualPipeline::VisualPipeline(std::unique_ptr<Undistorter>& preprocessing, bool
   output_camera_ = preprocessing_->getOutputCameraShared();
 }
 
+void VisualPipeline::enableBufferPools(size_t max_num_frames) {
+  CHECK_GT(max_num_frames, 0u);
+  frame_pool_.reset(new VisualFramePool(max_num_frames));
+  // Every frame may hold a copied raw image while another preprocessed image is in flight.
+  image_pool_.reset(new ImageBufferPool(2u * max_num_frames));
+}
+
 std::shared_ptr<VisualFrame> VisualPipeline::processImage(const cv::Mat& raw_image,
                                                           int64_t timestamp) const {
+  return processImageImpl(raw_image, timestamp, nullptr);
+}
+
+std::shared_ptr<VisualFrame> VisualPipeline::processImage(
+    const cv::Mat& raw_image, int64_t timestamp,
+    const ImageReleaseCallback& release_callback) const {
+  // The owner holds no data, it calls the callback once the last copy of it is released.
+  std::shared_ptr<const void> image_owner(nullptr, [release_callback](const void*) {
+    if (release_callback) {
+      release_callback();
+    }
+  });
+  return processImageImpl(raw_image, timestamp, image_owner);
+}
+
+std::shared_ptr<VisualFrame> VisualPipeline::processImageImpl(
+    const cv::Mat& raw_image, int64_t timestamp,
+    const std::shared_ptr<const void>& image_owner) const {
+  cv::Mat image;
+  std::shared_ptr<VisualFrame> frame =
+      preprocessImageImpl(raw_image, timestamp, image_owner, &image);
+  detectKeypoints(image, frame.get());
+  computeDescriptors(image, frame.get());
+  return frame;
+}
+
+std::shared_ptr<VisualFrame> VisualPipeline::preprocessImage(const cv::Mat& raw_image,
+                                                             int64_t timestamp,
+                                                             cv::Mat* image) const {
+  return preprocessImageImpl(raw_image, timestamp, nullptr, image);
+}
+
+std::shared_ptr<VisualFrame> VisualPipeline::preprocessImageImpl(
+    const cv::Mat& raw_image, int64_t timestamp,
+    const std::shared_ptr<const void>& image_owner, cv::Mat* image) const {
+  CHECK_NOTNULL(image);
   CHECK_EQ(input_camera_->imageWidth(), static_cast<size_t>(raw_image.cols));
   CHECK_EQ(input_camera_->imageHeight(), static_cast<size_t>(raw_image.rows));
 
   // \TODO(PTF) Eventually we can put timestamp correction policies in here.
-  std::shared_ptr<VisualFrame> frame(new VisualFrame);
+  // A recycled frame drops its old raw image here, so acquire it before the images.
+  // Frames referencing an external image are not recycled, as the pool would delay the release.
+  const bool keeps_external_image = image_owner && !copy_images_;
+  std::shared_ptr<VisualFrame> frame(
+      frame_pool_ && !keeps_external_image ? frame_pool_->acquire() :
+                                             std::shared_ptr<VisualFrame>(new VisualFrame));
   frame->setTimestampNanoseconds(timestamp);
   frame->setRawCameraGeometry(input_camera_);
   frame->setCameraGeometry(output_camera_);
@@ -39,21 +87,105 @@ std::shared_ptr<VisualFrame> VisualPipeline::processImage(const cv::Mat& raw_ima
   generateId(&id);
   frame->setId(id);
   if(copy_images_) {
-    frame->setRawImage(raw_image.clone());
+    if (image_pool_) {
+      cv::Mat raw_image_copy = image_pool_->acquire(raw_image.rows, raw_image.cols,
+                                                    raw_image.type());
+      raw_image.copyTo(raw_image_copy);
+      frame->setRawImage(raw_image_copy);
+    } else {
+      frame->setRawImage(raw_image.clone());
+    }
+  } else if (image_owner) {
+    frame->setRawImage(raw_image, image_owner);
   } else {
     frame->setRawImage(raw_image);
   }
 
-  cv::Mat image;
-  if(preprocessing_) {
-    preprocessing_->processImage(raw_image, &image);
+  if(preprocessing_ && preprocessing_->transformsImage()) {
+    if (image_pool_) {
+      // The undistorters write into an output image of the right size without reallocating.
+      *image = image_pool_->acquire(static_cast<int>(output_camera_->imageHeight()),
+                                    static_cast<int>(output_camera_->imageWidth()),
+                                    raw_image.type());
+    }
+    preprocessing_->processImage(raw_image, image);
   } else {
-    image = raw_image;
+    *image = raw_image;
   }
+  return frame;
+}
+
+void VisualPipeline::detectKeypoints(const cv::Mat& image, VisualFrame* frame) const {
+  CHECK_NOTNULL(frame);
   /// Send the image to the derived class for processing
-  processFrameImpl(image, frame.get());
+  detectKeypointsImpl(image, frame);
+}
 
-  return frame;
+void VisualPipeline::computeDescriptors(const cv::Mat& image, VisualFrame* frame) const {
+  CHECK_NOTNULL(frame);
+  computeDescriptorsImpl(image, frame);
+
+  // Undistorters that leave the image untouched map the detected keypoints instead.
+  if(preprocessing_ && !preprocessing_->transformsImage()) {
+    preprocessing_->processKeypoints(frame);
+  }
+}
+
+void VisualPipeline::setFrameKeypoints(const std::vector<cv::KeyPoint>& keypoints,
+                                       VisualFrame* frame) {
+  CHECK_NOTNULL(frame);
+  // The keypoint uncertainty is set to a constant value.
+  const double kKeypointUncertaintyPixelSigma = 0.8;
+
+  Eigen::Matrix2Xd ikeypoints(2, keypoints.size());
+  Eigen::VectorXd scales(keypoints.size());
+  Eigen::VectorXd orientations(keypoints.size());
+  Eigen::VectorXd scores(keypoints.size());
+  Eigen::VectorXd uncertainties(keypoints.size());
+
+  // \TODO(ptf) Who knows a good formula for uncertainty based on octave?
+  //            See https://github.com/ethz-asl/aslam_cv2/issues/73
+  for(size_t i = 0; i < keypoints.size(); ++i) {
+    const cv::KeyPoint& kp = keypoints[i];
+    ikeypoints(0,i)  = kp.pt.x;
+    ikeypoints(1,i)  = kp.pt.y;
+    scales[i]        = kp.size;
+    orientations[i]  = kp.angle;
+    scores[i]        = kp.response;
+    uncertainties[i] = kKeypointUncertaintyPixelSigma;
+  }
+  frame->swapKeypointMeasurements(&ikeypoints);
+  frame->swapKeypointScores(&scores);
+  frame->swapKeypointOrientations(&orientations);
+  frame->swapKeypointScales(&scales);
+  frame->swapKeypointMeasurementUncertainties(&uncertainties);
+}
+
+void VisualPipeline::getFrameKeypoints(const VisualFrame& frame,
+                                       std::vector<cv::KeyPoint>* keypoints) {
+  CHECK_NOTNULL(keypoints);
+  keypoints->clear();
+  if (!frame.hasKeypointMeasurements()) {
+    return;
+  }
+  const Eigen::Matrix2Xd& measurements = frame.getKeypointMeasurements();
+  const size_t num_keypoints = measurements.cols();
+  keypoints->reserve(num_keypoints);
+  for (size_t i = 0u; i < num_keypoints; ++i) {
+    cv::KeyPoint keypoint;
+    keypoint.pt.x = static_cast<float>(measurements(0, i));
+    keypoint.pt.y = static_cast<float>(measurements(1, i));
+    if (frame.hasKeypointScales()) {
+      keypoint.size = static_cast<float>(frame.getKeypointScales()[i]);
+    }
+    if (frame.hasKeypointOrientations()) {
+      keypoint.angle = static_cast<float>(frame.getKeypointOrientations()[i]);
+    }
+    if (frame.hasKeypointScores()) {
+      keypoint.response = static_cast<float>(frame.getKeypointScores()[i]);
+    }
+    keypoints->push_back(keypoint);
+  }
 }
 
 }  // namespace aslam
@@ -0,0 +1,173 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+
+#include <aslam/cameras/camera-pinhole.h>
+#include <aslam/cameras/distortion-radtan.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/common/time.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/pipeline/buffer-pool.h>
+#include <aslam/pipeline/undistorter.h>
+#include <aslam/pipeline/visual-pipeline.h>
+
+// Count the heap allocations of this test binary while counting is enabled.
+namespace {
+std::atomic<bool> count_allocations(false);
+std::atomic<size_t> num_allocations(0u);
+}  // namespace
+
+void* operator new(size_t size) {
+  if (count_allocations) {
+    ++num_allocations;
+  }
+  void* memory = std::malloc(size == 0u ? 1u : size);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+namespace aslam {
+// Copies the image, writing into the output image if it has the right size.
+class CopyUndistorter : public Undistorter {
+public:
+  explicit CopyUndistorter(const Camera::Ptr& camera) : Undistorter(camera, camera) {}
+  virtual ~CopyUndistorter() {}
+  virtual void processImage(const cv::Mat& input_image, cv::Mat* output_image) const {
+    input_image.copyTo(*output_image);
+  }
+};
+
+// Stores the data pointer of the preprocessed image.
+class TestVisualPipeline : public VisualPipeline {
+public:
+  TestVisualPipeline(std::unique_ptr<Undistorter>& preprocessing, bool copy_images)
+      : VisualPipeline(preprocessing, copy_images), last_image_data_(nullptr) {}
+  virtual ~TestVisualPipeline() {}
+  const unsigned char* getLastImageData() const { return last_image_data_; }
+
+protected:
+  virtual void processFrameImpl(const cv::Mat& image, VisualFrame* /* frame */) const {
+    last_image_data_ = image.data;
+  }
+
+private:
+  mutable const unsigned char* last_image_data_;
+};
+}  // namespace aslam
+
+TEST(TestBufferPool, ImageBufferPoolRecyclesReleasedImages) {
+  aslam::ImageBufferPool pool(2u);
+  cv::Mat image_1 = pool.acquire(10, 20, CV_8UC1);
+  const unsigned char* data_1 = image_1.data;
+  cv::Mat image_2 = pool.acquire(10, 20, CV_8UC1);
+  EXPECT_NE(data_1, image_2.data);
+  EXPECT_EQ(2u, pool.getNumBuffers());
+
+  // All buffers are in use, the image is not pooled.
+  cv::Mat image_3 = pool.acquire(10, 20, CV_8UC1);
+  EXPECT_NE(data_1, image_3.data);
+  EXPECT_NE(image_2.data, image_3.data);
+  EXPECT_EQ(2u, pool.getNumBuffers());
+
+  // A buffer is only recycled once all images sharing it are released.
+  cv::Mat image_1_copy = image_1;
+  image_1.release();
+  EXPECT_NE(data_1, pool.acquire(10, 20, CV_8UC1).data);
+  image_1_copy.release();
+  cv::Mat image_4 = pool.acquire(10, 20, CV_8UC1);
+  EXPECT_EQ(data_1, image_4.data);
+
+  // A free buffer of a different size is resized.
+  image_4.release();
+  cv::Mat image_5 = pool.acquire(5, 5, CV_8UC3);
+  EXPECT_EQ(5, image_5.rows);
+  EXPECT_EQ(5, image_5.cols);
+  EXPECT_EQ(CV_8UC3, image_5.type());
+  EXPECT_EQ(2u, pool.getNumBuffers());
+}
+
+TEST(TestBufferPool, VisualFramePoolRecyclesAndResetsFrames) {
+  aslam::VisualFramePool pool(1u);
+  aslam::VisualFrame::Ptr frame = pool.acquire();
+  aslam::VisualFrame* frame_address = frame.get();
+  frame->setTimestampNanoseconds(100);
+  frame->setKeypointMeasurements(Eigen::Matrix2Xd::Random(2, 10));
+  frame->setRawImage(cv::Mat(10, 10, CV_8UC1));
+  frame->setChannelData<Eigen::VectorXd>("custom", Eigen::VectorXd::Ones(10));
+  frame->invalidate();
+
+  // The frame is in use.
+  EXPECT_NE(frame_address, pool.acquire().get());
+
+  frame.reset();
+  frame = pool.acquire();
+  EXPECT_EQ(frame_address, frame.get());
+  EXPECT_FALSE(aslam::time::isValidTime(frame->getTimestampNanoseconds()));
+  EXPECT_TRUE(frame->isValid());
+  EXPECT_EQ(0u, frame->getNumKeypointMeasurements());
+  EXPECT_TRUE(frame->getRawImage().empty());
+  EXPECT_FALSE(frame->hasChannel("custom"));
+}
+
+// The test pipeline doesn't detect any features, so this only covers the frames and images. The
+// feature pipelines still allocate their keypoints and descriptors.
+TEST(TestBufferPool, SteadyStateFrameAndImageHandlingDoesNotAllocate) {
+  aslam::Camera::Ptr camera =
+      aslam::PinholeCamera::createTestCamera<aslam::RadTanDistortion>();
+  std::unique_ptr<aslam::Undistorter> undistorter(new aslam::CopyUndistorter(camera));
+  aslam::TestVisualPipeline pipeline(undistorter, true);
+  const size_t kMaxNumFrames = 3u;
+  pipeline.enableBufferPools(kMaxNumFrames);
+
+  cv::Mat image(camera->imageHeight(), camera->imageWidth(), CV_8UC1, cv::Scalar(0));
+  // Consumers hold on to the last frames for a while.
+  const size_t kNumFramesInUse = kMaxNumFrames - 1u;
+  std::vector<aslam::VisualFrame::Ptr> frames_in_use(kNumFramesInUse);
+  const size_t kNumWarmUpFrames = 10u;
+  const size_t kNumFrames = 100u;
+  std::set<const unsigned char*> image_data;
+  for (size_t i = 0u; i < kNumWarmUpFrames + kNumFrames; ++i) {
+    count_allocations = i >= kNumWarmUpFrames;
+    aslam::VisualFrame::Ptr frame = pipeline.processImage(image, static_cast<int64_t>(i));
+    frames_in_use[i % kNumFramesInUse] = frame;
+    count_allocations = false;
+
+    ASSERT_EQ(static_cast<int64_t>(i), frame->getTimestampNanoseconds());
+    ASSERT_NE(image.data, frame->getRawImage().data);
+    image_data.insert(frame->getRawImage().data);
+    image_data.insert(pipeline.getLastImageData());
+  }
+  EXPECT_EQ(0u, num_allocations);
+  // The images are recycled, OpenCV allocates them without operator new.
+  EXPECT_LE(image_data.size(), 2u * kMaxNumFrames);
+}
+
+TEST(TestBufferPool, ExternalImageIsReleasedWithTheFrame) {
+  aslam::Camera::Ptr camera =
+      aslam::PinholeCamera::createTestCamera<aslam::RadTanDistortion>();
+  std::unique_ptr<aslam::Undistorter> undistorter(new aslam::CopyUndistorter(camera));
+  aslam::TestVisualPipeline pipeline(undistorter, false);
+  pipeline.enableBufferPools();
+
+  cv::Mat image(camera->imageHeight(), camera->imageWidth(), CV_8UC1, cv::Scalar(0));
+  bool is_released = false;
+  aslam::VisualFrame::Ptr frame =
+      pipeline.processImage(image, 0, [&is_released]() { is_released = true; });
+  EXPECT_EQ(image.data, frame->getRawImage().data);
+  EXPECT_FALSE(is_released);
+  frame.reset();
+  EXPECT_TRUE(is_released);
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
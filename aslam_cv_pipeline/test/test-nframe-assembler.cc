@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/cameras/random-camera-generator.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/nframe-assembler.h>
+
+namespace {
+// Collects the output of an assembler.
+class NFrameCollector {
+public:
+  aslam::NFrameAssembler::OutputCallback getCallback() {
+    return [this](int64_t timestamp_nanoseconds,
+                  const std::shared_ptr<aslam::VisualNFrame>& nframe) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      nframes_.emplace_back(timestamp_nanoseconds, nframe);
+    };
+  }
+
+  std::vector<std::pair<int64_t, std::shared_ptr<aslam::VisualNFrame>>> getNFrames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nframes_;
+  }
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<std::pair<int64_t, std::shared_ptr<aslam::VisualNFrame>>> nframes_;
+};
+
+aslam::VisualFrame::Ptr createFrame(int64_t timestamp_nanoseconds) {
+  aslam::VisualFrame::Ptr frame(new aslam::VisualFrame);
+  frame->setTimestampNanoseconds(timestamp_nanoseconds);
+  return frame;
+}
+}  // namespace
+
+TEST(NFrameAssembler, AssemblesNFramesInOrder) {
+  aslam::NCamera::Ptr camera_system = aslam::createTestNCamera(2u);
+  NFrameCollector collector;
+  aslam::NFrameAssembler assembler(camera_system, 100, collector.getCallback());
+
+  assembler.addFrame(0u, createFrame(0));
+  assembler.addFrame(1u, createFrame(101));
+  EXPECT_EQ(2u, assembler.getNumNFramesInProgress());
+
+  // The nframe at 101 is complete but waits for the one at 0.
+  assembler.addFrame(0u, createFrame(101));
+  EXPECT_EQ(2u, assembler.getNumNFramesInProgress());
+  EXPECT_TRUE(collector.getNFrames().empty());
+
+  // A second frame of a camera is dropped.
+  assembler.addFrame(0u, createFrame(30));
+  EXPECT_EQ(2u, assembler.getNumNFramesInProgress());
+  EXPECT_TRUE(collector.getNFrames().empty());
+
+  // The frame joins the closest nframe.
+  assembler.addFrame(1u, createFrame(20));
+  EXPECT_EQ(0u, assembler.getNumNFramesInProgress());
+  const std::vector<std::pair<int64_t, std::shared_ptr<aslam::VisualNFrame>>> nframes =
+      collector.getNFrames();
+  ASSERT_EQ(2u, nframes.size());
+  EXPECT_EQ(0, nframes[0].first);
+  EXPECT_EQ(0, nframes[0].second->getFrame(0).getTimestampNanoseconds());
+  EXPECT_EQ(20, nframes[0].second->getFrame(1).getTimestampNanoseconds());
+  EXPECT_EQ(101, nframes[1].first);
+  EXPECT_EQ(101, nframes[1].second->getFrame(1).getTimestampNanoseconds());
+}
+
+TEST(NFrameAssembler, DiscardsNFramesAfterAFrameDrop) {
+  aslam::NCamera::Ptr camera_system = aslam::createTestNCamera(2u);
+  NFrameCollector collector;
+  aslam::NFrameAssembler assembler(camera_system, 10, collector.getCallback());
+
+  // Camera 1 dropped the image at 0.
+  assembler.addFrame(0u, createFrame(0));
+  for (int64_t timestamp = 100; timestamp <= 300; timestamp += 100) {
+    assembler.addFrame(0u, createFrame(timestamp));
+    assembler.addFrame(1u, createFrame(timestamp + 1));
+  }
+  std::vector<std::pair<int64_t, std::shared_ptr<aslam::VisualNFrame>>> nframes =
+      collector.getNFrames();
+  ASSERT_EQ(3u, nframes.size());
+  EXPECT_EQ(100, nframes[0].first);
+  EXPECT_EQ(200, nframes[1].first);
+  EXPECT_EQ(300, nframes[2].first);
+  EXPECT_EQ(0u, assembler.getNumNFramesInProgress());
+
+  // Discarding removes the nframes in progress, a late frame starts a new nframe.
+  assembler.addFrame(0u, createFrame(400));
+  assembler.addFrame(0u, createFrame(500));
+  EXPECT_EQ(2u, assembler.getNumNFramesInProgress());
+  assembler.discardNFramesUpTo(400);
+  EXPECT_EQ(1u, assembler.getNumNFramesInProgress());
+  assembler.addFrame(1u, createFrame(500));
+  nframes = collector.getNFrames();
+  ASSERT_EQ(4u, nframes.size());
+  EXPECT_EQ(500, nframes[3].first);
+  assembler.addFrame(1u, createFrame(400));
+  EXPECT_EQ(1u, assembler.getNumNFramesInProgress());
+}
+
+TEST(NFrameAssembler, DropsStaleNFrames) {
+  aslam::NCamera::Ptr camera_system = aslam::createTestNCamera(2u);
+  NFrameCollector collector;
+  aslam::NFrameAssembler assembler(camera_system, 10, collector.getCallback());
+  assembler.setDropStaleNFrames(true);
+
+  // The complete nframe at 100 is released without waiting for the one at 0.
+  assembler.addFrame(0u, createFrame(0));
+  assembler.addFrame(0u, createFrame(100));
+  assembler.addFrame(1u, createFrame(101));
+  std::vector<std::pair<int64_t, std::shared_ptr<aslam::VisualNFrame>>> nframes =
+      collector.getNFrames();
+  ASSERT_EQ(1u, nframes.size());
+  EXPECT_EQ(100, nframes[0].first);
+  EXPECT_EQ(0u, assembler.getNumNFramesInProgress());
+  EXPECT_EQ(1u, assembler.getNumDroppedNFrames());
+
+  // Late frames of the dropped nframe do not make it to the output.
+  assembler.addFrame(1u, createFrame(1));
+  assembler.addFrame(0u, createFrame(2));
+  EXPECT_EQ(1u, collector.getNFrames().size());
+  EXPECT_EQ(0u, assembler.getNumNFramesInProgress());
+  EXPECT_EQ(2u, assembler.getNumDroppedNFrames());
+}
+
+TEST(NFrameAssembler, StressTest) {
+  const size_t kNumCameras = 8u;
+  const size_t kNumThreads = 8u;
+  const size_t kNumNFrames = 2000u;
+  const int64_t kFramePeriodNs = 1000;
+  const int64_t kToleranceNs = 100;
+
+  aslam::NCamera::Ptr camera_system = aslam::createTestNCamera(kNumCameras);
+  NFrameCollector collector;
+  aslam::NFrameAssembler assembler(camera_system, kToleranceNs, collector.getCallback());
+
+  // The frames of two consecutive nframes are shuffled and spread over all threads to get as
+  // much contention as possible. The threads meet after every two nframes, such that a lagging
+  // thread is not taken for a dropped image.
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int64_t> jitter(-kToleranceNs / 2, kToleranceNs / 2);
+  std::vector<std::pair<size_t, aslam::VisualFrame::Ptr>> frames;
+  for (size_t nframe_index = 0u; nframe_index < kNumNFrames; ++nframe_index) {
+    const int64_t timestamp = static_cast<int64_t>(nframe_index) * kFramePeriodNs;
+    for (size_t camera_index = 0u; camera_index < kNumCameras; ++camera_index) {
+      frames.emplace_back(camera_index, createFrame(timestamp + jitter(generator)));
+    }
+  }
+  const size_t kWindowSize = 2u * kNumCameras;
+  for (size_t begin = 0u; begin < frames.size(); begin += kWindowSize) {
+    std::shuffle(frames.begin() + begin, frames.begin() + begin + kWindowSize, generator);
+  }
+
+  std::mutex barrier_mutex;
+  std::condition_variable barrier_condition;
+  size_t num_waiting = 0u;
+  size_t generation = 0u;
+  auto wait_for_all_threads = [&]() {
+    std::unique_lock<std::mutex> lock(barrier_mutex);
+    const size_t current_generation = generation;
+    if (++num_waiting == kNumThreads) {
+      num_waiting = 0u;
+      ++generation;
+      barrier_condition.notify_all();
+    } else {
+      barrier_condition.wait(lock, [&]() { return generation != current_generation; });
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t thread_index = 0u; thread_index < kNumThreads; ++thread_index) {
+    threads.emplace_back([&, thread_index]() {
+      for (size_t begin = 0u; begin < frames.size(); begin += kWindowSize) {
+        for (size_t frame_index = begin + thread_index; frame_index < begin + kWindowSize;
+             frame_index += kNumThreads) {
+          assembler.addFrame(frames[frame_index].first, frames[frame_index].second);
+        }
+        wait_for_all_threads();
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // No camera dropped an image, so every nframe is complete and emitted once. An nframe can
+  // only be held back for the older nframes that were started, so the order is only guaranteed
+  // between the windows.
+  const std::vector<std::pair<int64_t, std::shared_ptr<aslam::VisualNFrame>>> nframes =
+      collector.getNFrames();
+  ASSERT_EQ(kNumNFrames, nframes.size());
+  EXPECT_EQ(0u, assembler.getNumNFramesInProgress());
+  std::vector<bool> is_emitted(kNumNFrames, false);
+  size_t last_window_index = 0u;
+  for (const std::pair<int64_t, std::shared_ptr<aslam::VisualNFrame>>& nframe : nframes) {
+    const size_t nframe_index =
+        static_cast<size_t>((nframe.first + kFramePeriodNs / 2) / kFramePeriodNs);
+    ASSERT_LT(nframe_index, kNumNFrames);
+    EXPECT_FALSE(is_emitted[nframe_index]);
+    is_emitted[nframe_index] = true;
+    EXPECT_GE(nframe_index / 2u, last_window_index);
+    last_window_index = nframe_index / 2u;
+
+    const int64_t timestamp = static_cast<int64_t>(nframe_index) * kFramePeriodNs;
+    ASSERT_TRUE(nframe.second);
+    EXPECT_TRUE(nframe.second->areAllFramesSet());
+    for (size_t camera_index = 0u; camera_index < kNumCameras; ++camera_index) {
+      EXPECT_LE(std::abs(nframe.second->getFrame(camera_index).getTimestampNanoseconds() -
+                         timestamp), kToleranceNs / 2);
+    }
+  }
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
@@ -1,4 +1,12 @@
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
+#include <fstream>  // NOLINT
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
 
 #include <Eigen/Core>
 #include <eigen-checks/gtest.h>
@@ -15,8 +23,12 @@
 #include <aslam/cameras/distortion-radtan.h>
 #include <aslam/common/entrypoint.h>
 #include <aslam/common/memory.h>
-#include <aslam/pipeline/test/convert-maps-legacy.h>
+#include <aslam/frames/visual-frame.h>
+#include <aslam/pipeline/convert-maps-legacy.h>
+#include <aslam/pipeline/undistort-map-cache.h>
+#include <aslam/pipeline/undistorter-keypoint.h>
 #include <aslam/pipeline/undistorter-mapped.h>
+#include <aslam/pipeline/undistorter-tiled.h>
 
 ///////////////////////////////////////////////
 // Types to test
@@ -112,6 +124,215 @@ TYPED_TEST(TestUndistorters, TestMappedUndistorter) {
   }
 }
 
+TYPED_TEST(TestUndistorters, TestMappedUndistorterMapTypes) {
+  std::unique_ptr<aslam::MappedUndistorter> undistorter_float =
+      aslam::createMappedUndistorter(*(this->camera_), 0.0, 1.0,
+                                     aslam::InterpolationMethod::Linear,
+                                     aslam::UndistortMapType::kFloat);
+  std::unique_ptr<aslam::MappedUndistorter> undistorter_fixed_point =
+      aslam::createMappedUndistorter(*(this->camera_), 0.0, 1.0,
+                                     aslam::InterpolationMethod::Linear,
+                                     aslam::UndistortMapType::kFixedPoint);
+  std::unique_ptr<aslam::MappedUndistorter> undistorter_subsampled =
+      aslam::createMappedUndistorter(*(this->camera_), 0.0, 1.0,
+                                     aslam::InterpolationMethod::Linear,
+                                     aslam::UndistortMapType::kSubsampled);
+  ASSERT_EQ(aslam::UndistortMapType::kFloat, undistorter_float->getUndistortMapType());
+  ASSERT_EQ(aslam::UndistortMapType::kFixedPoint,
+            undistorter_fixed_point->getUndistortMapType());
+  ASSERT_EQ(aslam::UndistortMapType::kSubsampled,
+            undistorter_subsampled->getUndistortMapType());
+  EXPECT_LT(undistorter_fixed_point->getMapMemoryBytes(),
+            undistorter_float->getMapMemoryBytes());
+  EXPECT_LT(undistorter_subsampled->getMapMemoryBytes() * 10,
+            undistorter_fixed_point->getMapMemoryBytes());
+
+  // Compare the maps where they are inside of the input image.
+  cv::Mat map_u_float, map_v_float, map_u, map_v;
+  undistorter_float->getDenseUndistortMaps(&map_u_float, &map_v_float);
+  const int width = map_u_float.cols;
+  const int height = map_u_float.rows;
+  const double input_width = this->camera_->imageWidth();
+  const double input_height = this->camera_->imageHeight();
+  auto compare_maps = [&](double tolerance) {
+    ASSERT_EQ(width, map_u.cols);
+    ASSERT_EQ(height, map_u.rows);
+    for (int v = 0; v < height; ++v) {
+      for (int u = 0; u < width; ++u) {
+        const float u_map = map_u_float.at<float>(v, u);
+        const float v_map = map_v_float.at<float>(v, u);
+        if (u_map < 1.0 || u_map > input_width - 2.0 ||
+            v_map < 1.0 || v_map > input_height - 2.0) {
+          continue;
+        }
+        EXPECT_NEAR(u_map, map_u.at<float>(v, u), tolerance);
+        EXPECT_NEAR(v_map, map_v.at<float>(v, u), tolerance);
+      }
+    }
+  };
+  undistorter_fixed_point->getDenseUndistortMaps(&map_u, &map_v);
+  compare_maps(1.0 / cv::INTER_TAB_SIZE);
+  undistorter_subsampled->getDenseUndistortMaps(&map_u, &map_v);
+  compare_maps(0.1);
+
+  // Remap an image holding the u-coordinate, the outputs are the u-maps.
+  cv::Mat input_image(input_height, input_width, CV_32FC1);
+  for (int v = 0; v < input_image.rows; ++v) {
+    for (int u = 0; u < input_image.cols; ++u) {
+      input_image.at<float>(v, u) = u;
+    }
+  }
+  cv::Mat output_image, output_image_float;
+  undistorter_subsampled->processImage(input_image, &output_image);
+  undistorter_float->processImage(input_image, &output_image_float);
+  ASSERT_EQ(width, output_image.cols);
+  ASSERT_EQ(height, output_image.rows);
+  for (int v = 0; v < height; ++v) {
+    for (int u = 0; u < width; ++u) {
+      const float u_map = map_u_float.at<float>(v, u);
+      const float v_map = map_v_float.at<float>(v, u);
+      if (u_map < 1.0 || u_map > input_width - 2.0 ||
+          v_map < 1.0 || v_map > input_height - 2.0) {
+        continue;
+      }
+      EXPECT_NEAR(output_image_float.at<float>(v, u), output_image.at<float>(v, u), 0.1);
+    }
+  }
+}
+
+TYPED_TEST(TestUndistorters, TestKeypointUndistorter) {
+  std::unique_ptr<aslam::MappedUndistorter> mapped_undistorter =
+      aslam::createMappedUndistorter(*(this->camera_), 0.0, 1.0,
+                                     aslam::InterpolationMethod::Linear);
+  std::unique_ptr<aslam::KeypointUndistorter> keypoint_undistorter =
+      aslam::createKeypointUndistorter(*(this->camera_), 0.0, 1.0);
+  ASSERT_FALSE(keypoint_undistorter->transformsImage());
+  const aslam::Camera& output_camera = keypoint_undistorter->getOutputCamera();
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(mapped_undistorter->getOutputCamera().getParameters(),
+                                output_camera.getParameters(), 1e-12));
+  EXPECT_EQ(mapped_undistorter->getOutputCamera().imageWidth(), output_camera.imageWidth());
+
+  // The image is passed through.
+  cv::Mat input_image(this->camera_->imageHeight(), this->camera_->imageWidth(), CV_8UC1,
+                      cv::Scalar(1));
+  cv::Mat output_image;
+  keypoint_undistorter->processImage(input_image, &output_image);
+  EXPECT_EQ(input_image.data, output_image.data);
+
+  // Distort keypoints of the output image into the input image and map them back.
+  constexpr int kNumKeypoints = 1000;
+  constexpr double kOffsetPixels = 2.0;
+  Eigen::Matrix2Xd keypoints_expected(2, kNumKeypoints);
+  Eigen::Matrix2Xd keypoints(2, kNumKeypoints);
+  Eigen::VectorXd orientations(kNumKeypoints);
+  Eigen::VectorXd scales = Eigen::VectorXd::Constant(kNumKeypoints, 10.0);
+  auto to_input_image = [&](const Eigen::Vector2d& keypoint_output) {
+    Eigen::Vector3d point_3d;
+    CHECK(output_camera.backProject3(keypoint_output, &point_3d));
+    Eigen::Vector2d keypoint_input;
+    this->camera_->project3(point_3d, &keypoint_input);
+    return keypoint_input;
+  };
+  for (int i = 0; i < kNumKeypoints; ++i) {
+    do {
+      keypoints_expected.col(i) = output_camera.createRandomKeypoint();
+    } while (!output_camera.isKeypointVisibleWithMargin(
+        keypoints_expected.col(i), static_cast<Eigen::Vector2d::Scalar>(10.0)));
+    keypoints.col(i) = to_input_image(keypoints_expected.col(i));
+    orientations[i] = 360.0 * i / kNumKeypoints;
+  }
+  // Negative orientations are not computed and stay unchanged.
+  orientations[0] = -1.0;
+
+  Eigen::Matrix2Xd keypoints_mapped = keypoints;
+  Eigen::VectorXd orientations_mapped = orientations;
+  Eigen::VectorXd scales_mapped = scales;
+  std::vector<unsigned char> success;
+  keypoint_undistorter->undistortKeypoints(
+      &keypoints_mapped, &orientations_mapped, &scales_mapped, &success);
+  ASSERT_EQ(static_cast<size_t>(kNumKeypoints), success.size());
+  EXPECT_EQ(-1.0, orientations_mapped[0]);
+  for (int i = 0; i < kNumKeypoints; ++i) {
+    ASSERT_TRUE(success[i]);
+    EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoints_expected.col(i), keypoints_mapped.col(i), 1e-3));
+    EXPECT_GT(scales_mapped[i], 0.0);
+    if (i == 0) {
+      continue;
+    }
+    // The orientation follows a point further along the orientation in the input image.
+    const double angle = orientations[i] * M_PI / 180.0;
+    Eigen::Matrix2Xd keypoint_along =
+        keypoints.col(i) + kOffsetPixels * Eigen::Vector2d(std::cos(angle), std::sin(angle));
+    std::vector<unsigned char> success_along;
+    keypoint_undistorter->undistortKeypoints(&keypoint_along, nullptr, nullptr, &success_along);
+    if (!success_along[0]) {
+      continue;
+    }
+    const Eigen::Vector2d direction = keypoint_along.col(0) - keypoints_mapped.col(i);
+    const double expected_orientation = std::atan2(direction[1], direction[0]) * 180.0 / M_PI;
+    double orientation_error = std::abs(expected_orientation - orientations_mapped[i]);
+    orientation_error = std::min(orientation_error, 360.0 - orientation_error);
+    EXPECT_LT(orientation_error, 1.0);
+  }
+
+  // Keypoints outside of the output image are removed from all channels of the frame.
+  aslam::VisualFrame::Ptr frame =
+      aslam::VisualFrame::createEmptyTestVisualFrame(keypoint_undistorter->getOutputCameraShared(),
+                                                     0);
+  Eigen::Matrix2Xd frame_keypoints(2, kNumKeypoints + 1);
+  frame_keypoints << keypoints, Eigen::Vector2d(-1000.0, -1000.0);
+  Eigen::VectorXd uncertainties = Eigen::VectorXd::Constant(kNumKeypoints + 1, 0.8);
+  aslam::VisualFrame::DescriptorsT descriptors =
+      aslam::VisualFrame::DescriptorsT::Zero(48, kNumKeypoints + 1);
+  frame->swapKeypointMeasurements(&frame_keypoints);
+  frame->swapKeypointMeasurementUncertainties(&uncertainties);
+  frame->swapDescriptors(&descriptors);
+  keypoint_undistorter->processKeypoints(frame.get());
+  ASSERT_EQ(static_cast<size_t>(kNumKeypoints), frame->getNumKeypointMeasurements());
+  EXPECT_EQ(kNumKeypoints, frame->getKeypointMeasurementUncertainties().size());
+  EXPECT_EQ(kNumKeypoints, frame->getDescriptors().cols());
+  EXPECT_TRUE(EIGEN_MATRIX_NEAR(keypoints_expected, frame->getKeypointMeasurements(), 1e-3));
+}
+
+TYPED_TEST(TestUndistorters, TestTiledUndistorter) {
+  constexpr size_t kNumThreads = 4u;
+  // Small tiles to get many of them.
+  constexpr size_t kTileBytes = 4096u;
+  cv::Mat input_image(this->camera_->imageHeight(), this->camera_->imageWidth(), CV_8UC1);
+  cv::randu(input_image, 0, 255);
+
+  const aslam::UndistortMapType map_types[] = {
+      aslam::UndistortMapType::kFixedPoint, aslam::UndistortMapType::kSubsampled};
+  for (const aslam::UndistortMapType map_type : map_types) {
+    std::unique_ptr<aslam::MappedUndistorter> mapped_undistorter =
+        aslam::createMappedUndistorter(*(this->camera_), 0.0, 1.0,
+                                       aslam::InterpolationMethod::Linear, map_type);
+    cv::Mat expected_image;
+    mapped_undistorter->processImage(input_image, &expected_image);
+
+    aslam::TiledUndistorter tiled_undistorter(mapped_undistorter, kNumThreads, kTileBytes);
+    const int tile_rows = tiled_undistorter.getTileRows(input_image.type());
+    ASSERT_LT(tile_rows, expected_image.rows);
+
+    // The tiles are handed out in order and cover all rows. The output is identical to the one
+    // of the mapped undistorter.
+    cv::Mat output_image;
+    int next_row = 0;
+    tiled_undistorter.processImageStreaming(
+        input_image, &output_image, [&](int row_begin, int row_end) {
+          EXPECT_EQ(next_row, row_begin);
+          EXPECT_LE(row_end - row_begin, tile_rows);
+          EXPECT_EQ(0, cv::norm(expected_image.rowRange(row_begin, row_end),
+                                output_image.rowRange(row_begin, row_end), cv::NORM_INF));
+          next_row = row_end;
+        });
+    EXPECT_EQ(expected_image.rows, next_row);
+
+    tiled_undistorter.processImage(input_image, &output_image);
+    EXPECT_EQ(0, cv::norm(expected_image, output_image, cv::NORM_INF));
+  }
+}
+
 ////////////////////////////////////
 // Camera model specific test cases
 ////////////////////////////////////
@@ -165,4 +386,109 @@ TEST(TestUndistortersNoPinhole, TestMappedUndistorterUpcToPinhole) {
   }
 }
 
+TEST(TestUndistorters, TestMappedUndistorterMapCache) {
+  char directory_template[] = "/tmp/undistort-map-cache-XXXXXX";
+  ASSERT_TRUE(mkdtemp(directory_template) != nullptr);
+  aslam::UndistortMapCache cache(directory_template);
+
+  aslam::UnifiedProjectionCamera::Ptr camera = aslam::UnifiedProjectionCamera::createTestCamera<
+      aslam::RadTanDistortion>();
+  auto expect_equal_maps = [](const aslam::MappedUndistorter& expected,
+                              const aslam::MappedUndistorter& actual) {
+    ASSERT_EQ(expected.getUndistortMapU().type(), actual.getUndistortMapU().type());
+    ASSERT_EQ(expected.getUndistortMapV().type(), actual.getUndistortMapV().type());
+    EXPECT_EQ(0, cv::norm(expected.getUndistortMapU(), actual.getUndistortMapU(),
+                          cv::NORM_INF));
+    EXPECT_EQ(0, cv::norm(expected.getUndistortMapV(), actual.getUndistortMapV(),
+                          cv::NORM_INF));
+    EXPECT_EQ(expected.getMapSubsampling(), actual.getMapSubsampling());
+  };
+
+  const aslam::UndistortMapType map_types[] = {
+      aslam::UndistortMapType::kFloat, aslam::UndistortMapType::kFixedPoint,
+      aslam::UndistortMapType::kSubsampled};
+  for (const aslam::UndistortMapType map_type : map_types) {
+    std::unique_ptr<aslam::MappedUndistorter> expected = aslam::createMappedUndistorter(
+        *camera, 0.5, 1.0, aslam::InterpolationMethod::Linear, map_type);
+
+    // The first call builds and stores the maps, the second one loads them.
+    const size_t num_misses = cache.getNumMisses();
+    const size_t num_hits = cache.getNumHits();
+    std::unique_ptr<aslam::MappedUndistorter> built = aslam::createMappedUndistorter(
+        *camera, 0.5, 1.0, aslam::InterpolationMethod::Linear, map_type, &cache);
+    EXPECT_EQ(num_misses + 1u, cache.getNumMisses());
+    std::unique_ptr<aslam::MappedUndistorter> loaded = aslam::createMappedUndistorter(
+        *camera, 0.5, 1.0, aslam::InterpolationMethod::Linear, map_type, &cache);
+    EXPECT_EQ(num_hits + 1u, cache.getNumHits());
+    expect_equal_maps(*expected, *built);
+    expect_equal_maps(*expected, *loaded);
+  }
+
+  // The undistortion to a pinhole camera and a different calibration have their own entries.
+  std::unique_ptr<aslam::MappedUndistorter> expected_pinhole =
+      aslam::createMappedUndistorterToPinhole(*camera, 0.5, 1.0,
+                                              aslam::InterpolationMethod::Linear);
+  size_t num_misses = cache.getNumMisses();
+  aslam::createMappedUndistorterToPinhole(*camera, 0.5, 1.0, aslam::InterpolationMethod::Linear,
+                                          aslam::UndistortMapType::kFixedPoint, &cache);
+  EXPECT_EQ(num_misses + 1u, cache.getNumMisses());
+  std::unique_ptr<aslam::MappedUndistorter> loaded_pinhole =
+      aslam::createMappedUndistorterToPinhole(
+          *camera, 0.5, 1.0, aslam::InterpolationMethod::Linear,
+          aslam::UndistortMapType::kFixedPoint, &cache);
+  expect_equal_maps(*expected_pinhole, *loaded_pinhole);
+
+  aslam::Camera::Ptr recalibrated_camera(camera->clone());
+  recalibrated_camera->getParametersMutable()[1] += 1.0;
+  num_misses = cache.getNumMisses();
+  aslam::createMappedUndistorter(*recalibrated_camera, 0.5, 1.0,
+                                 aslam::InterpolationMethod::Linear,
+                                 aslam::UndistortMapType::kFixedPoint, &cache);
+  EXPECT_EQ(num_misses + 1u, cache.getNumMisses());
+
+  // A corrupted entry is removed and rebuilt.
+  const aslam::UndistortMapCache::Key key = aslam::UndistortMapCache::computeKey(
+      *camera, 0.5, 1.0, aslam::InterpolationMethod::Linear,
+      aslam::UndistortMapType::kFixedPoint, false);
+  {
+    std::ofstream file(cache.getFilePath(key), std::ios::binary | std::ios::trunc);
+    file << "corrupted";
+  }
+  num_misses = cache.getNumMisses();
+  std::unique_ptr<aslam::MappedUndistorter> rebuilt = aslam::createMappedUndistorter(
+      *camera, 0.5, 1.0, aslam::InterpolationMethod::Linear,
+      aslam::UndistortMapType::kFixedPoint, &cache);
+  EXPECT_EQ(num_misses + 1u, cache.getNumMisses());
+  std::unique_ptr<aslam::MappedUndistorter> expected = aslam::createMappedUndistorter(
+      *camera, 0.5, 1.0, aslam::InterpolationMethod::Linear);
+  expect_equal_maps(*expected, *rebuilt);
+
+  // Threads storing the same entry concurrently don't share their temporary files.
+  std::vector<std::thread> threads;
+  std::atomic<int> num_stored(0);
+  for (int thread_idx = 0; thread_idx < 4; ++thread_idx) {
+    threads.emplace_back([&]() {
+      for (int repetition = 0; repetition < 10; ++repetition) {
+        num_stored += cache.store(key, rebuilt->getUndistortMapU(), rebuilt->getUndistortMapV(),
+                                  rebuilt->getMapSubsampling()) ? 1 : 0;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(40, num_stored.load());
+  std::unique_ptr<aslam::MappedUndistorter> loaded = aslam::createMappedUndistorter(
+      *camera, 0.5, 1.0, aslam::InterpolationMethod::Linear,
+      aslam::UndistortMapType::kFixedPoint, &cache);
+  expect_equal_maps(*rebuilt, *loaded);
+
+  cache.clear();
+  cv::Mat map_u, map_v;
+  int map_subsampling;
+  std::shared_ptr<const void> map_storage;
+  EXPECT_FALSE(cache.load(key, &map_u, &map_v, &map_subsampling, &map_storage));
+  rmdir(directory_template);
+}
+
 ASLAM_UNITTEST_ENTRYPOINT
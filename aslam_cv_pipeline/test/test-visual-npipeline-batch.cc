@@ -0,0 +1,112 @@
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <opencv2/core/core.hpp>
+
+#include <aslam/cameras/ncamera.h>
+#include <aslam/cameras/random-camera-generator.h>
+#include <aslam/common/entrypoint.h>
+#include <aslam/frames/visual-nframe.h>
+#include <aslam/pipeline/visual-npipeline-batch.h>
+#include <aslam/pipeline/visual-pipeline-null.h>
+
+using namespace aslam;
+
+class BatchVisualNPipelineTest : public ::testing::Test {
+ protected:
+  void constructPipeline(size_t num_cameras, size_t num_threads,
+                         size_t checkpoint_interval_nframes) {
+    camera_system_ = createTestNCamera(num_cameras);
+    std::vector<VisualPipeline::Ptr> pipelines;
+    for (size_t camera_index = 0u; camera_index < num_cameras; ++camera_index) {
+      pipelines.emplace_back(
+          new NullVisualPipeline(camera_system_->getCameraShared(camera_index), false));
+    }
+    BatchVisualNPipeline::Options options;
+    options.num_threads = num_threads;
+    options.max_nframes_in_flight = 8u;
+    options.checkpoint_interval_nframes = checkpoint_interval_nframes;
+    pipeline_.reset(new BatchVisualNPipeline(options, pipelines, camera_system_));
+  }
+
+  /// Reads a sequence of num_nframes nframes with the nframe index as timestamp.
+  BatchVisualNPipeline::InputCallback getInput(size_t num_nframes) {
+    return [this, num_nframes](size_t nframe_index,
+                               BatchVisualNPipeline::SynchronizedImages* images) {
+      if (nframe_index >= num_nframes) {
+        return false;
+      }
+      images->timestamp_nanoseconds = static_cast<int64_t>(nframe_index);
+      for (size_t camera_index = 0u; camera_index < camera_system_->getNumCameras();
+           ++camera_index) {
+        const Camera& camera = camera_system_->getCamera(camera_index);
+        images->images.emplace_back(camera.imageHeight(), camera.imageWidth(), CV_8UC1,
+                                    cv::Scalar(camera_index));
+      }
+      return true;
+    };
+  }
+
+  NCamera::Ptr camera_system_;
+  BatchVisualNPipeline::Ptr pipeline_;
+};
+
+TEST_F(BatchVisualNPipelineTest, OutputsNFramesInOrder) {
+  const size_t kNumNFrames = 200u;
+  this->constructPipeline(3u, 4u, 50u);
+
+  std::vector<int64_t> timestamps;
+  std::vector<size_t> checkpoints;
+  const size_t end_index = pipeline_->process(
+      0u, getInput(kNumNFrames),
+      [&timestamps](size_t nframe_index, int64_t timestamp_nanoseconds,
+                    const std::shared_ptr<VisualNFrame>& nframe) {
+        ASSERT_TRUE(nframe.get() != NULL);
+        EXPECT_EQ(static_cast<int64_t>(nframe_index), timestamp_nanoseconds);
+        EXPECT_TRUE(nframe->areAllFramesSet());
+        for (size_t frame_index = 0u; frame_index < nframe->getNumFrames(); ++frame_index) {
+          EXPECT_EQ(timestamp_nanoseconds,
+                    nframe->getFrame(frame_index).getTimestampNanoseconds());
+        }
+        timestamps.push_back(timestamp_nanoseconds);
+      },
+      [&checkpoints](size_t next_nframe_index) { checkpoints.push_back(next_nframe_index); });
+
+  EXPECT_EQ(kNumNFrames, end_index);
+  ASSERT_EQ(kNumNFrames, timestamps.size());
+  for (size_t nframe_index = 0u; nframe_index < kNumNFrames; ++nframe_index) {
+    EXPECT_EQ(static_cast<int64_t>(nframe_index), timestamps[nframe_index]);
+  }
+  EXPECT_EQ((std::vector<size_t>{50u, 100u, 150u, 200u}), checkpoints);
+}
+
+TEST_F(BatchVisualNPipelineTest, ResumesFromCheckpoint) {
+  const size_t kNumNFrames = 25u;
+  this->constructPipeline(2u, 2u, 10u);
+
+  // Resume after the checkpoint at 10, the last checkpoint is at the end of the sequence.
+  std::vector<size_t> nframe_indices;
+  std::vector<size_t> checkpoints;
+  const size_t end_index = pipeline_->process(
+      10u, getInput(kNumNFrames),
+      [&nframe_indices](size_t nframe_index, int64_t /* timestamp_nanoseconds */,
+                        const std::shared_ptr<VisualNFrame>& /* nframe */) {
+        nframe_indices.push_back(nframe_index);
+      },
+      [&checkpoints](size_t next_nframe_index) { checkpoints.push_back(next_nframe_index); });
+
+  EXPECT_EQ(kNumNFrames, end_index);
+  ASSERT_EQ(kNumNFrames - 10u, nframe_indices.size());
+  EXPECT_EQ(10u, nframe_indices.front());
+  EXPECT_EQ(kNumNFrames - 1u, nframe_indices.back());
+  EXPECT_EQ((std::vector<size_t>{20u, 25u}), checkpoints);
+
+  // An empty sequence does not output anything.
+  EXPECT_EQ(kNumNFrames, pipeline_->process(
+      kNumNFrames, getInput(kNumNFrames),
+      [](size_t, int64_t, const std::shared_ptr<VisualNFrame>&) { FAIL(); },
+      BatchVisualNPipeline::CheckpointCallback()));
+}
+
+ASLAM_UNITTEST_ENTRYPOINT
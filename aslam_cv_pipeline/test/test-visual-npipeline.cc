@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 #include <opencv2/core/core.hpp>
 
@@ -13,6 +19,49 @@
 
 using namespace aslam;
 
+// Shifts the timestamps of the frames like a timestamp corrector.
+class TimestampShiftingVisualPipeline : public NullVisualPipeline {
+ public:
+  TimestampShiftingVisualPipeline(const Camera::ConstPtr& camera, int64_t shift_ns)
+      : NullVisualPipeline(camera, false), shift_ns_(shift_ns) {}
+  virtual ~TimestampShiftingVisualPipeline() {}
+
+ protected:
+  virtual void processFrameImpl(const cv::Mat& /* image */, VisualFrame* frame) const {
+    frame->setTimestampNanoseconds(frame->getTimestampNanoseconds() + shift_ns_);
+  }
+
+ private:
+  const int64_t shift_ns_;
+};
+
+// Takes a fixed time per image and logs the camera of every processed image.
+class SlowVisualPipeline : public NullVisualPipeline {
+ public:
+  struct ProcessingLog {
+    std::mutex mutex;
+    std::vector<size_t> camera_indices;
+  };
+
+  SlowVisualPipeline(const Camera::ConstPtr& camera, size_t camera_index,
+                     std::chrono::microseconds processing_time, ProcessingLog* log)
+      : NullVisualPipeline(camera, false), camera_index_(camera_index),
+        processing_time_(processing_time), log_(CHECK_NOTNULL(log)) {}
+  virtual ~SlowVisualPipeline() {}
+
+ protected:
+  virtual void processFrameImpl(const cv::Mat& /* image */, VisualFrame* /* frame */) const {
+    std::this_thread::sleep_for(processing_time_);
+    std::lock_guard<std::mutex> lock(log_->mutex);
+    log_->camera_indices.push_back(camera_index_);
+  }
+
+ private:
+  const size_t camera_index_;
+  const std::chrono::microseconds processing_time_;
+  ProcessingLog* log_;
+};
+
 class VisualNPipelineTest : public ::testing::Test {
  protected:
   typedef aslam::RadTanDistortion DistortionType;
@@ -20,7 +69,8 @@ class VisualNPipelineTest : public ::testing::Test {
 
   void constructNCamera(unsigned num_cameras,
                         unsigned num_threads,
-                        int64_t timestamp_tolerance_ns) {
+                        int64_t timestamp_tolerance_ns,
+                        bool staged = false) {
     NCameraId id;
     generateId(&id);
     Aligned<std::vector, kindr::minimal::QuatTransformation> T_C_B;
@@ -35,10 +85,21 @@ class VisualNPipelineTest : public ::testing::Test {
       pipelines.push_back(std::shared_ptr<VisualPipeline>(new NullVisualPipeline(camera, false)));
     }
     camera_rig_.reset(new NCamera(id, T_C_B, cameras, "Test Camera System"));
-
-    pipeline_.reset(new VisualNPipeline(num_threads, pipelines,
-                                        camera_rig_, camera_rig_,
-                                        timestamp_tolerance_ns));
+    pipelines_ = pipelines;
+
+    if (staged) {
+      // Use num_threads threads per stage and small queues to exercise the back pressure.
+      VisualNPipeline::StagedExecutionOptions options;
+      options.num_threads.fill(num_threads);
+      options.max_queue_size = 1u;
+      pipeline_.reset(new VisualNPipeline(options, pipelines,
+                                          camera_rig_, camera_rig_,
+                                          timestamp_tolerance_ns));
+    } else {
+      pipeline_.reset(new VisualNPipeline(num_threads, pipelines,
+                                          camera_rig_, camera_rig_,
+                                          timestamp_tolerance_ns));
+    }
 
   }
 
@@ -50,7 +111,47 @@ class VisualNPipelineTest : public ::testing::Test {
                    CV_8UC1, uint8_t(camera_index));
   }
 
+  /// Process images with pipelines that correct the frame timestamps in processFrameImpl, which
+  /// runs in the detection stage of a staged pipeline.
+  void processImagesWithCorrectedTimestamps(bool staged) {
+    this->constructNCamera(2, 4, 100);
+    std::vector<VisualPipeline::Ptr> pipelines;
+    for (size_t camera_index = 0u; camera_index < 2u; ++camera_index) {
+      pipelines.push_back(std::make_shared<TimestampShiftingVisualPipeline>(
+          camera_rig_->getCameraShared(camera_index), 500));
+    }
+    if (staged) {
+      VisualNPipeline::StagedExecutionOptions options;
+      options.num_threads.fill(2u);
+      options.max_queue_size = 1u;
+      pipeline_.reset(new VisualNPipeline(options, pipelines, camera_rig_, camera_rig_, 100));
+    } else {
+      pipeline_.reset(new VisualNPipeline(4, pipelines, camera_rig_, camera_rig_, 100));
+    }
+    ASSERT_EQ(staged, pipeline_->isStaged());
+
+    // The deadlines are found although the frames have other timestamps than the images.
+    const int64_t kLargeLatencyBudgetNs = 10 * 1000 * 1000 * 1000ll;
+    const size_t kNumNFrames = 10u;
+    for (size_t i = 0u; i < kNumNFrames; ++i) {
+      const int64_t timestamp = static_cast<int64_t>(i) * 1000;
+      EXPECT_TRUE(pipeline_->processImageWithinLatencyBudget(
+          0, getImageFromCamera(0), timestamp, kLargeLatencyBudgetNs));
+      EXPECT_TRUE(pipeline_->processImageWithinLatencyBudget(
+          1, getImageFromCamera(1), timestamp + 1, kLargeLatencyBudgetNs));
+      pipeline_->waitForAllWorkToComplete();
+    }
+    EXPECT_EQ(kNumNFrames, pipeline_->getNumFramesComplete());
+    const VisualNPipeline::LatencyStatistics statistics = pipeline_->getLatencyStatistics();
+    EXPECT_EQ(kNumNFrames, statistics.num_output_nframes);
+    EXPECT_EQ(0u, statistics.num_late_nframes);
+    std::shared_ptr<VisualNFrame> nframe = pipeline_->getNext();
+    ASSERT_TRUE(nframe.get() != NULL);
+    EXPECT_EQ(500, nframe->getFrame(0).getTimestampNanoseconds());
+  }
+
   NCamera::Ptr camera_rig_;
+  std::vector<VisualPipeline::Ptr> pipelines_;
   VisualNPipeline::Ptr pipeline_;
 };
 
@@ -206,4 +307,208 @@ TEST_F(VisualNPipelineTest, testTimestampDiff) {
   ASSERT_TRUE(nframes.get() == NULL);
 }
 
+TEST_F(VisualNPipelineTest, latencyBudget) {
+  this->constructNCamera(2, 4, 100);
+
+  const int64_t kLargeLatencyBudgetNs = 10 * 1000 * 1000 * 1000ll;
+  const size_t kNumNFrames = 10u;
+  for (size_t i = 0u; i < kNumNFrames; ++i) {
+    const int64_t timestamp = static_cast<int64_t>(i) * 1000;
+    EXPECT_TRUE(pipeline_->processImageWithinLatencyBudget(
+        0, getImageFromCamera(0), timestamp, kLargeLatencyBudgetNs));
+    EXPECT_TRUE(pipeline_->processImageWithinLatencyBudget(
+        1, getImageFromCamera(1), timestamp + 1, kLargeLatencyBudgetNs));
+    pipeline_->waitForAllWorkToComplete();
+  }
+  EXPECT_EQ(kNumNFrames, pipeline_->getNumFramesComplete());
+
+  VisualNPipeline::LatencyStatistics statistics = pipeline_->getLatencyStatistics();
+  EXPECT_EQ(kNumNFrames, statistics.num_output_nframes);
+  EXPECT_EQ(0u, statistics.num_skipped_images);
+  EXPECT_EQ(0u, statistics.num_late_nframes);
+  EXPECT_EQ(0u, statistics.num_dropped_nframes);
+  EXPECT_GT(statistics.mean_latency_seconds, 0.0);
+  EXPECT_GE(statistics.max_latency_seconds, statistics.mean_latency_seconds);
+  ASSERT_EQ(VisualNPipeline::kNumLatencyHistogramBins, statistics.latency_histogram.size());
+  size_t num_nframes_in_histogram = 0u;
+  for (size_t count : statistics.latency_histogram) {
+    num_nframes_in_histogram += count;
+  }
+  EXPECT_EQ(kNumNFrames, num_nframes_in_histogram);
+
+  // The measured processing time does not fit into an empty budget.
+  EXPECT_FALSE(pipeline_->processImageWithinLatencyBudget(
+      0, getImageFromCamera(0), kNumNFrames * 1000, 0));
+  pipeline_->waitForAllWorkToComplete();
+  statistics = pipeline_->getLatencyStatistics();
+  EXPECT_EQ(1u, statistics.num_skipped_images);
+  EXPECT_EQ(0u, pipeline_->getNumFramesProcessing());
+}
+
+TEST_F(VisualNPipelineTest, latencyBudgetWithCorrectedTimestamps) {
+  processImagesWithCorrectedTimestamps(false);
+}
+
+TEST_F(VisualNPipelineTest, latencyBudgetWithCorrectedTimestampsStaged) {
+  processImagesWithCorrectedTimestamps(true);
+}
+
+TEST_F(VisualNPipelineTest, buildNFramesStaged) {
+  this->constructNCamera(2, 2, 100, true);
+  ASSERT_TRUE(pipeline_->isStaged());
+
+  // Build n frames out of order.
+  pipeline_->processImage(0, getImageFromCamera(0), 0);
+  pipeline_->processImage(0, getImageFromCamera(0), 1000);
+  pipeline_->processImage(1, getImageFromCamera(1), 1);
+  pipeline_->processImage(1, getImageFromCamera(1), 1001);
+  pipeline_->waitForAllWorkToComplete();
+  ASSERT_EQ(2u, pipeline_->getNumFramesComplete());
+
+  std::shared_ptr<VisualNFrame> nframes = pipeline_->getNext();
+  ASSERT_TRUE(nframes.get() != NULL);
+  ASSERT_EQ(0, nframes->getFrame(0).getTimestampNanoseconds());
+  ASSERT_EQ(1, nframes->getFrame(1).getTimestampNanoseconds());
+  nframes = pipeline_->getNext();
+  ASSERT_TRUE(nframes.get() != NULL);
+  ASSERT_EQ(1000, nframes->getFrame(0).getTimestampNanoseconds());
+  ASSERT_EQ(1001, nframes->getFrame(1).getTimestampNanoseconds());
+
+  // Many images pass the bounded queues.
+  const int64_t kNumNFrames = 50;
+  for (int64_t i = 2; i < kNumNFrames + 2; ++i) {
+    pipeline_->processImage(0, getImageFromCamera(0), i * 1000);
+    pipeline_->processImage(1, getImageFromCamera(1), i * 1000 + 1);
+  }
+  pipeline_->waitForAllWorkToComplete();
+  EXPECT_EQ(static_cast<size_t>(kNumNFrames), pipeline_->getNumFramesComplete());
+
+  const VisualNPipeline::Stage kStages[] = {
+      VisualNPipeline::Stage::kPreprocessing, VisualNPipeline::Stage::kDetection,
+      VisualNPipeline::Stage::kExtraction, VisualNPipeline::Stage::kAssembly};
+  for (const VisualNPipeline::Stage stage : kStages) {
+    const VisualNPipeline::StageStatistics statistics = pipeline_->getStageStatistics(stage);
+    EXPECT_EQ(static_cast<size_t>(2 * (kNumNFrames + 2)), statistics.num_processed);
+    EXPECT_EQ(0u, statistics.queue_size);
+    EXPECT_GE(statistics.max_processing_time_seconds, statistics.mean_processing_time_seconds);
+    if (stage != VisualNPipeline::Stage::kPreprocessing) {
+      EXPECT_LE(statistics.max_queue_size, 1u);
+    }
+  }
+}
+
+TEST_F(VisualNPipelineTest, buildNFramesScheduled) {
+  this->constructNCamera(3, 1, 100);
+
+  // Cameras 0 and 1 share a worker set pinned to the first core, camera 2 has its own. With a
+  // single thread per set the images of a camera are processed in order.
+  VisualNPipeline::CameraSchedulingOptions options;
+  options.worker_sets.resize(2u);
+  options.worker_sets[0].cpu_cores.push_back(0);
+  options.camera_worker_sets = {0u, 0u, 1u};
+  options.camera_priority_weights = {2.0, 1.0, 1.0};
+  pipeline_.reset(new VisualNPipeline(options, pipelines_, camera_rig_, camera_rig_, 100));
+  ASSERT_TRUE(pipeline_->isScheduled());
+
+  const int64_t kNumNFrames = 50;
+  for (int64_t i = 0; i < kNumNFrames; ++i) {
+    for (size_t camera_index = 0u; camera_index < 3u; ++camera_index) {
+      pipeline_->processImage(camera_index, getImageFromCamera(camera_index),
+                              i * 1000 + static_cast<int64_t>(camera_index));
+    }
+  }
+  pipeline_->waitForAllWorkToComplete();
+  EXPECT_EQ(static_cast<size_t>(kNumNFrames), pipeline_->getNumFramesComplete());
+  std::shared_ptr<VisualNFrame> nframes = pipeline_->getNext();
+  ASSERT_TRUE(nframes.get() != NULL);
+  EXPECT_EQ(0, nframes->getFrame(0).getTimestampNanoseconds());
+  EXPECT_EQ(2, nframes->getFrame(2).getTimestampNanoseconds());
+
+  // Without a queue limit every image is processed.
+  for (size_t camera_index = 0u; camera_index < 3u; ++camera_index) {
+    const VisualNPipeline::CameraSchedulingStatistics statistics =
+        pipeline_->getCameraSchedulingStatistics(camera_index);
+    EXPECT_EQ(static_cast<size_t>(kNumNFrames), statistics.num_processed);
+    EXPECT_EQ(0u, statistics.num_queued);
+    EXPECT_EQ(0u, statistics.num_dropped);
+  }
+}
+
+TEST_F(VisualNPipelineTest, scheduledOverloadFollowsPriorityWeights) {
+  this->constructNCamera(2, 1, 100);
+  SlowVisualPipeline::ProcessingLog log;
+  const std::chrono::microseconds kProcessingTime(3000);
+  std::vector<VisualPipeline::Ptr> pipelines;
+  for (size_t camera_index = 0u; camera_index < 2u; ++camera_index) {
+    pipelines.push_back(std::make_shared<SlowVisualPipeline>(
+        camera_rig_->getCameraShared(camera_index), camera_index, kProcessingTime, &log));
+  }
+  VisualNPipeline::CameraSchedulingOptions options;
+  options.worker_sets.resize(1u);
+  options.camera_worker_sets = {0u, 0u};
+  options.camera_priority_weights = {4.0, 1.0};
+  options.max_queued_images_per_camera = 2u;
+  pipeline_.reset(new VisualNPipeline(options, pipelines, camera_rig_, camera_rig_, 100));
+
+  // Both cameras hand in an image every 4 ms, but the worker only processes one every 3 ms.
+  // Camera 0 is given 4/5 of the worker, which is more than it needs.
+  const int64_t kNumImages = 60;
+  const std::chrono::microseconds kImagePeriod(4000);
+  std::chrono::steady_clock::time_point next_image_time = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < kNumImages; ++i) {
+    std::this_thread::sleep_until(next_image_time);
+    next_image_time += kImagePeriod;
+    pipeline_->processImage(0u, getImageFromCamera(0u), i * 1000);
+    pipeline_->processImage(1u, getImageFromCamera(1u), i * 1000 + 1);
+  }
+  pipeline_->waitForAllWorkToComplete();
+
+  const VisualNPipeline::CameraSchedulingStatistics statistics_0 =
+      pipeline_->getCameraSchedulingStatistics(0u);
+  const VisualNPipeline::CameraSchedulingStatistics statistics_1 =
+      pipeline_->getCameraSchedulingStatistics(1u);
+  EXPECT_EQ(static_cast<size_t>(kNumImages), statistics_0.num_processed + statistics_0.num_dropped);
+  EXPECT_EQ(static_cast<size_t>(kNumImages), statistics_1.num_processed + statistics_1.num_dropped);
+  EXPECT_GE(statistics_0.num_processed, static_cast<size_t>(kNumImages * 9 / 10));
+  EXPECT_LT(2u * statistics_1.num_processed, statistics_0.num_processed);
+  EXPECT_GT(statistics_1.num_dropped, statistics_0.num_dropped);
+}
+
+TEST_F(VisualNPipelineTest, scheduledIdleCameraDoesNotBuildUpCredit) {
+  this->constructNCamera(2, 1, 100);
+  SlowVisualPipeline::ProcessingLog log;
+  const std::chrono::microseconds kProcessingTime(1000);
+  std::vector<VisualPipeline::Ptr> pipelines;
+  for (size_t camera_index = 0u; camera_index < 2u; ++camera_index) {
+    pipelines.push_back(std::make_shared<SlowVisualPipeline>(
+        camera_rig_->getCameraShared(camera_index), camera_index, kProcessingTime, &log));
+  }
+  VisualNPipeline::CameraSchedulingOptions options;
+  options.worker_sets.resize(1u);
+  options.camera_worker_sets = {0u, 0u};
+  pipeline_.reset(new VisualNPipeline(options, pipelines, camera_rig_, camera_rig_, 100));
+
+  // Only camera 0 is busy at first.
+  const int64_t kNumIdleImages = 20;
+  for (int64_t i = 0; i < kNumIdleImages; ++i) {
+    pipeline_->processImage(0u, getImageFromCamera(0u), i * 1000);
+  }
+  pipeline_->waitForAllWorkToComplete();
+
+  // Afterwards both cameras are busy and share the worker equally, instead of camera 1
+  // catching up with the images camera 0 processed while camera 1 was idle.
+  const int64_t kNumImages = 20;
+  for (int64_t i = kNumIdleImages; i < kNumIdleImages + kNumImages; ++i) {
+    pipeline_->processImage(0u, getImageFromCamera(0u), i * 1000);
+    pipeline_->processImage(1u, getImageFromCamera(1u), i * 1000 + 1);
+  }
+  pipeline_->waitForAllWorkToComplete();
+  ASSERT_EQ(static_cast<size_t>(kNumIdleImages + 2 * kNumImages), log.camera_indices.size());
+  const std::vector<size_t> first_shared_images(
+      log.camera_indices.begin() + kNumIdleImages,
+      log.camera_indices.begin() + kNumIdleImages + kNumImages / 2);
+  EXPECT_GE(std::count(first_shared_images.begin(), first_shared_images.end(), 0u),
+            static_cast<int>(kNumImages / 2 / 2 - 1));
+}
+
 ASLAM_UNITTEST_ENTRYPOINT